@@ -26,6 +26,18 @@ if [ "$1" = "c" ] ; then
   exit 0
 fi
 
+if [ "$1" = "host" ] ; then
+  echo "Building C for host..."
+  make -C c/host -j4
+  exit 0
+fi
+
+if [ "$1" = "clean_host" ] ; then
+  echo "Cleaning C host..."
+  make -C c/host clean
+  exit 0
+fi
+
 if [ "$1" = "cpp" ] ; then
   echo "Building C++..."
   make -C cpp -j4
@@ -0,0 +1,135 @@
+#include <libdragon.h>
+#include "arena.h"
+#include "memtrack.h"
+#include "thread.h"
+
+ArenaStats arenaFrame;
+ArenaStats arenaLast;
+ArenaStats arenaRun;
+
+// Heap blocks of allocations that did not fit, freed when the frame ends
+typedef struct ArenaSpill {
+  struct ArenaSpill* next;
+} ArenaSpill;
+
+static uint8_t* arenaBuffer;
+static size_t arenaSize;
+static size_t arenaUsed;
+static ArenaSpill* arenaSpills;
+static rspq_syncpoint_t arenaSyncs[ARENA_FRAMES];
+static bool arenaSynced[ARENA_FRAMES];
+static int arenaIndex;
+static THREAD_MUTEX(arenaLock); // Host job workers share the frame's buffer
+
+void arena_init() {
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  arenaBuffer = mem_malloc(ARENA_SIZE);
+  arenaSize = arenaBuffer ? ARENA_SIZE : 0;
+  if (!arenaBuffer) {
+    debugf("Arena buffer allocation failed\n");
+  }
+  arenaUsed = 0;
+  arenaSpills = NULL;
+  for (int i = 0; i < ARENA_FRAMES; ++i) {
+    arenaSynced[i] = false;
+  }
+  arenaIndex = 0;
+  memset(&arenaFrame, 0, sizeof(ArenaStats));
+  memset(&arenaLast, 0, sizeof(ArenaStats));
+  memset(&arenaRun, 0, sizeof(ArenaStats));
+}
+
+// Function to get scratch memory that stays valid until arena_frame_end, NULL on failure
+void* arena_alloc(size_t size) {
+  THREAD_LOCK(arenaLock);
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  arenaFrame.allocs++;
+  arenaFrame.bytes += size;
+  if (arenaUsed + size <= arenaSize) {
+    void* ptr = arenaBuffer + arenaUsed;
+    arenaUsed += size;
+    return ptr;
+  }
+
+  // Spill to the heap until the frame ends
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  ArenaSpill* spill = mem_malloc(ARENA_ALIGN + size);
+  if (!spill) {
+    debugf("Arena spill allocation failed\n");
+    return NULL;
+  }
+  spill->next = arenaSpills;
+  arenaSpills = spill;
+  arenaFrame.spills++;
+  return (uint8_t*)spill + ARENA_ALIGN;
+}
+
+// Function to grow the buffer to fit a frame of the given bytes, keeps the old one on failure
+static void arena_grow(size_t bytes) {
+  size_t size = arenaSize ? arenaSize : ARENA_SIZE;
+  while (size < bytes) {
+    size *= 2;
+  }
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  uint8_t* buffer = mem_malloc(size);
+  if (!buffer) {
+    debugf("Arena grow to %u bytes failed\n", (unsigned)size);
+    return;
+  }
+  mem_free(arenaBuffer);
+  arenaBuffer = buffer;
+  arenaSize = size;
+  arenaFrame.grows++;
+}
+
+// Function to free the frame's scratch memory once it is submitted, growing the buffer if it spilled
+void arena_frame_end() {
+  while (arenaSpills) {
+    ArenaSpill* next = arenaSpills->next;
+    mem_free(arenaSpills);
+    arenaSpills = next;
+  }
+  if (arenaFrame.spills) {
+    arena_grow(arenaFrame.bytes);
+  }
+  arenaUsed = 0;
+
+  // Frames still in flight, this one included, the RDP works on them while the CPU starts the next
+  arenaSyncs[arenaIndex] = rspq_syncpoint_new();
+  arenaSynced[arenaIndex] = true;
+  arenaIndex = (arenaIndex + 1) % ARENA_FRAMES;
+  for (int i = 0; i < ARENA_FRAMES; ++i) {
+    if (arenaSynced[i] && !rspq_syncpoint_check(arenaSyncs[i])) {
+      arenaFrame.inFlight++;
+    }
+  }
+
+  arenaFrame.frames = 1;
+  arenaRun.frames++;
+  arenaRun.allocs += arenaFrame.allocs;
+  arenaRun.bytes = arenaFrame.bytes > arenaRun.bytes ? arenaFrame.bytes : arenaRun.bytes;
+  arenaRun.spills += arenaFrame.spills;
+  arenaRun.grows += arenaFrame.grows;
+  arenaRun.inFlight += arenaFrame.inFlight;
+  arenaLast = arenaFrame;
+  memset(&arenaFrame, 0, sizeof(ArenaStats));
+}
+
+// Function to get the frames in flight per frame since arena_init, 0 when the CPU always waits for the RDP
+float arena_overlap() {
+  return arenaRun.frames ? (float)arenaRun.inFlight / (float)arenaRun.frames : 0.0f;
+}
+
+// Function to print the arena totals to the debug log as an `arena,` line
+void arena_dump() {
+  debugf("arena,size,frames,allocs,peak_bytes,spills,grows,in_flight\n");
+  debugf("arena,%lu,%lu,%lu,%lu,%lu,%lu,%.2f\n",
+    (unsigned long)arenaSize,
+    (unsigned long)arenaRun.frames,
+    (unsigned long)arenaRun.allocs,
+    (unsigned long)arenaRun.bytes,
+    (unsigned long)arenaRun.spills,
+    (unsigned long)arenaRun.grows,
+    arena_overlap()
+  );
+}
@@ -0,0 +1,52 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <libdragon.h>
+
+// Frames the overlap stat tracks, display_init asks for 3 display buffers
+#ifndef ARENA_FRAMES
+#define ARENA_FRAMES 3
+#endif
+
+// Starting bytes of the buffer, it grows to the largest frame after one spills
+#ifndef ARENA_SIZE
+#define ARENA_SIZE (32 * 1024)
+#endif
+
+#define ARENA_ALIGN 16
+
+/*
+  Per frame geometry arena for the tessellators.
+
+  Scratch vertices, indices and outlines come from one buffer with
+  arena_alloc, which only bumps a pointer, and are never freed one by one.
+  rdpq copies triangles into the command queue when they are submitted, so
+  the RDP never reads the arena and arena_frame_end reuses the buffer for the
+  next frame right away, nothing allocated may be kept past it. An allocation
+  that does not fit goes to the heap until the frame ends, then the buffer is
+  grown to the bytes the frame asked for so later frames fit.
+
+  arena_frame_end also checks an RSPQ syncpoint per frame, without waiting,
+  to count the earlier frames the RDP is still drawing while the CPU starts
+  the next one, which is how much CPU and RDP work overlaps.
+*/
+typedef struct {
+  uint32_t frames;
+  uint32_t allocs;
+  uint32_t bytes; // Asked for in the frame, in arenaRun the most any frame asked for
+  uint32_t spills; // Allocations that did not fit and went to the heap
+  uint32_t grows; // Frames that grew the buffer after spilling
+  uint32_t inFlight; // Earlier frames the RDP had not finished when the next one started
+} ArenaStats;
+
+extern ArenaStats arenaFrame;
+extern ArenaStats arenaLast;
+extern ArenaStats arenaRun; // Totals since arena_init, bytes is the largest frame
+
+void arena_init();
+void* arena_alloc(size_t size);
+void arena_frame_end();
+float arena_overlap();
+void arena_dump();
+
+#endif // ARENA_H
@@ -0,0 +1,147 @@
+#include <libdragon.h>
+#include "budget.h"
+
+const char* budgetPriorityNames[BUDGET_PRIORITY_COUNT] = {
+  [BUDGET_CRITICAL] = "critical",
+  [BUDGET_NORMAL]   = "normal",
+  [BUDGET_DETAIL]   = "detail",
+};
+
+THREAD_LOCAL BudgetStats budgetFrame[BUDGET_PRIORITY_COUNT];
+BudgetStats budgetLast[BUDGET_PRIORITY_COUNT];
+float budgetScale[BUDGET_PRIORITY_COUNT];
+uint32_t budgetTris;
+float budgetPixels;
+float budgetLoad;
+THREAD_LOCAL int budgetPriority;
+
+void budget_init() {
+  memset(budgetFrame, 0, sizeof(budgetFrame));
+  memset(budgetLast, 0, sizeof(budgetLast));
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    budgetScale[i] = 1.0f;
+  }
+  budgetLoad = 0.0f;
+  budgetPriority = BUDGET_NORMAL;
+  budget_set(BUDGET_TRIS, BUDGET_PIXELS);
+
+#ifdef N64_HOST
+  const char* tris = getenv("BUDGET_TRIS");
+  const char* pixels = getenv("BUDGET_PIXELS");
+  budget_set(tris && *tris ? strtoul(tris, NULL, 10) : budgetTris, pixels && *pixels ? strtof(pixels, NULL) : budgetPixels);
+#endif // N64_HOST
+}
+
+void budget_set(uint32_t tris, float pixels) {
+  budgetTris = tris > 0 ? tris : 1;
+  budgetPixels = pixels > 0.0f ? pixels : 1.0f;
+}
+
+// Function to get the priority of a shape of the given size in pixels, small normal shapes are detail
+int budget_size_priority(float size) {
+  if (budgetPriority == BUDGET_NORMAL && size < BUDGET_SMALL_SIZE) {
+    return BUDGET_DETAIL;
+  }
+  return budgetPriority;
+}
+
+// Function to count a shape drawn through the LOD policy, with what it would have cost at full detail
+void budget_lod(uint32_t fullTris, uint32_t tris) {
+  BudgetStats* s = &budgetFrame[budgetPriority];
+  s->lodTris += tris;
+  s->lodFullTris += fullTris;
+  if (budgetScale[budgetPriority] < 1.0f) {
+    s->degraded++;
+  }
+}
+
+/*
+  Function to close the frame and plan the next one. The triangles of shapes
+  without LOD are a fixed cost, what is left of the budget goes to the LOD
+  shapes from the most important priority down. A frame over its pixel
+  budget gets fewer triangles in proportion, as many as its full detail
+  count over the pixel load, so a few huge shapes degrade too. A priority that does not fit
+  gets its quality scaled so its segment counts, which grow with the square
+  root of the quality, fit what is left. The plan uses the full detail cost of
+  the last frame, so it does not swing back once degrading made room, and a
+  degraded priority is only restored when it fits within BUDGET_RESTORE.
+*/
+void budget_frame_end() {
+  memcpy(budgetLast, budgetFrame, sizeof(budgetFrame));
+  memset(budgetFrame, 0, sizeof(budgetFrame));
+
+  uint32_t tris = 0;
+  uint32_t fixedTris = 0;
+  float pixels = 0.0f;
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    tris += budgetLast[i].tris;
+    fixedTris += budgetLast[i].tris > budgetLast[i].lodTris ? budgetLast[i].tris - budgetLast[i].lodTris : 0;
+    pixels += budgetLast[i].pixels;
+  }
+  float pixelLoad = pixels / budgetPixels;
+  budgetLoad = fmaxf((float)tris / (float)budgetTris, pixelLoad);
+
+  // Triangles the frame may take, lowered by as much as it is over its fill
+  float fullTris = (float)fixedTris;
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    fullTris += (float)budgetLast[i].lodFullTris;
+  }
+  float room = (float)budgetTris;
+  if (pixelLoad > 1.0f) {
+    room = fminf(room, fullTris / pixelLoad);
+  }
+
+  float remaining = room - (float)fixedTris;
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    float need = (float)budgetLast[i].lodFullTris;
+    float fits = budgetScale[i] < 1.0f ? remaining * BUDGET_RESTORE : remaining;
+    float scale = 1.0f;
+    if (i != BUDGET_CRITICAL && need > 0.0f && need > fits) {
+      float share = remaining > 0.0f ? remaining / need : 0.0f;
+      scale = fmaxf(share * share, BUDGET_MIN_SCALE);
+    }
+    budgetScale[i] = scale;
+    remaining -= need * sqrtf(scale);
+  }
+}
+
+// Function to get the shapes drawn with a lowered LOD last frame
+uint32_t budget_degraded() {
+  uint32_t degraded = 0;
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    degraded += budgetLast[i].degraded;
+  }
+  return degraded;
+}
+
+void budget_draw_overlay(float x, float y) {
+  uint32_t tris = 0;
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    tris += budgetLast[i].tris;
+  }
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y,
+    "Budget %3.0f%% %4lu/%lu tris %3lu low",
+    budgetLoad * 100.0f,
+    (unsigned long)tris,
+    (unsigned long)budgetTris,
+    (unsigned long)budget_degraded()
+  );
+}
+
+// Function to print last frame's load to the debug log, one `budget,` line per priority
+void budget_dump() {
+  debugf("budget,priority,tris,lod_tris,lod_full_tris,pixels,scale,degraded\n");
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    const BudgetStats* s = &budgetLast[i];
+    debugf("budget,%s,%lu,%lu,%lu,%.0f,%.3f,%lu\n",
+      budgetPriorityNames[i],
+      (unsigned long)s->tris,
+      (unsigned long)s->lodTris,
+      (unsigned long)s->lodFullTris,
+      s->pixels,
+      budgetScale[i],
+      (unsigned long)s->degraded
+    );
+  }
+  debugf("budget,load,%lu,%.0f,%.3f\n", (unsigned long)budgetTris, budgetPixels, budgetLoad);
+}
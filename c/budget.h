@@ -0,0 +1,88 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <libdragon.h>
+#include "thread.h"
+
+// Default frame budget, the host reads BUDGET_TRIS and BUDGET_PIXELS
+#ifndef BUDGET_TRIS
+#define BUDGET_TRIS 2000
+#endif
+
+#ifndef BUDGET_PIXELS
+#define BUDGET_PIXELS (320 * 240 * 2)
+#endif
+
+#define BUDGET_MIN_SCALE 0.0625f // Lowest LOD quality scale a priority is degraded to
+#define BUDGET_SMALL_SIZE 8.0f // Normal shapes smaller than this many pixels count as detail
+#define BUDGET_RESTORE 0.9f // Share of the budget full detail must fit in before a priority is restored
+
+/*
+  Shapes are degraded in this order, critical ones never. Draw calls outside a
+  BUDGET_PRIORITY scope are normal, small normal shapes are treated as detail.
+*/
+typedef enum {
+  BUDGET_CRITICAL,
+  BUDGET_NORMAL,
+  BUDGET_DETAIL,
+  BUDGET_PRIORITY_COUNT
+} BUDGET_PRIORITIES;
+
+typedef struct {
+  uint32_t tris; // Triangles submitted
+  uint32_t lodTris; // Of those, triangles from shapes that go through the LOD policy
+  uint32_t lodFullTris; // What those shapes would have cost without degrading
+  float pixels; // Estimated fill, the area of every triangle
+  uint32_t degraded; // Shapes drawn with a lowered LOD
+} BudgetStats;
+
+extern const char* budgetPriorityNames[BUDGET_PRIORITY_COUNT];
+extern THREAD_LOCAL BudgetStats budgetFrame[BUDGET_PRIORITY_COUNT];
+extern BudgetStats budgetLast[BUDGET_PRIORITY_COUNT];
+extern float budgetScale[BUDGET_PRIORITY_COUNT];
+extern uint32_t budgetTris;
+extern float budgetPixels;
+extern float budgetLoad;
+extern THREAD_LOCAL int budgetPriority;
+
+void budget_init();
+void budget_set(uint32_t tris, float pixels);
+int budget_size_priority(float size);
+void budget_lod(uint32_t fullTris, uint32_t tris);
+void budget_frame_end();
+uint32_t budget_degraded();
+void budget_draw_overlay(float x, float y);
+void budget_dump();
+
+// Function to count one submitted triangle and its area for the current priority, see fillrate_tri
+static inline void budget_tri(float pixels) {
+  BudgetStats* s = &budgetFrame[budgetPriority];
+  s->tris++;
+  s->pixels += pixels;
+}
+
+// Function to count the area of a rectangle command, which is no triangle
+static inline void budget_rect(float pixels) {
+  budgetFrame[budgetPriority].pixels += pixels;
+}
+
+// Function to get the LOD quality scale of the current priority
+static inline float budget_scale() {
+  return budgetScale[budgetPriority];
+}
+
+// Function to set the priority of the rest of a scope, inner scopes win
+static inline int budget_priority_begin(int priority) {
+  int prev = budgetPriority;
+  budgetPriority = priority;
+  return prev;
+}
+
+static inline void budget_priority_end(int* prev) {
+  budgetPriority = *prev;
+}
+
+#define BUDGET_PRIORITY(priority) \
+  int __attribute__((cleanup(budget_priority_end), unused)) _budget_priority = budget_priority_begin(priority)
+
+#endif // BUDGET_H
@@ -0,0 +1,379 @@
+#include <libdragon.h>
+#include "bvh.h"
+#include "memtrack.h"
+
+static const Bounds bvhEmpty = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+
+// Half the perimeter of a box, what the heuristic weighs a node by
+static float bvh_cost(const Bounds* b) {
+  return (b->x1 - b->x0) + (b->y1 - b->y0);
+}
+
+void bvh_init(Bvh* bvh) {
+  memset(bvh, 0, sizeof(Bvh));
+}
+
+void bvh_free(Bvh* bvh) {
+  mem_free(bvh->items);
+  mem_free(bvh->order);
+  mem_free(bvh->nodes);
+  memset(bvh, 0, sizeof(Bvh));
+}
+
+// Function to remove every item and the tree, and keep the memory
+void bvh_clear(Bvh* bvh) {
+  bvh->itemCount = 0;
+  bvh->orderCount = 0;
+  bvh->nodeCount = 0;
+  bvh->depth = 0;
+  bvh->dirty = false;
+}
+
+// Function to add an item, returns its id, queries only find it after the next bvh_build
+int bvh_insert(Bvh* bvh, Bounds bounds, void* data) {
+  if (bvh->itemCount == bvh->itemCapacity) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    int capacity = bvh->itemCapacity ? bvh->itemCapacity * 2 : 64;
+    BvhItem* items = (BvhItem*)mem_realloc(bvh->items, sizeof(BvhItem) * capacity);
+    if (items == NULL) {
+      debugf("BVH item allocation failed\n");
+      return BVH_NONE;
+    }
+    bvh->items = items;
+    bvh->itemCapacity = capacity;
+  }
+  int id = bvh->itemCount++;
+  bvh->items[id].bounds = bounds;
+  bvh->items[id].data = data;
+  bvh->items[id].live = true;
+  return id;
+}
+
+// Function to move an item, the tree is refitted before the next query
+void bvh_update(Bvh* bvh, int id, Bounds bounds) {
+  if (id < 0 || id >= bvh->itemCount || !bvh->items[id].live) {
+    return;
+  }
+  bvh->items[id].bounds = bounds;
+  bvh->dirty = true;
+}
+
+// Function to take an item out of the queries, its slot is kept until bvh_clear
+void bvh_remove(Bvh* bvh, int id) {
+  if (id < 0 || id >= bvh->itemCount || !bvh->items[id].live) {
+    return;
+  }
+  bvh->items[id].bounds = bvhEmpty;
+  bvh->items[id].data = NULL;
+  bvh->items[id].live = false;
+  bvh->dirty = true;
+}
+
+typedef struct {
+  Bounds bounds;
+  int count;
+} BvhBin;
+
+// Function to split the items of a node at the cheapest of the bins along both axes, returns how many go left or 0 to keep it a leaf
+static int bvh_split(Bvh* bvh, const BvhNode* node) {
+  int* order = &bvh->order[node->first];
+  int count = node->count;
+
+  // Boxes are binned by their center, kept doubled
+  Bounds centers = bvhEmpty;
+  for (int i = 0; i < count; ++i) {
+    const Bounds* b = &bvh->items[order[i]].bounds;
+    float cx = b->x0 + b->x1;
+    float cy = b->y0 + b->y1;
+    centers.x0 = fminf(centers.x0, cx);
+    centers.y0 = fminf(centers.y0, cy);
+    centers.x1 = fmaxf(centers.x1, cx);
+    centers.y1 = fmaxf(centers.y1, cy);
+  }
+
+  float bestCost = INFINITY;
+  int bestAxis = -1, bestBin = 0;
+  for (int axis = 0; axis < 2; ++axis) {
+    float min = axis ? centers.y0 : centers.x0;
+    float extent = axis ? centers.y1 - centers.y0 : centers.x1 - centers.x0;
+    if (!(extent > 0.0f)) {
+      continue;
+    }
+    float scale = BVH_BINS / extent;
+
+    BvhBin bins[BVH_BINS];
+    for (int b = 0; b < BVH_BINS; ++b) {
+      bins[b].bounds = bvhEmpty;
+      bins[b].count = 0;
+    }
+    for (int i = 0; i < count; ++i) {
+      const Bounds* box = &bvh->items[order[i]].bounds;
+      float c = axis ? box->y0 + box->y1 : box->x0 + box->x1;
+      int b = (int)((c - min) * scale);
+      b = b < BVH_BINS ? b : BVH_BINS - 1;
+      bins[b].bounds = bounds_union(bins[b].bounds, *box);
+      bins[b].count++;
+    }
+
+    // Sweep from the right for the cost of every right side, then from the left
+    float rightCost[BVH_BINS];
+    Bounds right = bvhEmpty;
+    int rightCount = 0;
+    for (int b = BVH_BINS - 1; b > 0; --b) {
+      right = bounds_union(right, bins[b].bounds);
+      rightCount += bins[b].count;
+      rightCost[b] = rightCount ? rightCount * bvh_cost(&right) : INFINITY;
+    }
+    Bounds left = bvhEmpty;
+    int leftCount = 0;
+    for (int b = 0; b < BVH_BINS - 1; ++b) {
+      left = bounds_union(left, bins[b].bounds);
+      leftCount += bins[b].count;
+      float cost = leftCount ? leftCount * bvh_cost(&left) + rightCost[b + 1] : INFINITY;
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestBin = b;
+      }
+    }
+  }
+  if (bestAxis < 0) {
+    // Every center is at the same spot, nothing to split by
+    return 0;
+  }
+
+  float min = bestAxis ? centers.y0 : centers.x0;
+  float scale = BVH_BINS / (bestAxis ? centers.y1 - centers.y0 : centers.x1 - centers.x0);
+  int i = 0, j = count - 1;
+  while (i <= j) {
+    const Bounds* box = &bvh->items[order[i]].bounds;
+    float c = bestAxis ? box->y0 + box->y1 : box->x0 + box->x1;
+    int b = (int)((c - min) * scale);
+    if ((b < BVH_BINS ? b : BVH_BINS - 1) <= bestBin) {
+      i++;
+    } else {
+      int swap = order[i];
+      order[i] = order[j];
+      order[j--] = swap;
+    }
+  }
+  return i > 0 && i < count ? i : 0;
+}
+
+// Function to build the tree over every live item, from scratch
+void bvh_build(Bvh* bvh) {
+  MEM_TAG(MEM_TAG_SHAPES);
+
+  bvh->nodeCount = 0;
+  bvh->orderCount = 0;
+  bvh->depth = 0;
+  bvh->dirty = false;
+  if (bvh->itemCount == 0) {
+    return;
+  }
+
+  // A tree of n leaves has 2n - 1 nodes, at most one leaf per item
+  int* order = (int*)mem_realloc(bvh->order, sizeof(int) * bvh->itemCount);
+  if (order == NULL) {
+    debugf("BVH order allocation failed\n");
+    return;
+  }
+  bvh->order = order;
+  if (bvh->nodeCapacity < bvh->itemCount * 2) {
+    BvhNode* nodes = (BvhNode*)mem_realloc(bvh->nodes, sizeof(BvhNode) * bvh->itemCount * 2);
+    if (nodes == NULL) {
+      debugf("BVH node allocation failed\n");
+      return;
+    }
+    bvh->nodes = nodes;
+    bvh->nodeCapacity = bvh->itemCount * 2;
+  }
+  for (int id = 0; id < bvh->itemCount; ++id) {
+    if (bvh->items[id].live) {
+      order[bvh->orderCount++] = id;
+    }
+  }
+  if (bvh->orderCount == 0) {
+    return;
+  }
+
+  // Nodes hold their range of order until they are split
+  bvh->nodes[0] = (BvhNode){ bvhEmpty, 0, bvh->orderCount };
+  bvh->nodeCount = 1;
+  int stack[BVH_MAX_DEPTH + 1];
+  int depths[BVH_MAX_DEPTH + 1];
+  int top = 0;
+  stack[top] = 0;
+  depths[top++] = 1;
+  while (top > 0) {
+    top--;
+    BvhNode* node = &bvh->nodes[stack[top]];
+    int depth = depths[top];
+    bvh->depth = depth > bvh->depth ? depth : bvh->depth;
+    if (node->count <= BVH_LEAF_ITEMS || depth >= BVH_MAX_DEPTH) {
+      continue;
+    }
+    int leftCount = bvh_split(bvh, node);
+    if (leftCount == 0) {
+      continue;
+    }
+
+    int left = bvh->nodeCount;
+    bvh->nodes[left] = (BvhNode){ bvhEmpty, node->first, leftCount };
+    bvh->nodes[left + 1] = (BvhNode){ bvhEmpty, node->first + leftCount, node->count - leftCount };
+    bvh->nodeCount += 2;
+    node->first = left;
+    node->count = 0;
+
+    stack[top] = left;
+    depths[top++] = depth + 1;
+    stack[top] = left + 1;
+    depths[top++] = depth + 1;
+  }
+  bvh_refit(bvh);
+}
+
+// Function to fit every node around its items again, children always come after their parent
+void bvh_refit(Bvh* bvh) {
+  for (int i = bvh->nodeCount - 1; i >= 0; --i) {
+    BvhNode* node = &bvh->nodes[i];
+    if (node->count > 0) {
+      Bounds b = bvhEmpty;
+      for (int k = 0; k < node->count; ++k) {
+        b = bounds_union(b, bvh->items[bvh->order[node->first + k]].bounds);
+      }
+      node->bounds = b;
+    } else {
+      node->bounds = bounds_union(bvh->nodes[node->first].bounds, bvh->nodes[node->first + 1].bounds);
+    }
+  }
+  bvh->dirty = false;
+}
+
+static bool bvh_contains(const Bounds* outer, const Bounds* inner) {
+  return outer->x0 <= inner->x0 && outer->y0 <= inner->y0 && inner->x1 <= outer->x1 && inner->y1 <= outer->y1;
+}
+
+// Function to call visit for every item overlapping an area, returns how many
+static int bvh_visit(Bvh* bvh, const Bounds* area, void (*visit)(Bvh* bvh, int id, void* arg), void* arg) {
+  if (bvh->dirty) {
+    bvh_refit(bvh);
+  }
+  bvh->visited = 0;
+  if (bvh->nodeCount == 0) {
+    return 0;
+  }
+
+  // Nodes inside the area are pushed as ~index, nothing under them needs testing
+  int found = 0;
+  int stack[BVH_MAX_DEPTH + 1];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    int index = stack[--top];
+    bool inside = index < 0;
+    const BvhNode* node = &bvh->nodes[inside ? ~index : index];
+    bvh->visited++;
+    if (!inside) {
+      if (!bounds_overlap(&node->bounds, area)) {
+        continue;
+      }
+      inside = bvh_contains(area, &node->bounds);
+    }
+
+    if (node->count > 0) {
+      for (int k = 0; k < node->count; ++k) {
+        int id = bvh->order[node->first + k];
+        const BvhItem* item = &bvh->items[id];
+        if (item->live && (inside || bounds_overlap(&item->bounds, area))) {
+          visit(bvh, id, arg);
+          found++;
+        }
+      }
+    } else {
+      stack[top++] = inside ? ~(node->first + 1) : node->first + 1;
+      stack[top++] = inside ? ~node->first : node->first;
+    }
+  }
+  return found;
+}
+
+typedef struct {
+  int* ids;
+  int max;
+  int found;
+} BvhQuery;
+
+static void bvh_visit_ids(Bvh* bvh, int id, void* arg) {
+  BvhQuery* q = (BvhQuery*)arg;
+  if (q->found < q->max) {
+    q->ids[q->found] = id;
+  }
+  q->found++;
+}
+
+// Function to find the items whose box overlaps an area, returns how many, only the first max go to ids
+int bvh_query_rect(Bvh* bvh, Bounds area, int* ids, int max) {
+  BvhQuery q = { .ids = ids, .max = max };
+  bvh_visit(bvh, &area, bvh_visit_ids, &q);
+  return q.found;
+}
+
+typedef struct {
+  void (*visit)(void* data, void* arg);
+  void* arg;
+} BvhVisitor;
+
+static void bvh_visit_data(Bvh* bvh, int id, void* arg) {
+  BvhVisitor* v = (BvhVisitor*)arg;
+  v->visit(bvh->items[id].data, v->arg);
+}
+
+// Function to call visit with the data of every item overlapping an area, like drawing what is in view, returns how many
+int bvh_visit_rect(Bvh* bvh, Bounds area, void (*visit)(void* data, void* arg), void* arg) {
+  BvhVisitor v = { visit, arg };
+  return bvh_visit(bvh, &area, bvh_visit_data, &v);
+}
+
+// Function to pick the item closest to a point within radius, like the shape under a cursor, BVH_NONE for none
+int bvh_nearest(Bvh* bvh, Point p, float radius) {
+  if (bvh->dirty) {
+    bvh_refit(bvh);
+  }
+  bvh->visited = 0;
+  if (bvh->nodeCount == 0) {
+    return BVH_NONE;
+  }
+
+  // Depth first into the nearer child, skipping nodes further than the best so far
+  int best = BVH_NONE;
+  float bestSq = radius * radius;
+  int stack[BVH_MAX_DEPTH + 1];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const BvhNode* node = &bvh->nodes[stack[--top]];
+    bvh->visited++;
+    if (bounds_distance_sq(&node->bounds, p) > bestSq) {
+      continue;
+    }
+
+    if (node->count > 0) {
+      for (int k = 0; k < node->count; ++k) {
+        int id = bvh->order[node->first + k];
+        const BvhItem* item = &bvh->items[id];
+        float d = bounds_distance_sq(&item->bounds, p);
+        if (item->live && d <= bestSq) {
+          bestSq = d;
+          best = id;
+        }
+      }
+    } else {
+      float left = bounds_distance_sq(&bvh->nodes[node->first].bounds, p);
+      float right = bounds_distance_sq(&bvh->nodes[node->first + 1].bounds, p);
+      stack[top++] = left <= right ? node->first + 1 : node->first;
+      stack[top++] = left <= right ? node->first : node->first + 1;
+    }
+  }
+  return best;
+}
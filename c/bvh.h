@@ -0,0 +1,79 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <libdragon.h>
+#include "point.h"
+#include "spatial.h" // Bounds
+
+#define BVH_BINS 16 // Split candidates tried per axis when building
+#define BVH_LEAF_ITEMS 4 // Nodes with this many items or fewer are not split
+#define BVH_MAX_DEPTH 64
+#define BVH_NONE (-1)
+
+/*
+  Bounding volume hierarchy for culling and picking in large scenes of
+  shapes that mostly stay where they are, thousands of filled shapes of a
+  level or a map drawn through a view much smaller than it.
+
+  Items are boxes with a data pointer like in spatial.h, added with
+  bvh_insert and found by queries once bvh_build has sorted them into a
+  tree. Every node splits its items in two along the axis and position of
+  the lowest surface area heuristic cost, the perimeter of both halves
+  times their item count, tried at BVH_BINS positions per axis.
+
+  bvh_update only stores the new box of an item. Before the next query
+  the tree is refitted, every node box grows or shrinks around its items
+  again without changing which items it holds. That is a single pass over
+  the nodes, but shapes that move far from where they were at the build
+  leave boxes that overlap a lot, build again after large changes.
+
+  bvh_visit_rect calls back for every item whose box overlaps an area,
+  like the view of the screen, so only the visible shapes are tessellated
+  and drawn. Whole nodes inside the area are visited without testing
+  their items.
+*/
+
+typedef struct {
+  Bounds bounds;
+  void* data;
+  bool live;
+} BvhItem;
+
+// Leaves hold count items from first in order, other nodes have count 0 and their children at first and first + 1
+typedef struct {
+  Bounds bounds;
+  int first;
+  int count;
+} BvhNode;
+
+typedef struct {
+  BvhItem* items;
+  int itemCount; // Slots, live and removed
+  int itemCapacity;
+  int* order; // Items of the leaves, one leaf after the other
+  int orderCount;
+  BvhNode* nodes;
+  int nodeCount;
+  int nodeCapacity;
+  int depth; // Of the last build
+  bool dirty; // Items moved since the last refit
+  uint32_t visited; // Nodes visited by the last query
+} Bvh;
+
+void bvh_init(Bvh* bvh);
+void bvh_free(Bvh* bvh);
+void bvh_clear(Bvh* bvh);
+int bvh_insert(Bvh* bvh, Bounds bounds, void* data);
+void bvh_update(Bvh* bvh, int id, Bounds bounds);
+void bvh_remove(Bvh* bvh, int id);
+void bvh_build(Bvh* bvh);
+void bvh_refit(Bvh* bvh);
+int bvh_query_rect(Bvh* bvh, Bounds area, int* ids, int max);
+int bvh_visit_rect(Bvh* bvh, Bounds area, void (*visit)(void* data, void* arg), void* arg);
+int bvh_nearest(Bvh* bvh, Point p, float radius);
+
+static inline const BvhItem* bvh_item(const Bvh* bvh, int id) {
+  return &bvh->items[id];
+}
+
+#endif // BVH_H
@@ -0,0 +1,510 @@
+#include <libdragon.h>
+#include "collide.h"
+#include "memtrack.h"
+
+#define COLLIDE_EPSILON 1e-6f
+
+static float collide_clamp01(float v) {
+  return v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v;
+}
+
+// Function to get the closest points of two segments at s along the first and t along the second, returns their squared distance
+static float collide_closest(Point p1, Point q1, Point p2, Point q2, float* s, float* t, Point* c1, Point* c2) {
+  Point d1 = point_sub(&q1, &p1);
+  Point d2 = point_sub(&q2, &p2);
+  Point r = point_sub(&p1, &p2);
+  float a = point_dot(&d1, &d1);
+  float e = point_dot(&d2, &d2);
+  float f = point_dot(&d2, &r);
+
+  if (a <= COLLIDE_EPSILON && e <= COLLIDE_EPSILON) {
+    *s = *t = 0.0f;
+  } else if (a <= COLLIDE_EPSILON) {
+    *s = 0.0f;
+    *t = collide_clamp01(f / e);
+  } else {
+    float c = point_dot(&d1, &r);
+    if (e <= COLLIDE_EPSILON) {
+      *t = 0.0f;
+      *s = collide_clamp01(-c / a);
+    } else {
+      // Closest points of the infinite lines, then clamped to the segments one after the other
+      float b = point_dot(&d1, &d2);
+      float denom = a * e - b * b;
+      *s = denom != 0.0f ? collide_clamp01((b * f - c * e) / denom) : 0.0f;
+      *t = (b * *s + f) / e;
+      if (*t < 0.0f) {
+        *t = 0.0f;
+        *s = collide_clamp01(-c / a);
+      } else if (*t > 1.0f) {
+        *t = 1.0f;
+        *s = collide_clamp01((b - c) / a);
+      }
+    }
+  }
+
+  *c1 = point_new(p1.x + d1.x * *s, p1.y + d1.y * *s);
+  *c2 = point_new(p2.x + d2.x * *t, p2.y + d2.y * *t);
+  Point diff = point_sub(c2, c1);
+  return point_dot(&diff, &diff);
+}
+
+static void collide_project(const Point* points, size_t count, Point axis, float* min, float* max) {
+  *min = INFINITY;
+  *max = -INFINITY;
+  for (size_t i = 0; i < count; ++i) {
+    float d = point_dot(&points[i], &axis);
+    *min = fminf(*min, d);
+    *max = fmaxf(*max, d);
+  }
+}
+
+static Point collide_centroid(const Point* points, size_t count) {
+  Point c = point_default();
+  for (size_t i = 0; i < count; ++i) {
+    c.x += points[i].x;
+    c.y += points[i].y;
+  }
+  return point_new(c.x / count, c.y / count);
+}
+
+// Function to get the unit normal of the edge from point i to the next one, zero for a degenerate edge
+static Point collide_edge_normal(const Point* points, size_t count, size_t i) {
+  const Point* p = &points[i];
+  const Point* q = &points[(i + 1) % count];
+  Point normal = point_new(p->y - q->y, q->x - p->x);
+  return point_normalized(&normal);
+}
+
+// Function to get the vertex furthest along an axis, or against it when sign is negative
+static Point collide_support(const Point* points, size_t count, Point axis, float sign) {
+  size_t best = 0;
+  float bestDot = -INFINITY;
+  for (size_t i = 0; i < count; ++i) {
+    float d = sign * point_dot(&points[i], &axis);
+    if (d > bestDot) {
+      bestDot = d;
+      best = i;
+    }
+  }
+  return points[best];
+}
+
+// Function to test two convex polygons on the normals of all their edges, the axis of least overlap is the contact normal
+bool collide_polygons(const Point* a, size_t na, const Point* b, size_t nb, Contact* contact) {
+  if (na == 0 || nb == 0) {
+    return false;
+  }
+
+  float best = INFINITY;
+  Point bestAxis = point_default();
+  bool fromA = true;
+  for (int pass = 0; pass < 2; ++pass) {
+    const Point* points = pass == 0 ? a : b;
+    size_t count = pass == 0 ? na : nb;
+    for (size_t i = 0; i < count; ++i) {
+      Point axis = collide_edge_normal(points, count, i);
+      if (axis.x == 0.0f && axis.y == 0.0f) {
+        continue;
+      }
+      float minA, maxA, minB, maxB;
+      collide_project(a, na, axis, &minA, &maxA);
+      collide_project(b, nb, axis, &minB, &maxB);
+      float overlap = fminf(maxA, maxB) - fmaxf(minA, minB);
+      if (overlap <= 0.0f) {
+        return false;
+      }
+      if (overlap < best) {
+        best = overlap;
+        bestAxis = axis;
+        fromA = pass == 0;
+      }
+    }
+  }
+
+  Point ca = collide_centroid(a, na);
+  Point cb = collide_centroid(b, nb);
+  Point between = point_sub(&cb, &ca);
+  if (point_dot(&between, &bestAxis) < 0.0f) {
+    bestAxis = point_new(-bestAxis.x, -bestAxis.y);
+  }
+
+  // The deepest vertex of the polygon whose edge did not give the axis
+  contact->point = fromA ? collide_support(b, nb, bestAxis, -1.0f) : collide_support(a, na, bestAxis, 1.0f);
+  contact->normal = bestAxis;
+  contact->depth = best;
+  return true;
+}
+
+// Function to test two capsules, the radius changes linearly from one end to the other
+bool collide_capsules(Point a0, Point a1, float ra0, float ra1, Point b0, Point b1, float rb0, float rb1, Contact* contact) {
+  float s, t;
+  Point ca, cb;
+  float distSq = collide_closest(a0, a1, b0, b1, &s, &t, &ca, &cb);
+  float ra = ra0 + (ra1 - ra0) * s;
+  float radius = ra + rb0 + (rb1 - rb0) * t;
+  if (distSq >= radius * radius) {
+    return false;
+  }
+
+  float dist = sqrtf(distSq);
+  Point normal;
+  if (dist > COLLIDE_EPSILON) {
+    normal = point_new((cb.x - ca.x) / dist, (cb.y - ca.y) / dist);
+  } else {
+    // Crossing segments, push out along the normal of the first one
+    Point d = point_sub(&a1, &a0);
+    Point perpendicular = point_new(-d.y, d.x);
+    normal = point_normalized(&perpendicular);
+    if (normal.x == 0.0f && normal.y == 0.0f) {
+      normal = point_new(1.0f, 0.0f);
+    }
+  }
+
+  contact->depth = radius - dist;
+  contact->normal = normal;
+  contact->point = point_new(ca.x + normal.x * (ra - contact->depth * 0.5f), ca.y + normal.y * (ra - contact->depth * 0.5f));
+  return true;
+}
+
+// Function to test a capsule against a convex polygon with SAT, using the larger end radius all along the capsule
+bool collide_capsule_polygon(Point a, Point b, float ra, float rb, const Point* points, size_t count, Contact* contact) {
+  if (count == 0) {
+    return false;
+  }
+  float radius = fmaxf(ra, rb);
+  Point segment[2] = { a, b };
+
+  // The edge normals, the normal of the segment and the axis from the nearest vertex to the segment
+  float best = INFINITY;
+  Point bestAxis = point_default();
+  float nearestSq = INFINITY;
+  Point nearestAxis = point_default();
+  for (size_t i = 0; i <= count + 1; ++i) {
+    Point axis;
+    if (i < count) {
+      axis = collide_edge_normal(points, count, i);
+      float s, t;
+      Point onSegment, onPoint;
+      float distSq = collide_closest(a, b, points[i], points[i], &s, &t, &onSegment, &onPoint);
+      if (distSq < nearestSq) {
+        nearestSq = distSq;
+        nearestAxis = point_sub(&onPoint, &onSegment);
+      }
+    } else if (i == count) {
+      Point d = point_sub(&b, &a);
+      Point perpendicular = point_new(-d.y, d.x);
+      axis = point_normalized(&perpendicular);
+    } else {
+      axis = point_normalized(&nearestAxis);
+    }
+    if (axis.x == 0.0f && axis.y == 0.0f) {
+      continue;
+    }
+
+    float minA, maxA, minB, maxB;
+    collide_project(segment, 2, axis, &minA, &maxA);
+    collide_project(points, count, axis, &minB, &maxB);
+    float overlap = fminf(maxA + radius, maxB) - fmaxf(minA - radius, minB);
+    if (overlap <= 0.0f) {
+      return false;
+    }
+    if (overlap < best) {
+      best = overlap;
+      bestAxis = axis;
+    }
+  }
+
+  Point ca = point_lerp(&a, &b, 0.5f);
+  Point cb = collide_centroid(points, count);
+  Point between = point_sub(&cb, &ca);
+  if (point_dot(&between, &bestAxis) < 0.0f) {
+    bestAxis = point_new(-bestAxis.x, -bestAxis.y);
+  }
+
+  // From the end of the segment closest to the polygon, the middle when both are as close
+  float da = point_dot(&a, &bestAxis);
+  float db = point_dot(&b, &bestAxis);
+  Point deepest = fabsf(da - db) < COLLIDE_EPSILON ? ca : da > db ? a : b;
+  contact->depth = best;
+  contact->normal = bestAxis;
+  contact->point = point_new(deepest.x + bestAxis.x * (radius - best * 0.5f), deepest.y + bestAxis.y * (radius - best * 0.5f));
+  return true;
+}
+
+static Bounds collide_bounds(const Collider* c) {
+  if (c->type == COLLIDER_POLYGON) {
+    return bounds_of_points(c->points, c->count);
+  }
+  float radius = fmaxf(c->ra, c->rb);
+  return (Bounds){
+    fminf(c->a.x, c->b.x) - radius,
+    fminf(c->a.y, c->b.y) - radius,
+    fmaxf(c->a.x, c->b.x) + radius,
+    fmaxf(c->a.y, c->b.y) + radius,
+  };
+}
+
+// Function to test two colliders of any type, the normal points from a to b
+bool collide_test(const Collider* a, const Collider* b, Contact* contact) {
+  if (a->type == COLLIDER_CAPSULE && b->type == COLLIDER_CAPSULE) {
+    return collide_capsules(a->a, a->b, a->ra, a->rb, b->a, b->b, b->ra, b->rb, contact);
+  }
+  if (a->type == COLLIDER_POLYGON && b->type == COLLIDER_POLYGON) {
+    return collide_polygons(a->points, a->count, b->points, b->count, contact);
+  }
+  if (a->type == COLLIDER_CAPSULE) {
+    return collide_capsule_polygon(a->a, a->b, a->ra, a->rb, b->points, b->count, contact);
+  }
+  if (!collide_capsule_polygon(b->a, b->b, b->ra, b->rb, a->points, a->count, contact)) {
+    return false;
+  }
+  contact->normal = point_new(-contact->normal.x, -contact->normal.y);
+  return true;
+}
+
+void collide_world_init(CollisionWorld* world) {
+  memset(world, 0, sizeof(CollisionWorld));
+}
+
+void collide_world_free(CollisionWorld* world) {
+  mem_free(world->colliders);
+  mem_free(world->boxes);
+  mem_free(world->boxOf);
+  mem_free(world->bandBoxes);
+  mem_free(world->bandStart);
+  mem_free(world->pairs);
+  memset(world, 0, sizeof(CollisionWorld));
+}
+
+static int collide_add(CollisionWorld* world, const Collider* collider) {
+  MEM_TAG(MEM_TAG_SHAPES);
+
+  if (world->count == world->capacity) {
+    int capacity = world->capacity ? world->capacity * 2 : 64;
+    Collider* colliders = (Collider*)mem_realloc(world->colliders, sizeof(Collider) * capacity);
+    CollideBox* boxes = colliders ? (CollideBox*)mem_realloc(world->boxes, sizeof(CollideBox) * capacity) : NULL;
+    int* boxOf = boxes ? (int*)mem_realloc(world->boxOf, sizeof(int) * capacity) : NULL;
+    if (colliders) {
+      world->colliders = colliders;
+    }
+    if (boxes) {
+      world->boxes = boxes;
+    }
+    if (boxOf == NULL) {
+      debugf("Collider allocation failed\n");
+      return -1;
+    }
+    world->boxOf = boxOf;
+    world->capacity = capacity;
+  }
+
+  int id = world->count++;
+  world->colliders[id] = *collider;
+  world->boxes[id].bounds = collide_bounds(collider);
+  world->boxes[id].id = id;
+  world->boxOf[id] = id;
+  world->unsorted = true;
+  return id;
+}
+
+// Function to add a convex polygon whose points stay owned by the caller, returns its id
+int collide_add_polygon(CollisionWorld* world, const Point* points, size_t count, void* data, int group, int index) {
+  Collider c = { .type = COLLIDER_POLYGON, .points = points, .count = count, .data = data, .group = group, .index = index };
+  return collide_add(world, &c);
+}
+
+// Function to add a capsule from a to b with the radius ra at a and rb at b, returns its id
+int collide_add_capsule(CollisionWorld* world, Point a, Point b, float ra, float rb, void* data, int group, int index) {
+  Collider c = { .type = COLLIDER_CAPSULE, .a = a, .b = b, .ra = ra, .rb = rb, .data = data, .group = group, .index = index };
+  return collide_add(world, &c);
+}
+
+void collide_set_polygon(CollisionWorld* world, int id, const Point* points, size_t count) {
+  if (id < 0 || id >= world->count) {
+    return;
+  }
+  Collider* c = &world->colliders[id];
+  c->points = points;
+  c->count = count;
+  world->boxes[world->boxOf[id]].bounds = collide_bounds(c);
+}
+
+void collide_set_capsule(CollisionWorld* world, int id, Point a, Point b, float ra, float rb) {
+  if (id < 0 || id >= world->count) {
+    return;
+  }
+  Collider* c = &world->colliders[id];
+  c->a = a;
+  c->b = b;
+  c->ra = ra;
+  c->rb = rb;
+  world->boxes[world->boxOf[id]].bounds = collide_bounds(c);
+}
+
+static int collide_box_compare(const void* a, const void* b) {
+  float xa = ((const CollideBox*)a)->bounds.x0;
+  float xb = ((const CollideBox*)b)->bounds.x0;
+  return xa < xb ? -1 : xa > xb;
+}
+
+// Function to put the boxes back in order along x, a full sort after colliders were added
+static void collide_sort(CollisionWorld* world) {
+  CollideBox* boxes = world->boxes;
+  if (world->unsorted) {
+    qsort(boxes, world->count, sizeof(CollideBox), collide_box_compare);
+    world->unsorted = false;
+  } else {
+    for (int i = 1; i < world->count; ++i) {
+      CollideBox box = boxes[i];
+      int j = i - 1;
+      while (j >= 0 && boxes[j].bounds.x0 > box.bounds.x0) {
+        boxes[j + 1] = boxes[j];
+        j--;
+      }
+      boxes[j + 1] = box;
+    }
+  }
+  for (int i = 0; i < world->count; ++i) {
+    world->boxOf[boxes[i].id] = i;
+  }
+}
+
+// Function to keep a pair from the sweep unless it is two neighbours of one group
+static void collide_candidate(CollisionWorld* world, int a, int b) {
+  const Collider* ca = &world->colliders[a];
+  const Collider* cb = &world->colliders[b];
+  world->stats.candidates++;
+  if (ca->group != COLLIDE_NO_GROUP && ca->group == cb->group && abs(ca->index - cb->index) <= COLLIDE_NEIGHBORS) {
+    return;
+  }
+
+  if (world->pairCount == world->pairCapacity) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    int capacity = world->pairCapacity ? world->pairCapacity * 2 : 256;
+    CollisionPair* pairs = (CollisionPair*)mem_realloc(world->pairs, sizeof(CollisionPair) * capacity);
+    if (pairs == NULL) {
+      debugf("Collision pair allocation failed\n");
+      return;
+    }
+    world->pairs = pairs;
+    world->pairCapacity = capacity;
+  }
+  world->pairs[world->pairCount].a = a < b ? a : b;
+  world->pairs[world->pairCount].b = a < b ? b : a;
+  world->pairCount++;
+}
+
+// Function to copy the boxes in x order into every band they cover, false when out of memory
+static bool collide_bands(CollisionWorld* world) {
+  const CollideBox* boxes = world->boxes;
+  float top = INFINITY, bottom = -INFINITY;
+  for (int i = 0; i < world->count; ++i) {
+    top = fminf(top, boxes[i].bounds.y0);
+    bottom = fmaxf(bottom, boxes[i].bounds.y1);
+  }
+  int bandCount = world->count && bottom >= top ? (int)fminf((bottom - top) / COLLIDE_BAND + 1.0f, COLLIDE_MAX_BANDS) : 1;
+  float scale = bandCount > 1 ? bandCount / (bottom - top + 1.0f) : 0.0f;
+
+  MEM_TAG(MEM_TAG_SHAPES);
+  if (bandCount > world->bandCapacity) {
+    int* bandStart = (int*)mem_realloc(world->bandStart, sizeof(int) * (COLLIDE_MAX_BANDS + 1));
+    if (bandStart == NULL) {
+      debugf("Collision band allocation failed\n");
+      return false;
+    }
+    world->bandStart = bandStart;
+    world->bandCapacity = COLLIDE_MAX_BANDS;
+  }
+  world->bandCount = bandCount;
+  int* bandStart = world->bandStart;
+  memset(bandStart, 0, sizeof(int) * (bandCount + 1));
+
+  // Count the boxes of every band, then place them in order
+  int total = 0;
+  for (int i = 0; i < world->count; ++i) {
+    int b0 = (int)((boxes[i].bounds.y0 - top) * scale);
+    int b1 = (int)((boxes[i].bounds.y1 - top) * scale);
+    b1 = b1 < bandCount ? b1 : bandCount - 1;
+    for (int b = b0; b <= b1; ++b) {
+      bandStart[b + 1]++;
+    }
+    total += b1 - b0 + 1;
+  }
+  for (int b = 0; b < bandCount; ++b) {
+    bandStart[b + 1] += bandStart[b];
+  }
+  if (total > world->bandBoxCapacity) {
+    int capacity = world->bandBoxCapacity ? world->bandBoxCapacity : 256;
+    while (capacity < total) {
+      capacity *= 2;
+    }
+    CollideBox* bandBoxes = (CollideBox*)mem_realloc(world->bandBoxes, sizeof(CollideBox) * capacity);
+    if (bandBoxes == NULL) {
+      debugf("Collision band allocation failed\n");
+      return false;
+    }
+    world->bandBoxes = bandBoxes;
+    world->bandBoxCapacity = capacity;
+  }
+  for (int i = 0; i < world->count; ++i) {
+    int b0 = (int)((boxes[i].bounds.y0 - top) * scale);
+    int b1 = (int)((boxes[i].bounds.y1 - top) * scale);
+    b1 = b1 < bandCount ? b1 : bandCount - 1;
+    for (int b = b0; b <= b1; ++b) {
+      CollideBox* box = &world->bandBoxes[bandStart[b]++];
+      *box = boxes[i];
+      box->band = b0;
+    }
+  }
+  // The counts moved every start to the next band
+  for (int b = bandCount; b > 0; --b) {
+    bandStart[b] = bandStart[b - 1];
+  }
+  bandStart[0] = 0;
+  return true;
+}
+
+// Function to find every touching pair, returns how many, only the first max go to pairs
+int collide_find(CollisionWorld* world, CollisionPair* pairs, int max) {
+  CollideStats* stats = &world->stats;
+  memset(stats, 0, sizeof(CollideStats));
+
+  uint32_t start = get_ticks();
+  collide_sort(world);
+  world->pairCount = 0;
+  if (collide_bands(world)) {
+    // Sweep every band along x, the boxes after one that start before it ends overlap it on x
+    for (int band = 0; band < world->bandCount; ++band) {
+      const CollideBox* boxes = &world->bandBoxes[world->bandStart[band]];
+      int count = world->bandStart[band + 1] - world->bandStart[band];
+      for (int i = 0; i < count; ++i) {
+        const CollideBox* a = &boxes[i];
+        for (int j = i + 1; j < count && boxes[j].bounds.x0 <= a->bounds.x1; ++j) {
+          const CollideBox* b = &boxes[j];
+          if (a->bounds.y0 <= b->bounds.y1 && b->bounds.y0 <= a->bounds.y1 && (a->band > b->band ? a->band : b->band) == band) {
+            collide_candidate(world, a->id, b->id);
+          }
+        }
+      }
+    }
+  }
+  uint32_t broad = get_ticks();
+  stats->broadTicks = broad - start;
+  stats->tests = world->pairCount;
+
+  int found = 0;
+  for (int i = 0; i < world->pairCount; ++i) {
+    const CollisionPair* pair = &world->pairs[i];
+    Contact contact;
+    if (collide_test(&world->colliders[pair->a], &world->colliders[pair->b], &contact)) {
+      if (found < max) {
+        pairs[found] = (CollisionPair){ pair->a, pair->b, contact };
+      }
+      found++;
+    }
+  }
+  stats->narrowTicks = get_ticks() - broad;
+  stats->contacts = found;
+  return found;
+}
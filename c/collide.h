@@ -0,0 +1,115 @@
+#ifndef COLLIDE_H
+#define COLLIDE_H
+
+#include <libdragon.h>
+#include "point.h"
+#include "spatial.h" // Bounds
+
+#define COLLIDE_BAND 64.0f // Height of the bands the sweep is split into, a few colliders tall
+#define COLLIDE_MAX_BANDS 1024 // Colliders further out share the first or last band
+#define COLLIDE_NO_GROUP (-1)
+#define COLLIDE_NEIGHBORS 2 // Colliders of one group this close in index always touch and are skipped
+
+/*
+  Collision detection between shapes and snake bodies.
+
+  A collider is either a convex polygon, like the outline of a fan or a
+  quad, or a capsule, a segment with a radius at each end like a snake link
+  between two joints with their bodyWidth.
+
+  collide_find sorts the boxes of all colliders along x and sweeps them
+  (sweep and prune), only boxes that overlap on both axes go on to the
+  exact tests. The boxes sit in one array in that order between calls, and
+  colliders move little from one frame to the next, so the insertion sort
+  that keeps them in order is close to one pass.
+
+  A sweep over the whole world compares every box with all the boxes in the
+  same columns, so the boxes are first copied, still in order, into every
+  horizontal band of COLLIDE_BAND they cover and each band is swept on its
+  own. A pair is kept only in the band of the lower of their tops, once.
+
+  The exact tests are SAT over the edge normals for two polygons, the
+  closest points of the segments for two capsules and SAT with the extra
+  axis of the closest polygon vertex for a capsule against a polygon. Every
+  pair that touches gives a contact with a point, the normal from the first
+  collider to the second and how deep they overlap.
+
+  Colliders of the same group, one snake, whose index is COLLIDE_NEIGHBORS
+  or closer always touch and are skipped, the rest of the body still
+  collides with itself.
+*/
+
+typedef enum {
+  COLLIDER_POLYGON,
+  COLLIDER_CAPSULE,
+} COLLIDER_TYPES;
+
+typedef struct {
+  int type;
+  const Point* points; // Polygon, convex, kept by the caller
+  size_t count;
+  Point a, b; // Capsule
+  float ra, rb;
+  void* data;
+  int group;
+  int index;
+} Collider;
+
+typedef struct {
+  Point point;
+  Point normal; // Unit, from the first collider to the second
+  float depth;
+} Contact;
+
+typedef struct {
+  int a, b; // Collider ids, a < b
+  Contact contact;
+} CollisionPair;
+
+typedef struct {
+  uint32_t candidates; // Pairs whose boxes overlap
+  uint32_t tests; // Of those, pairs tested exactly, not neighbours in a group
+  uint32_t contacts;
+  uint32_t broadTicks;
+  uint32_t narrowTicks;
+} CollideStats;
+
+// Box of a collider in the order of the sweep
+typedef struct {
+  Bounds bounds;
+  int id;
+  int band; // First band it covers
+} CollideBox;
+
+typedef struct {
+  Collider* colliders;
+  CollideBox* boxes; // Sorted along x by the last collide_find
+  int* boxOf; // Index in boxes of every collider
+  int count;
+  int capacity;
+  bool unsorted; // Colliders were added since the last sweep
+  CollideBox* bandBoxes; // The boxes of every band, one after the other
+  int bandBoxCapacity;
+  int* bandStart; // Of every band in bandBoxes, and the end of the last
+  int bandCount;
+  int bandCapacity;
+  CollisionPair* pairs; // Left by the broadphase for the exact tests
+  int pairCount;
+  int pairCapacity;
+  CollideStats stats; // Of the last collide_find
+} CollisionWorld;
+
+void collide_world_init(CollisionWorld* world);
+void collide_world_free(CollisionWorld* world);
+int collide_add_polygon(CollisionWorld* world, const Point* points, size_t count, void* data, int group, int index);
+int collide_add_capsule(CollisionWorld* world, Point a, Point b, float ra, float rb, void* data, int group, int index);
+void collide_set_polygon(CollisionWorld* world, int id, const Point* points, size_t count);
+void collide_set_capsule(CollisionWorld* world, int id, Point a, Point b, float ra, float rb);
+bool collide_test(const Collider* a, const Collider* b, Contact* contact);
+int collide_find(CollisionWorld* world, CollisionPair* pairs, int max);
+
+bool collide_polygons(const Point* a, size_t na, const Point* b, size_t nb, Contact* contact);
+bool collide_capsules(Point a0, Point a1, float ra0, float ra1, Point b0, Point b1, float rb0, float rb1, Contact* contact);
+bool collide_capsule_polygon(Point a, Point b, float ra, float rb, const Point* points, size_t count, Contact* contact);
+
+#endif // COLLIDE_H
@@ -9,12 +9,13 @@ Shape* curve2;
 int resetCurve;
 PointArray* bezierPoints;
 PointArray* basePoints;
+LodState curveLod, fillLod, baseLod; // One per curve so their counts are held separately
 
 void create_bezier(){
   // Curves are treat as strips
-  curve = (Shape*)malloc_uncached(sizeof(Shape));
+  curve = (Shape*)mem_malloc_uncached(sizeof(Shape));
   strip_init(curve, screenCenter, 20.0f, 20.0f, 2.0f, 10, RED);
-  curve2 = (Shape*)malloc_uncached(sizeof(Shape));
+  curve2 = (Shape*)mem_malloc_uncached(sizeof(Shape));
   strip_init(curve2, screenCenter, 20.0f, 20.0f, 2.0f, 10, GREEN);
 
   // Set up control points for transformable curve (curve)
@@ -27,7 +28,7 @@ void create_bezier(){
   };
   size_t numPoints = sizeof(points) / sizeof(points[0]);
 
-  bezierPoints = (PointArray*)malloc_uncached(sizeof(PointArray));
+  bezierPoints = (PointArray*)mem_malloc_uncached(sizeof(PointArray));
   if (!bezierPoints) {
     debugf("Failed to allocate bezierPoints\n");
     return;
@@ -44,11 +45,11 @@ void create_bezier(){
   };
   size_t numResets = sizeof(resets) / sizeof(resets[0]);
 
-  basePoints = (PointArray*)malloc_uncached(sizeof(PointArray));
+  basePoints = (PointArray*)mem_malloc_uncached(sizeof(PointArray));
   if (!basePoints) {
     debugf("Failed to allocate basePoints\n");
-    free(bezierPoints->points); // Clean up previously allocated memory
-    free(bezierPoints);
+    mem_free(bezierPoints->points); // Clean up previously allocated memory
+    mem_free(bezierPoints);
     return;
   }
   init_point_array_from_points(basePoints, resets, numResets);
@@ -113,32 +114,41 @@ void bezier_draw(){
     }
   }
 
-  // Transformable curve
+  // Transformable curve, currSegments caps what the LOD policy picks
   currShapeColor = get_fill_color(currShape);
   set_render_color(currShapeColor);
-  draw_bezier_curve(
-    &bezierPoints->points[0], &bezierPoints->points[1], &bezierPoints->points[2], &bezierPoints->points[3],
-    currSegments,
-    currAngle,
-    currThickness
-  );
+  {
+    LOD_SCOPE(&curveLod);
+    draw_bezier_curve(
+      &bezierPoints->points[0], &bezierPoints->points[1], &bezierPoints->points[2], &bezierPoints->points[3],
+      currSegments,
+      currAngle,
+      currThickness
+    );
+  }
 
   // Fill strips
   set_render_color(T_BLUE);
-  draw_filled_beziers(
-    &bezierPoints->points[0], &bezierPoints->points[1], &bezierPoints->points[2], &bezierPoints->points[3],
-    &basePoints->points[0], &basePoints->points[1], &basePoints->points[2], &basePoints->points[3],
-    currSegments
-  );
+  {
+    LOD_SCOPE(&fillLod);
+    draw_filled_beziers(
+      &bezierPoints->points[0], &bezierPoints->points[1], &bezierPoints->points[2], &bezierPoints->points[3],
+      &basePoints->points[0], &basePoints->points[1], &basePoints->points[2], &basePoints->points[3],
+      currSegments
+    );
+  }
 
   // Static curve
   set_render_color(get_fill_color(curve2));
-  draw_bezier_curve(
-    &basePoints->points[0], &basePoints->points[1], &basePoints->points[2], &basePoints->points[3],
-    currSegments,
-    0.0f,
-    currThickness
-  );
+  {
+    LOD_SCOPE(&baseLod);
+    draw_bezier_curve(
+      &basePoints->points[0], &basePoints->points[1], &basePoints->points[2], &basePoints->points[3],
+      currSegments,
+      0.0f,
+      currThickness
+    );
+  }
 
   // Control Points
   set_render_color(BLACK);
@@ -146,7 +156,8 @@ void bezier_draw(){
     draw_circle(bezierPoints->points[i].x, bezierPoints->points[i].y, 2.0f, 2.0f, currAngle, 0.01f);
   }
 
-  // Selected Control Point
+  // Selected Control Point, kept at full detail as the player is moving it
+  BUDGET_PRIORITY(BUDGET_CRITICAL);
   set_render_color(YELLOW);
   draw_circle(bezierPoints->points[controlPoint].x, bezierPoints->points[controlPoint].y, 1.5f, 1.5f, currAngle, 0.01f);
 
@@ -20,6 +20,7 @@
 
 #include <libdragon.h>
 #include "control.h"
+#include "../fixed.h"
 
 typedef struct {
     PointArray* joints;
@@ -37,14 +38,14 @@ void chain_init(Chain* chain, Point origin, size_t jointCount, int linkSize, flo
     chain->linkSize = linkSize;
 
     // Allocate memory for the PointArray structure itself
-    chain->joints = (PointArray*)malloc_uncached(sizeof(PointArray));
+    chain->joints = (PointArray*)mem_malloc_uncached(sizeof(PointArray));
     init_point_array(chain->joints);
 
     // Allocate memory for the initial point (origin)
     add_existing_point(chain->joints, origin);
 
     // Allocate memory for the angles array
-    chain->angles = (float*)malloc_uncached(sizeof(float) * (jointCount - 1));
+    chain->angles = (float*)mem_malloc_uncached(sizeof(float) * (jointCount - 1));
 
     Point offset = point_new(0, chain->linkSize);
 
@@ -57,6 +58,7 @@ void chain_init(Chain* chain, Point origin, size_t jointCount, int linkSize, flo
 }
 
 void chain_resolve(Chain* chain, Point pos) {
+    PROF_SCOPE(ZONE_SOLVE);
 
     // 0 length check
     if (chain->joints->count == 0) {
@@ -76,6 +78,27 @@ void chain_resolve(Chain* chain, Point pos) {
     Point* points = chain->joints->points;
     float* angles = chain->angles;
 
+#if POINT_FIXED
+    // Same steps in integers, the angles binary and unwrapped like the float ones, the last joint kept in s16.16
+    int32_t anchor = fixed_angle_from_float(angles[0]);
+    int32_t constraint = fixed_angle_from_float(precomputedConstraint);
+    fixed_t link = fixed_from_float(precomputedLinkSize);
+    fixed_t lastX = fixed_from_float(points[0].x);
+    fixed_t lastY = fixed_from_float(points[0].y);
+    for (size_t i = 1; i < chain->joints->count; i++) {
+        fixed_t dx = lastX - fixed_from_float(points[i].x);
+        fixed_t dy = lastY - fixed_from_float(points[i].y);
+
+        // Keeping 16 bits of the difference wraps it to half a turn either way
+        int32_t diff = (int16_t)(fixed_atan2(dy, dx) - anchor);
+        anchor += diff < -constraint ? -constraint : diff > constraint ? constraint : diff;
+        angles[i] = fixed_angle_to_float(anchor);
+
+        lastX -= fixed_mul(fixed_cos(anchor), link);
+        lastY -= fixed_mul(fixed_sin(anchor), link);
+        points[i] = point_new(fixed_to_float(lastX), fixed_to_float(lastY));
+    }
+#else
     // For every count except the first
     for (size_t i = 1; i < chain->joints->count; i++) {
         // Get the distance to the last point
@@ -91,9 +114,12 @@ void chain_resolve(Chain* chain, Point pos) {
         // Get next position from difference
         points[i] = point_sub(&points[i - 1], &offset);
     }
+#endif
 }
 
 void chain_fabrik_resolve(Chain* chain, Point pos, Point anchor){
+    PROF_SCOPE(ZONE_SOLVE);
+
     chain->joints->points[0] = pos;
 
     // Forward pass
@@ -5,9 +5,14 @@
 #include "control.h"
 
 Shape* circle;
+LodState circleLod; // Keeps the segment count steady while scaling
+
+// B cycles the texture of the circle: none, stretched over its bounds, then planar in screen space
+sprite_t* circleSprite;
+int circleTexMode;
 
 void create_circle(){
-  circle = (Shape*)malloc_uncached(sizeof(Shape));
+  circle = (Shape*)mem_malloc_uncached(sizeof(Shape));
   circle_init(circle, screenCenter, 20.0f, 0.05f, RED); 
 }
 
@@ -35,7 +40,15 @@ void circle_draw(){
   // Set render color and draw the circle
   currShapeColor = get_fill_color(currShape);
   set_render_color(currShapeColor);
+  LOD_SCOPE(&circleLod);
+  if (circleTexMode && circleSprite) {
+    TexMap map = circleTexMode == 1 ? texmap_bounds(circleSprite) : texmap_planar(circleSprite, point_default(), 1.0f);
+    set_render_texture(&map);
+  }
   draw_circle(currCenter.x, currCenter.y, currRadiusX, currRadiusY, currAngle, currLOD);
+  if (circleTexMode && circleSprite) {
+    set_render_texture(NULL);
+  }
 
   // Get the current points from the shape
   currPoints = get_points(currShape);
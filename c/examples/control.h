@@ -29,7 +29,7 @@ color_t currShapeColor;
 void shape_control_init() {
 
   // Allocate a dummy/control shape
-  currShape = (Shape*)malloc_uncached(sizeof(Shape));
+  currShape = (Shape*)mem_malloc_uncached(sizeof(Shape));
 
   // Initialize shape parameters
   shape_init(currShape);
@@ -38,7 +38,7 @@ void shape_control_init() {
   init_point_array(currShape->currPoints);
 
   // Allocate a dummy pointer array
-  currPoints = (PointArray*)malloc_uncached(sizeof(PointArray));
+  currPoints = (PointArray*)mem_malloc_uncached(sizeof(PointArray));
 
   // Populate the array using the previous one
   init_point_array_from_points(currPoints, currShape->currPoints->points, currShape->currPoints->count);
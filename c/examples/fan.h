@@ -8,7 +8,7 @@ Shape* fan;
 
 void create_fan(){
 // `fan` has only scale, whereas `fan2` has both X and Y scales
-  fan = (Shape*)malloc_uncached(sizeof(Shape));
+  fan = (Shape*)mem_malloc_uncached(sizeof(Shape));
   fan2_init(fan, screenCenter, 20.0f, 20.0f, 3, T_BLUE);
 }
 
@@ -57,7 +57,7 @@ void fan_draw(){
     Using set_points like from the circle example will
     clear the points of the Shape if not NULL.
   */
-  free(currPoints->points);
+  mem_free(currPoints->points);
 }
 
 
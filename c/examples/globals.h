@@ -3,13 +3,22 @@
 
 #include <libdragon.h>
 #include "../point.h"
+#include "../profiler.h"
+#include "../rdpcap.h"
+#include "../memtrack.h"
+#include "../lod.h"
+#include "../budget.h"
+#include "../fillrate.h"
+#include "../arena.h"
+#include "../thread.h"
 
 // Global variables
 surface_t disp;
-struct mallinfo mem_info;
-int ramUsed, totalRAM, ldRAM, example, triCount, vertCount, currVerts, currTris, fillTris;
+int ramUsed, totalRAM, example;
+THREAD_LOCAL int triCount, vertCount, currVerts, currTris, fillTris; // Per thread while host jobs run, see thread.h
 float stickX, stickY;
-uint64_t bootTime, firstTime, secondTime, dispTime, jpTime, drawTime;
+float cpuTime;
+bool showProfiler;
 uint32_t screenWidth, screenHeight, frameCounter;
 Point screenCenter;
 size_t controlPoint;
@@ -26,13 +35,8 @@ void accums_init(){
 // Initialize acummulators
   ramUsed = 0;
   totalRAM = 0;
-  ldRAM = 0;
-  bootTime= 0;
-  firstTime = 0;
-  secondTime = 0;
-  jpTime = 0;
-  dispTime = 0;
-  drawTime = 0;
+  cpuTime = 0.0f;
+  showProfiler = false;
   frameCounter = 0;
   example = 0;
   triCount = 0;
@@ -48,10 +52,6 @@ void accums_init(){
 void accums_reset(){
 // Initialize acummulators
   ramUsed = 0;
-  firstTime = 0;
-  secondTime = 0;
-  jpTime = 0;
-  dispTime = 0;
   triCount = 0;
   vertCount = 0;
   currTris = 0;
@@ -9,7 +9,7 @@ Shape* quad;
 
 void create_quad(){
 // Quad as a strip
-  quad = (Shape*)malloc_uncached(sizeof(Shape));
+  quad = (Shape*)mem_malloc_uncached(sizeof(Shape));
   strip_init(quad, screenCenter, 20.0f, 20.0f, 0.01f, 1, DARK_GREEN);
 }
 
@@ -20,6 +20,7 @@
 
 #include <libdragon.h>
 #include "chain.h"
+#include "../collide.h"
 
 #define SNAKE_SEGMENTS 32
 #define SNAKE_MAX_VERTS (SNAKE_SEGMENTS*4)
@@ -29,8 +30,13 @@ typedef struct {
     Point center;
     float* bodyWidth;
     color_t color;
+    CollisionWorld* world; // Optional, one capsule per link from firstCollider on
+    int firstCollider;
 } Snake;
 
+// Shade the bodies from their color at the head to a darker one at the tail, in one batch each
+bool snakeGradient;
+
 Snake* snake1;
 Point* snake1Verts;
 Point* snake1ShadowVerts;
@@ -50,12 +56,12 @@ Point* snake4ShadowVerts;
 void snake_init(Snake* snake, Point origin, int jointCount, color_t color) {
 
     // Allocate memory for the "spine" of the snake
-    snake->spine = (Chain*)malloc_uncached(sizeof(Chain));
+    snake->spine = (Chain*)mem_malloc_uncached(sizeof(Chain));
     chain_init(snake->spine, origin, jointCount, 4, M_PI / (jointCount/4)); 
 
     // Allocate an array of floats to hold the widths of different sections
-    snake->bodyWidth = (float*)malloc(sizeof(float) * jointCount); 
-    float* tempBodyWidth = (float*)malloc(sizeof(float) * jointCount);
+    snake->bodyWidth = (float*)mem_malloc(sizeof(float) * jointCount); 
+    float* tempBodyWidth = (float*)mem_malloc(sizeof(float) * jointCount);
 
     // First 4 widths shape the snake head
     snake->bodyWidth[0] = 4.5f;
@@ -73,10 +79,42 @@ void snake_init(Snake* snake, Point origin, int jointCount, color_t color) {
         snake->bodyWidth[i] = tempBodyWidth[i];
     }
 
-    free(tempBodyWidth);
+    mem_free(tempBodyWidth);
 
     snake->color = color;
+    snake->world = NULL;
+    snake->firstCollider = SPATIAL_NONE;
+
+}
 
+void snake_free(Snake* snake) {
+    mem_free(snake->bodyWidth);
+    mem_free(snake->spine->angles);
+    mem_free(snake->spine->joints->points);
+    mem_free(snake->spine->joints);
+    mem_free(snake->spine);
+    mem_free(snake);
+}
+
+// Function to give every link of the body a capsule in a collision world, as wide as the joints at its ends
+void snake_collide_add(Snake* snake, CollisionWorld* world, int group) {
+    const Point* joints = snake->spine->joints->points;
+    snake->world = world;
+    snake->firstCollider = world->count;
+    for (int i = 0; i < snake->spine->joints->count - 1; ++i) {
+        collide_add_capsule(world, joints[i], joints[i + 1], snake->bodyWidth[i], snake->bodyWidth[i + 1], snake, group, i);
+    }
+}
+
+// Function to move the capsules of the body to where the last resolve left the joints
+void snake_collide_update(Snake* snake) {
+    if (snake->world == NULL) {
+        return;
+    }
+    const Point* joints = snake->spine->joints->points;
+    for (int i = 0; i < snake->spine->joints->count - 1; ++i) {
+        collide_set_capsule(snake->world, snake->firstCollider + i, joints[i], joints[i + 1], snake->bodyWidth[i], snake->bodyWidth[i + 1]);
+    }
 }
 
 void snake_resolve(Snake* snake, float stickX, float stickY) {
@@ -114,6 +152,7 @@ void snake_resolve(Snake* snake, float stickX, float stickY) {
     direction = point_set_mag(&direction, move_mag);
     Point targetPos = point_sub(&headPos, &direction);
     chain_resolve(snake->spine, targetPos);
+    snake_collide_update(snake);
 }
 
 float snake_get_body_width(Snake* snake, int i) {
@@ -130,6 +169,10 @@ float snake_get_posY(Snake* snake, int i, float angleOffset, float lengthOffset)
 
 
 void draw_snake_shape(Snake* snake, Point* verts, Point* shadowVerts) {
+    RDPCAP_TAG(CAP_TAG_SNAKE);
+    MEM_TAG(MEM_TAG_TESSELLATION);
+    prof_begin(ZONE_TESSELLATE);
+
     int vertexCount = 0;
 
     Point* vertices = verts;
@@ -181,7 +224,10 @@ void draw_snake_shape(Snake* snake, Point* verts, Point* shadowVerts) {
         scaled_vertices[i] = point_scale(&center, &vertices[i], scale);
     }
 
-    // Draw drop shadow and snake body
+    prof_end(ZONE_TESSELLATE);
+
+    // Draw drop shadow and snake body, one color for the whole loop
+    set_render_color(T_BLACK);
     for (int i = 0; i < snake->spine->joints->count - 1; ++i) {
         float v1S[] = { scaled_vertices[i].x, scaled_vertices[i].y };
         float v2S[] = { scaled_vertices[i + 1].x, scaled_vertices[i + 1].y };
@@ -189,23 +235,34 @@ void draw_snake_shape(Snake* snake, Point* verts, Point* shadowVerts) {
         float v4S[] = { scaled_vertices[vertexCount - 2 - i].x, scaled_vertices[vertexCount - 2 - i].y };
 
         // Draw drop shadow
-        set_render_color(T_BLACK);
         draw_strip(v1S, v2S, v3S, v4S);
     }
 
     // It is necessary to draw the shadow and body in separate loops, or they interlace
+    set_render_color(snake->color);
+    if (snakeGradient) {
+        const PointArray* joints = snake->spine->joints;
+        color_t tail = RGBA32(snake->color.r / 3, snake->color.g / 3, snake->color.b / 3, snake->color.a);
+        Gradient body = gradient_linear(joints->points[0], joints->points[joints->count - 1], snake->color, tail);
+        set_render_gradient(&body);
+    }
     for (int i = 0; i < snake->spine->joints->count - 1; ++i) {
         // Draw snake body
         float v1[] = { vertices[i].x, vertices[i].y };
         float v2[] = { vertices[i + 1].x, vertices[i + 1].y };
         float v3[] = { vertices[vertexCount - 1 - i].x, vertices[vertexCount - 1 - i].y };
         float v4[] = { vertices[vertexCount - 2 - i].x, vertices[vertexCount - 2 - i].y };
-        
-        set_render_color(snake->color); 
         draw_strip(v1, v2, v3, v4);
     }
 
-    // Draw eyes
+    // Fringe along the whole outline, not the edges between the strips
+    draw_fringe(&(PointArray){ .points = vertices, .count = vertexCount });
+    if (snakeGradient) {
+        set_render_gradient(NULL);
+    }
+
+    // Draw eyes, the first thing to lose detail when over budget
+    BUDGET_PRIORITY(BUDGET_DETAIL);
     float rightEyeOffsetX = snake_get_posX(snake, 0, M_PI / 2, -2);
     float rightEyeOffsetY = snake_get_posY(snake, 0, M_PI / 2, -2);
     float leftEyeOffsetX = snake_get_posX(snake, 0, -M_PI / 2, -2);
@@ -221,25 +278,25 @@ void draw_snake_shape(Snake* snake, Point* verts, Point* shadowVerts) {
 }
 
 void init_snakes(){
-    snake1 = (Snake*)malloc_uncached(sizeof(Snake));
+    snake1 = (Snake*)mem_malloc_uncached(sizeof(Snake));
     snake_init(snake1, screenCenter, SNAKE_SEGMENTS, N_RED);
-    snake1Verts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
-    snake1ShadowVerts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake1Verts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake1ShadowVerts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
 
-    snake2 = (Snake*)malloc_uncached(sizeof(Snake));
+    snake2 = (Snake*)mem_malloc_uncached(sizeof(Snake));
     snake_init(snake2, screenCenter, SNAKE_SEGMENTS, N_GREEN);
-    snake2Verts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
-    snake2ShadowVerts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake2Verts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake2ShadowVerts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
 
-    snake3 = (Snake*)malloc_uncached(sizeof(Snake));
+    snake3 = (Snake*)mem_malloc_uncached(sizeof(Snake));
     snake_init(snake3, screenCenter, SNAKE_SEGMENTS, N_YELLOW);
-    snake3Verts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
-    snake3ShadowVerts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake3Verts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake3ShadowVerts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
 
-    snake4 = (Snake*)malloc_uncached(sizeof(Snake));
+    snake4 = (Snake*)mem_malloc_uncached(sizeof(Snake));
     snake_init(snake4, screenCenter, SNAKE_SEGMENTS, N_BLUE);
-    snake4Verts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
-    snake4ShadowVerts = malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake4Verts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
+    snake4ShadowVerts = mem_malloc(sizeof(Point) * SNAKE_MAX_VERTS);
 }
 
 void draw_snakes(){
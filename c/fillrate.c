@@ -0,0 +1,290 @@
+#include <libdragon.h>
+#include "fillrate.h"
+
+THREAD_LOCAL FillrateStats fillrateFrame[CAP_TAG_COUNT];
+FillrateStats fillrateLast[CAP_TAG_COUNT];
+FillrateStats fillrateRun[CAP_TAG_COUNT];
+float fillrateDrawn;
+float fillrateCovered;
+double fillrateRunDrawn;
+double fillrateRunCovered;
+#if FILLRATE_OVERDRAW
+THREAD_LOCAL uint32_t fillrateGrid[FILLRATE_GRID_H][(FILLRATE_GRID_W + 31) / 32];
+THREAD_LOCAL uint32_t fillrateHits;
+THREAD_LOCAL float fillrateSampleArea = FILLRATE_SAMPLE * FILLRATE_SAMPLE;
+#endif
+
+void fillrate_init() {
+  memset(fillrateFrame, 0, sizeof(fillrateFrame));
+  memset(fillrateLast, 0, sizeof(fillrateLast));
+  memset(fillrateRun, 0, sizeof(fillrateRun));
+#if FILLRATE_OVERDRAW
+  memset(fillrateGrid, 0, sizeof(fillrateGrid));
+  fillrateHits = 0;
+#endif
+  fillrateDrawn = fillrateCovered = 0.0f;
+  fillrateRunDrawn = fillrateRunCovered = 0.0;
+}
+
+#if FILLRATE_OVERDRAW
+// Function to get the pixels between grid samples, the grid spans targets larger than FILLRATE_WIDTH x FILLRATE_HEIGHT with sparser samples
+static void fillrate_grid_step(float width, float height, float* stepX, float* stepY) {
+  *stepX = fmaxf((float)FILLRATE_SAMPLE, width / FILLRATE_GRID_W);
+  *stepY = fmaxf((float)FILLRATE_SAMPLE, height / FILLRATE_GRID_H);
+  fillrateSampleArea = *stepX * *stepY;
+}
+
+// Function to mark the grid samples inside a triangle, counting every hit
+static void fillrate_cover(const float* v1, const float* v2, const float* v3, float minX, float minY, float maxX, float maxY, float stepX, float stepY) {
+  int sx0 = (int)ceilf(minX / stepX - 0.5f), sx1 = (int)floorf(maxX / stepX - 0.5f);
+  int sy0 = (int)ceilf(minY / stepY - 0.5f), sy1 = (int)floorf(maxY / stepY - 0.5f);
+  if (sx0 < 0) sx0 = 0;
+  if (sy0 < 0) sy0 = 0;
+  if (sx1 >= FILLRATE_GRID_W) sx1 = FILLRATE_GRID_W - 1;
+  if (sy1 >= FILLRATE_GRID_H) sy1 = FILLRATE_GRID_H - 1;
+
+  // Edge functions keep one sign inside, whichever way the triangle winds
+  float sign = (v2[0] - v1[0]) * (v3[1] - v1[1]) - (v3[0] - v1[0]) * (v2[1] - v1[1]) < 0.0f ? -1.0f : 1.0f;
+  for (int sy = sy0; sy <= sy1; ++sy) {
+    float py = (sy + 0.5f) * stepY;
+    for (int sx = sx0; sx <= sx1; ++sx) {
+      float px = (sx + 0.5f) * stepX;
+      float e0 = ((v2[0] - v1[0]) * (py - v1[1]) - (v2[1] - v1[1]) * (px - v1[0])) * sign;
+      float e1 = ((v3[0] - v2[0]) * (py - v2[1]) - (v3[1] - v2[1]) * (px - v2[0])) * sign;
+      float e2 = ((v1[0] - v3[0]) * (py - v3[1]) - (v1[1] - v3[1]) * (px - v3[0])) * sign;
+      if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+        fillrateHits++;
+        fillrateGrid[sy][sx >> 5] |= 1u << (sx & 31);
+      }
+    }
+  }
+}
+#endif
+
+// Function to get the scissor of the attached target, the RDP draws nothing outside it
+static void fillrate_scissor(float* width, float* height) {
+  const surface_t* target = rdpq_get_attached();
+  *width = target ? (float)target->width : (float)display_get_width();
+  *height = target ? (float)target->height : (float)display_get_height();
+}
+
+// Function to clip a polygon of count points to the half plane where the coordinate axis is on the side of limit, returns the points left
+static int fillrate_clip(const float* in, int count, float* out, int axis, float limit, float side) {
+  int n = 0;
+  for (int i = 0; i < count; ++i) {
+    const float* a = in + i * 2;
+    const float* b = in + ((i + 1) % count) * 2;
+    float da = (a[axis] - limit) * side, db = (b[axis] - limit) * side;
+    if (da >= 0.0f) {
+      out[n * 2] = a[0];
+      out[n * 2 + 1] = a[1];
+      n++;
+    }
+    if ((da >= 0.0f) != (db >= 0.0f)) {
+      float t = da / (da - db);
+      out[n * 2] = a[0] + (b[0] - a[0]) * t;
+      out[n * 2 + 1] = a[1] + (b[1] - a[1]) * t;
+      n++;
+    }
+  }
+  return n;
+}
+
+// Function to get the area and the y range of the part of a triangle inside the scissor, false when none of it is
+static bool fillrate_clip_tri(const float* v1, const float* v2, const float* v3, float width, float height, float* area, float* minY, float* maxY) {
+  // A triangle clipped by the four sides has at most 7 points
+  float poly[2][14] = { { v1[0], v1[1], v2[0], v2[1], v3[0], v3[1] } };
+  int count = 3;
+  count = fillrate_clip(poly[0], count, poly[1], 0, 0.0f, 1.0f);
+  count = fillrate_clip(poly[1], count, poly[0], 0, width, -1.0f);
+  count = fillrate_clip(poly[0], count, poly[1], 1, 0.0f, 1.0f);
+  count = fillrate_clip(poly[1], count, poly[0], 1, height, -1.0f);
+  if (count < 3) {
+    return false;
+  }
+  float twice = 0.0f;
+  *minY = *maxY = poly[0][1];
+  for (int i = 0; i < count; ++i) {
+    const float* a = poly[0] + i * 2;
+    const float* b = poly[0] + ((i + 1) % count) * 2;
+    twice += a[0] * b[1] - b[0] * a[1];
+    *minY = fminf(*minY, a[1]);
+    *maxY = fmaxf(*maxY, a[1]);
+  }
+  *area = fabsf(twice) * 0.5f;
+  return true;
+}
+
+// Function to count one submitted triangle for the current draw call, returns its area in pixels inside the scissor
+float fillrate_tri(const float* v1, const float* v2, const float* v3) {
+  float ax = v2[0] - v1[0], ay = v2[1] - v1[1];
+  float bx = v3[0] - v1[0], by = v3[1] - v1[1];
+  float cx = v3[0] - v2[0], cy = v3[1] - v2[1];
+  float area = fabsf(ax * by - bx * ay) * 0.5f;
+
+  float minY = fminf(v1[1], fminf(v2[1], v3[1]));
+  float maxY = fmaxf(v1[1], fmaxf(v2[1], v3[1]));
+  float minX = fminf(v1[0], fminf(v2[0], v3[0]));
+  float maxX = fmaxf(v1[0], fmaxf(v2[0], v3[0]));
+
+  // Height over the longest edge, how wide the triangle is where the RDP walks it
+  float edge = fmaxf(ax * ax + ay * ay, fmaxf(bx * bx + by * by, cx * cx + cy * cy));
+  float width = edge > 0.0f ? 2.0f * area / sqrtf(edge) : 0.0f;
+
+  FillrateStats* s = &fillrateFrame[capTag];
+  s->tris++;
+  if (width < FILLRATE_SLIVER) {
+    s->slivers++;
+  }
+
+  // Only what is inside the scissor is paid for, triangles crossing its sides are clipped to it
+  float scissorW, scissorH;
+  fillrate_scissor(&scissorW, &scissorH);
+  if (minX < 0.0f || minY < 0.0f || maxX > scissorW || maxY > scissorH) {
+    if (!fillrate_clip_tri(v1, v2, v3, scissorW, scissorH, &area, &minY, &maxY)) {
+      return 0.0f;
+    }
+  }
+  s->pixels += area;
+  s->spans += ceilf(maxY) - floorf(minY);
+
+#if FILLRATE_OVERDRAW
+  float stepX, stepY;
+  fillrate_grid_step(scissorW, scissorH, &stepX, &stepY);
+  fillrate_cover(v1, v2, v3, minX, minY, maxX, maxY, stepX, stepY);
+#endif
+  return area;
+}
+
+// Function to count one rectangle command for the current draw call, returns its area in pixels inside the scissor
+float fillrate_rect(float x0, float y0, float x1, float y1, bool fillMode) {
+  float scissorW, scissorH;
+  fillrate_scissor(&scissorW, &scissorH);
+  x0 = fmaxf(x0, 0.0f);
+  y0 = fmaxf(y0, 0.0f);
+  x1 = fminf(x1, scissorW);
+  y1 = fminf(y1, scissorH);
+  float area = fmaxf(x1 - x0, 0.0f) * fmaxf(y1 - y0, 0.0f);
+
+  FillrateStats* s = &fillrateFrame[capTag];
+  s->rects++;
+  s->pixels += area;
+  s->spans += fmaxf(y1 - y0, 0.0f);
+  if (fillMode) {
+    s->fillPixels += area;
+  }
+
+#if FILLRATE_OVERDRAW
+  float stepX, stepY;
+  fillrate_grid_step(scissorW, scissorH, &stepX, &stepY);
+  int sx0 = (int)ceilf(x0 / stepX - 0.5f), sx1 = (int)ceilf(x1 / stepX - 0.5f) - 1;
+  int sy0 = (int)ceilf(y0 / stepY - 0.5f), sy1 = (int)ceilf(y1 / stepY - 0.5f) - 1;
+  if (sx0 < 0) sx0 = 0;
+  if (sy0 < 0) sy0 = 0;
+  if (sx1 >= FILLRATE_GRID_W) sx1 = FILLRATE_GRID_W - 1;
+  if (sy1 >= FILLRATE_GRID_H) sy1 = FILLRATE_GRID_H - 1;
+  for (int sy = sy0; sy <= sy1; ++sy) {
+    for (int sx = sx0; sx <= sx1; ++sx) {
+      fillrateHits++;
+      fillrateGrid[sy][sx >> 5] |= 1u << (sx & 31);
+    }
+  }
+#endif
+  return area;
+}
+
+// Function to get the estimated RDP cost of some triangles in pixels, fill plus scanline setup
+float fillrate_cost(const FillrateStats* s) {
+  return s->pixels - s->fillPixels * (1.0f - 1.0f / FILLRATE_FILL_SPEED) + s->spans * FILLRATE_SPAN_COST;
+}
+
+// Function to add up the stats of every draw call
+void fillrate_total(const FillrateStats* stats, FillrateStats* total) {
+  memset(total, 0, sizeof(FillrateStats));
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    total->tris += stats[i].tris;
+    total->rects += stats[i].rects;
+    total->slivers += stats[i].slivers;
+    total->pixels += stats[i].pixels;
+    total->fillPixels += stats[i].fillPixels;
+    total->spans += stats[i].spans;
+  }
+}
+
+// Function to get last frame's overdraw, 1 when no pixel was drawn twice
+float fillrate_overdraw() {
+  return fillrateCovered > 0.0f ? fillrateDrawn / fillrateCovered : 1.0f;
+}
+
+void fillrate_frame_end() {
+#if FILLRATE_OVERDRAW
+  // Every sample stands for the pixels between samples of the last target drawn to
+  uint32_t samples = 0;
+  for (int y = 0; y < FILLRATE_GRID_H; ++y) {
+    for (int x = 0; x < (FILLRATE_GRID_W + 31) / 32; ++x) {
+      samples += __builtin_popcount(fillrateGrid[y][x]);
+    }
+  }
+  float drawn = (float)fillrateHits * fillrateSampleArea;
+  float covered = (float)samples * fillrateSampleArea;
+  fillrateDrawn = drawn;
+  fillrateCovered = covered;
+  fillrateHits = 0;
+  fillrateRunDrawn += drawn;
+  fillrateRunCovered += covered;
+  memset(fillrateGrid, 0, sizeof(fillrateGrid));
+#endif
+
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    fillrateRun[i].tris += fillrateFrame[i].tris;
+    fillrateRun[i].rects += fillrateFrame[i].rects;
+    fillrateRun[i].slivers += fillrateFrame[i].slivers;
+    fillrateRun[i].pixels += fillrateFrame[i].pixels;
+    fillrateRun[i].fillPixels += fillrateFrame[i].fillPixels;
+    fillrateRun[i].spans += fillrateFrame[i].spans;
+  }
+  memcpy(fillrateLast, fillrateFrame, sizeof(fillrateFrame));
+  memset(fillrateFrame, 0, sizeof(fillrateFrame));
+}
+
+void fillrate_draw_overlay(float x, float y) {
+  FillrateStats total;
+  fillrate_total(fillrateLast, &total);
+#if FILLRATE_OVERDRAW
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y,
+    "Fill %6.0fpx %4.2fx over %3lu thin",
+    fillrate_cost(&total),
+    fillrate_overdraw(),
+    (unsigned long)total.slivers
+  );
+#else
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y,
+    "Fill %6.0fpx %3lu thin",
+    fillrate_cost(&total),
+    (unsigned long)total.slivers
+  );
+#endif
+}
+
+// Function to print last frame's fill estimate to the debug log, one `fill,` line per draw call
+void fillrate_dump() {
+  debugf("fill,draw_call,tris,rects,slivers,pixels,spans,cost\n");
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    const FillrateStats* s = &fillrateLast[i];
+    if (s->tris == 0 && s->rects == 0) {
+      continue;
+    }
+    debugf("fill,%s,%lu,%lu,%lu,%.0f,%.0f,%.0f\n",
+      capTagNames[i],
+      (unsigned long)s->tris,
+      (unsigned long)s->rects,
+      (unsigned long)s->slivers,
+      s->pixels,
+      s->spans,
+      fillrate_cost(s)
+    );
+  }
+#if FILLRATE_OVERDRAW
+  debugf("fill,overdraw,%.0f,%.0f,%.3f\n", fillrateDrawn, fillrateCovered, fillrate_overdraw());
+#endif
+}
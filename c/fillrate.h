@@ -0,0 +1,77 @@
+#ifndef FILLRATE_H
+#define FILLRATE_H
+
+#include <libdragon.h>
+#include "rdpcap.h"
+
+// Overdraw from a coverage grid, a second rasterizer on the CPU, so off unless asked for (the host build turns it on)
+#ifndef FILLRATE_OVERDRAW
+#define FILLRATE_OVERDRAW 0
+#endif
+
+// Screen the coverage grid spans at FILLRATE_SAMPLE, it is stretched over larger targets
+#ifndef FILLRATE_WIDTH
+#define FILLRATE_WIDTH 320
+#endif
+
+#ifndef FILLRATE_HEIGHT
+#define FILLRATE_HEIGHT 240
+#endif
+
+#define FILLRATE_SAMPLE 2 // Coverage is sampled once per this many pixels in each direction
+#define FILLRATE_GRID_W (FILLRATE_WIDTH / FILLRATE_SAMPLE)
+#define FILLRATE_GRID_H (FILLRATE_HEIGHT / FILLRATE_SAMPLE)
+#define FILLRATE_SPAN_COST 4.0f // Rough RDP setup cost of one scanline of a triangle, in pixels
+#define FILLRATE_SLIVER 1.0f // Triangles thinner than this many pixels across their longest edge are slivers
+#define FILLRATE_FILL_SPEED 4.0f // Pixels per cycle of fill mode rectangles against 1 for the other modes
+
+/*
+  RDP fill cost estimated from the triangles as they are submitted.
+
+  Every triangle and rectangle adds its exact area and the scanlines it
+  spans inside the scissor of the attached target to the current draw call
+  (the RDPCAP_TAG), the parts the RDP scissors away cost nothing. The RDP
+  pays for every pixel of every triangle, covered or not, and for walking
+  each scanline, so slivers and overlapping strips cost more than their
+  triangle count says.
+
+  With FILLRATE_OVERDRAW=1 overdraw comes from a coarse coverage grid with
+  one sample every FILLRATE_SAMPLE pixels, sparser on targets larger than
+  the grid so it still spans all of them: the overdraw of a frame is the
+  samples hit over the samples hit at least once. Without it only the area
+  and spans are counted and fillrate_overdraw is 1. The host build has it
+  on and checks the estimates against what its rasterizer writes.
+*/
+typedef struct {
+  uint32_t tris;
+  uint32_t rects;
+  uint32_t slivers;
+  float pixels; // Area of the triangles and rectangles
+  float fillPixels; // Of those, pixels of fill mode rectangles
+  float spans; // Scanlines walked
+} FillrateStats;
+
+extern THREAD_LOCAL FillrateStats fillrateFrame[CAP_TAG_COUNT];
+extern FillrateStats fillrateLast[CAP_TAG_COUNT];
+extern FillrateStats fillrateRun[CAP_TAG_COUNT]; // Totals since fillrate_init
+#if FILLRATE_OVERDRAW
+extern THREAD_LOCAL uint32_t fillrateGrid[FILLRATE_GRID_H][(FILLRATE_GRID_W + 31) / 32]; // One bit per sample
+extern THREAD_LOCAL uint32_t fillrateHits; // Samples hit this frame, overlaps included
+extern THREAD_LOCAL float fillrateSampleArea; // Pixels a sample stands for on the last target drawn to
+#endif
+extern float fillrateDrawn; // On screen pixels drawn last frame, from the samples
+extern float fillrateCovered; // Of those, pixels covered at least once
+extern double fillrateRunDrawn;
+extern double fillrateRunCovered;
+
+void fillrate_init();
+float fillrate_tri(const float* v1, const float* v2, const float* v3);
+float fillrate_rect(float x0, float y0, float x1, float y1, bool fillMode);
+float fillrate_cost(const FillrateStats* s);
+void fillrate_total(const FillrateStats* stats, FillrateStats* total);
+float fillrate_overdraw();
+void fillrate_frame_end();
+void fillrate_draw_overlay(float x, float y);
+void fillrate_dump();
+
+#endif // FILLRATE_H
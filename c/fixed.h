@@ -0,0 +1,101 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+/*
+  s16.16 fixed point for the geometry math, selected at compile time with
+  POINT_FIXED=1 (make POINT_FIXED=1, the host build puts it in build_fixed).
+
+  The API stays float, a Point is still two floats. What changes is the
+  math inside the functions that do more than add and multiply: sqrt, sine,
+  cosine and atan2 in point.c and the C++ Point.cpp, the outlines of
+  draw_circle and render_get_ellipse_points, render_rotate_shape_points and
+  the joint loop of chain_resolve. They take their float arguments to
+  s16.16, work in integers and give floats back, the loops once per point
+  with one sine and cosine for all of them.
+
+  Angles inside are binary, FIXED_TURN units per turn, so wrapping one is
+  keeping its low 16 bits. Sine comes from a table of a quarter turn and
+  atan2 from a table of atan over [0, 1], both interpolated, the square root
+  is exact to the last bit. Positions have to stay within +-32767, lengths
+  and distances are computed in 64 bits so they can be as long as that.
+
+  Accuracy against the float build is checked on the host with the `fixed,`
+  line of ld_benchmark.c and golden_test.py --fixed. The host times are
+  x86 ones, where float is cheap, run the bench ROM to compare on the
+  VR4300.
+*/
+
+#ifndef POINT_FIXED
+#define POINT_FIXED 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_TURN 65536 // Binary angle units per turn
+#define FIXED_QUARTER (FIXED_TURN / 4)
+
+static inline fixed_t fixed_from_float(float v) {
+  return (fixed_t)(v * (float)FIXED_ONE);
+}
+
+static inline float fixed_to_float(fixed_t v) {
+  return (float)v * (1.0f / FIXED_ONE);
+}
+
+static inline fixed_t fixed_mul(fixed_t a, fixed_t b) {
+  return (fixed_t)(((int64_t)a * b) >> FIXED_SHIFT);
+}
+
+static inline fixed_t fixed_div(fixed_t a, fixed_t b) {
+  return (fixed_t)(((int64_t)a << FIXED_SHIFT) / b);
+}
+
+// Function to get a binary angle from radians, rounded to the nearest unit
+static inline int32_t fixed_angle_from_float(float radians) {
+  float units = radians * (FIXED_TURN / 6.28318530718f);
+  return (int32_t)(units + (units < 0.0f ? -0.5f : 0.5f));
+}
+
+static inline float fixed_angle_to_float(int32_t angle) {
+  return (float)angle * (6.28318530718f / FIXED_TURN);
+}
+
+extern const int32_t fixedSin[258];
+
+uint32_t fixed_isqrt64(uint64_t v);
+fixed_t fixed_sqrt(fixed_t v);
+fixed_t fixed_length(fixed_t x, fixed_t y);
+int32_t fixed_atan2(fixed_t y, fixed_t x);
+
+// Function to get the sine of a binary angle from the quarter turn table, mirrored for the other three
+static inline fixed_t fixed_sin(int32_t angle) {
+  uint32_t a = (uint32_t)angle & (FIXED_TURN - 1);
+  uint32_t quadrant = a / FIXED_QUARTER;
+  uint32_t within = a % FIXED_QUARTER;
+  if (quadrant & 1) {
+    within = FIXED_QUARTER - within;
+  }
+  // 64 angle units between table entries
+  int index = within >> 6;
+  int32_t frac = within & 63;
+  fixed_t s = fixedSin[index] + (((fixedSin[index + 1] - fixedSin[index]) * frac) >> 6);
+  return quadrant & 2 ? -s : s;
+}
+
+static inline fixed_t fixed_cos(int32_t angle) {
+  return fixed_sin(angle + FIXED_QUARTER);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FIXED_H
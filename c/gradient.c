@@ -0,0 +1,44 @@
+#include <libdragon.h>
+#include "gradient.h"
+
+Gradient gradient_linear(Point from, Point to, color_t c0, color_t c1) {
+  Gradient g = { .type = GRADIENT_LINEAR, .from = from, .c0 = c0, .c1 = c1 };
+  float dx = to.x - from.x, dy = to.y - from.y;
+  float len2 = dx * dx + dy * dy;
+  if (len2 > 0.0f) {
+    g.axis = point_new(dx / len2, dy / len2);
+  } else {
+    debugf("gradient_linear: from and to are the same point\n");
+  }
+  return g;
+}
+
+Gradient gradient_radial(Point center, float radius, color_t inner, color_t outer) {
+  Gradient g = { .type = GRADIENT_RADIAL, .from = center, .c0 = inner, .c1 = outer };
+  if (radius > 0.0f) {
+    g.invRadius = 1.0f / radius;
+  } else {
+    debugf("gradient_radial: radius must be positive\n");
+  }
+  return g;
+}
+
+// Function to get how far a position is from c0 to c1, clamped to 0 to 1
+float gradient_t(const Gradient* g, float x, float y) {
+  float dx = x - g->from.x, dy = y - g->from.y;
+  float t = g->type == GRADIENT_RADIAL
+    ? sqrtf(dx * dx + dy * dy) * g->invRadius
+    : dx * g->axis.x + dy * g->axis.y;
+  return fminf(fmaxf(t, 0.0f), 1.0f);
+}
+
+// Function to write the color at the position v[0], v[1] to v[2..5], the shade of TRIFMT_SHADE
+void gradient_shade(const Gradient* g, float* v) {
+  float t = gradient_t(g, v[0], v[1]);
+  float u = 1.0f - t;
+  const float scale = 1.0f / 255.0f;
+  v[2] = (g->c0.r * u + g->c1.r * t) * scale;
+  v[3] = (g->c0.g * u + g->c1.g * t) * scale;
+  v[4] = (g->c0.b * u + g->c1.b * t) * scale;
+  v[5] = (g->c0.a * u + g->c1.a * t) * scale;
+}
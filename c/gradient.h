@@ -0,0 +1,38 @@
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include <libdragon.h>
+#include "point.h"
+
+/*
+  Per vertex colors for the tessellators in render.c.
+
+  While a gradient is set with set_render_gradient, every vertex the
+  tessellators emit gets its RGBA from the gradient at the vertex position
+  and triangles go out as TRIFMT_SHADE with the shade combiner. A
+  multicolored shape is then one batch, with no prim color changes and
+  no syncs between its parts.
+
+  The RDP interpolates the colors linearly inside each triangle, so a
+  linear gradient is exact and a radial one is only exact at the vertices.
+*/
+typedef enum {
+  GRADIENT_LINEAR, // c0 up to from, c1 from to on, blended along the line between them
+  GRADIENT_RADIAL, // c0 at from, c1 at the radius and beyond
+} GRADIENT_TYPES;
+
+typedef struct {
+  int type;
+  Point from;
+  Point axis; // Linear: to - from over its squared length, so the dot product is 0 to 1
+  float invRadius; // Radial
+  color_t c0;
+  color_t c1;
+} Gradient;
+
+Gradient gradient_linear(Point from, Point to, color_t c0, color_t c1);
+Gradient gradient_radial(Point center, float radius, color_t inner, color_t outer);
+float gradient_t(const Gradient* g, float x, float y);
+void gradient_shade(const Gradient* g, float* v);
+
+#endif // GRADIENT_H
@@ -0,0 +1,235 @@
+#include <libdragon.h>
+#include <pthread.h>
+#include <sched.h>
+#include "cmdq.h"
+#include "host.h"
+#include "../fillrate.h"
+#include "../thread.h"
+
+#define CMDQ_PAD UINT32_MAX // Ticket of the filler up to the end of a ring
+
+// Front of every segment in a ring, followed by its recorded calls padded to 8 bytes
+typedef struct {
+  uint32_t ticket;
+  uint32_t size;
+} CmdqEntry;
+
+// Ring of one producer thread, head and tail count bytes and only grow
+typedef struct {
+  uint8_t* data;
+  uint64_t head __attribute__((aligned(64))); // Published by the producer
+  uint64_t tail __attribute__((aligned(64))); // Replayed by the render thread
+  uint32_t owned; // Claimed by a producer thread
+  HostCommands commands; // Calls of the segment being recorded
+} CmdqRing;
+
+CmdqStats cmdqRun;
+
+static CmdqRing cmdqRings[CMDQ_MAX_PRODUCERS];
+static uint32_t cmdqProducers; // Rings ever claimed since cmdq_reset, the ones cmdq_drain looks at
+static uint32_t cmdqTicket; // Next ticket handed out
+static uint32_t cmdqNext; // Next ticket to replay
+static uint32_t cmdqGeneration; // Bumped by cmdq_reset, rings claimed before are stale
+static RenderState cmdqState;
+
+// Fill stats of the render thread the producers add theirs to, THREAD_LOCAL so only reachable through pointers
+typedef struct {
+  FillrateStats* fill;
+  uint32_t* grid;
+  uint32_t* hits;
+  float* sampleArea;
+} CmdqTargets;
+
+static CmdqTargets cmdqTargets;
+static pthread_mutex_t cmdqMergeLock = PTHREAD_MUTEX_INITIALIZER;
+
+static THREAD_LOCAL CmdqRing* cmdqOwn;
+static THREAD_LOCAL uint32_t cmdqOwnGeneration;
+
+static size_t cmdq_entry_bytes(uint32_t size) {
+  return sizeof(CmdqEntry) + ((size + 7) & ~(size_t)7);
+}
+
+// Function to claim a free ring for this thread, NULL once all of them are taken
+static CmdqRing* cmdq_claim() {
+  uint32_t generation = __atomic_load_n(&cmdqGeneration, __ATOMIC_ACQUIRE);
+  if (cmdqOwn && cmdqOwnGeneration == generation) {
+    return cmdqOwn;
+  }
+
+  for (uint32_t i = 0; i < CMDQ_MAX_PRODUCERS; ++i) {
+    CmdqRing* ring = &cmdqRings[i];
+    uint32_t free = 0;
+    if (!__atomic_compare_exchange_n(&ring->owned, &free, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      continue;
+    }
+    if (!ring->data) {
+      ring->data = (uint8_t*)malloc(CMDQ_RING_BYTES);
+    }
+    uint32_t producers = __atomic_load_n(&cmdqProducers, __ATOMIC_RELAXED);
+    while (producers <= i && !__atomic_compare_exchange_n(&cmdqProducers, &producers, i + 1, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    cmdqOwn = ring;
+    cmdqOwnGeneration = generation;
+    return ring;
+  }
+  debugf("Command queue has no ring left for another producer\n");
+  return NULL;
+}
+
+// Function to set the attributes every segment starts from and returns to
+void cmdq_set_state(const RenderState* state) {
+  cmdqState = *state;
+  cmdqTargets = (CmdqTargets){
+    .fill = fillrateFrame,
+    .grid = &fillrateGrid[0][0],
+    .hits = &fillrateHits,
+    .sampleArea = &fillrateSampleArea,
+  };
+}
+
+// Function to add the fill stats of this producer to those of the render thread and clear them
+static void cmdq_merge() {
+  CmdqTargets* t = &cmdqTargets;
+  if (!t->fill) {
+    return;
+  }
+  pthread_mutex_lock(&cmdqMergeLock);
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    t->fill[i].tris += fillrateFrame[i].tris;
+    t->fill[i].rects += fillrateFrame[i].rects;
+    t->fill[i].slivers += fillrateFrame[i].slivers;
+    t->fill[i].pixels += fillrateFrame[i].pixels;
+    t->fill[i].fillPixels += fillrateFrame[i].fillPixels;
+    t->fill[i].spans += fillrateFrame[i].spans;
+  }
+  uint32_t* grid = &fillrateGrid[0][0];
+  for (size_t i = 0; i < sizeof(fillrateGrid) / sizeof(uint32_t); ++i) {
+    t->grid[i] |= grid[i];
+  }
+  *t->hits += fillrateHits;
+  *t->sampleArea = fillrateSampleArea;
+  pthread_mutex_unlock(&cmdqMergeLock);
+  memset(fillrateFrame, 0, sizeof(fillrateFrame));
+  memset(fillrateGrid, 0, sizeof(fillrateGrid));
+  fillrateHits = 0;
+}
+
+// Function to record the rdpq calls of this thread until cmdq_end instead of drawing them
+void cmdq_begin() {
+  CmdqRing* ring = cmdq_claim();
+  if (!ring) {
+    return;
+  }
+  ring->commands.size = 0;
+  host_commands_begin(&ring->commands);
+  render_set_state(&cmdqState);
+}
+
+// Function to submit the calls since cmdq_begin as one segment, waits while the ring is full
+void cmdq_end() {
+  CmdqRing* ring = cmdq_claim();
+  if (!ring) {
+    return;
+  }
+  render_restore_state(&cmdqState);
+  host_commands_end();
+
+  uint32_t size = (uint32_t)ring->commands.size;
+  size_t bytes = cmdq_entry_bytes(size);
+  if (bytes > CMDQ_RING_BYTES) {
+    debugf("Command queue segment of %u bytes does not fit its ring\n", size);
+    return;
+  }
+
+  // A segment never wraps, the rest of the ring is skipped instead
+  uint64_t head = ring->head;
+  size_t pos = head % CMDQ_RING_BYTES;
+  size_t pad = CMDQ_RING_BYTES - pos < bytes ? CMDQ_RING_BYTES - pos : 0;
+  if (CMDQ_RING_BYTES - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) < pad + bytes) {
+    __atomic_fetch_add(&cmdqRun.waits, 1, __ATOMIC_RELAXED);
+    while (CMDQ_RING_BYTES - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) < pad + bytes) {
+      sched_yield();
+    }
+  }
+  if (pad > 0) {
+    CmdqEntry* filler = (CmdqEntry*)(ring->data + pos);
+    filler->ticket = CMDQ_PAD;
+    filler->size = (uint32_t)(pad - sizeof(CmdqEntry));
+    pos = 0;
+  }
+
+  CmdqEntry* entry = (CmdqEntry*)(ring->data + pos);
+  entry->ticket = __atomic_fetch_add(&cmdqTicket, 1, __ATOMIC_RELAXED);
+  entry->size = size;
+  memcpy(entry + 1, ring->commands.data, size);
+  __atomic_store_n(&ring->head, head + pad + bytes, __ATOMIC_RELEASE);
+}
+
+// Function to give the ring of this thread to the next producer, what it submitted is still drained
+void cmdq_release() {
+  cmdq_merge();
+  if (cmdqOwn && cmdqOwnGeneration == __atomic_load_n(&cmdqGeneration, __ATOMIC_ACQUIRE)) {
+    __atomic_store_n(&cmdqOwn->owned, 0, __ATOMIC_RELEASE);
+  }
+  cmdqOwn = NULL;
+}
+
+// Function to replay the published segments in ticket order on the render thread, returns how many
+uint32_t cmdq_drain() {
+  uint32_t producers = __atomic_load_n(&cmdqProducers, __ATOMIC_ACQUIRE);
+  cmdqRun.producers = producers;
+  render_restore_state(&cmdqState);
+
+  uint32_t drained = 0;
+  for (bool progress = true; progress;) {
+    progress = false;
+    for (uint32_t i = 0; i < producers; ++i) {
+      CmdqRing* ring = &cmdqRings[i];
+      uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+      uint64_t tail = ring->tail;
+      while (tail < head) {
+        const CmdqEntry* entry = (const CmdqEntry*)(ring->data + tail % CMDQ_RING_BYTES);
+        if (entry->ticket == CMDQ_PAD) {
+          tail += cmdq_entry_bytes(entry->size);
+          continue;
+        }
+        if (entry->ticket != cmdqNext) {
+          break;
+        }
+        host_commands_replay((const uint8_t*)(entry + 1), entry->size);
+        cmdqRun.segments++;
+        cmdqRun.bytes += entry->size;
+        tail += cmdq_entry_bytes(entry->size);
+        cmdqNext++;
+        drained++;
+        progress = true;
+      }
+      __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+  }
+
+  if (cmdq_pending() > 0) {
+    cmdqRun.stalls++;
+  }
+  return drained;
+}
+
+// Function to get the segments handed a ticket but not replayed yet
+uint32_t cmdq_pending() {
+  return __atomic_load_n(&cmdqTicket, __ATOMIC_RELAXED) - cmdqNext;
+}
+
+// Function to empty the queue and release the rings, with no producer inside a segment
+void cmdq_reset() {
+  for (int i = 0; i < CMDQ_MAX_PRODUCERS; ++i) {
+    __atomic_store_n(&cmdqRings[i].head, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cmdqRings[i].tail, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cmdqRings[i].owned, 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&cmdqProducers, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&cmdqTicket, 0, __ATOMIC_RELAXED);
+  cmdqNext = 0;
+  memset(&cmdqRun, 0, sizeof(CmdqStats));
+  __atomic_fetch_add(&cmdqGeneration, 1, __ATOMIC_RELEASE);
+}
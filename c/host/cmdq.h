@@ -0,0 +1,54 @@
+#ifndef CMDQ_H
+#define CMDQ_H
+
+#include <libdragon.h>
+#include "../render.h"
+
+#define CMDQ_MAX_PRODUCERS 32
+#define CMDQ_RING_BYTES (256 * 1024) // Per producer, a multiple of 8
+
+/*
+  Lock free multi producer command queue of the host build, lets simulation
+  and tessellation threads submit draws while the render thread owns rdpq.
+
+  A producer wraps its draw calls in cmdq_begin and cmdq_end. Its rdpq calls
+  are recorded (host_commands_begin) instead of drawn, and cmdq_end copies
+  them as one segment into the ring of that thread. Every producer thread
+  has its own single producer ring, claimed on first use and handed back
+  with cmdq_release before the thread exits, so producers never wait on each
+  other, only on the render thread when their ring is full.
+
+  cmdq_end numbers every segment with a ticket from one atomic counter and
+  cmdq_drain on the render thread replays them in ticket order, taking the
+  next one from the front of whichever ring has it. It returns when the next
+  ticket is not published yet, the draws of one producer always come out in
+  the order it submitted them.
+
+  Segments start from the attributes of cmdq_set_state and put them back at
+  their end, like the jobs of jobs.h, so they can be replayed in any order.
+  Call cmdq_set_state and cmdq_reset only while no producer is inside
+  cmdq_begin/cmdq_end. The render thread must not be a producer itself. The
+  fill estimates of fillrate.h a producer makes are added to those of the
+  thread that called cmdq_set_state in cmdq_release, the other counters the
+  draws write (see thread.h) stay with the producer thread.
+*/
+
+typedef struct {
+  uint64_t segments; // Replayed by cmdq_drain
+  uint64_t bytes;
+  uint64_t waits; // Times a producer found its ring full
+  uint64_t stalls; // cmdq_drain calls that stopped at a ticket not published yet
+  uint32_t producers; // Rings in use since cmdq_reset
+} CmdqStats;
+
+extern CmdqStats cmdqRun; // Totals since cmdq_reset
+
+void cmdq_set_state(const RenderState* state);
+void cmdq_begin();
+void cmdq_end();
+void cmdq_release();
+uint32_t cmdq_drain();
+uint32_t cmdq_pending();
+void cmdq_reset();
+
+#endif // CMDQ_H
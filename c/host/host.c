@@ -0,0 +1,786 @@
+#include <libdragon.h>
+#include <stdarg.h>
+#include <time.h>
+#include "host.h"
+#include "raster.h"
+#include "../rdpcap.h"
+#include "../fillrate.h"
+
+const rdpq_trifmt_t TRIFMT_FILL = { .pos_offset = 0, .shade_offset = -1, .tex_offset = -1, .z_offset = -1 };
+const rdpq_trifmt_t TRIFMT_SHADE = { .pos_offset = 0, .shade_offset = 2, .tex_offset = -1, .z_offset = -1 };
+const rdpq_trifmt_t TRIFMT_TEX = { .pos_offset = 0, .shade_offset = -1, .tex_offset = 2, .z_offset = -1 };
+const rdpq_trifmt_t TRIFMT_SHADE_TEX = { .pos_offset = 0, .shade_offset = 2, .tex_offset = 6, .z_offset = -1 };
+
+#define HOST_BUFFERS 3
+
+static surface_t hostBuffers[HOST_BUFFERS];
+static int hostBufferCount;
+static int hostBufferIndex;
+static int hostWidth = 320;
+static int hostHeight = 240;
+
+static const surface_t* hostTarget;
+static const char* hostDumpDir;
+static const char* hostDumpFrames;
+static const char* hostHeatDir;
+static FILE* hostHeatLog;
+
+static uint32_t hostFrames;
+static uint32_t hostFrameLimit;
+static uint64_t hostLastShow;
+static float hostFps;
+
+// With HOST_RDP_FRAMES=<n> syncpoints complete n shows late, like an RDP running behind the CPU
+#define HOST_SYNC_HISTORY 16
+static uint32_t hostRdpFrames;
+static rspq_syncpoint_t hostSyncHistory[HOST_SYNC_HISTORY];
+
+// ====~ Stream ~==== //
+
+static FILE* hostStream;
+static THREAD_LOCAL uint8_t hostRecord[1024];
+static THREAD_LOCAL size_t hostRecordUsed;
+
+// Set on a host job worker, its calls are recorded here and drawn when the job is replayed
+static THREAD_LOCAL HostCommands* hostCommands;
+
+static void host_put_u8(uint8_t v) {
+  if (hostRecordUsed < sizeof(hostRecord)) {
+    hostRecord[hostRecordUsed++] = v;
+  }
+}
+
+static void host_put_u16(uint16_t v) {
+  host_put_u8(v >> 8);
+  host_put_u8(v & 0xFF);
+}
+
+static void host_put_u32(uint32_t v) {
+  host_put_u16(v >> 16);
+  host_put_u16(v & 0xFFFF);
+}
+
+static void host_put_f32(float f) {
+  uint32_t v;
+  memcpy(&v, &f, sizeof(v));
+  host_put_u32(v);
+}
+
+// Function to start a record, the payload size is patched in by host_record_end
+static void host_record_begin(int op) {
+  hostRecordUsed = 0;
+  host_put_u8(op);
+  host_put_u8(capTag);
+  host_put_u16(0);
+}
+
+// Function to finish a record, true when it went to the commands of a job and the call must not draw yet
+static bool host_record_end() {
+  uint16_t len = hostRecordUsed - 4;
+  hostRecord[2] = len >> 8;
+  hostRecord[3] = len & 0xFF;
+  if (hostCommands) {
+    if (hostCommands->size + hostRecordUsed > hostCommands->capacity) {
+      hostCommands->capacity = (hostCommands->capacity + hostRecordUsed) * 2;
+      hostCommands->data = (uint8_t*)realloc(hostCommands->data, hostCommands->capacity);
+    }
+    memcpy(hostCommands->data + hostCommands->size, hostRecord, hostRecordUsed);
+    hostCommands->size += hostRecordUsed;
+    return true;
+  }
+  if (hostStream) {
+    fwrite(hostRecord, 1, hostRecordUsed, hostStream);
+  }
+  return false;
+}
+
+static bool host_record_op(int op) {
+  host_record_begin(op);
+  return host_record_end();
+}
+
+bool host_stream_open(const char* path) {
+  host_stream_close();
+  hostStream = fopen(path, "wb");
+  if (!hostStream) {
+    debugf("Failed to open host stream %s\n", path);
+    return false;
+  }
+  hostRecordUsed = 0;
+  host_put_u8('H');
+  host_put_u8('S');
+  host_put_u8('T');
+  host_put_u8('R');
+  host_put_u16(HOST_STREAM_VERSION);
+  host_put_u16(hostWidth);
+  host_put_u16(hostHeight);
+  fwrite(hostRecord, 1, hostRecordUsed, hostStream);
+  return true;
+}
+
+void host_stream_close() {
+  if (hostStream) {
+    fclose(hostStream);
+    hostStream = NULL;
+  }
+}
+
+void host_set_frame_limit(uint32_t frames) {
+  hostFrameLimit = frames;
+}
+
+uint32_t host_frame_count() {
+  return hostFrames;
+}
+
+// Function to print the fill estimates of the whole run next to what the rasterizer wrote, as `fillcheck,` lines
+static void host_fill_report() {
+  // The last frame was drawn but not closed
+  fillrate_frame_end();
+
+  debugf("fillcheck,draw_call,estimated,rasterized,error_pct\n");
+  double estimated = 0.0;
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    double est = fillrateRun[i].pixels;
+    double exact = (double)rasterStats.pixels[i];
+    estimated += est;
+    if (fillrateRun[i].tris == 0 && fillrateRun[i].rects == 0 && exact == 0) {
+      continue;
+    }
+    debugf("fillcheck,%s,%.0f,%.0f,%.1f\n", capTagNames[i], est, exact, exact > 0 ? 100.0 * (est - exact) / exact : 0.0);
+  }
+  double written = (double)rasterStats.written;
+  debugf("fillcheck,total,%.0f,%.0f,%.1f\n", estimated, written, written > 0 ? 100.0 * (estimated - written) / written : 0.0);
+
+  double overdraw = fillrateRunCovered > 0 ? fillrateRunDrawn / fillrateRunCovered : 1.0;
+  double exactOverdraw = rasterStats.covered > 0 ? written / (double)rasterStats.covered : 1.0;
+  debugf("fillcheck,overdraw,%.3f,%.3f,%.1f\n", overdraw, exactOverdraw, 100.0 * (overdraw - exactOverdraw) / exactOverdraw);
+}
+
+static void host_heat_close() {
+  if (hostHeatLog) {
+    fclose(hostHeatLog);
+    hostHeatLog = NULL;
+  }
+}
+
+// Function to start the overdraw log, heat.csv gets a line per frame and heat_NNNN.ppm is saved for dumped frames
+static void host_heat_open(const char* dir) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/heat.csv", dir);
+  hostHeatLog = fopen(path, "w");
+  if (!hostHeatLog) {
+    debugf("Failed to open %s\n", path);
+    return;
+  }
+  hostHeatDir = dir;
+  fprintf(hostHeatLog, "frame,touched,writes,mean,max,over2_pct\n");
+  atexit(host_heat_close);
+}
+
+// Settings from the environment, so the unchanged main loops can be run as tools
+static void host_init_env() {
+  static bool done = false;
+  if (done) {
+    return;
+  }
+  done = true;
+
+  const char* stream = getenv("HOST_STREAM");
+  if (stream && *stream) {
+    host_stream_open(stream);
+  }
+  const char* frames = getenv("HOST_FRAMES");
+  if (frames && *frames) {
+    host_set_frame_limit(strtoul(frames, NULL, 10));
+  }
+  const char* dump = getenv("HOST_DUMP");
+  if (dump && *dump) {
+    hostDumpDir = dump;
+  }
+  hostDumpFrames = getenv("HOST_DUMP_FRAMES");
+  const char* rdpFrames = getenv("HOST_RDP_FRAMES");
+  if (rdpFrames && *rdpFrames) {
+    hostRdpFrames = strtoul(rdpFrames, NULL, 10) % HOST_SYNC_HISTORY;
+  }
+  const char* rasterThreads = getenv("HOST_RASTER_THREADS");
+  if (rasterThreads && *rasterThreads) {
+    raster_set_threads(strtol(rasterThreads, NULL, 10));
+  }
+  const char* heat = getenv("HOST_HEATMAP");
+  if (heat && *heat) {
+    host_heat_open(heat);
+  }
+  atexit(host_stream_close);
+  atexit(host_fill_report);
+}
+
+// ====~ Debug ~==== //
+
+void debug_init_isviewer(void) {}
+void debug_init_usblog(void) {}
+
+bool debug_init_sdfs(const char* prefix, int npart) {
+  (void)prefix;
+  (void)npart;
+  return true;
+}
+
+// ====~ Memory ~==== //
+
+void* malloc_uncached(size_t size) {
+  return malloc(size);
+}
+
+void free_uncached(void* buf) {
+  free(buf);
+}
+
+int get_memory_size(void) {
+  return 8 * 1024 * 1024;
+}
+
+// ====~ Timer ~==== //
+
+// Nanoseconds since the first call, so tick values stay small like after boot
+static uint64_t host_nanoseconds() {
+  static uint64_t base = 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  if (base == 0) {
+    base = now;
+  }
+  return now - base;
+}
+
+// Same tick rate as the console so profiler numbers read the same
+uint32_t get_ticks(void) {
+  return (uint32_t)(host_nanoseconds() * (TICKS_PER_SECOND / 1000) / 1000000ull);
+}
+
+uint64_t get_ticks_ms(void) {
+  return host_nanoseconds() / 1000000ull;
+}
+
+// ====~ Graphics ~==== //
+
+surface_t surface_alloc(tex_format_t format, uint16_t width, uint16_t height) {
+  int bpp = format == FMT_RGBA32 ? 4 : 2;
+  surface_t s = {
+    .flags = format,
+    .width = width,
+    .height = height,
+    .stride = width * bpp,
+    .buffer = calloc(height, width * bpp),
+  };
+  return s;
+}
+
+void surface_free(surface_t* surface) {
+  free(surface->buffer);
+  surface->buffer = NULL;
+}
+
+// There is no filesystem on the host, sprites are a checkerboard of the right size
+sprite_t* sprite_load(const char* fn) {
+  (void)fn;
+  sprite_t* sprite = (sprite_t*)malloc(sizeof(sprite_t));
+  sprite->width = 32;
+  sprite->height = 32;
+  uint32_t* texels = (uint32_t*)malloc(32 * 32 * sizeof(uint32_t));
+  for (int y = 0; y < 32; ++y) {
+    for (int x = 0; x < 32; ++x) {
+      texels[y * 32 + x] = ((x / 8 + y / 8) & 1) ? 0xFFFFFFFF : 0x202020FF;
+    }
+  }
+  sprite->data = texels;
+  return sprite;
+}
+
+void display_init(resolution_t res, int bitdepth, uint32_t num_buffers, int gamma, int filters) {
+  (void)bitdepth;
+  (void)gamma;
+  (void)filters;
+  host_init_env();
+  hostWidth = res.width;
+  hostHeight = res.height;
+  hostBufferCount = num_buffers > HOST_BUFFERS ? HOST_BUFFERS : num_buffers;
+  for (int i = 0; i < hostBufferCount; ++i) {
+    hostBuffers[i] = surface_alloc(FMT_RGBA16, hostWidth, hostHeight);
+  }
+  hostLastShow = host_nanoseconds();
+}
+
+surface_t* display_get(void) {
+  hostBufferIndex = (hostBufferIndex + 1) % hostBufferCount;
+  return &hostBuffers[hostBufferIndex];
+}
+
+int display_get_width(void) {
+  return hostWidth;
+}
+
+int display_get_height(void) {
+  return hostHeight;
+}
+
+float display_get_fps(void) {
+  return hostFps;
+}
+
+void display_set_fps_limit(float fps) {
+  (void)fps;
+}
+
+int dfs_init(uint32_t base_fs_loc) {
+  (void)base_fs_loc;
+  return 0;
+}
+
+// ====~ Joypad ~==== //
+
+void joypad_init(void) {}
+void joypad_poll(void) {}
+
+joypad_inputs_t joypad_get_inputs(joypad_port_t port) {
+  (void)port;
+  joypad_inputs_t inputs;
+  memset(&inputs, 0, sizeof(inputs));
+  return inputs;
+}
+
+joypad_buttons_t joypad_get_buttons_pressed(joypad_port_t port) {
+  (void)port;
+  joypad_buttons_t buttons = { .raw = 0 };
+  return buttons;
+}
+
+joypad_buttons_t joypad_get_buttons_held(joypad_port_t port) {
+  (void)port;
+  joypad_buttons_t buttons = { .raw = 0 };
+  return buttons;
+}
+
+// ====~ RSPQ ~==== //
+
+// Syncpoints handed out and the last one whose commands were drawn
+static rspq_syncpoint_t hostSyncpoints;
+static rspq_syncpoint_t hostSyncpointsDone;
+
+rspq_syncpoint_t rspq_syncpoint_new(void) {
+  hostSyncpoints++;
+  if (raster_pending() == 0 && hostFrames > 0) {
+    // Nothing queued since the last show, the syncpoint completes with that frame
+    hostSyncHistory[(hostFrames - 1) % HOST_SYNC_HISTORY] = hostSyncpoints;
+    if (hostRdpFrames == 0) {
+      hostSyncpointsDone = hostSyncpoints;
+    }
+  }
+  return hostSyncpoints;
+}
+
+bool rspq_syncpoint_check(rspq_syncpoint_t sync_id) {
+  return sync_id <= hostSyncpointsDone;
+}
+
+// Function to wait for a syncpoint, the queued commands are drawn right away like the RDP would
+void rspq_syncpoint_wait(rspq_syncpoint_t sync_id) {
+  if (!rspq_syncpoint_check(sync_id)) {
+    raster_flush((surface_t*)hostTarget);
+    hostSyncpointsDone = hostSyncpoints;
+  }
+}
+
+// Function to complete the syncpoints of the frame shown hostRdpFrames shows ago, hostFrames is this show
+static void host_sync_show() {
+  hostSyncHistory[hostFrames % HOST_SYNC_HISTORY] = hostSyncpoints;
+  if (hostRdpFrames == 0) {
+    hostSyncpointsDone = hostSyncpoints;
+  } else if (hostFrames >= hostRdpFrames) {
+    rspq_syncpoint_t done = hostSyncHistory[(hostFrames - hostRdpFrames) % HOST_SYNC_HISTORY];
+    hostSyncpointsDone = done > hostSyncpointsDone ? done : hostSyncpointsDone;
+  }
+}
+
+void host_rspq_write(uint32_t ovl_id, uint32_t cmd_id, int nargs, const uint32_t* args) {
+  host_record_begin(HOST_OP_RSPQ);
+  host_put_u32(ovl_id);
+  host_put_u32(cmd_id);
+  for (int i = 0; i < nargs; ++i) {
+    host_put_u32(args[i]);
+  }
+  if (host_record_end()) {
+    return;
+  }
+
+  // Fan vertices land in the TRI_DATA slots, each TRIANGLE draws next, last and center
+  static RasterVertex slots[3];
+  if (ovl_id == RDPQ_OVL_ID && cmd_id == RDPQ_CMD_TRIANGLE_DATA && nargs >= 5) {
+    uint32_t slot = args[0] / 32;
+    if (slot < 3) {
+      RasterVertex* v = &slots[slot];
+      v->x = (int16_t)(args[1] >> 16);
+      v->y = (int16_t)(args[1] & 0xFFFF);
+      v->r = args[3] >> 24;
+      v->g = (args[3] >> 16) & 0xFF;
+      v->b = (args[3] >> 8) & 0xFF;
+      v->a = args[3] & 0xFF;
+      v->s = (int16_t)(args[4] >> 16) / 32.0f;
+      v->t = (int16_t)(args[4] & 0xFFFF) / 32.0f;
+    }
+  } else if (ovl_id == RDPQ_OVL_ID && cmd_id == RDPQ_CMD_TRIANGLE) {
+    raster_triangle(&slots[0], &slots[1], &slots[2]);
+  }
+}
+
+// ====~ RDPQ ~==== //
+
+void rdpq_init(void) {
+  host_init_env();
+}
+
+void rdpq_attach(const surface_t* color, const surface_t* depth) {
+  (void)depth;
+  hostTarget = color;
+  host_record_begin(HOST_OP_ATTACH);
+  host_put_u16(color->width);
+  host_put_u16(color->height);
+  host_record_end();
+}
+
+const surface_t* rdpq_get_attached(void) {
+  return hostTarget;
+}
+
+// Function to check if a frame is in the HOST_DUMP_FRAMES list, every frame without one
+static bool host_dump_wanted(uint32_t frame) {
+  if (!hostDumpFrames || !*hostDumpFrames) {
+    return true;
+  }
+  const char* c = hostDumpFrames;
+  while (*c) {
+    char* end;
+    unsigned long n = strtoul(c, &end, 10);
+    if (end == c) {
+      break;
+    }
+    if (n == frame) {
+      return true;
+    }
+    c = *end == ',' ? end + 1 : end;
+  }
+  return false;
+}
+
+// Function to log the overdraw of the frame just drawn
+static void host_heat_frame() {
+  RasterHeat heat;
+  raster_heat(hostTarget, &heat);
+  fprintf(hostHeatLog, "%u,%u,%u,%.3f,%u,%.2f\n",
+    hostFrames,
+    heat.touched,
+    heat.writes,
+    heat.touched ? (double)heat.writes / heat.touched : 0.0,
+    heat.max,
+    heat.touched ? 100.0 * heat.over2 / heat.touched : 0.0
+  );
+  if (host_dump_wanted(hostFrames)) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/heat_%04u.ppm", hostHeatDir, hostFrames);
+    raster_write_heatmap(hostTarget, path);
+  }
+}
+
+void rdpq_detach_show(void) {
+  host_record_op(HOST_OP_SHOW);
+
+  raster_flush((surface_t*)hostTarget);
+  host_sync_show();
+  if (hostDumpDir && hostTarget && host_dump_wanted(hostFrames)) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame_%04u.ppm", hostDumpDir, hostFrames);
+    raster_write_ppm(hostTarget, path);
+  }
+  if (hostHeatLog && hostTarget) {
+    host_heat_frame();
+  }
+
+  uint64_t now = host_nanoseconds();
+  if (now > hostLastShow) {
+    hostFps = 1e9f / (float)(now - hostLastShow);
+  }
+  hostLastShow = now;
+
+  hostFrames++;
+  if (hostFrameLimit && hostFrames >= hostFrameLimit) {
+    exit(0);
+  }
+}
+
+void rdpq_clear(color_t color) {
+  host_record_begin(HOST_OP_CLEAR);
+  host_put_u32(color_to_packed32(color));
+  if (host_record_end()) {
+    return;
+  }
+  raster_clear(color);
+}
+
+void rdpq_clear_z(uint16_t z) {
+  host_record_begin(HOST_OP_CLEAR_Z);
+  host_put_u16(z);
+  host_record_end();
+}
+
+void rdpq_set_mode_standard(void) {
+  if (host_record_op(HOST_OP_MODE_STANDARD)) {
+    return;
+  }
+  raster_set_combiner(RASTER_COMB_FLAT);
+  raster_set_blend(false);
+  raster_set_fill_mode(false);
+}
+
+void rdpq_mode_combiner(rdpq_combiner_t comb) {
+  host_record_begin(HOST_OP_COMBINER);
+  host_put_u32((uint32_t)comb);
+  if (host_record_end()) {
+    return;
+  }
+  raster_set_combiner(comb >= RDPQ_COMBINER_FLAT && comb <= RDPQ_COMBINER_TEX_SHADE ? (int)(comb - RDPQ_COMBINER_FLAT) : RASTER_COMB_FLAT);
+}
+
+void rdpq_mode_blender(rdpq_blender_t blend) {
+  host_record_begin(HOST_OP_BLENDER);
+  host_put_u32(blend);
+  if (host_record_end()) {
+    return;
+  }
+  raster_set_blend(blend == RDPQ_BLENDER_MULTIPLY);
+}
+
+void rdpq_set_prim_color(color_t color) {
+  host_record_begin(HOST_OP_PRIM_COLOR);
+  host_put_u32(color_to_packed32(color));
+  if (host_record_end()) {
+    return;
+  }
+  raster_set_prim(color);
+}
+
+void rdpq_set_mode_fill(color_t color) {
+  host_record_begin(HOST_OP_MODE_FILL);
+  host_put_u32(color_to_packed32(color));
+  if (host_record_end()) {
+    return;
+  }
+  raster_set_fill(color);
+}
+
+void rdpq_mode_push(void) {
+  if (host_record_op(HOST_OP_MODE_PUSH)) {
+    return;
+  }
+  raster_push_mode();
+}
+
+void rdpq_mode_pop(void) {
+  if (host_record_op(HOST_OP_MODE_POP)) {
+    return;
+  }
+  raster_pop_mode();
+}
+
+void rdpq_fill_rectangle(float x0, float y0, float x1, float y1) {
+  host_record_begin(HOST_OP_FILL_RECTANGLE);
+  host_put_f32(x0);
+  host_put_f32(y0);
+  host_put_f32(x1);
+  host_put_f32(y1);
+  if (host_record_end()) {
+    return;
+  }
+  raster_rectangle(floorf(x0 * 4.0f), floorf(y0 * 4.0f), floorf(x1 * 4.0f), floorf(y1 * 4.0f));
+}
+
+void rdpq_sync_pipe(void) {
+  host_record_op(HOST_OP_SYNC_PIPE);
+}
+
+void rdpq_sync_tile(void) {
+  host_record_op(HOST_OP_SYNC_TILE);
+}
+
+void rdpq_sync_load(void) {
+  host_record_op(HOST_OP_SYNC_LOAD);
+}
+
+void rdpq_triangle(const rdpq_trifmt_t* fmt, const float* v1, const float* v2, const float* v3) {
+  int floats = fmt->pos_offset + 2;
+  if (fmt->shade_offset >= 0 && fmt->shade_offset + 4 > floats) floats = fmt->shade_offset + 4;
+  if (fmt->tex_offset >= 0 && fmt->tex_offset + 3 > floats) floats = fmt->tex_offset + 3;
+  if (fmt->z_offset >= 0 && fmt->z_offset + 1 > floats) floats = fmt->z_offset + 1;
+
+  host_record_begin(HOST_OP_TRIANGLE);
+  host_put_u8(fmt->pos_offset);
+  host_put_u8(fmt->shade_offset >= 0 ? fmt->shade_offset : 0xFF);
+  host_put_u8(fmt->tex_offset >= 0 ? fmt->tex_offset : 0xFF);
+  host_put_u8(fmt->z_offset >= 0 ? fmt->z_offset : 0xFF);
+  host_put_u8(floats);
+  const float* verts[3] = { v1, v2, v3 };
+  for (int v = 0; v < 3; ++v) {
+    for (int i = 0; i < floats; ++i) {
+      host_put_f32(verts[v][i]);
+    }
+  }
+  if (host_record_end()) {
+    return;
+  }
+
+  RasterVertex r1 = raster_vertex(fmt, v1);
+  RasterVertex r2 = raster_vertex(fmt, v2);
+  RasterVertex r3 = raster_vertex(fmt, v3);
+  raster_triangle(&r1, &r2, &r3);
+}
+
+int rdpq_sprite_upload(rdpq_tile_t tile, sprite_t* sprite, const rdpq_texparms_t* parms) {
+  (void)parms;
+  host_record_begin(HOST_OP_SPRITE_UPLOAD);
+  host_put_u8(tile);
+  host_put_u16(sprite->width);
+  host_put_u16(sprite->height);
+  if (hostCommands) {
+    // Only jobs need the sprite back, the stream keeps its size
+    host_put_u32((uint32_t)((uintptr_t)sprite >> 32));
+    host_put_u32((uint32_t)(uintptr_t)sprite);
+  }
+  if (host_record_end()) {
+    return 0;
+  }
+  raster_set_texture(sprite);
+  return 0;
+}
+
+void rdpq_debug_start(void) {}
+
+// ====~ Text ~==== //
+
+rdpq_font_t* rdpq_font_load_builtin(int font) {
+  (void)font;
+  return NULL;
+}
+
+void rdpq_text_register_font(uint8_t font_id, const rdpq_font_t* font) {
+  (void)font_id;
+  (void)font;
+}
+
+// Text is not drawn on the host, the string is kept in the stream for reference
+int rdpq_text_printf(const rdpq_textparms_t* parms, uint8_t font_id, float x0, float y0, const char* fmt, ...) {
+  (void)parms;
+  (void)font_id;
+  char text[512];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+
+  host_record_begin(HOST_OP_TEXT);
+  host_put_f32(x0);
+  host_put_f32(y0);
+  for (const char* c = text; *c; ++c) {
+    host_put_u8(*c);
+  }
+  host_record_end();
+  return len;
+}
+
+// ====~ Jobs ~==== //
+
+// Function to send the rdpq/rspq calls of this thread to commands until host_commands_end, appending
+void host_commands_begin(HostCommands* commands) {
+  hostCommands = commands;
+}
+
+void host_commands_end() {
+  hostCommands = NULL;
+}
+
+static uint32_t host_get_u32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static float host_get_f32(const uint8_t* p) {
+  uint32_t v = host_get_u32(p);
+  float f;
+  memcpy(&f, &v, sizeof(f));
+  return f;
+}
+
+// Function to make the calls recorded by a job, in order and with the draw call tags they were made under
+void host_commands_replay(const uint8_t* data, size_t size) {
+  int prevTag = capTag;
+  size_t pos = 0;
+  while (pos + 4 <= size) {
+    int op = data[pos];
+    size_t len = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+    const uint8_t* p = data + pos + 4;
+    capTag = data[pos + 1];
+    pos += 4 + len;
+
+    switch (op) {
+      case HOST_OP_MODE_STANDARD: rdpq_set_mode_standard(); break;
+      case HOST_OP_COMBINER: rdpq_mode_combiner((rdpq_combiner_t)host_get_u32(p)); break;
+      case HOST_OP_BLENDER: rdpq_mode_blender((rdpq_blender_t)host_get_u32(p)); break;
+      case HOST_OP_PRIM_COLOR: rdpq_set_prim_color(color_from_packed32(host_get_u32(p))); break;
+      case HOST_OP_MODE_FILL: rdpq_set_mode_fill(color_from_packed32(host_get_u32(p))); break;
+      case HOST_OP_MODE_PUSH: rdpq_mode_push(); break;
+      case HOST_OP_MODE_POP: rdpq_mode_pop(); break;
+      case HOST_OP_SYNC_PIPE: rdpq_sync_pipe(); break;
+      case HOST_OP_SYNC_TILE: rdpq_sync_tile(); break;
+      case HOST_OP_SYNC_LOAD: rdpq_sync_load(); break;
+      case HOST_OP_FILL_RECTANGLE:
+        rdpq_fill_rectangle(host_get_f32(p), host_get_f32(p + 4), host_get_f32(p + 8), host_get_f32(p + 12));
+        break;
+      case HOST_OP_TRIANGLE: {
+        rdpq_trifmt_t fmt = {
+          .pos_offset = p[0],
+          .shade_offset = p[1] == 0xFF ? -1 : p[1],
+          .tex_offset = p[2] == 0xFF ? -1 : p[2],
+          .z_offset = p[3] == 0xFF ? -1 : p[3],
+        };
+        int floats = p[4];
+        float v[3][16];
+        for (int i = 0; i < 3; ++i) {
+          for (int j = 0; j < floats && j < 16; ++j) {
+            v[i][j] = host_get_f32(p + 5 + (i * floats + j) * 4);
+          }
+        }
+        rdpq_triangle(&fmt, v[0], v[1], v[2]);
+        break;
+      }
+      case HOST_OP_RSPQ: {
+        uint32_t args[32];
+        int nargs = (int)(len - 8) / 4;
+        for (int i = 0; i < nargs && i < 32; ++i) {
+          args[i] = host_get_u32(p + 8 + i * 4);
+        }
+        host_rspq_write(host_get_u32(p), host_get_u32(p + 4), nargs < 32 ? nargs : 32, args);
+        break;
+      }
+      case HOST_OP_SPRITE_UPLOAD: {
+        sprite_t* sprite = (sprite_t*)(uintptr_t)(((uint64_t)host_get_u32(p + 5) << 32) | host_get_u32(p + 9));
+        rdpq_sprite_upload((rdpq_tile_t)p[0], sprite, NULL);
+        break;
+      }
+      case HOST_OP_TEXT:
+        rdpq_text_printf(NULL, 0, host_get_f32(p), host_get_f32(p + 4), "%.*s", (int)len - 8, (const char*)p + 8);
+        break;
+      default:
+        debugf("Host op %d can't be replayed\n", op);
+        break;
+    }
+  }
+  capTag = prevTag;
+}
@@ -0,0 +1,58 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <libdragon.h>
+
+/*
+  Host command stream, every rdpq/rspq call made through the stand-in is
+  appended as one record. All values are big endian like the console.
+
+  File:   "HSTR" u16 version u16 width u16 height
+  Record: u8 op, u8 tag (current rdpcap tag), u16 payload bytes, payload
+*/
+
+#define HOST_STREAM_VERSION 1
+
+typedef enum {
+  HOST_OP_ATTACH = 1,     // u16 width, u16 height
+  HOST_OP_SHOW,           // end of frame
+  HOST_OP_CLEAR,          // u32 rgba
+  HOST_OP_CLEAR_Z,        // u16 z
+  HOST_OP_MODE_STANDARD,
+  HOST_OP_COMBINER,       // u32 combiner
+  HOST_OP_BLENDER,        // u32 blender
+  HOST_OP_PRIM_COLOR,     // u32 rgba
+  HOST_OP_SYNC_PIPE,
+  HOST_OP_SYNC_TILE,
+  HOST_OP_SYNC_LOAD,
+  HOST_OP_TRIANGLE,       // u8 pos/shade/tex/z offsets (0xFF unused), u8 floats per vertex, 3 vertices of f32
+  HOST_OP_RSPQ,           // u32 overlay, u32 command, u32 args...
+  HOST_OP_SPRITE_UPLOAD,  // u8 tile, u16 width, u16 height
+  HOST_OP_TEXT,           // f32 x, f32 y, chars
+  HOST_OP_MODE_FILL,      // u32 rgba
+  HOST_OP_MODE_PUSH,
+  HOST_OP_MODE_POP,
+  HOST_OP_FILL_RECTANGLE, // f32 x0, f32 y0, f32 x1, f32 y1
+  HOST_OP_COUNT
+} HOST_OPS;
+
+// Calls recorded by the host jobs, see jobs.h, in the record layout above
+typedef struct {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+} HostCommands;
+
+void host_commands_begin(HostCommands* commands);
+void host_commands_end();
+void host_commands_replay(const uint8_t* data, size_t size);
+
+// Function to start recording every rdpq/rspq call to a file
+bool host_stream_open(const char* path);
+void host_stream_close();
+
+// Stops the program after this many frames, the main loops never return on their own
+void host_set_frame_limit(uint32_t frames);
+uint32_t host_frame_count();
+
+#endif // HOST_H
@@ -0,0 +1,311 @@
+#include <libdragon.h>
+#include <unistd.h>
+#include "jobs.h"
+#include "host.h"
+#include "../thread.h"
+#include "../utils.h"
+#include "../render.h"
+#include "../rdpcap.h"
+#include "../memtrack.h"
+#include "../lod.h"
+#include "../budget.h"
+#include "../fillrate.h"
+
+typedef struct {
+  JobFn fn;
+  void* arg;
+  int queued; // Worker it was queued to
+  int worker; // Worker that ran it
+  size_t start; // Its calls in the commands of that worker
+  size_t end;
+} Job;
+
+// Jobs of a worker, the owner takes from the back and thieves from the front
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  int items[JOBS_MAX];
+  int head;
+  int tail;
+  int index;
+  uint32_t generation; // Last jobs_run it took part in
+  HostCommands commands;
+} JobWorker;
+
+// Frame stats of the caller the workers add theirs to, THREAD_LOCAL so only reachable through pointers
+typedef struct {
+  int* triCount;
+  int* vertCount;
+  int* currTris;
+  int* fillTris;
+  int* currVerts;
+  BudgetStats* budget;
+  FillrateStats* fill;
+  uint32_t* grid;
+  uint32_t* hits;
+  LodStats* lod;
+  CapFrame* cap;
+  int capTag;
+  int memTag;
+  int budgetPriority;
+} JobTargets;
+
+JobStats jobsRun;
+
+static JobWorker jobsWorkers[JOBS_MAX_THREADS];
+static int jobsThreads;
+static Job jobs[JOBS_MAX];
+static int jobsCount;
+static RenderState jobsState;
+static JobTargets jobsTargets;
+
+static pthread_mutex_t jobsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobsStart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobsDone = PTHREAD_COND_INITIALIZER;
+static uint32_t jobsGeneration;
+static int jobsActive;
+static bool jobsQuit;
+static uint32_t jobsSteals;
+
+// Function to take the next job of a worker, its own newest first, then the oldest of another one
+static int jobs_take(JobWorker* w) {
+  pthread_mutex_lock(&w->lock);
+  int job = w->tail > w->head ? w->items[--w->tail] : -1;
+  pthread_mutex_unlock(&w->lock);
+  if (job >= 0) {
+    return job;
+  }
+
+  for (int i = 1; i < jobsThreads; ++i) {
+    JobWorker* victim = &jobsWorkers[(w->index + i) % jobsThreads];
+    pthread_mutex_lock(&victim->lock);
+    job = victim->tail > victim->head ? victim->items[victim->head++] : -1;
+    pthread_mutex_unlock(&victim->lock);
+    if (job >= 0) {
+      return job;
+    }
+  }
+  return -1;
+}
+
+// Function to add the frame stats of this worker to those of the caller and clear them
+static void jobs_merge() {
+  JobTargets* t = &jobsTargets;
+  *t->triCount += triCount;
+  *t->vertCount += vertCount;
+  *t->currTris += currTris;
+  *t->fillTris += fillTris;
+  *t->currVerts += currVerts;
+  triCount = vertCount = currTris = fillTris = currVerts = 0;
+
+  for (int i = 0; i < BUDGET_PRIORITY_COUNT; ++i) {
+    t->budget[i].tris += budgetFrame[i].tris;
+    t->budget[i].lodTris += budgetFrame[i].lodTris;
+    t->budget[i].lodFullTris += budgetFrame[i].lodFullTris;
+    t->budget[i].pixels += budgetFrame[i].pixels;
+    t->budget[i].degraded += budgetFrame[i].degraded;
+  }
+  memset(budgetFrame, 0, sizeof(budgetFrame));
+
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    t->fill[i].tris += fillrateFrame[i].tris;
+    t->fill[i].rects += fillrateFrame[i].rects;
+    t->fill[i].slivers += fillrateFrame[i].slivers;
+    t->fill[i].pixels += fillrateFrame[i].pixels;
+    t->fill[i].fillPixels += fillrateFrame[i].fillPixels;
+    t->fill[i].spans += fillrateFrame[i].spans;
+  }
+  memset(fillrateFrame, 0, sizeof(fillrateFrame));
+  uint32_t* grid = &fillrateGrid[0][0];
+  for (size_t i = 0; i < sizeof(fillrateGrid) / sizeof(uint32_t); ++i) {
+    t->grid[i] |= grid[i];
+  }
+  memset(fillrateGrid, 0, sizeof(fillrateGrid));
+  *t->hits += fillrateHits;
+  fillrateHits = 0;
+
+  t->lod->shapes += lodFrame.shapes;
+  t->lod->tris += lodFrame.tris;
+  t->lod->trisSaved += lodFrame.trisSaved;
+  memset(&lodFrame, 0, sizeof(LodStats));
+
+  for (int i = 0; i < CAP_CMD_COUNT; ++i) {
+    t->cap->cmds[i] += capFrame.cmds[i];
+  }
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    t->cap->tagBytes[i] += capFrame.tagBytes[i];
+    t->cap->tagTris[i] += capFrame.tagTris[i];
+  }
+  memset(&capFrame, 0, sizeof(CapFrame));
+}
+
+static void* jobs_worker(void* arg) {
+  JobWorker* w = (JobWorker*)arg;
+  for (;;) {
+    pthread_mutex_lock(&jobsLock);
+    while (!jobsQuit && jobsGeneration == w->generation) {
+      pthread_cond_wait(&jobsStart, &jobsLock);
+    }
+    if (jobsQuit) {
+      pthread_mutex_unlock(&jobsLock);
+      return NULL;
+    }
+    w->generation = jobsGeneration;
+    pthread_mutex_unlock(&jobsLock);
+
+    // The scopes the caller was in when it ran the jobs
+    capTag = jobsTargets.capTag;
+    memTag = jobsTargets.memTag;
+    budgetPriority = jobsTargets.budgetPriority;
+
+    uint32_t steals = 0;
+    host_commands_begin(&w->commands);
+    for (int i = jobs_take(w); i >= 0; i = jobs_take(w)) {
+      Job* job = &jobs[i];
+      render_set_state(&jobsState);
+      job->worker = w->index;
+      job->start = w->commands.size;
+      job->fn(job->arg);
+      render_restore_state(&jobsState);
+      job->end = w->commands.size;
+      steals += job->queued != w->index;
+    }
+    host_commands_end();
+
+    pthread_mutex_lock(&jobsLock);
+    jobs_merge();
+    jobsSteals += steals;
+    if (--jobsActive == 0) {
+      pthread_cond_signal(&jobsDone);
+    }
+    pthread_mutex_unlock(&jobsLock);
+  }
+}
+
+// Function to get the cores of the machine, the default worker count
+int jobs_cores() {
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return cores < 1 ? 1 : cores > JOBS_MAX_THREADS ? JOBS_MAX_THREADS : (int)cores;
+}
+
+// Function to start the workers, 0 starts one per core, again to change their count
+void jobs_init(int threads) {
+  jobs_shutdown();
+  if (threads <= 0) {
+    threads = jobs_cores();
+  }
+  jobsThreads = threads > JOBS_MAX_THREADS ? JOBS_MAX_THREADS : threads;
+  jobsCount = 0;
+  jobsQuit = false;
+  memset(&jobsRun, 0, sizeof(JobStats));
+  for (int i = 0; i < jobsThreads; ++i) {
+    JobWorker* w = &jobsWorkers[i];
+    w->index = i;
+    w->head = w->tail = 0;
+    w->generation = jobsGeneration;
+    pthread_mutex_init(&w->lock, NULL);
+    if (pthread_create(&w->thread, NULL, jobs_worker, w) != 0) {
+      debugf("Failed to start job worker %d\n", i);
+      jobsThreads = i;
+      break;
+    }
+  }
+}
+
+void jobs_shutdown() {
+  if (jobsThreads == 0) {
+    return;
+  }
+  pthread_mutex_lock(&jobsLock);
+  jobsQuit = true;
+  pthread_cond_broadcast(&jobsStart);
+  pthread_mutex_unlock(&jobsLock);
+  for (int i = 0; i < jobsThreads; ++i) {
+    pthread_join(jobsWorkers[i].thread, NULL);
+    pthread_mutex_destroy(&jobsWorkers[i].lock);
+    free(jobsWorkers[i].commands.data);
+    memset(&jobsWorkers[i].commands, 0, sizeof(HostCommands));
+  }
+  jobsThreads = 0;
+}
+
+int jobs_threads() {
+  return jobsThreads;
+}
+
+// Function to queue a draw call for the next jobs_run, without workers it is drawn right away
+void jobs_add(JobFn fn, void* arg) {
+  if (jobsThreads == 0) {
+    fn(arg);
+    return;
+  }
+  if (jobsCount == JOBS_MAX) {
+    jobs_run();
+  }
+  jobs[jobsCount].fn = fn;
+  jobs[jobsCount].arg = arg;
+  jobsCount++;
+}
+
+// Function to tessellate the queued jobs on the workers and submit their calls in the order they were added
+void jobs_run() {
+  if (jobsCount == 0) {
+    return;
+  }
+
+  render_get_state(&jobsState);
+  jobsTargets = (JobTargets){
+    .triCount = &triCount,
+    .vertCount = &vertCount,
+    .currTris = &currTris,
+    .fillTris = &fillTris,
+    .currVerts = &currVerts,
+    .budget = budgetFrame,
+    .fill = fillrateFrame,
+    .grid = &fillrateGrid[0][0],
+    .hits = &fillrateHits,
+    .lod = &lodFrame,
+    .cap = &capFrame,
+    .capTag = capTag,
+    .memTag = memTag,
+    .budgetPriority = budgetPriority,
+  };
+
+  // Runs of consecutive jobs per worker, neighbours tend to be alike
+  for (int i = 0; i < jobsThreads; ++i) {
+    JobWorker* w = &jobsWorkers[i];
+    w->head = w->tail = 0;
+    w->commands.size = 0;
+    for (int j = jobsCount * i / jobsThreads; j < jobsCount * (i + 1) / jobsThreads; ++j) {
+      jobs[j].queued = i;
+      w->items[w->tail++] = j;
+    }
+  }
+
+  uint32_t start = get_ticks();
+  pthread_mutex_lock(&jobsLock);
+  jobsActive = jobsThreads;
+  jobsSteals = 0;
+  jobsGeneration++;
+  pthread_cond_broadcast(&jobsStart);
+  while (jobsActive > 0) {
+    pthread_cond_wait(&jobsDone, &jobsLock);
+  }
+  pthread_mutex_unlock(&jobsLock);
+  uint32_t tessTicks = get_ticks() - start;
+
+  start = get_ticks();
+  for (int i = 0; i < jobsCount; ++i) {
+    const Job* job = &jobs[i];
+    const HostCommands* commands = &jobsWorkers[job->worker].commands;
+    host_commands_replay(commands->data + job->start, job->end - job->start);
+    jobsRun.bytes += job->end - job->start;
+  }
+
+  jobsRun.runs++;
+  jobsRun.jobs += jobsCount;
+  jobsRun.steals += jobsSteals;
+  jobsRun.tessTicks += tessTicks;
+  jobsRun.replayTicks += get_ticks() - start;
+  jobsCount = 0;
+}
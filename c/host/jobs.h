@@ -0,0 +1,52 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <libdragon.h>
+
+#define JOBS_MAX_THREADS 16
+#define JOBS_MAX 4096 // Jobs per jobs_run
+
+/*
+  Work stealing job system of the host build, tessellates the shapes of a
+  large scene on every core.
+
+  jobs_add queues a draw call, like one bezier or one snake, and jobs_run
+  hands them to the workers and returns once all of them are drawn. The jobs
+  are split over the workers in runs of consecutive ones, each worker takes
+  its own from the back of its deque and steals from the front of the others
+  once it runs dry.
+
+  A job starts with the render attributes of the caller (render_get_state)
+  and its rdpq calls go to the commands of its worker (host_commands_begin)
+  instead of the rasterizer. When all are done the caller replays them job by
+  job in the order they were added, so the frame comes out as if drawn on one
+  thread. A job that leaves the attributes changed pays for the commands to
+  restore them.
+
+  The counters and frame stats the draw calls write are THREAD_LOCAL (see
+  thread.h), every worker adds its own to those of the caller before
+  jobs_run returns. Jobs may change the data of their own shape, not any
+  other shared state.
+*/
+
+typedef void (*JobFn)(void* arg);
+
+typedef struct {
+  uint32_t runs;
+  uint32_t jobs;
+  uint32_t steals; // Jobs run by another worker than the one they were queued to
+  uint64_t tessTicks; // From handing out the jobs until the last one was done
+  uint64_t replayTicks; // Replaying the recorded calls on the caller
+  uint64_t bytes; // Recorded calls
+} JobStats;
+
+extern JobStats jobsRun; // Totals since jobs_init
+
+void jobs_init(int threads);
+void jobs_shutdown();
+int jobs_threads();
+int jobs_cores();
+void jobs_add(JobFn fn, void* arg);
+void jobs_run();
+
+#endif // JOBS_H
@@ -0,0 +1,264 @@
+/*
+  Host stand-in for the parts of Libdragon used by this repo.
+
+  Only what the C sources call is declared here, with the same names and
+  argument types, so render.c, shapes.c, the examples and main.c build
+  unchanged with the host compiler. Every RDP/RSPQ call is recorded to a
+  command stream (see host.h) instead of being sent to hardware.
+*/
+
+#ifndef HOST_LIBDRAGON_H
+#define HOST_LIBDRAGON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <malloc.h>
+
+#define N64_HOST 1
+
+// ====~ Debug ~==== //
+
+#define debugf(...) fprintf(stderr, __VA_ARGS__)
+void debug_init_isviewer(void);
+void debug_init_usblog(void);
+bool debug_init_sdfs(const char* prefix, int npart);
+
+// ====~ Memory ~==== //
+
+void* malloc_uncached(size_t size);
+void free_uncached(void* buf);
+int get_memory_size(void);
+#define HEAP_START_ADDR 0x80100000u
+
+// ====~ Timer ~==== //
+
+#define TICKS_PER_SECOND (93750000/2)
+#define TICKS_TO_US(val) (((val) * 8) / (TICKS_PER_SECOND / 125000))
+#define TICKS_TO_MS(val) (((val) * 1) / (TICKS_PER_SECOND / 1000))
+uint32_t get_ticks(void);
+uint64_t get_ticks_ms(void);
+
+// ====~ Math ~==== //
+
+#define fm_sinf sinf
+#define fm_cosf cosf
+#define fm_atan2f atan2f
+#define fm_floorf floorf
+
+// ====~ Graphics ~==== //
+
+typedef struct {
+  uint8_t r, g, b, a;
+} color_t;
+
+#define RGBA32(rx, gx, bx, ax) ((color_t){rx, gx, bx, ax})
+
+static inline uint32_t color_to_packed32(color_t c) {
+  return ((uint32_t)c.r << 24) | ((uint32_t)c.g << 16) | ((uint32_t)c.b << 8) | c.a;
+}
+
+static inline color_t color_from_packed32(uint32_t c) {
+  return (color_t){ c >> 24, (c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF };
+}
+
+typedef enum {
+  FMT_NONE = 0,
+  FMT_RGBA16 = 2,
+  FMT_RGBA32 = 3,
+} tex_format_t;
+
+typedef struct surface_s {
+  uint16_t flags;
+  uint16_t width;
+  uint16_t height;
+  uint16_t stride;
+  void* buffer;
+} surface_t;
+
+surface_t surface_alloc(tex_format_t format, uint16_t width, uint16_t height);
+void surface_free(surface_t* surface);
+
+typedef struct sprite_s {
+  uint16_t width;
+  uint16_t height;
+  void* data;
+} sprite_t;
+
+sprite_t* sprite_load(const char* fn);
+
+typedef struct {
+  int width, height;
+} resolution_t;
+
+#define RESOLUTION_320x240 ((resolution_t){320, 240})
+#define DEPTH_16_BPP 2
+#define GAMMA_NONE 0
+#define FILTERS_RESAMPLE_ANTIALIAS_DEDITHER 3
+
+void display_init(resolution_t res, int bitdepth, uint32_t num_buffers, int gamma, int filters);
+surface_t* display_get(void);
+int display_get_width(void);
+int display_get_height(void);
+float display_get_fps(void);
+void display_set_fps_limit(float fps);
+
+// ====~ Filesystem ~==== //
+
+#define DFS_DEFAULT_LOCATION 0x10101000
+int dfs_init(uint32_t base_fs_loc);
+
+// ====~ Joypad ~==== //
+
+typedef enum {
+  JOYPAD_PORT_1 = 0,
+  JOYPAD_PORT_2,
+  JOYPAD_PORT_3,
+  JOYPAD_PORT_4,
+} joypad_port_t;
+
+typedef union {
+  uint16_t raw;
+  struct __attribute__((packed)) {
+    unsigned a : 1;
+    unsigned b : 1;
+    unsigned z : 1;
+    unsigned start : 1;
+    unsigned d_up : 1;
+    unsigned d_down : 1;
+    unsigned d_left : 1;
+    unsigned d_right : 1;
+    unsigned y : 1;
+    unsigned x : 1;
+    unsigned l : 1;
+    unsigned r : 1;
+    unsigned c_up : 1;
+    unsigned c_down : 1;
+    unsigned c_left : 1;
+    unsigned c_right : 1;
+  };
+} joypad_buttons_t;
+
+typedef struct {
+  joypad_buttons_t btn;
+  int8_t stick_x;
+  int8_t stick_y;
+  int8_t cstick_x;
+  int8_t cstick_y;
+  uint8_t analog_l;
+  uint8_t analog_r;
+} joypad_inputs_t;
+
+void joypad_init(void);
+void joypad_poll(void);
+joypad_inputs_t joypad_get_inputs(joypad_port_t port);
+joypad_buttons_t joypad_get_buttons_pressed(joypad_port_t port);
+joypad_buttons_t joypad_get_buttons_held(joypad_port_t port);
+
+// ====~ RSPQ ~==== //
+
+#define RDPQ_OVL_ID (0xC << 28)
+#define RDPQ_CMD_TRI 0x08
+#define RDPQ_CMD_TRIANGLE 0x1E
+#define RDPQ_CMD_TRIANGLE_DATA 0x1F
+
+void host_rspq_write(uint32_t ovl_id, uint32_t cmd_id, int nargs, const uint32_t* args);
+
+// Syncpoints complete once the commands queued before them are drawn, at the next rdpq_detach_show
+typedef int rspq_syncpoint_t;
+rspq_syncpoint_t rspq_syncpoint_new(void);
+bool rspq_syncpoint_check(rspq_syncpoint_t sync_id);
+void rspq_syncpoint_wait(rspq_syncpoint_t sync_id);
+
+// Same call shape as Libdragon's rspq_write macro, arguments are 32-bit words
+#define rspq_write(ovl_id, cmd_id, ...) \
+  host_rspq_write(ovl_id, cmd_id, \
+    sizeof((uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t), \
+    (uint32_t[]){__VA_ARGS__})
+
+// ====~ RDPQ ~==== //
+
+typedef enum {
+  TILE0 = 0, TILE1, TILE2, TILE3, TILE4, TILE5, TILE6, TILE7
+} rdpq_tile_t;
+
+typedef struct {
+  int pos_offset;
+  int shade_offset;
+  bool shade_flat;
+  int tex_offset;
+  rdpq_tile_t tex_tile;
+  int tex_mipmaps;
+  int z_offset;
+} rdpq_trifmt_t;
+
+// Texture sampling of an upload, the host rasterizer always repeats
+#define REPEAT_INFINITE 2048
+
+typedef struct {
+  float translate;
+  int scale_log;
+  float repeats;
+  bool mirror;
+} rdpq_texparms_axis_t;
+
+typedef struct {
+  int tmem_addr;
+  int palette;
+  rdpq_texparms_axis_t s, t;
+} rdpq_texparms_t;
+
+extern const rdpq_trifmt_t TRIFMT_FILL;
+extern const rdpq_trifmt_t TRIFMT_SHADE;
+extern const rdpq_trifmt_t TRIFMT_TEX;
+extern const rdpq_trifmt_t TRIFMT_SHADE_TEX;
+
+typedef uint64_t rdpq_combiner_t;
+typedef uint32_t rdpq_blender_t;
+
+// The host only needs to tell combiners and blenders apart
+#define RDPQ_COMBINER_FLAT ((rdpq_combiner_t)1)
+#define RDPQ_COMBINER_SHADE ((rdpq_combiner_t)2)
+#define RDPQ_COMBINER_TEX ((rdpq_combiner_t)3)
+#define RDPQ_COMBINER_TEX_FLAT ((rdpq_combiner_t)4)
+#define RDPQ_COMBINER_TEX_SHADE ((rdpq_combiner_t)5)
+#define RDPQ_BLENDER_MULTIPLY ((rdpq_blender_t)1)
+
+void rdpq_init(void);
+void rdpq_attach(const surface_t* color, const surface_t* depth);
+const surface_t* rdpq_get_attached(void);
+void rdpq_detach_show(void);
+void rdpq_clear(color_t color);
+void rdpq_clear_z(uint16_t z);
+void rdpq_set_mode_standard(void);
+void rdpq_mode_combiner(rdpq_combiner_t comb);
+void rdpq_mode_blender(rdpq_blender_t blend);
+void rdpq_set_prim_color(color_t color);
+void rdpq_set_mode_fill(color_t color);
+void rdpq_mode_push(void);
+void rdpq_mode_pop(void);
+void rdpq_fill_rectangle(float x0, float y0, float x1, float y1);
+void rdpq_sync_pipe(void);
+void rdpq_sync_tile(void);
+void rdpq_sync_load(void);
+void rdpq_triangle(const rdpq_trifmt_t* fmt, const float* v1, const float* v2, const float* v3);
+int rdpq_sprite_upload(rdpq_tile_t tile, sprite_t* sprite, const rdpq_texparms_t* parms);
+void rdpq_debug_start(void);
+
+// ====~ Text ~==== //
+
+#define FONT_BUILTIN_DEBUG_MONO 1
+
+typedef struct rdpq_font_s rdpq_font_t;
+typedef struct rdpq_textparms_s rdpq_textparms_t;
+
+rdpq_font_t* rdpq_font_load_builtin(int font);
+void rdpq_text_register_font(uint8_t font_id, const rdpq_font_t* font);
+int rdpq_text_printf(const rdpq_textparms_t* parms, uint8_t font_id, float x0, float y0, const char* fmt, ...)
+  __attribute__((format(printf, 5, 6)));
+
+#endif // HOST_LIBDRAGON_H
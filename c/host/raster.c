@@ -0,0 +1,851 @@
+#include <libdragon.h>
+#include <pthread.h>
+#include "raster.h"
+
+#define RASTER_MODE_STACK 4
+
+typedef enum {
+  RASTER_CMD_CLEAR,
+  RASTER_CMD_TRI,
+  RASTER_CMD_RECT,
+} RASTER_CMDS;
+
+typedef struct {
+  uint8_t type;
+  uint8_t tag; // Draw call, see RDPCAP_TAG
+  RasterState state;
+  RasterVertex v[3];
+} RasterCmd;
+
+static RasterState rasterState;
+static RasterState rasterModeStack[RASTER_MODE_STACK];
+static int rasterModeDepth;
+static RasterCmd* rasterCmds;
+static size_t rasterCount;
+static size_t rasterCapacity;
+static uint16_t* rasterWrites; // Writes per pixel this frame
+static size_t rasterWritesSize;
+RasterStats rasterStats;
+
+void raster_set_combiner(int combiner) {
+  rasterState.combiner = combiner;
+}
+
+void raster_set_blend(bool blend) {
+  rasterState.blend = blend;
+}
+
+void raster_set_prim(color_t color) {
+  rasterState.prim = color;
+}
+
+void raster_set_texture(const sprite_t* sprite) {
+  rasterState.tex = sprite;
+}
+
+// Fill mode is a mode of its own, like rdpq_set_mode_fill
+void raster_set_fill(color_t color) {
+  rasterState.fill = true;
+  rasterState.fillColor = color;
+  rasterState.blend = false;
+}
+
+void raster_set_fill_mode(bool fill) {
+  rasterState.fill = fill;
+}
+
+// Function to save the mode like rdpq_mode_push, the prim color is not part of it
+void raster_push_mode() {
+  if (rasterModeDepth < RASTER_MODE_STACK) {
+    rasterModeStack[rasterModeDepth] = rasterState;
+  }
+  rasterModeDepth++;
+}
+
+void raster_pop_mode() {
+  if (rasterModeDepth == 0) {
+    debugf("raster_pop_mode: mode stack is empty\n");
+    return;
+  }
+  rasterModeDepth--;
+  if (rasterModeDepth < RASTER_MODE_STACK) {
+    color_t prim = rasterState.prim;
+    rasterState = rasterModeStack[rasterModeDepth];
+    rasterState.prim = prim;
+  }
+}
+
+static RasterCmd* raster_push(int type) {
+  if (rasterCount == rasterCapacity) {
+    rasterCapacity = rasterCapacity ? rasterCapacity * 2 : 1024;
+    rasterCmds = (RasterCmd*)realloc(rasterCmds, rasterCapacity * sizeof(RasterCmd));
+  }
+  RasterCmd* cmd = &rasterCmds[rasterCount++];
+  cmd->type = type;
+  cmd->tag = capTag;
+  cmd->state = rasterState;
+  return cmd;
+}
+
+void raster_clear(color_t color) {
+  RasterCmd* cmd = raster_push(RASTER_CMD_CLEAR);
+  cmd->state.prim = color;
+}
+
+void raster_triangle(const RasterVertex* v1, const RasterVertex* v2, const RasterVertex* v3) {
+  RasterCmd* cmd = raster_push(RASTER_CMD_TRI);
+  cmd->v[0] = *v1;
+  cmd->v[1] = *v2;
+  cmd->v[2] = *v3;
+}
+
+// Corners are in quarter pixels, pixels with their center inside are drawn
+void raster_rectangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+  RasterCmd* cmd = raster_push(RASTER_CMD_RECT);
+  cmd->v[0].x = x0;
+  cmd->v[0].y = y0;
+  cmd->v[1].x = x1;
+  cmd->v[1].y = y1;
+}
+
+RasterVertex raster_vertex(const rdpq_trifmt_t* fmt, const float* v) {
+  RasterVertex r;
+  memset(&r, 0, sizeof(r));
+  r.x = floorf(v[fmt->pos_offset + 0] * 4.0f);
+  r.y = floorf(v[fmt->pos_offset + 1] * 4.0f);
+  if (fmt->shade_offset >= 0) {
+    r.r = v[fmt->shade_offset + 0] * 255.0f;
+    r.g = v[fmt->shade_offset + 1] * 255.0f;
+    r.b = v[fmt->shade_offset + 2] * 255.0f;
+    r.a = v[fmt->shade_offset + 3] * 255.0f;
+  }
+  if (fmt->tex_offset >= 0) {
+    r.s = v[fmt->tex_offset + 0];
+    r.t = v[fmt->tex_offset + 1];
+  }
+  return r;
+}
+
+// ====~ Pixels ~==== //
+
+static inline uint16_t raster_pack(uint32_t r, uint32_t g, uint32_t b) {
+  return ((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | 1;
+}
+
+static inline void raster_unpack(uint16_t p, uint32_t* r, uint32_t* g, uint32_t* b) {
+  uint32_t r5 = (p >> 11) & 0x1F, g5 = (p >> 6) & 0x1F, b5 = (p >> 1) & 0x1F;
+  *r = (r5 << 3) | (r5 >> 2);
+  *g = (g5 << 3) | (g5 >> 2);
+  *b = (b5 << 3) | (b5 >> 2);
+}
+
+static inline color_t raster_texel(const sprite_t* tex, float s, float t) {
+  if (!tex || !tex->data) {
+    return RGBA32(255, 255, 255, 255);
+  }
+  int x = (int)floorf(s) % tex->width;
+  int y = (int)floorf(t) % tex->height;
+  if (x < 0) x += tex->width;
+  if (y < 0) y += tex->height;
+  uint32_t texel = ((const uint32_t*)tex->data)[y * tex->width + x];
+  return RGBA32(texel >> 24, (texel >> 16) & 0xFF, (texel >> 8) & 0xFF, texel & 0xFF);
+}
+
+static inline uint8_t raster_mul(uint8_t a, uint8_t b) {
+  return (a * b + 127) / 255;
+}
+
+// Pixels a command may write, the surface or the tile being drawn, inclusive
+typedef struct {
+  int x0, y0, x1, y1;
+} RasterClip;
+
+// Function to count a written pixel for the stats and the heatmap
+static inline void raster_count(RasterStats* stats, uint16_t* writes, int tag) {
+  stats->pixels[tag]++;
+  stats->written++;
+  if (*writes == 0) {
+    stats->covered++;
+  }
+  if (*writes < UINT16_MAX) {
+    (*writes)++;
+  }
+}
+
+static inline uint16_t raster_blend(uint16_t dst, color_t c) {
+  uint32_t dr, dg, db;
+  raster_unpack(dst, &dr, &dg, &db);
+  uint32_t a = c.a, ia = 255 - c.a;
+  return raster_pack((c.r * a + dr * ia + 127) / 255, (c.g * a + dg * ia + 127) / 255, (c.b * a + db * ia + 127) / 255);
+}
+
+static void raster_draw_clear(surface_t* surface, const RasterCmd* cmd, const RasterClip* clip) {
+  color_t c = cmd->state.prim;
+  uint16_t p = raster_pack(c.r, c.g, c.b);
+  for (int y = clip->y0; y <= clip->y1; ++y) {
+    uint16_t* row = (uint16_t*)((uint8_t*)surface->buffer + y * surface->stride);
+    for (int x = clip->x0; x <= clip->x1; ++x) {
+      row[x] = p;
+    }
+  }
+}
+
+// Ties on an edge go to exactly one of the two triangles sharing it
+static inline bool raster_top_left(const RasterVertex* a, const RasterVertex* b) {
+  int32_t dx = b->x - a->x;
+  int32_t dy = b->y - a->y;
+  return dy > 0 || (dy == 0 && dx < 0);
+}
+
+static inline int64_t raster_edge(const RasterVertex* a, const RasterVertex* b, int32_t px, int32_t py) {
+  return (int64_t)(b->x - a->x) * (py - a->y) - (int64_t)(b->y - a->y) * (px - a->x);
+}
+
+// Edge functions of a triangle, w[0] weighs v[0] and so on
+typedef struct {
+  const RasterVertex* v[3]; // Wound so the area is positive
+  int64_t area;
+  int x0, y0, x1, y1; // Pixels of the surface in the bounding box
+  int64_t bias[3]; // Top left rule
+  int64_t stepX[3]; // Per pixel
+  int64_t stepY[3];
+  bool shade;
+  bool tex;
+} RasterTri;
+
+// Function to set up a triangle for the walkers, false when its bounding box misses the surface
+static bool raster_tri_setup(const surface_t* surface, const RasterCmd* cmd, RasterTri* tri) {
+  const RasterVertex* v0 = &cmd->v[0];
+  const RasterVertex* v1 = &cmd->v[1];
+  const RasterVertex* v2 = &cmd->v[2];
+
+  int64_t area = raster_edge(v0, v1, v2->x, v2->y);
+  if (area == 0) {
+    return false;
+  }
+  if (area < 0) {
+    const RasterVertex* tmp = v1;
+    v1 = v2;
+    v2 = tmp;
+    area = -area;
+  }
+
+  // Bounding box in pixels
+  int32_t minX = v0->x < v1->x ? v0->x : v1->x;
+  int32_t maxX = v0->x > v1->x ? v0->x : v1->x;
+  int32_t minY = v0->y < v1->y ? v0->y : v1->y;
+  int32_t maxY = v0->y > v1->y ? v0->y : v1->y;
+  if (v2->x < minX) minX = v2->x;
+  if (v2->x > maxX) maxX = v2->x;
+  if (v2->y < minY) minY = v2->y;
+  if (v2->y > maxY) maxY = v2->y;
+
+  tri->x0 = minX >> 2;
+  tri->x1 = maxX >> 2;
+  tri->y0 = minY >> 2;
+  tri->y1 = maxY >> 2;
+  if (tri->x0 < 0) tri->x0 = 0;
+  if (tri->y0 < 0) tri->y0 = 0;
+  if (tri->x1 >= surface->width) tri->x1 = surface->width - 1;
+  if (tri->y1 >= surface->height) tri->y1 = surface->height - 1;
+  if (tri->x0 > tri->x1 || tri->y0 > tri->y1) {
+    return false;
+  }
+
+  tri->v[0] = v0;
+  tri->v[1] = v1;
+  tri->v[2] = v2;
+  tri->area = area;
+  tri->bias[0] = raster_top_left(v1, v2) ? 0 : -1;
+  tri->bias[1] = raster_top_left(v2, v0) ? 0 : -1;
+  tri->bias[2] = raster_top_left(v0, v1) ? 0 : -1;
+  tri->stepX[0] = -4 * (int64_t)(v2->y - v1->y);
+  tri->stepX[1] = -4 * (int64_t)(v0->y - v2->y);
+  tri->stepX[2] = -4 * (int64_t)(v1->y - v0->y);
+  tri->stepY[0] = 4 * (int64_t)(v2->x - v1->x);
+  tri->stepY[1] = 4 * (int64_t)(v0->x - v2->x);
+  tri->stepY[2] = 4 * (int64_t)(v1->x - v0->x);
+
+  uint8_t comb = cmd->state.combiner;
+  tri->shade = comb == RASTER_COMB_SHADE || comb == RASTER_COMB_TEX_SHADE;
+  tri->tex = comb >= RASTER_COMB_TEX;
+  return true;
+}
+
+// Function to get the edge functions at the center of pixel x, y
+static inline void raster_tri_edges(const RasterTri* tri, int x, int y, int64_t* w) {
+  int32_t px = x * 4 + 2;
+  int32_t py = y * 4 + 2;
+  w[0] = raster_edge(tri->v[1], tri->v[2], px, py);
+  w[1] = raster_edge(tri->v[2], tri->v[0], px, py);
+  w[2] = raster_edge(tri->v[0], tri->v[1], px, py);
+}
+
+// Function to write one pixel inside a triangle from its edge functions
+static inline void raster_tri_pixel(const RasterCmd* cmd, const RasterTri* tri, int64_t w0, int64_t w1, int64_t w2, uint16_t* pixel, uint16_t* writes, RasterStats* stats) {
+  const RasterState* st = &cmd->state;
+  const RasterVertex* v0 = tri->v[0];
+  const RasterVertex* v1 = tri->v[1];
+  const RasterVertex* v2 = tri->v[2];
+  int64_t area = tri->area;
+  color_t c = st->prim;
+
+  raster_count(stats, writes, cmd->tag);
+
+  if (tri->shade) {
+    c.r = (w0 * v0->r + w1 * v1->r + w2 * v2->r) / area;
+    c.g = (w0 * v0->g + w1 * v1->g + w2 * v2->g) / area;
+    c.b = (w0 * v0->b + w1 * v1->b + w2 * v2->b) / area;
+    c.a = (w0 * v0->a + w1 * v1->a + w2 * v2->a) / area;
+  }
+
+  if (tri->tex) {
+    float inv = 1.0f / (float)area;
+    float s = ((float)w0 * v0->s + (float)w1 * v1->s + (float)w2 * v2->s) * inv;
+    float t = ((float)w0 * v0->t + (float)w1 * v1->t + (float)w2 * v2->t) * inv;
+    color_t texel = raster_texel(st->tex, s, t);
+    if (st->combiner == RASTER_COMB_TEX) {
+      c = texel;
+    } else {
+      c.r = raster_mul(texel.r, c.r);
+      c.g = raster_mul(texel.g, c.g);
+      c.b = raster_mul(texel.b, c.b);
+      c.a = raster_mul(texel.a, c.a);
+    }
+  }
+
+  *pixel = st->blend ? raster_blend(*pixel, c) : raster_pack(c.r, c.g, c.b);
+}
+
+// Function to walk the whole bounding box of a triangle one pixel at a time, the reference
+static void raster_draw_tri(surface_t* surface, const RasterCmd* cmd) {
+  RasterTri tri;
+  if (!raster_tri_setup(surface, cmd, &tri)) {
+    return;
+  }
+
+  int64_t rowW[3];
+  raster_tri_edges(&tri, tri.x0, tri.y0, rowW);
+
+  rasterStats.tested += (uint64_t)(tri.x1 - tri.x0 + 1) * (tri.y1 - tri.y0 + 1);
+  for (int y = tri.y0; y <= tri.y1; ++y) {
+    uint16_t* row = (uint16_t*)((uint8_t*)surface->buffer + y * surface->stride);
+    uint16_t* writes = rasterWrites + y * surface->width;
+    int64_t w0 = rowW[0], w1 = rowW[1], w2 = rowW[2];
+
+    for (int x = tri.x0; x <= tri.x1; ++x) {
+      if (w0 + tri.bias[0] >= 0 && w1 + tri.bias[1] >= 0 && w2 + tri.bias[2] >= 0) {
+        raster_tri_pixel(cmd, &tri, w0, w1, w2, &row[x], &writes[x], &rasterStats);
+      }
+      w0 += tri.stepX[0];
+      w1 += tri.stepX[1];
+      w2 += tri.stepX[2];
+    }
+
+    rowW[0] += tri.stepY[0];
+    rowW[1] += tri.stepY[1];
+    rowW[2] += tri.stepY[2];
+  }
+}
+
+// Four edge function values at once, GCC lowers it to the SIMD the target has
+typedef int64_t RasterLanes __attribute__((vector_size(4 * sizeof(int64_t))));
+
+// Function to walk the part of a triangle in a tile four pixels at a time
+static void raster_draw_tri_lanes(surface_t* surface, const RasterCmd* cmd, const RasterTri* tri, const RasterClip* clip, RasterStats* stats) {
+  int x0 = tri->x0 > clip->x0 ? tri->x0 : clip->x0;
+  int x1 = tri->x1 < clip->x1 ? tri->x1 : clip->x1;
+  int y0 = tri->y0 > clip->y0 ? tri->y0 : clip->y0;
+  int y1 = tri->y1 < clip->y1 ? tri->y1 : clip->y1;
+  if (x0 > x1 || y0 > y1) {
+    return;
+  }
+
+  const RasterLanes lane = { 0, 1, 2, 3 };
+  RasterLanes stepX[3], bias[3];
+  for (int e = 0; e < 3; ++e) {
+    stepX[e] = (RasterLanes){ 4, 4, 4, 4 } * tri->stepX[e];
+    bias[e] = (RasterLanes){ 0, 0, 0, 0 } + tri->bias[e];
+  }
+
+  int64_t rowW[3];
+  raster_tri_edges(tri, x0, y0, rowW);
+
+  stats->tested += (uint64_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+  for (int y = y0; y <= y1; ++y) {
+    uint16_t* row = (uint16_t*)((uint8_t*)surface->buffer + y * surface->stride);
+    uint16_t* writes = rasterWrites + y * surface->width;
+    RasterLanes w0 = rowW[0] + lane * tri->stepX[0];
+    RasterLanes w1 = rowW[1] + lane * tri->stepX[1];
+    RasterLanes w2 = rowW[2] + lane * tri->stepX[2];
+
+    for (int x = x0; x <= x1; x += 4) {
+      // All ones in the lanes with the pixel center inside
+      RasterLanes inside = (w0 + bias[0] >= 0) & (w1 + bias[1] >= 0) & (w2 + bias[2] >= 0);
+      if (inside[0] | inside[1] | inside[2] | inside[3]) {
+        for (int l = 0; l < 4 && x + l <= x1; ++l) {
+          if (inside[l]) {
+            raster_tri_pixel(cmd, tri, w0[l], w1[l], w2[l], &row[x + l], &writes[x + l], stats);
+          }
+        }
+      }
+      w0 += stepX[0];
+      w1 += stepX[1];
+      w2 += stepX[2];
+    }
+
+    rowW[0] += tri->stepY[0];
+    rowW[1] += tri->stepY[1];
+    rowW[2] += tri->stepY[2];
+  }
+}
+
+// Function to get the pixels of a rectangle command, first and last whose center, at 4 * x + 2, is inside
+static RasterClip raster_rect_pixels(const surface_t* surface, const RasterCmd* cmd) {
+  RasterClip r = {
+    .x0 = (cmd->v[0].x + 1) >> 2,
+    .x1 = ((cmd->v[1].x + 1) >> 2) - 1,
+    .y0 = (cmd->v[0].y + 1) >> 2,
+    .y1 = ((cmd->v[1].y + 1) >> 2) - 1,
+  };
+  if (r.x0 < 0) r.x0 = 0;
+  if (r.y0 < 0) r.y0 = 0;
+  if (r.x1 >= surface->width) r.x1 = surface->width - 1;
+  if (r.y1 >= surface->height) r.y1 = surface->height - 1;
+  return r;
+}
+
+static void raster_draw_rect(surface_t* surface, const RasterCmd* cmd, const RasterClip* clip, RasterStats* stats) {
+  RasterClip r = raster_rect_pixels(surface, cmd);
+  int x0 = r.x0 > clip->x0 ? r.x0 : clip->x0;
+  int x1 = r.x1 < clip->x1 ? r.x1 : clip->x1;
+  int y0 = r.y0 > clip->y0 ? r.y0 : clip->y0;
+  int y1 = r.y1 < clip->y1 ? r.y1 : clip->y1;
+
+  const RasterState* st = &cmd->state;
+  color_t c = st->fill ? st->fillColor : st->prim;
+  bool blend = !st->fill && st->blend;
+  uint16_t packed = raster_pack(c.r, c.g, c.b);
+
+  for (int y = y0; y <= y1; ++y) {
+    uint16_t* row = (uint16_t*)((uint8_t*)surface->buffer + y * surface->stride);
+    uint16_t* writes = rasterWrites + y * surface->width;
+    for (int x = x0; x <= x1; ++x) {
+      raster_count(stats, &writes[x], cmd->tag);
+      row[x] = blend ? raster_blend(row[x], c) : packed;
+    }
+  }
+}
+
+// ====~ Tiles ~==== //
+
+// Commands that touch a tile, in queue order
+typedef struct {
+  uint32_t* cmds;
+  size_t count;
+  size_t capacity;
+} RasterBin;
+
+typedef struct {
+  pthread_t thread;
+  uint32_t generation; // Last flush it took part in
+  RasterStats stats;
+} RasterWorker;
+
+static int rasterThreads;
+static RasterWorker rasterWorkers[RASTER_MAX_THREADS];
+static RasterBin* rasterBins;
+static size_t rasterBinCount;
+static RasterTri* rasterTris; // Set up once per triangle while binning
+static size_t rasterTrisCapacity;
+static surface_t* rasterTarget;
+static int rasterTilesX;
+static int rasterTilesY;
+static int rasterNextTile;
+
+static pthread_mutex_t rasterLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rasterStart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rasterDone = PTHREAD_COND_INITIALIZER;
+static uint32_t rasterGeneration;
+static int rasterActive;
+static bool rasterQuit;
+
+static void raster_bin_add(int tx0, int ty0, int tx1, int ty1, uint32_t cmd) {
+  for (int ty = ty0; ty <= ty1; ++ty) {
+    for (int tx = tx0; tx <= tx1; ++tx) {
+      RasterBin* bin = &rasterBins[ty * rasterTilesX + tx];
+      if (bin->count == bin->capacity) {
+        bin->capacity = bin->capacity ? bin->capacity * 2 : 64;
+        bin->cmds = (uint32_t*)realloc(bin->cmds, bin->capacity * sizeof(uint32_t));
+      }
+      bin->cmds[bin->count++] = cmd;
+    }
+  }
+}
+
+// Function to sort the queued commands into the tiles they touch
+static void raster_bin(surface_t* surface) {
+  rasterTilesX = (surface->width + RASTER_TILE - 1) / RASTER_TILE;
+  rasterTilesY = (surface->height + RASTER_TILE - 1) / RASTER_TILE;
+  size_t tiles = (size_t)rasterTilesX * rasterTilesY;
+  if (tiles > rasterBinCount) {
+    rasterBins = (RasterBin*)realloc(rasterBins, tiles * sizeof(RasterBin));
+    memset(rasterBins + rasterBinCount, 0, (tiles - rasterBinCount) * sizeof(RasterBin));
+    rasterBinCount = tiles;
+  }
+  for (size_t i = 0; i < tiles; ++i) {
+    rasterBins[i].count = 0;
+  }
+  if (rasterCount > rasterTrisCapacity) {
+    rasterTrisCapacity = rasterCount;
+    rasterTris = (RasterTri*)realloc(rasterTris, rasterTrisCapacity * sizeof(RasterTri));
+  }
+
+  for (size_t i = 0; i < rasterCount; ++i) {
+    const RasterCmd* cmd = &rasterCmds[i];
+    if (cmd->type == RASTER_CMD_CLEAR) {
+      raster_bin_add(0, 0, rasterTilesX - 1, rasterTilesY - 1, i);
+    } else if (cmd->type == RASTER_CMD_RECT) {
+      RasterClip r = raster_rect_pixels(surface, cmd);
+      if (r.x0 <= r.x1 && r.y0 <= r.y1) {
+        raster_bin_add(r.x0 / RASTER_TILE, r.y0 / RASTER_TILE, r.x1 / RASTER_TILE, r.y1 / RASTER_TILE, i);
+      }
+    } else {
+      RasterTri* tri = &rasterTris[i];
+      if (raster_tri_setup(surface, cmd, tri)) {
+        raster_bin_add(tri->x0 / RASTER_TILE, tri->y0 / RASTER_TILE, tri->x1 / RASTER_TILE, tri->y1 / RASTER_TILE, i);
+      }
+    }
+  }
+}
+
+// Function to draw tiles until none are left, every pixel belongs to one tile so workers never share one
+static void raster_draw_tiles(RasterStats* stats) {
+  surface_t* surface = rasterTarget;
+  int tiles = rasterTilesX * rasterTilesY;
+  for (int t = __atomic_fetch_add(&rasterNextTile, 1, __ATOMIC_RELAXED); t < tiles; t = __atomic_fetch_add(&rasterNextTile, 1, __ATOMIC_RELAXED)) {
+    int tx = t % rasterTilesX, ty = t / rasterTilesX;
+    RasterClip clip = {
+      .x0 = tx * RASTER_TILE,
+      .y0 = ty * RASTER_TILE,
+      .x1 = (tx + 1) * RASTER_TILE - 1,
+      .y1 = (ty + 1) * RASTER_TILE - 1,
+    };
+    if (clip.x1 >= surface->width) clip.x1 = surface->width - 1;
+    if (clip.y1 >= surface->height) clip.y1 = surface->height - 1;
+
+    const RasterBin* bin = &rasterBins[t];
+    for (size_t i = 0; i < bin->count; ++i) {
+      const RasterCmd* cmd = &rasterCmds[bin->cmds[i]];
+      if (cmd->type == RASTER_CMD_CLEAR) {
+        raster_draw_clear(surface, cmd, &clip);
+      } else if (cmd->type == RASTER_CMD_RECT) {
+        raster_draw_rect(surface, cmd, &clip, stats);
+      } else {
+        raster_draw_tri_lanes(surface, cmd, &rasterTris[bin->cmds[i]], &clip, stats);
+      }
+    }
+  }
+}
+
+static void* raster_worker(void* arg) {
+  RasterWorker* w = (RasterWorker*)arg;
+  for (;;) {
+    pthread_mutex_lock(&rasterLock);
+    while (!rasterQuit && rasterGeneration == w->generation) {
+      pthread_cond_wait(&rasterStart, &rasterLock);
+    }
+    if (rasterQuit) {
+      pthread_mutex_unlock(&rasterLock);
+      return NULL;
+    }
+    w->generation = rasterGeneration;
+    pthread_mutex_unlock(&rasterLock);
+
+    raster_draw_tiles(&w->stats);
+
+    pthread_mutex_lock(&rasterLock);
+    if (--rasterActive == 0) {
+      pthread_cond_signal(&rasterDone);
+    }
+    pthread_mutex_unlock(&rasterLock);
+  }
+}
+
+static void raster_stats_add(RasterStats* stats) {
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    rasterStats.pixels[i] += stats->pixels[i];
+  }
+  rasterStats.written += stats->written;
+  rasterStats.covered += stats->covered;
+  rasterStats.tested += stats->tested;
+  memset(stats, 0, sizeof(RasterStats));
+}
+
+/*
+  Function to draw the frame in RASTER_TILE tiles on this thread and threads - 1
+  workers, 0 draws it on this thread with the reference walker. Both write
+  the same pixels, only tested differs: the tiles only test the part of a
+  bounding box inside them.
+*/
+void raster_set_threads(int threads) {
+  if (rasterThreads > 1) {
+    pthread_mutex_lock(&rasterLock);
+    rasterQuit = true;
+    pthread_cond_broadcast(&rasterStart);
+    pthread_mutex_unlock(&rasterLock);
+    for (int i = 1; i < rasterThreads; ++i) {
+      pthread_join(rasterWorkers[i].thread, NULL);
+    }
+    rasterQuit = false;
+  }
+
+  rasterThreads = threads < 0 ? 0 : threads > RASTER_MAX_THREADS ? RASTER_MAX_THREADS : threads;
+  for (int i = 1; i < rasterThreads; ++i) {
+    memset(&rasterWorkers[i].stats, 0, sizeof(RasterStats));
+    rasterWorkers[i].generation = rasterGeneration;
+    if (pthread_create(&rasterWorkers[i].thread, NULL, raster_worker, &rasterWorkers[i]) != 0) {
+      debugf("Failed to start raster worker %d\n", i);
+      rasterThreads = i;
+      break;
+    }
+  }
+}
+
+int raster_threads() {
+  return rasterThreads;
+}
+
+static void raster_flush_tiles(surface_t* surface) {
+  uint32_t start = get_ticks();
+  raster_bin(surface);
+
+  rasterTarget = surface;
+  rasterNextTile = 0;
+  pthread_mutex_lock(&rasterLock);
+  rasterActive = rasterThreads - 1;
+  rasterGeneration++;
+  pthread_cond_broadcast(&rasterStart);
+  pthread_mutex_unlock(&rasterLock);
+
+  raster_draw_tiles(&rasterWorkers[0].stats);
+
+  pthread_mutex_lock(&rasterLock);
+  while (rasterActive > 0) {
+    pthread_cond_wait(&rasterDone, &rasterLock);
+  }
+  pthread_mutex_unlock(&rasterLock);
+
+  for (int i = 0; i < rasterThreads; ++i) {
+    raster_stats_add(&rasterWorkers[i].stats);
+  }
+  rasterStats.triTicks += get_ticks() - start;
+}
+
+// Function to draw every queued command into the surface, like the RDP working through the frame
+void raster_flush(surface_t* surface) {
+  if (surface && surface->buffer) {
+    size_t size = (size_t)surface->width * surface->height;
+    if (size > rasterWritesSize) {
+      rasterWrites = (uint16_t*)realloc(rasterWrites, size * sizeof(uint16_t));
+      rasterWritesSize = size;
+    }
+    memset(rasterWrites, 0, size * sizeof(uint16_t));
+
+    if (rasterThreads > 0) {
+      raster_flush_tiles(surface);
+      rasterCount = 0;
+      return;
+    }
+
+    RasterClip all = { 0, 0, surface->width - 1, surface->height - 1 };
+    for (size_t i = 0; i < rasterCount; ++i) {
+      const RasterCmd* cmd = &rasterCmds[i];
+      if (cmd->type == RASTER_CMD_CLEAR) {
+        raster_draw_clear(surface, cmd, &all);
+      } else if (cmd->type == RASTER_CMD_RECT) {
+        raster_draw_rect(surface, cmd, &all, &rasterStats);
+      } else {
+        uint32_t start = get_ticks();
+        raster_draw_tri(surface, cmd);
+        rasterStats.triTicks += get_ticks() - start;
+      }
+    }
+  }
+  rasterCount = 0;
+}
+
+// Function to get the commands queued since the last flush
+size_t raster_pending() {
+  return rasterCount;
+}
+
+// Function to save an RGBA16 surface as a binary PPM
+bool raster_write_ppm(const surface_t* surface, const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    debugf("Failed to open %s\n", path);
+    return false;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", surface->width, surface->height);
+  for (int y = 0; y < surface->height; ++y) {
+    const uint16_t* row = (const uint16_t*)((const uint8_t*)surface->buffer + y * surface->stride);
+    for (int x = 0; x < surface->width; ++x) {
+      uint32_t r, g, b;
+      raster_unpack(row[x], &r, &g, &b);
+      uint8_t rgb[3] = { r, g, b };
+      fwrite(rgb, 1, 3, f);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// ====~ Edge quality ~==== //
+
+// Function to get the signed distance of a point to the edge a to b, positive inside for the given winding
+static inline float raster_edge_distance(const float* a, const float* b, float side, float x, float y) {
+  float dx = b[0] - a[0], dy = b[1] - a[1];
+  float length = sqrtf(dx * dx + dy * dy);
+  return length > 0.0f ? ((x - a[0]) * dy - (y - a[1]) * dx) / length * -side : INFINITY;
+}
+
+/*
+  Function to compare the edges of a convex polygon drawn in fg over bg with
+  ideally antialiased ones, as the mean coverage error per pixel of outline:
+  0 is exact, an aliased edge is about 0.25. Pixels within 2 of the outline
+  are read back as a coverage from 0 to 1 between the two colors and checked
+  against the share of their 8x8 samples inside the polygon. xy has count
+  x, y pairs, a polygon with many points stands in for a curve.
+*/
+float raster_convex_error(const surface_t* surface, const float* xy, int count, color_t fg, color_t bg) {
+  // Both colors as the framebuffer stores them, so flat pixels read back as exactly 0 or 1
+  uint32_t br, bgg, bb, cr, cg, cb;
+  raster_unpack(raster_pack(bg.r, bg.g, bg.b), &br, &bgg, &bb);
+  raster_unpack(raster_pack(fg.r, fg.g, fg.b), &cr, &cg, &cb);
+  float dr = (float)cr - br, dg = (float)cg - bgg, db = (float)cb - bb;
+  float contrast = dr * dr + dg * dg + db * db;
+  if (contrast == 0.0f || count < 3) {
+    return 0.0f;
+  }
+
+  float area = 0.0f, perimeter = 0.0f;
+  float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+  for (int i = 0; i < count; ++i) {
+    const float* a = &xy[i * 2];
+    const float* b = &xy[((i + 1) % count) * 2];
+    area += a[0] * b[1] - b[0] * a[1];
+    perimeter += hypotf(b[0] - a[0], b[1] - a[1]);
+    minX = fminf(minX, a[0]);
+    minY = fminf(minY, a[1]);
+    maxX = fmaxf(maxX, a[0]);
+    maxY = fmaxf(maxY, a[1]);
+  }
+  float side = area > 0.0f ? 1.0f : -1.0f;
+
+  int x0 = (int)floorf(minX - 2.0f), x1 = (int)ceilf(maxX + 2.0f);
+  int y0 = (int)floorf(minY - 2.0f), y1 = (int)ceilf(maxY + 2.0f);
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > surface->width) x1 = surface->width;
+  if (y1 > surface->height) y1 = surface->height;
+
+  double error = 0.0;
+  for (int y = y0; y < y1; ++y) {
+    const uint16_t* row = (const uint16_t*)((const uint8_t*)surface->buffer + y * surface->stride);
+    for (int x = x0; x < x1; ++x) {
+      // Distance of the pixel center to the outline, the smallest one for inside points
+      float d = INFINITY;
+      for (int i = 0; i < count; ++i) {
+        d = fminf(d, fabsf(raster_edge_distance(&xy[i * 2], &xy[((i + 1) % count) * 2], side, x + 0.5f, y + 0.5f)));
+      }
+      if (d > 2.0f) {
+        continue;
+      }
+
+      int inside = 0;
+      for (int sy = 0; sy < 8; ++sy) {
+        for (int sx = 0; sx < 8; ++sx) {
+          float px = x + (sx + 0.5f) / 8.0f, py = y + (sy + 0.5f) / 8.0f;
+          bool in = true;
+          for (int i = 0; i < count && in; ++i) {
+            in = raster_edge_distance(&xy[i * 2], &xy[((i + 1) % count) * 2], side, px, py) >= 0.0f;
+          }
+          inside += in;
+        }
+      }
+      uint32_t pr, pg, pb;
+      raster_unpack(row[x], &pr, &pg, &pb);
+      float cover = (((float)pr - br) * dr + ((float)pg - bgg) * dg + ((float)pb - bb) * db) / contrast;
+      error += fabsf(fminf(fmaxf(cover, 0.0f), 1.0f) - inside / 64.0f);
+    }
+  }
+  return (float)(error / perimeter);
+}
+
+// ====~ Heatmap ~==== //
+
+// Function to get the overdraw of the last flushed frame
+void raster_heat(const surface_t* surface, RasterHeat* heat) {
+  memset(heat, 0, sizeof(RasterHeat));
+  size_t size = (size_t)surface->width * surface->height;
+  if (!rasterWrites || size > rasterWritesSize) {
+    return;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    uint32_t n = rasterWrites[i];
+    if (n == 0) {
+      continue;
+    }
+    heat->touched++;
+    heat->writes += n;
+    if (n > heat->max) heat->max = n;
+    if (n > 2) heat->over2++;
+  }
+}
+
+// Colors for 1 to 7 writes, 8 or more are white
+static const uint8_t rasterHeatRamp[8][3] = {
+  { 0, 0, 0 },
+  { 0, 0, 255 },
+  { 0, 192, 0 },
+  { 255, 255, 0 },
+  { 255, 128, 0 },
+  { 255, 0, 0 },
+  { 255, 0, 255 },
+  { 160, 0, 160 },
+};
+
+// Function to save the writes per pixel of the last flushed frame as a PPM, untouched pixels are the frame in dark grey
+bool raster_write_heatmap(const surface_t* surface, const char* path) {
+  size_t size = (size_t)surface->width * surface->height;
+  if (!rasterWrites || size > rasterWritesSize) {
+    debugf("No heatmap for %s, nothing was flushed\n", path);
+    return false;
+  }
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    debugf("Failed to open %s\n", path);
+    return false;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", surface->width, surface->height);
+  for (int y = 0; y < surface->height; ++y) {
+    const uint16_t* row = (const uint16_t*)((const uint8_t*)surface->buffer + y * surface->stride);
+    const uint16_t* writes = rasterWrites + y * surface->width;
+    for (int x = 0; x < surface->width; ++x) {
+      uint8_t rgb[3];
+      if (writes[x] == 0) {
+        uint32_t r, g, b;
+        raster_unpack(row[x], &r, &g, &b);
+        rgb[0] = rgb[1] = rgb[2] = (r + g + b) / 12;
+      } else if (writes[x] >= 8) {
+        rgb[0] = rgb[1] = rgb[2] = 255;
+      } else {
+        memcpy(rgb, rasterHeatRamp[writes[x]], 3);
+      }
+      fwrite(rgb, 1, 3, f);
+    }
+  }
+  fclose(f);
+  return true;
+}
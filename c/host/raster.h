@@ -0,0 +1,94 @@
+#ifndef HOST_RASTER_H
+#define HOST_RASTER_H
+
+#include <libdragon.h>
+#include "../rdpcap.h"
+
+/*
+  Software rasterizer for the host build.
+
+  Commands are queued during the frame like they would be in the RSPQ and
+  drawn into the attached RGBA16 surface by raster_flush, which the stand-in
+  calls from rdpq_detach_show. Positions are snapped to quarter pixels like
+  the RDP's s13.2 input and coverage uses pixel centers with a top-left rule,
+  all in integers so the output only depends on the commands. This is close
+  to, not identical with, the RDP's edge walker.
+
+  With raster_set_threads, or HOST_RASTER_THREADS=<n>, raster_flush first
+  bins the commands into RASTER_TILE square tiles by their bounding boxes,
+  then draws whole tiles on n threads, each tile its commands in queue order
+  and four pixels of edge functions at a time. A pixel is only ever written
+  by its tile, so the frame is bit for bit the one of the reference walker,
+  which draws every command over the whole surface one pixel at a time.
+*/
+
+#define RASTER_TILE 64 // Pixels per side of a tile
+#define RASTER_MAX_THREADS 16
+
+// Combiners the rasterizer understands, see RDPQ_COMBINER_* in libdragon.h
+typedef enum {
+  RASTER_COMB_FLAT,
+  RASTER_COMB_SHADE,
+  RASTER_COMB_TEX,
+  RASTER_COMB_TEX_FLAT,
+  RASTER_COMB_TEX_SHADE,
+} RASTER_COMBINERS;
+
+typedef struct {
+  int32_t x, y; // Quarter pixels
+  uint8_t r, g, b, a;
+  float s, t; // Texels
+} RasterVertex;
+
+typedef struct {
+  uint8_t combiner;
+  bool blend; // Alpha blend with the framebuffer, RDPQ_BLENDER_MULTIPLY
+  bool fill; // Fill mode, rectangles write the fill color as is
+  color_t prim;
+  color_t fillColor;
+  const sprite_t* tex;
+} RasterState;
+
+// Pixels written by triangles since the start, to check the estimates of fillrate.h against
+typedef struct {
+  uint64_t pixels[CAP_TAG_COUNT]; // Per draw call
+  uint64_t written;
+  uint64_t covered; // Pixels written at least once in their frame
+  uint64_t tested; // Pixel centers the triangle walker tested, inside or not
+  uint64_t triTicks; // Host time spent drawing triangles, with threads binning and drawing the whole frame
+} RasterStats;
+
+// Overdraw of the last flushed frame, writes are counted per pixel for triangles only
+typedef struct {
+  uint32_t touched; // Pixels written at least once
+  uint32_t writes;
+  uint32_t max; // Most writes to one pixel
+  uint32_t over2; // Pixels written more than twice
+} RasterHeat;
+
+extern RasterStats rasterStats;
+
+void raster_set_combiner(int combiner);
+void raster_set_blend(bool blend);
+void raster_set_prim(color_t color);
+void raster_set_texture(const sprite_t* sprite);
+void raster_set_fill(color_t color);
+void raster_set_fill_mode(bool fill);
+void raster_push_mode();
+void raster_pop_mode();
+void raster_clear(color_t color);
+void raster_triangle(const RasterVertex* v1, const RasterVertex* v2, const RasterVertex* v3);
+void raster_rectangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+void raster_flush(surface_t* surface);
+void raster_set_threads(int threads);
+int raster_threads();
+size_t raster_pending();
+bool raster_write_ppm(const surface_t* surface, const char* path);
+void raster_heat(const surface_t* surface, RasterHeat* heat);
+bool raster_write_heatmap(const surface_t* surface, const char* path);
+float raster_convex_error(const surface_t* surface, const float* xy, int count, color_t fg, color_t bg);
+
+// Function to get a vertex from rdpq_triangle's float layout
+RasterVertex raster_vertex(const rdpq_trifmt_t* fmt, const float* v);
+
+#endif // HOST_RASTER_H
@@ -0,0 +1,7 @@
+#ifndef HOST_RSPQ_CONSTANTS_H
+#define HOST_RSPQ_CONSTANTS_H
+
+// There is no RSP on the host to profile
+#define RSPQ_PROFILE 0
+
+#endif // HOST_RSPQ_CONSTANTS_H
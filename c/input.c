@@ -0,0 +1,283 @@
+#include <libdragon.h>
+#include "input.h"
+#include "memtrack.h"
+
+/*
+  File:  "INPR" u16 version, u32 rand() seed
+  Runs:  u8 frames, u16 held buttons, s8 stick x, s8 stick y
+  A run covers up to 255 frames of unchanged input, so idle stretches cost 5 bytes.
+*/
+#define INPUT_RUN_BYTES 5
+
+static int inputMode;
+static uint32_t inputFrames;
+static uint16_t inputPrevHeld;
+
+// Recording
+static FILE* inputFile;
+static InputFrame inputRun;
+static uint32_t inputRunLength;
+static uint8_t inputBuffer[1024];
+static size_t inputUsed;
+
+// Replay, the whole file is kept in memory
+static uint8_t* inputData;
+static size_t inputSize;
+static size_t inputPos;
+static uint32_t inputRunLeft;
+
+void input_init() {
+  inputMode = INPUT_LIVE;
+  inputFrames = 0;
+  inputPrevHeld = 0;
+
+  // Writes out the last run when the host build stops after HOST_FRAMES
+  atexit(input_stop);
+
+#if INPUT_REPLAY
+  input_replay_start(INPUT_PATH);
+#elif INPUT_RECORD
+  input_record_start(INPUT_PATH);
+#endif
+
+#ifdef N64_HOST
+  // The host build takes its files from the environment
+  const char* replay = getenv("INPUT_REPLAY");
+  const char* record = getenv("INPUT_RECORD");
+  if (replay && *replay) {
+    input_replay_start(replay);
+  } else if (record && *record) {
+    input_record_start(record);
+  }
+#endif // N64_HOST
+}
+
+// Function to convert libdragon's buttons to the recorded bits
+static uint16_t input_pack(joypad_buttons_t b) {
+  return (b.a       ? INPUT_BTN_A       : 0) |
+         (b.b       ? INPUT_BTN_B       : 0) |
+         (b.z       ? INPUT_BTN_Z       : 0) |
+         (b.start   ? INPUT_BTN_START   : 0) |
+         (b.d_up    ? INPUT_BTN_D_UP    : 0) |
+         (b.d_down  ? INPUT_BTN_D_DOWN  : 0) |
+         (b.d_left  ? INPUT_BTN_D_LEFT  : 0) |
+         (b.d_right ? INPUT_BTN_D_RIGHT : 0) |
+         (b.l       ? INPUT_BTN_L       : 0) |
+         (b.r       ? INPUT_BTN_R       : 0) |
+         (b.c_up    ? INPUT_BTN_C_UP    : 0) |
+         (b.c_down  ? INPUT_BTN_C_DOWN  : 0) |
+         (b.c_left  ? INPUT_BTN_C_LEFT  : 0) |
+         (b.c_right ? INPUT_BTN_C_RIGHT : 0);
+}
+
+static joypad_buttons_t input_unpack(uint16_t bits) {
+  joypad_buttons_t b;
+  memset(&b, 0, sizeof(b));
+  b.a       = (bits & INPUT_BTN_A) != 0;
+  b.b       = (bits & INPUT_BTN_B) != 0;
+  b.z       = (bits & INPUT_BTN_Z) != 0;
+  b.start   = (bits & INPUT_BTN_START) != 0;
+  b.d_up    = (bits & INPUT_BTN_D_UP) != 0;
+  b.d_down  = (bits & INPUT_BTN_D_DOWN) != 0;
+  b.d_left  = (bits & INPUT_BTN_D_LEFT) != 0;
+  b.d_right = (bits & INPUT_BTN_D_RIGHT) != 0;
+  b.l       = (bits & INPUT_BTN_L) != 0;
+  b.r       = (bits & INPUT_BTN_R) != 0;
+  b.c_up    = (bits & INPUT_BTN_C_UP) != 0;
+  b.c_down  = (bits & INPUT_BTN_C_DOWN) != 0;
+  b.c_left  = (bits & INPUT_BTN_C_LEFT) != 0;
+  b.c_right = (bits & INPUT_BTN_C_RIGHT) != 0;
+  return b;
+}
+
+static void input_flush() {
+  if (inputFile && inputUsed > 0) {
+    fwrite(inputBuffer, 1, inputUsed, inputFile);
+    fflush(inputFile);
+  }
+  inputUsed = 0;
+}
+
+static void input_write_run() {
+  if (inputRunLength == 0) {
+    return;
+  }
+  if (inputUsed + INPUT_RUN_BYTES > sizeof(inputBuffer)) {
+    input_flush();
+  }
+  inputBuffer[inputUsed++] = inputRunLength;
+  inputBuffer[inputUsed++] = inputRun.held >> 8;
+  inputBuffer[inputUsed++] = inputRun.held & 0xFF;
+  inputBuffer[inputUsed++] = (uint8_t)inputRun.stickX;
+  inputBuffer[inputUsed++] = (uint8_t)inputRun.stickY;
+  inputRunLength = 0;
+}
+
+// Function to add one frame to the recording, identical frames extend the current run
+static void input_record(InputFrame f) {
+  bool same = inputRun.held == f.held && inputRun.stickX == f.stickX && inputRun.stickY == f.stickY;
+  if (inputRunLength > 0 && (!same || inputRunLength == 255)) {
+    input_write_run();
+  }
+  inputRun = f;
+  inputRunLength++;
+
+  // The main loop never returns, so write out regularly instead of at stop
+  if ((inputFrames & 63) == 63) {
+    input_flush();
+  }
+}
+
+// Function to start recording, rand() is reseeded so the replay starts from the same state
+bool input_record_start(const char* path) {
+  input_stop();
+
+  inputFile = fopen(path, "wb");
+  if (!inputFile) {
+    debugf("Failed to open input recording %s\n", path);
+    return false;
+  }
+
+  inputUsed = 0;
+  inputBuffer[inputUsed++] = 'I';
+  inputBuffer[inputUsed++] = 'N';
+  inputBuffer[inputUsed++] = 'P';
+  inputBuffer[inputUsed++] = 'R';
+  inputBuffer[inputUsed++] = INPUT_VERSION >> 8;
+  inputBuffer[inputUsed++] = INPUT_VERSION & 0xFF;
+  for (int i = 3; i >= 0; --i) {
+    inputBuffer[inputUsed++] = (INPUT_SEED >> (i * 8)) & 0xFF;
+  }
+  input_flush();
+
+  srand(INPUT_SEED);
+  inputRunLength = 0;
+  inputFrames = 0;
+  inputPrevHeld = 0;
+  inputMode = INPUT_RECORDING;
+  return true;
+}
+
+// Function to load a recording and feed it to input_get from the next frame on
+bool input_replay_start(const char* path) {
+  input_stop();
+
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    debugf("Failed to open input replay %s\n", path);
+    return false;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  if (size < 10) {
+    debugf("Input replay %s is too short\n", path);
+    fclose(f);
+    return false;
+  }
+
+  inputData = (uint8_t*)mem_malloc(size);
+  if (!inputData) {
+    fclose(f);
+    return false;
+  }
+  inputSize = fread(inputData, 1, size, f);
+  fclose(f);
+
+  if (memcmp(inputData, "INPR", 4) != 0 || ((inputData[4] << 8) | inputData[5]) != INPUT_VERSION) {
+    debugf("%s is not an input recording\n", path);
+    mem_free(inputData);
+    inputData = NULL;
+    return false;
+  }
+
+  uint32_t seed = ((uint32_t)inputData[6] << 24) | (inputData[7] << 16) | (inputData[8] << 8) | inputData[9];
+  srand(seed);
+
+  input_rewind();
+  inputMode = INPUT_REPLAYING;
+  return true;
+}
+
+// Function to go back to the first frame of the replay, so every benchmark case sees the same input
+void input_rewind() {
+  inputPos = 10;
+  inputRunLeft = 0;
+  inputFrames = 0;
+  inputPrevHeld = 0;
+}
+
+void input_stop() {
+  if (inputFile) {
+    input_write_run();
+    input_flush();
+    fclose(inputFile);
+    inputFile = NULL;
+  }
+  if (inputData) {
+    mem_free(inputData);
+    inputData = NULL;
+  }
+  inputMode = INPUT_LIVE;
+}
+
+int input_mode() {
+  return inputMode;
+}
+
+uint32_t input_frame() {
+  return inputFrames;
+}
+
+// Function to get the next replayed frame, returns false at the end of the recording
+static bool input_next(InputFrame* f) {
+  while (inputRunLeft == 0) {
+    if (inputPos + INPUT_RUN_BYTES > inputSize) {
+      return false;
+    }
+    inputRunLeft = inputData[inputPos];
+    inputRun.held = (inputData[inputPos + 1] << 8) | inputData[inputPos + 2];
+    inputRun.stickX = (int8_t)inputData[inputPos + 3];
+    inputRun.stickY = (int8_t)inputData[inputPos + 4];
+    inputPos += INPUT_RUN_BYTES;
+  }
+  inputRunLeft--;
+  *f = inputRun;
+  return true;
+}
+
+/*
+  Function to get this frame's joypad state, call once per frame after joypad_poll.
+  Live and recording read the joypad, replay fills the same structs from the file.
+*/
+void input_get(joypad_port_t port, joypad_inputs_t* inputs, joypad_buttons_t* pressed, joypad_buttons_t* held) {
+  if (inputMode == INPUT_REPLAYING) {
+    InputFrame f;
+    if (input_next(&f)) {
+      memset(inputs, 0, sizeof(joypad_inputs_t));
+      inputs->btn = input_unpack(f.held);
+      inputs->stick_x = f.stickX;
+      inputs->stick_y = f.stickY;
+      *held = inputs->btn;
+      *pressed = input_unpack(f.held & ~inputPrevHeld);
+      inputPrevHeld = f.held;
+      inputFrames++;
+      return;
+    }
+
+    debugf("Input replay finished after %lu frames\n", (unsigned long)inputFrames);
+    input_stop();
+  }
+
+  *inputs = joypad_get_inputs(port);
+  *pressed = joypad_get_buttons_pressed(port);
+  *held = joypad_get_buttons_held(port);
+
+  if (inputMode == INPUT_RECORDING) {
+    InputFrame f = { .held = input_pack(*held), .stickX = inputs->stick_x, .stickY = inputs->stick_y };
+    input_record(f);
+    inputPrevHeld = f.held;
+  }
+  inputFrames++;
+}
@@ -0,0 +1,67 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <libdragon.h>
+
+// Define whether to record the joypad to INPUT_PATH, or replay it from there
+#ifndef INPUT_RECORD
+#define INPUT_RECORD 0
+#endif
+
+#ifndef INPUT_REPLAY
+#define INPUT_REPLAY 0
+#endif
+
+#ifndef INPUT_PATH
+#define INPUT_PATH "sd:/input.rec"
+#endif
+
+#define INPUT_VERSION 1
+
+// Seed for rand() when recording or replaying, so random colors match too
+#define INPUT_SEED 1
+
+/*
+  Held buttons are stored as these bits and not as joypad_buttons_t.raw,
+  so recordings read the same on the console and in the host build.
+  Pressed buttons are worked out from the held ones on replay.
+*/
+typedef enum {
+  INPUT_BTN_A       = 1 << 0,
+  INPUT_BTN_B       = 1 << 1,
+  INPUT_BTN_Z       = 1 << 2,
+  INPUT_BTN_START   = 1 << 3,
+  INPUT_BTN_D_UP    = 1 << 4,
+  INPUT_BTN_D_DOWN  = 1 << 5,
+  INPUT_BTN_D_LEFT  = 1 << 6,
+  INPUT_BTN_D_RIGHT = 1 << 7,
+  INPUT_BTN_L       = 1 << 8,
+  INPUT_BTN_R       = 1 << 9,
+  INPUT_BTN_C_UP    = 1 << 10,
+  INPUT_BTN_C_DOWN  = 1 << 11,
+  INPUT_BTN_C_LEFT  = 1 << 12,
+  INPUT_BTN_C_RIGHT = 1 << 13,
+} INPUT_BUTTONS;
+
+typedef struct {
+  uint16_t held;
+  int8_t stickX;
+  int8_t stickY;
+} InputFrame;
+
+typedef enum {
+  INPUT_LIVE,
+  INPUT_RECORDING,
+  INPUT_REPLAYING
+} INPUT_MODES;
+
+void input_init();
+bool input_record_start(const char* path);
+bool input_replay_start(const char* path);
+void input_stop();
+void input_rewind();
+int input_mode();
+uint32_t input_frame();
+void input_get(joypad_port_t port, joypad_inputs_t* inputs, joypad_buttons_t* pressed, joypad_buttons_t* held);
+
+#endif // INPUT_H
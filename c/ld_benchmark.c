@@ -1,31 +1,450 @@
 #include <libdragon.h>
-#include <malloc.h>
-
-#include "rspq_constants.h"
-#if defined(RSPQ_PROFILE) && RSPQ_PROFILE
-#include "rspq_profile.h"
-static rspq_profile_data_t profile_data;
-#endif // RSPQ_PROFILE
-
-// Global variables
-surface_t disp;
-float stickX, stickY;
-uint32_t screenWidth, screenHeight, frameCounter;
-struct mallinfo mem_info;
-int ramUsed = 0;
-int totalMem = 0;
+
+#include "examples/globals.h"
+#include "examples/control.h"
+
+#include "examples/chain.h"
+#include "examples/snake.h"
+
+#include "input.h"
+#include "scene.h"
+#include "fixed.h"
+
+#ifdef N64_HOST
+#include <pthread.h>
+#include <sched.h>
+#include "raster.h"
+#include "jobs.h"
+#include "cmdq.h"
+#endif // N64_HOST
+
+/*
+  Benchmark suite for the primitives in render.c and the snake scene.
+
+  Every case is run once per value of its parameter sweep. Each value gets
+  BENCH_WARMUP frames that are thrown away and BENCH_FRAMES frames that are
+  measured. Within a frame the primitive is drawn `reps` times so short calls
+  are well above the timer resolution, and everything is reported per call.
+
+  Results go to the debug log as one `bench,` CSV line per case and value:
+
+    bench,case,param,value,frames,reps,cpu_min_us,cpu_avg_us,cpu_max_us,
+          tris,verts,rspq_bytes,rdp_bytes,allocs,alloc_bytes,fill_cost
+
+  Triangles, vertices and bytes are counted by rdpcap.h, allocations by
+  memtrack.h, the RDP fill cost in pixels is estimated by fillrate.h. Compare two runs with tools/bench_compare.py.
+
+  The host build adds a `raster,` line per case and value with what its
+  rasterizer did per call: pixel centers tested by the triangle walker and
+  the host time spent in triangles.
+
+    raster,case,value,tested,tri_us
+
+  Cases that draw one BENCH_AA_RADIUS circle in the middle also get an
+  `edge,` line to weigh edge quality against triangles, from the last frame:
+  the coverage error of the edges against ideally antialiased ones of the
+  polygon drawn (alias_err) and of the circle itself (shape_err), see
+  raster_convex_error. The second one adds what the segments cut off.
+
+    edge,case,value,tris,alias_err,shape_err
+
+  The spatial hash of spatial.h is timed with BENCH_SPATIAL_SHAPES circles
+  spread over a large world: inserting them all, moving them all a few
+  pixels, then rect, radius and nearest queries against testing every box.
+  Times are per call, found is what the rect and radius queries returned
+  and matches whether every query agreed with the brute force one:
+
+    spatial,shapes,cell,build_us,update_us,relinks,rect_us,rect_brute_us,radius_us,radius_brute_us,nearest_us,nearest_brute_us,found,matches
+
+  BENCH_COLLIDE_SNAKES snakes then swim in tight loops through each other and
+  themselves, one capsule per link in a collision world (collide.h). The
+  `collide,` line has the time per frame of solving the chains, moving the
+  capsules, the sweep and prune broadphase and the exact tests, what the
+  broadphase let through, the contacts and how many of those a snake had
+  with itself. The host checks the last frame against testing every pair
+  exactly:
+
+    collide,snakes,colliders,frames,solve_ms,update_ms,broad_ms,narrow_ms,step_ms,candidates,tests,contacts,self,matches
+
+  A BVH (bvh.h) of BENCH_BVH_SHAPES static circles is built, refitted after
+  every circle moved a few pixels and queried with views the size of the
+  screen and picks in their middle, against testing every box. A view then
+  pans over the world, every circle is drawn and then only those the BVH
+  finds in view, with the CPU time of the draw calls and the triangles per
+  frame of both. visible and visited are the circles drawn and the nodes
+  visited per frame, the host also checks both last frames are the same:
+
+    bvh,shapes,nodes,depth,build_us,refit_us,view_us,view_brute_us,nearest_us,nearest_brute_us,visible,visited,draw_all_ms,draw_bvh_ms,tris_all,tris_bvh,matches
+
+  BENCH_SCENE_CREATURES creature rigs of the scene graph (scene.h), a body,
+  a tail, two fins and two eyes with pupils each, first stand still, then
+  only flap their fins and tail, then swim around while drawn. Every phase
+  has the time of scene_update per frame and the nodes it transformed,
+  sort_us is one update after a z change, draw_ms the draw calls of the
+  swimming frames:
+
+    scene,creatures,nodes,draws,frames,idle_us,idle_nodes,fins_us,fins_nodes,swim_us,swim_nodes,sort_us,draw_ms,tris
+
+  BENCH_MESH_SHAPES cached circle outlines of BENCH_MESH_POINTS points are
+  kept once as float points and once packed (PointQ in point.h). Every
+  frame all of them are moved by a pixel, rotated from a copy and drawn,
+  with the time per frame of each and the bytes both take. The host also
+  checks the last frames of both are the same:
+
+    mesh,shapes,points,float_bytes,packed_bytes,frames,translate_float_us,translate_packed_us,rotate_float_us,rotate_packed_us,draw_float_ms,draw_packed_ms,matches
+
+  The geometry math of the build, float or s16.16 fixed point when built
+  with POINT_FIXED=1 (fixed.h), is timed per call over BENCH_FIXED_POINTS
+  random vectors: point_normalized, point_heading, point_from_angle and
+  point_rotate, then BENCH_FIXED_CIRCLES draw_circle outlines a frame and
+  chain_resolve of a BENCH_FIXED_JOINTS chain following a target. The
+  errors are the largest against double precision math, and for the chain
+  how far a link got from its length. Run both builds to compare:
+
+    fixed,backend,points,normalize_ns,heading_ns,from_angle_ns,rotate_ns,circles_ms,chain_us,normalize_err,heading_err,rotate_err,chain_err
+
+  The host then draws a scene of BENCH_JOBS_SHAPES curves, filled shapes and
+  circles plus the four snakes with the job system of host/jobs.h, on one
+  thread without it and on 1 to BENCH_JOBS_THREADS workers, at least one per
+  core. Every thread count gets a `jobs,` line with the frame time, the
+  speedup over the single threaded frame, and whether its triangles and last
+  frame match the single threaded ones exactly:
+
+    jobs,threads,cores,shapes,frames,cpu_avg_ms,speedup,tess_ms,replay_ms,steals,tris,identical
+
+  The command queue of host/cmdq.h gets BENCH_CMDQ_DRAWS of those shapes a
+  frame, each submitted as its own segment by 1 to BENCH_CMDQ_PRODUCERS
+  producer threads while the main thread drains them. Every producer count
+  gets a `cmdq,` line with the frame time, the draws drained per ms, how
+  often a producer found its ring full and a drain stopped at a ticket not
+  published yet, and the average segment:
+
+    cmdq,producers,cores,draws,frames,cpu_avg_ms,draws_per_ms,waits,stalls,segment_bytes
+
+  Last the same shapes are scaled up to a BENCH_TILES_WIDTH x
+  BENCH_TILES_HEIGHT target and rasterized by the reference rasterizer and
+  by the tile mode of host/raster.h on 1 to at least one thread per core. A
+  `tiles,` line per thread count has the time of rdpq_detach_show, which
+  draws the frame, and whether the pixels match the reference ones:
+
+    tiles,threads,cores,width,height,frames,tris,raster_ms,speedup,identical
+
+  With an input replay (INPUT_REPLAY, see input.h) the snakes follow the
+  recorded stick instead of the built in path, rewound for every value.
+*/
+
+// Frames measured per case and value
+#ifndef BENCH_FRAMES
+#define BENCH_FRAMES 60
+#endif
+
+// Frames drawn before measuring, so caches and the RSPQ are warm
+#ifndef BENCH_WARMUP
+#define BENCH_WARMUP 10
+#endif
+
+#define BENCH_MAX_VALUES 6
+#define BENCH_MAX_FAN 256
+#define BENCH_AA_RADIUS 40.0f
+#define BENCH_JOBS_SHAPES 600
+#define BENCH_JOBS_THREADS 8
+#define BENCH_TILES_WIDTH 3840
+#define BENCH_TILES_HEIGHT 2160
+#define BENCH_TILES_FRAMES 10 // Measured per thread count, a frame that large takes a while
+#define BENCH_CMDQ_DRAWS 2400 // Per frame, split over the producers
+#define BENCH_CMDQ_PRODUCERS 16
+#define BENCH_SPATIAL_SHAPES 10000
+#define BENCH_SPATIAL_WORLD 4096.0f // Side of the square the shapes are spread over
+#define BENCH_SPATIAL_QUERIES 256
+#define BENCH_SPATIAL_MAX_FOUND 512
+#define BENCH_COLLIDE_SNAKES 1000
+#define BENCH_COLLIDE_WORLD 4000.0f // Side of the square the snakes swim in
+#define BENCH_COLLIDE_MAX_PAIRS 32768
+#define BENCH_BVH_SHAPES 20000
+#define BENCH_SCENE_CREATURES 400
+#define BENCH_MESH_SHAPES 1000
+#define BENCH_MESH_POINTS 24 // Per cached outline
+#define BENCH_FIXED_POINTS 4096
+#define BENCH_FIXED_REPS 50 // Passes over the points per timed function
+#define BENCH_FIXED_JOINTS 64
+#define BENCH_FIXED_CIRCLES 200
+#define BENCH_BVH_WORLD 2048.0f // Side of the square the shapes are spread over, a few hundred of them fit on the screen
+
+typedef struct {
+  const char* name;
+  const char* param; // Name of the swept parameter
+  int reps; // Calls per frame
+  int valueCount;
+  float values[BENCH_MAX_VALUES];
+  void (*prepare)(float value); // Optional, not timed
+  void (*run)(float value, int rep);
+  bool edges; // Host only, compare the edges of the BENCH_AA_RADIUS circle with ideal ones
+} BenchCase;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t minTicks;
+  uint32_t maxTicks;
+  uint64_t totalTicks;
+  uint64_t tris;
+  uint64_t verts;
+  uint64_t rspqBytes;
+  uint64_t rdpBytes;
+  uint64_t allocs;
+  uint64_t allocBytes;
+  double fillCost;
+} BenchResult;
+
+static int benchFrame;
+
+// Control points shared by the curve cases, same layout as the bezier example
+static Point benchCurve[4];
+static Point benchBase[4];
+
+static Point benchFanPoints[BENCH_MAX_FAN];
+static PointArray benchFan = { .count = 0, .points = benchFanPoints };
+
+static Snake* benchSnakes[4];
+
+static sprite_t* benchSprite;
+
+// ====~ Cases ~==== //
+
+static void bench_circle(float radius, int rep) {
+  draw_circle(screenCenter.x + (rep & 7), screenCenter.y, radius, radius, 0.0f, 0.05f);
+}
+
+// The same circles submitted as a fan from their first point, to compare against the strip
+static void bench_circle_fan(float radius, int rep) {
+  RenderConvexMode prev = renderConvexMode;
+  renderConvexMode = RENDER_CONVEX_FAN;
+  bench_circle(radius, rep);
+  renderConvexMode = prev;
+}
+
+static void bench_line(float thickness, int rep) {
+  draw_line(40.0f, 40.0f + (rep & 7), 280.0f, 200.0f - (rep & 7), thickness);
+}
+
+static void bench_quad(float size, int rep) {
+  float half = size * 0.5f;
+  draw_quad(screenCenter.x - half, screenCenter.y - half, screenCenter.x + half, screenCenter.y + half, 0.1f * (rep & 7), 1.0f);
+}
+
+static void bench_bezier_curve(float segments, int rep) {
+  draw_bezier_curve(&benchCurve[0], &benchCurve[1], &benchCurve[2], &benchCurve[3], (int)segments, 0.0f, 2.0f);
+}
+
+static void bench_filled_beziers(float segments, int rep) {
+  draw_filled_beziers(
+    &benchCurve[0], &benchCurve[1], &benchCurve[2], &benchCurve[3],
+    &benchBase[0], &benchBase[1], &benchBase[2], &benchBase[3],
+    (int)segments
+  );
+}
+
+static void bench_filled_bezier_shape(float segments, int rep) {
+  draw_filled_bezier_shape(&benchCurve[0], &benchCurve[1], &benchCurve[2], &benchCurve[3], (int)segments);
+}
+
+// Function to place the fan points on an ellipse, done once per value so only the fan is timed
+static void bench_rdp_fan_prepare(float points) {
+  int count = (int)points;
+  if (count > BENCH_MAX_FAN) {
+    count = BENCH_MAX_FAN;
+  }
+  for (int i = 0; i < count; ++i) {
+    float angle = TWO_PI * (float)i / (float)count;
+    benchFanPoints[i] = point_new(screenCenter.x + 80.0f * fm_cosf(angle), screenCenter.y + 60.0f * fm_sinf(angle));
+  }
+  benchFan.count = count;
+}
+
+static void bench_rdp_fan(float points, int rep) {
+  draw_rdp_fan(&benchFan, screenCenter);
+}
+
+/*
+  A rect heavy UI: a grid of buttons, half of them large enough for fill
+  mode. ui_rects goes through draw_quad's rectangle path,
+  ui_rects_strip draws the same rectangles as 2 triangles each like before.
+*/
+static void bench_ui_rect(int i, float* x0, float* y0, float* x1, float* y1) {
+  int col = i % 8;
+  int row = (i / 8) % 16;
+  float w = (i & 1) ? 36.0f : 12.0f;
+  *x0 = 4.0f + col * 39.0f;
+  *y0 = 4.0f + row * 14.0f;
+  *x1 = *x0 + w;
+  *y1 = *y0 + ((i & 1) ? 12.0f : 8.0f);
+}
+
+static void bench_ui_rects(float rects, int rep) {
+  for (int i = 0; i < (int)rects; ++i) {
+    float x0, y0, x1, y1;
+    bench_ui_rect(i, &x0, &y0, &x1, &y1);
+    draw_quad(x0, y0, x1, y1, 0.0f, 0.0f);
+  }
+}
+
+static void bench_ui_rects_strip(float rects, int rep) {
+  for (int i = 0; i < (int)rects; ++i) {
+    float x0, y0, x1, y1;
+    bench_ui_rect(i, &x0, &y0, &x1, &y1);
+    float v1[] = { x0, y0 };
+    float v2[] = { x1, y0 };
+    float v3[] = { x0, y1 };
+    float v4[] = { x1, y1 };
+    draw_strip(v1, v2, v3, v4);
+  }
+}
+
+/*
+  Horizontal bands in a ramp of colors, the gradient look done with flat
+  colors: bands_flat sets the prim color before every band, bands_gradient
+  draws the same bands shaded by one linear gradient.
+*/
+static void bench_band(int i, int bands, float* v1, float* v2, float* v3, float* v4) {
+  float h = 160.0f / bands;
+  float y0 = 40.0f + i * h;
+  v1[0] = 40.0f;  v1[1] = y0;
+  v2[0] = 280.0f; v2[1] = y0;
+  v3[0] = 40.0f;  v3[1] = y0 + h;
+  v4[0] = 280.0f; v4[1] = y0 + h;
+}
+
+static void bench_bands_flat(float bands, int rep) {
+  for (int i = 0; i < (int)bands; ++i) {
+    float v1[2], v2[2], v3[2], v4[2];
+    bench_band(i, (int)bands, v1, v2, v3, v4);
+    uint8_t t = 255 * i / (int)bands;
+    set_render_color(RGBA32(255 - t, t, 64, 255));
+    draw_strip(v1, v2, v3, v4);
+  }
+}
+
+static void bench_bands_gradient(float bands, int rep) {
+  Gradient g = gradient_linear(point_new(0.0f, 40.0f), point_new(0.0f, 200.0f), RGBA32(255, 0, 64, 255), RGBA32(0, 255, 64, 255));
+  set_render_gradient(&g);
+  for (int i = 0; i < (int)bands; ++i) {
+    float v1[2], v2[2], v3[2], v4[2];
+    bench_band(i, (int)bands, v1, v2, v3, v4);
+    draw_strip(v1, v2, v3, v4);
+  }
+  set_render_gradient(NULL);
+}
+
+/*
+  Textured circles in a grid, each with the sprite stretched over it.
+  textured_batch sets the map once for all of them, textured_each starts
+  a new batch per circle, which uploads the sprite every time.
+*/
+static void bench_textured_circle(int i) {
+  float x = 24.0f + (i % 12) * 24.0f;
+  float y = 24.0f + ((i / 12) % 8) * 24.0f;
+  draw_circle(x, y, 10.0f, 10.0f, 0.0f, 0.16f);
+}
+
+static void bench_textured_batch(float circles, int rep) {
+  TexMap map = texmap_bounds(benchSprite);
+  set_render_texture(&map);
+  for (int i = 0; i < (int)circles; ++i) {
+    bench_textured_circle(i);
+  }
+  set_render_texture(NULL);
+}
+
+static void bench_textured_each(float circles, int rep) {
+  TexMap map = texmap_bounds(benchSprite);
+  for (int i = 0; i < (int)circles; ++i) {
+    set_render_texture(&map);
+    bench_textured_circle(i);
+    set_render_texture(NULL);
+  }
+}
+
+/*
+  One circle at a swept LOD quality, aa_circle_fringe adds the AA fringe to
+  it. Both are measured against an ideal disc on the host, so a fringe can
+  be compared with more segments for the same edge quality.
+*/
+static void bench_aa_circle(float quality, int rep) {
+  float prev = lodQuality;
+  lod_set_quality(quality);
+  draw_circle(screenCenter.x, screenCenter.y, BENCH_AA_RADIUS, BENCH_AA_RADIUS, 0.0f, 0.05f);
+  lod_set_quality(prev);
+}
+
+static void bench_aa_circle_fringe(float quality, int rep) {
+  set_render_fringe(true);
+  bench_aa_circle(quality, rep);
+  set_render_fringe(false);
+}
+
+#ifdef N64_HOST
+// Function to place the points draw_circle puts around the aa cases' circle
+static void bench_aa_outline(Point* points, int segments) {
+  for (int i = 0; i < segments; ++i) {
+    float angle = TWO_PI * (float)i / (float)segments;
+    points[i] = point_new(screenCenter.x + BENCH_AA_RADIUS * cosf(angle), screenCenter.y + BENCH_AA_RADIUS * sinf(angle));
+  }
+}
+#endif // N64_HOST
+
+// The snakes follow a fixed stick path so every run does the same work
+static void bench_snakes(float count, int rep) {
+  float t = (float)benchFrame * 0.05f;
+  float x = 60.0f * fm_cosf(t);
+  float y = 60.0f * fm_sinf(t * 0.7f);
+  if (input_mode() == INPUT_REPLAYING) {
+    x = stickX;
+    y = stickY;
+  }
+  for (int i = 0; i < (int)count && i < 4; ++i) {
+    snake_resolve(benchSnakes[i], (i & 1) ? -x : x, (i & 2) ? -y : y);
+    draw_snake_shape(benchSnakes[i], snake1Verts, snake1ShadowVerts);
+  }
+}
+
+static const BenchCase benchCases[] = {
+  { "draw_circle",              "radius",    16, 5, { 2, 8, 32, 64, 110 },    NULL,                  bench_circle },
+  { "draw_circle_fan",          "radius",    16, 5, { 2, 8, 32, 64, 110 },    NULL,                  bench_circle_fan },
+  { "draw_line",                "thickness", 64, 3, { 1, 4, 16 },             NULL,                  bench_line },
+  { "draw_quad",                "size",      64, 3, { 4, 32, 128 },           NULL,                  bench_quad },
+  { "draw_bezier_curve",        "segments",   8, 5, { 5, 10, 25, 50, 100 },   NULL,                  bench_bezier_curve },
+  { "draw_filled_beziers",      "segments",   8, 5, { 5, 10, 25, 50, 100 },   NULL,                  bench_filled_beziers },
+  { "draw_filled_bezier_shape", "segments",   4, 4, { 5, 10, 25, 50 },        NULL,                  bench_filled_bezier_shape },
+  { "draw_rdp_fan",             "points",    16, 5, { 6, 16, 32, 64, 200 },   bench_rdp_fan_prepare, bench_rdp_fan },
+  { "snakes",                   "snakes",     1, 4, { 1, 2, 3, 4 },           NULL,                  bench_snakes },
+  { "bands_flat",               "bands",      4, 3, { 4, 16, 64 },            NULL,                  bench_bands_flat },
+  { "bands_gradient",           "bands",      4, 3, { 4, 16, 64 },            NULL,                  bench_bands_gradient },
+  { "textured_batch",           "circles",    1, 3, { 4, 16, 64 },            NULL,                  bench_textured_batch },
+  { "textured_each",            "circles",    1, 3, { 4, 16, 64 },            NULL,                  bench_textured_each },
+  { "ui_rects",                 "rects",      1, 3, { 16, 64, 128 },          NULL,                  bench_ui_rects },
+  { "ui_rects_strip",           "rects",      1, 3, { 16, 64, 128 },          NULL,                  bench_ui_rects_strip },
+  { "aa_circle",                "quality",    1, 5, { 0.25, 0.5, 1, 2, 4 },   NULL,                  bench_aa_circle,        true },
+  { "aa_circle_fringe",         "quality",    1, 5, { 0.25, 0.5, 1, 2, 4 },   NULL,                  bench_aa_circle_fringe, true },
+};
+
+#define BENCH_CASE_COUNT (sizeof(benchCases) / sizeof(benchCases[0]))
+
+// ====~ Runner ~==== //
 
 // Initialize libdragon
 void setup() {
 
+  // Before anything is allocated
+  mem_init();
+
   debug_init_isviewer();
   debug_init_usblog();
-    
+
   dfs_init(DFS_DEFAULT_LOCATION);
 
   display_init(RESOLUTION_320x240, DEPTH_16_BPP, 3, GAMMA_NONE, FILTERS_RESAMPLE_ANTIALIAS_DEDITHER);
   screenWidth = display_get_width();
   screenHeight = display_get_height();
+  screenCenter = point_new(screenWidth/2,screenHeight/2);
   disp = surface_alloc(FMT_RGBA16, screenWidth, screenHeight);
 
   rdpq_init();
@@ -33,78 +452,1330 @@ void setup() {
   rdpq_debug_start();
 #endif // DEBUG_RDPQ
 
-#if defined(RSPQ_PROFILE) && RSPQ_PROFILE
-  profile_data.frame_count = 0;
-  rspq_profile_start();
-#endif // RSPQ_PROFILE
+#if INPUT_REPLAY
+  debug_init_sdfs("sd:/", -1);
+#endif // INPUT_REPLAY
 
   joypad_init();
+  input_init();
 
   rdpq_text_register_font(FONT_BUILTIN_DEBUG_MONO, rdpq_font_load_builtin(FONT_BUILTIN_DEBUG_MONO));
 
+  benchSprite = sprite_load("rom:/n64brew.sprite");
 
-  // Initialize acummulators
-  frameCounter = 0;
-  stickX = 0.0f;
-  stickY = 0.0f;
+  accums_init();
+  prof_init();
+  lod_init();
+  budget_init();
+  fillrate_init();
+  arena_init();
+  rdpcap_init();
 
-  mem_info = mallinfo();
-  totalMem = (get_memory_size() / 1024);
+  int prevTag = mem_tag_begin(MEM_TAG_SHAPES);
+  shape_control_init();
+  init_snakes();
+  mem_tag_end(&prevTag);
 
-}
+  benchSnakes[0] = snake1;
+  benchSnakes[1] = snake2;
+  benchSnakes[2] = snake3;
+  benchSnakes[3] = snake4;
 
-// Main function with rendering loop
-int main() {
-  setup();
+  Point center = screenCenter;
+  benchCurve[0] = point_new(center.x - 40.0f, center.y + 20.0f);
+  benchCurve[1] = point_new(center.x - 20.0f, center.y - 40.0f);
+  benchCurve[2] = point_new(center.x + 20.0f, center.y - 40.0f);
+  benchCurve[3] = point_new(center.x + 40.0f, center.y + 20.0f);
+  for (int i = 0; i < 4; ++i) {
+    benchBase[i] = point_new(benchCurve[i].x, benchCurve[i].y + 40.0f);
+  }
 
-  for (;;) {
+  display_set_fps_limit(0); // Disable limiter
 
-    if(frameCounter > 59)frameCounter = 0;
+}
 
-    rdpq_attach(display_get(), &disp);
-    rdpq_clear(RGBA32(128, 128, 128, 255));
+// Function to run one case at one parameter value and print its `bench,` line
+static void bench_run(const BenchCase* c, float value, int caseIndex) {
+  BenchResult r;
+  memset(&r, 0, sizeof(BenchResult));
+  r.minTicks = UINT32_MAX;
+#ifdef N64_HOST
+  uint64_t rasterTested = 0, rasterTicks = 0;
+  float aliasError = 0.0f, shapeError = 0.0f;
+#endif // N64_HOST
 
-    rdpq_set_mode_standard();
+  if (c->prepare) {
+    c->prepare(value);
+  }
+  if (input_mode() == INPUT_REPLAYING) {
+    input_rewind();
+  }
+
+  for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+    benchFrame = f;
 
     joypad_poll();
-    joypad_inputs_t input = joypad_get_inputs(JOYPAD_PORT_1);
-    joypad_buttons_t keys = joypad_get_buttons_pressed(JOYPAD_PORT_1);
-    joypad_buttons_t keysDown = joypad_get_buttons_held(JOYPAD_PORT_1);
+    joypad_inputs_t input;
+    joypad_buttons_t keys, keysDown;
+    input_get(JOYPAD_PORT_1, &input, &keys, &keysDown);
+    stickX = (float)input.stick_x;
+    stickY = (float)input.stick_y;
+
+    surface_t* fb = display_get();
+    rdpq_attach(fb, &disp);
+    rdpcap_clear(GREY);
+    rdpcap_clear_z(0xFFFC);
+    rdpcap_sync_pipe();
+    rdpcap_set_mode_standard();
+    rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+    rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+    set_render_color(RED);
 
-    // RAM used from RDPQ Demo
-    ramUsed = mem_info.uordblks - (size_t) (((screenWidth * screenHeight) * 2) - ((unsigned int) HEAP_START_ADDR - 0x80000000) - 0x10000);
-    if (ramUsed < 0) {
-      debugf("Calculated RAM usage is negative: %d\n", ramUsed);
-      ramUsed = 0; // Set to zero or handle the error as needed
+    // Only what the case adds to this frame is counted
+    CapFrame before = capFrame;
+    uint32_t allocs = memTotal.frameAllocs;
+    uint32_t allocBytes = memTotal.frameBytes;
+    FillrateStats fillBefore;
+    fillrate_total(fillrateFrame, &fillBefore);
+
+    uint32_t start = get_ticks();
+    for (int i = 0; i < c->reps; ++i) {
+      c->run(value, i);
     }
+    uint32_t ticks = get_ticks() - start;
 
-    stickX = (float)input.stick_x;
-    stickY = (float)input.stick_y;
+    if (f >= BENCH_WARMUP) {
+      r.frames++;
+      r.totalTicks += ticks;
+      if (ticks < r.minTicks) r.minTicks = ticks;
+      if (ticks > r.maxTicks) r.maxTicks = ticks;
+      r.tris += rdpcap_frame_tris(&capFrame) - rdpcap_frame_tris(&before);
+      r.verts += rdpcap_frame_verts(&capFrame) - rdpcap_frame_verts(&before);
+      r.rspqBytes += rdpcap_frame_bytes(&capFrame, false) - rdpcap_frame_bytes(&before, false);
+      r.rdpBytes += rdpcap_frame_bytes(&capFrame, true) - rdpcap_frame_bytes(&before, true);
+      r.allocs += memTotal.frameAllocs - allocs;
+      r.allocBytes += memTotal.frameBytes - allocBytes;
+      FillrateStats fill;
+      fillrate_total(fillrateFrame, &fill);
+      r.fillCost += fillrate_cost(&fill) - fillrate_cost(&fillBefore);
+    }
+
+    rdpcap_sync_pipe();
+    rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, 20, 20,
+      "Benchmark %d/%d\n\n"
+      "%s\n"
+      "%s: %.0f\n"
+      "Frame: %d/%d",
+      caseIndex + 1, (int)BENCH_CASE_COUNT,
+      c->name,
+      c->param, value,
+      f + 1, BENCH_WARMUP + BENCH_FRAMES
+    );
+
+    accums_reset();
+#ifdef N64_HOST
+    RasterStats rasterBefore = rasterStats;
+#endif // N64_HOST
+    rdpq_detach_show();
+#ifdef N64_HOST
+    if (f >= BENCH_WARMUP) {
+      rasterTested += rasterStats.tested - rasterBefore.tested;
+      rasterTicks += rasterStats.triTicks - rasterBefore.triTicks;
+    }
+    if (c->edges && f == BENCH_WARMUP + BENCH_FRAMES - 1) {
+      Point outline[LOD_MAX_SEGMENTS];
+      float prev = lodQuality;
+      lod_set_quality(value);
+      int segments = lod_ellipse_segments(BENCH_AA_RADIUS, BENCH_AA_RADIUS);
+      lod_set_quality(prev);
+      bench_aa_outline(outline, segments);
+      aliasError = raster_convex_error(fb, (const float*)outline, segments, RED, GREY);
+      bench_aa_outline(outline, LOD_MAX_SEGMENTS);
+      shapeError = raster_convex_error(fb, (const float*)outline, LOD_MAX_SEGMENTS, RED, GREY);
+    }
+#endif // N64_HOST
+    rdpcap_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+    arena_frame_end();
+  }
+
+  float calls = (float)r.frames * (float)c->reps;
+  float ticksToUs = 1000000.0f / (float)TICKS_PER_SECOND;
+
+  debugf("bench,%s,%s,%g,%lu,%d,%.2f,%.2f,%.2f,%.1f,%.1f,%.0f,%.0f,%.2f,%.0f,%.0f\n",
+    c->name,
+    c->param,
+    value,
+    (unsigned long)r.frames,
+    c->reps,
+    r.minTicks * ticksToUs / c->reps,
+    r.totalTicks * ticksToUs / calls,
+    r.maxTicks * ticksToUs / c->reps,
+    r.tris / calls,
+    r.verts / calls,
+    r.rspqBytes / calls,
+    r.rdpBytes / calls,
+    r.allocs / calls,
+    r.allocBytes / calls,
+    r.fillCost / calls
+  );
+#ifdef N64_HOST
+  debugf("raster,%s,%g,%.0f,%.2f\n", c->name, value, rasterTested / calls, rasterTicks * ticksToUs / calls);
+  if (c->edges) {
+    debugf("edge,%s,%g,%.1f,%.4f,%.4f\n", c->name, value, r.tris / calls, aliasError, shapeError);
+  }
+#endif // N64_HOST
+}
+
+// Function to get the next number of a fixed sequence, the same on every run and platform
+static float bench_random(uint32_t* state, float min, float max) {
+  *state = *state * 1664525u + 1013904223u;
+  return min + (max - min) * (float)(*state >> 8) / 16777216.0f;
+}
+
+// Function to find what the spatial queries find by testing every box
+static int bench_spatial_brute(const Bounds* bounds, int count, int kind, Point p, float radius) {
+  Bounds area = bounds_around(p, radius, radius);
+  float radiusSq = radius * radius;
+  int found = 0;
+  int nearest = SPATIAL_NONE;
+  for (int i = 0; i < count; ++i) {
+    if (kind == 0) {
+      found += bounds_overlap(&bounds[i], &area);
+    } else {
+      float d = bounds_distance_sq(&bounds[i], p);
+      if (d <= radiusSq) {
+        found++;
+        radiusSq = kind == 2 ? d : radiusSq;
+        nearest = i;
+      }
+    }
+  }
+  return kind == 2 ? nearest : found;
+}
+
+// Function to time the spatial hash against testing every shape, with BENCH_SPATIAL_SHAPES shapes in a grid, and print its `spatial,` line
+static void bench_spatial() {
+  debugf("spatial,shapes,cell,build_us,update_us,relinks,rect_us,rect_brute_us,radius_us,radius_brute_us,nearest_us,nearest_brute_us,found,matches\n");
+  float ticksToUs = 1000000.0f / (float)TICKS_PER_SECOND;
+  Shape* shapes = (Shape*)mem_malloc(sizeof(Shape) * BENCH_SPATIAL_SHAPES);
+  Bounds* bounds = (Bounds*)mem_malloc(sizeof(Bounds) * BENCH_SPATIAL_SHAPES);
+  int* ids = (int*)mem_malloc(sizeof(int) * BENCH_SPATIAL_MAX_FOUND);
+  if (shapes == NULL || bounds == NULL || ids == NULL) {
+    debugf("Spatial benchmark allocation failed\n");
+    mem_free(shapes);
+    mem_free(bounds);
+    mem_free(ids);
+    return;
+  }
+
+  uint32_t seed = 1;
+  for (int i = 0; i < BENCH_SPATIAL_SHAPES; ++i) {
+    Point center = point_new(bench_random(&seed, 0.0f, BENCH_SPATIAL_WORLD), bench_random(&seed, 0.0f, BENCH_SPATIAL_WORLD));
+    circle_init(&shapes[i], center, bench_random(&seed, 4.0f, 20.0f), 0.05f, RED);
+  }
+
+  SpatialHash grid;
+  spatial_init(&grid, SPATIAL_CELL, BENCH_SPATIAL_SHAPES);
+  uint32_t start = get_ticks();
+  for (int i = 0; i < BENCH_SPATIAL_SHAPES; ++i) {
+    shape_grid_insert(&shapes[i], &grid);
+  }
+  uint32_t buildTicks = get_ticks() - start;
+
+  // Every shape moves a little like it would in a frame, through set_center like resolve
+  start = get_ticks();
+  for (int i = 0; i < BENCH_SPATIAL_SHAPES; ++i) {
+    Point center = get_center(&shapes[i]);
+    set_center(&shapes[i], point_new(center.x + bench_random(&seed, -3.5f, 3.5f), center.y + bench_random(&seed, -3.5f, 3.5f)));
+  }
+  uint32_t updateTicks = get_ticks() - start;
+  for (int i = 0; i < BENCH_SPATIAL_SHAPES; ++i) {
+    bounds[i] = spatial_item(&grid, shapes[i].gridId)->bounds;
+  }
+
+  // Rects, radius then nearest picks around the same points, grid first then brute force
+  uint32_t ticks[3][2] = { { 0 } };
+  uint32_t found = 0;
+  bool matches = true;
+  for (int kind = 0; kind < 3; ++kind) {
+    uint32_t querySeed = 7;
+    for (int q = 0; q < BENCH_SPATIAL_QUERIES; ++q) {
+      Point p = point_new(bench_random(&querySeed, 0.0f, BENCH_SPATIAL_WORLD), bench_random(&querySeed, 0.0f, BENCH_SPATIAL_WORLD));
+      float radius = kind == 1 ? 48.0f : 32.0f;
+      start = get_ticks();
+      int result = kind == 0 ? spatial_query_rect(&grid, bounds_around(p, radius, radius), ids, BENCH_SPATIAL_MAX_FOUND)
+        : kind == 1 ? spatial_query_radius(&grid, p, radius, ids, BENCH_SPATIAL_MAX_FOUND)
+        : spatial_nearest(&grid, p, radius);
+      ticks[kind][0] += get_ticks() - start;
+
+      start = get_ticks();
+      int brute = bench_spatial_brute(bounds, BENCH_SPATIAL_SHAPES, kind, p, radius);
+      ticks[kind][1] += get_ticks() - start;
+
+      if (kind == 2) {
+        // Ties may pick another shape at the same distance
+        matches &= (result == SPATIAL_NONE) == (brute == SPATIAL_NONE);
+        matches &= result == SPATIAL_NONE || bounds_distance_sq(&spatial_item(&grid, result)->bounds, p) == bounds_distance_sq(&bounds[brute], p);
+      } else {
+        matches &= result == brute;
+        found += result;
+      }
+    }
+  }
+
+  float perQuery = ticksToUs / BENCH_SPATIAL_QUERIES;
+  debugf("spatial,%d,%.0f,%.1f,%.1f,%lu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%lu,%d\n",
+    BENCH_SPATIAL_SHAPES,
+    grid.cell,
+    buildTicks * ticksToUs,
+    updateTicks * ticksToUs,
+    (unsigned long)grid.relinks,
+    ticks[0][0] * perQuery,
+    ticks[0][1] * perQuery,
+    ticks[1][0] * perQuery,
+    ticks[1][1] * perQuery,
+    ticks[2][0] * perQuery,
+    ticks[2][1] * perQuery,
+    (unsigned long)found,
+    matches
+  );
+
+  for (int i = 0; i < BENCH_SPATIAL_SHAPES; ++i) {
+    destroy(&shapes[i]);
+  }
+  spatial_free(&grid);
+  mem_free(shapes);
+  mem_free(bounds);
+  mem_free(ids);
+}
+
+// Function to test every pair of colliders exactly, for checking collide_find
+static int bench_collide_brute(CollisionWorld* world) {
+  int found = 0;
+  for (int i = 0; i < world->count; ++i) {
+    const Collider* a = &world->colliders[i];
+    for (int j = i + 1; j < world->count; ++j) {
+      const Collider* b = &world->colliders[j];
+      if (a->group == b->group && abs(a->index - b->index) <= COLLIDE_NEIGHBORS) {
+        continue;
+      }
+      Contact contact;
+      found += collide_test(a, b, &contact);
+    }
+  }
+  return found;
+}
+
+// Function to run BENCH_COLLIDE_SNAKES snakes swimming in loops through each other and themselves, and print its `collide,` line
+static void bench_collide() {
+  debugf("collide,snakes,colliders,frames,solve_ms,update_ms,broad_ms,narrow_ms,step_ms,candidates,tests,contacts,self,matches\n");
+  Snake** snakes = (Snake**)mem_malloc(sizeof(Snake*) * BENCH_COLLIDE_SNAKES);
+  CollisionPair* pairs = (CollisionPair*)mem_malloc(sizeof(CollisionPair) * BENCH_COLLIDE_MAX_PAIRS);
+  if (snakes == NULL || pairs == NULL) {
+    debugf("Collision benchmark allocation failed\n");
+    mem_free(snakes);
+    mem_free(pairs);
+    return;
+  }
+
+  CollisionWorld world;
+  collide_world_init(&world);
+  uint32_t seed = 3;
+  for (int i = 0; i < BENCH_COLLIDE_SNAKES; ++i) {
+    Point origin = point_new(bench_random(&seed, 0.0f, BENCH_COLLIDE_WORLD), bench_random(&seed, 0.0f, BENCH_COLLIDE_WORLD));
+    snakes[i] = (Snake*)mem_malloc_uncached(sizeof(Snake));
+    snake_init(snakes[i], origin, SNAKE_SEGMENTS, N_RED);
+    snake_collide_add(snakes[i], &world, i);
+  }
+
+  uint64_t solveTicks = 0, updateTicks = 0, broadTicks = 0, narrowTicks = 0;
+  uint64_t candidates = 0, tests = 0, contacts = 0, self = 0;
+  int found = 0;
+  for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+    // Each head circles its own point, tight enough for the body to catch up with itself
+    uint32_t start = get_ticks();
+    for (int i = 0; i < BENCH_COLLIDE_SNAKES; ++i) {
+      const Point* joints = snakes[i]->spine->joints->points;
+      float angle = (float)f * 0.15f + (float)i;
+      Point head = point_new(joints[0].x + 6.0f * fm_cosf(angle), joints[0].y + 6.0f * fm_sinf(angle));
+      chain_resolve(snakes[i]->spine, head);
+    }
+    uint32_t solved = get_ticks();
+    for (int i = 0; i < BENCH_COLLIDE_SNAKES; ++i) {
+      snake_collide_update(snakes[i]);
+    }
+    uint32_t updated = get_ticks();
+    found = collide_find(&world, pairs, BENCH_COLLIDE_MAX_PAIRS);
+
+    if (f >= BENCH_WARMUP) {
+      solveTicks += solved - start;
+      updateTicks += updated - solved;
+      broadTicks += world.stats.broadTicks;
+      narrowTicks += world.stats.narrowTicks;
+      candidates += world.stats.candidates;
+      tests += world.stats.tests;
+      contacts += found;
+      for (int p = 0; p < found && p < BENCH_COLLIDE_MAX_PAIRS; ++p) {
+        self += world.colliders[pairs[p].a].group == world.colliders[pairs[p].b].group;
+      }
+    }
+  }
+
+  // Testing every pair is too slow for the console
+  int matches = -1;
+#ifdef N64_HOST
+  matches = bench_collide_brute(&world) == found;
+#endif // N64_HOST
+
+  double toMs = 1000.0 / TICKS_PER_SECOND / BENCH_FRAMES;
+  debugf("collide,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%.0f,%.1f,%.1f,%d\n",
+    BENCH_COLLIDE_SNAKES,
+    world.count,
+    BENCH_FRAMES,
+    solveTicks * toMs,
+    updateTicks * toMs,
+    broadTicks * toMs,
+    narrowTicks * toMs,
+    (updateTicks + broadTicks + narrowTicks) * toMs,
+    (double)candidates / BENCH_FRAMES,
+    (double)tests / BENCH_FRAMES,
+    (double)contacts / BENCH_FRAMES,
+    (double)self / BENCH_FRAMES,
+    matches
+  );
+
+  for (int i = 0; i < BENCH_COLLIDE_SNAKES; ++i) {
+    snake_free(snakes[i]);
+  }
+  collide_world_free(&world);
+  mem_free(snakes);
+  mem_free(pairs);
+}
+
+#ifdef N64_HOST
+// Function to get a hash of the pixels of a frame
+static uint32_t bench_frame_hash(const surface_t* fb) {
+  uint32_t hash = 2166136261u;
+  const uint8_t* p = (const uint8_t*)fb->buffer;
+  for (size_t i = 0; i < (size_t)fb->stride * fb->height; ++i) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+  return hash;
+}
+
+#endif // N64_HOST
+
+// Function to draw a circle of the BVH scene, the view origin is the top left of the screen
+static void bench_bvh_draw(void* data, void* arg) {
+  const Shape* shape = (const Shape*)data;
+  const Point* origin = (const Point*)arg;
+  draw_circle(shape->center.x - origin->x, shape->center.y - origin->y, shape->scaleX, shape->scaleX, 0.0f, shape->lod);
+}
+
+// Function to time building, refitting and querying a BVH of BENCH_BVH_SHAPES circles, then drawing a view panning over them, and print its `bvh,` line
+static void bench_bvh() {
+  debugf("bvh,shapes,nodes,depth,build_us,refit_us,view_us,view_brute_us,nearest_us,nearest_brute_us,visible,visited,draw_all_ms,draw_bvh_ms,tris_all,tris_bvh,matches\n");
+  float ticksToUs = 1000000.0f / (float)TICKS_PER_SECOND;
+  Shape* shapes = (Shape*)mem_malloc(sizeof(Shape) * BENCH_BVH_SHAPES);
+  Bounds* bounds = (Bounds*)mem_malloc(sizeof(Bounds) * BENCH_BVH_SHAPES);
+  int* ids = (int*)mem_malloc(sizeof(int) * BENCH_BVH_SHAPES);
+  if (shapes == NULL || bounds == NULL || ids == NULL) {
+    debugf("BVH benchmark allocation failed\n");
+    mem_free(shapes);
+    mem_free(bounds);
+    mem_free(ids);
+    return;
+  }
+
+  Bvh bvh;
+  bvh_init(&bvh);
+  uint32_t seed = 5;
+  for (int i = 0; i < BENCH_BVH_SHAPES; ++i) {
+    Point center = point_new(bench_random(&seed, 0.0f, BENCH_BVH_WORLD), bench_random(&seed, 0.0f, BENCH_BVH_WORLD));
+    circle_init(&shapes[i], center, bench_random(&seed, 4.0f, 20.0f), 0.05f, RED);
+    shape_bvh_insert(&shapes[i], &bvh);
+  }
+  uint32_t start = get_ticks();
+  bvh_build(&bvh);
+  uint32_t buildTicks = get_ticks() - start;
+
+  // Every shape drifts a little, set_center hands the new boxes to the BVH
+  for (int i = 0; i < BENCH_BVH_SHAPES; ++i) {
+    Point center = get_center(&shapes[i]);
+    set_center(&shapes[i], point_new(center.x + bench_random(&seed, -3.5f, 3.5f), center.y + bench_random(&seed, -3.5f, 3.5f)));
+    bounds[i] = shape_bounds(&shapes[i]);
+  }
+  start = get_ticks();
+  bvh_refit(&bvh);
+  uint32_t refitTicks = get_ticks() - start;
+
+  // Views the size of the screen and picks around their centers, BVH first then brute force
+  float width = display_get_width();
+  float height = display_get_height();
+  uint32_t ticks[2][2] = { { 0 } };
+  bool matches = true;
+  uint32_t querySeed = 9;
+  for (int q = 0; q < BENCH_SPATIAL_QUERIES; ++q) {
+    Point p = point_new(bench_random(&querySeed, 0.0f, BENCH_BVH_WORLD - width), bench_random(&querySeed, 0.0f, BENCH_BVH_WORLD - height));
+    Bounds view = { p.x, p.y, p.x + width, p.y + height };
+    start = get_ticks();
+    int result = bvh_query_rect(&bvh, view, ids, BENCH_BVH_SHAPES);
+    ticks[0][0] += get_ticks() - start;
+    start = get_ticks();
+    int brute = 0;
+    for (int i = 0; i < BENCH_BVH_SHAPES; ++i) {
+      brute += bounds_overlap(&bounds[i], &view);
+    }
+    ticks[0][1] += get_ticks() - start;
+    matches &= result == brute;
+
+    Point cursor = point_new(p.x + width / 2.0f, p.y + height / 2.0f);
+    start = get_ticks();
+    int picked = bvh_nearest(&bvh, cursor, 32.0f);
+    ticks[1][0] += get_ticks() - start;
+    start = get_ticks();
+    int nearest = bench_spatial_brute(bounds, BENCH_BVH_SHAPES, 2, cursor, 32.0f);
+    ticks[1][1] += get_ticks() - start;
+    // Ties may pick another shape at the same distance
+    matches &= (picked == BVH_NONE) == (nearest == SPATIAL_NONE);
+    matches &= picked == BVH_NONE || bounds_distance_sq(&bvh_item(&bvh, picked)->bounds, cursor) == bounds_distance_sq(&bounds[nearest], cursor);
+  }
+
+  // The view pans across the world, drawing every circle then only those the BVH finds in view
+  uint32_t budgetTrisWas = budgetTris;
+  float budgetPixelsWas = budgetPixels;
+  budget_set(UINT32_MAX, 1e12f);
+  uint64_t drawTicks[2] = { 0 };
+  int tris[2] = { 0 };
+  uint32_t visible = 0, visited = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+      float t = (float)f / (BENCH_WARMUP + BENCH_FRAMES);
+      Point origin = point_new(t * (BENCH_BVH_WORLD - width), t * (BENCH_BVH_WORLD - height) * 0.5f);
+      surface_t* fb = display_get();
+      rdpq_attach(fb, &disp);
+      rdpcap_clear(GREY);
+      rdpcap_sync_pipe();
+      rdpcap_set_mode_standard();
+      rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+      rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+      set_render_color(RED);
+
+      start = get_ticks();
+      if (pass == 0) {
+        for (int i = 0; i < BENCH_BVH_SHAPES; ++i) {
+          bench_bvh_draw(&shapes[i], &origin);
+        }
+      } else {
+        Bounds view = { origin.x, origin.y, origin.x + width, origin.y + height };
+        int found = bvh_visit_rect(&bvh, view, bench_bvh_draw, &origin);
+        if (f >= BENCH_WARMUP) {
+          visible += found;
+          visited += bvh.visited;
+        }
+      }
+      if (f >= BENCH_WARMUP) {
+        drawTicks[pass] += get_ticks() - start;
+        tris[pass] += triCount;
+      }
+
+      accums_reset();
+      rdpq_detach_show();
+#ifdef N64_HOST
+      // The last frame of both passes must look the same
+      if (f == BENCH_WARMUP + BENCH_FRAMES - 1) {
+        static uint32_t hash;
+        matches &= pass == 0 || bench_frame_hash(fb) == hash;
+        hash = bench_frame_hash(fb);
+      }
+#endif // N64_HOST
+      rdpcap_frame_end();
+      mem_frame_end();
+      lod_frame_end();
+      budget_frame_end();
+      fillrate_frame_end();
+      arena_frame_end();
+    }
+  }
+  budget_set(budgetTrisWas, budgetPixelsWas);
+
+  float perQuery = ticksToUs / BENCH_SPATIAL_QUERIES;
+  double toMs = 1000.0 / TICKS_PER_SECOND / BENCH_FRAMES;
+  debugf("bvh,%d,%d,%d,%.1f,%.1f,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.3f,%.3f,%d,%d,%d\n",
+    BENCH_BVH_SHAPES,
+    bvh.nodeCount,
+    bvh.depth,
+    buildTicks * ticksToUs,
+    refitTicks * ticksToUs,
+    ticks[0][0] * perQuery,
+    ticks[0][1] * perQuery,
+    ticks[1][0] * perQuery,
+    ticks[1][1] * perQuery,
+    (double)visible / BENCH_FRAMES,
+    (double)visited / BENCH_FRAMES,
+    drawTicks[0] * toMs,
+    drawTicks[1] * toMs,
+    tris[0] / BENCH_FRAMES,
+    tris[1] / BENCH_FRAMES,
+    matches
+  );
 
-//=========== ~ UPDATE ~ ==============//
+  for (int i = 0; i < BENCH_BVH_SHAPES; ++i) {
+    destroy(&shapes[i]);
+  }
+  bvh_free(&bvh);
+  mem_free(shapes);
+  mem_free(bounds);
+  mem_free(ids);
+}
+
+// Function to add a creature rig to a scene, body, tail, two fins and two eyes with pupils, returns its root
+static int bench_scene_creature(Scene* scene, Shape* parts) {
+  int root = scene_add(scene, SCENE_NONE, SCENE_GROUP, NULL);
+  scene_add(scene, root, SCENE_ELLIPSE, &parts[0]);
+  int tail = scene_add(scene, root, SCENE_POLYGON, &parts[1]);
+  int finL = scene_add(scene, root, SCENE_POLYGON, &parts[2]);
+  int finR = scene_add(scene, root, SCENE_POLYGON, &parts[2]);
+  scene_set_position(scene, tail, point_new(-10.0f, 0.0f));
+  scene_set_position(scene, finL, point_new(2.0f, -7.0f));
+  scene_set_transform(scene, finR, point_new(2.0f, 7.0f), 0.0f, 1.0f, -1.0f);
+  scene_set_z(scene, tail, -1);
+  scene_set_z(scene, finL, -1);
+  scene_set_z(scene, finR, -1);
+  for (int side = -1; side <= 1; side += 2) {
+    int eye = scene_add(scene, root, SCENE_ELLIPSE, &parts[3]);
+    int pupil = scene_add(scene, eye, SCENE_ELLIPSE, &parts[4]);
+    scene_set_position(scene, eye, point_new(7.0f, 4.0f * side));
+    scene_set_position(scene, pupil, point_new(1.0f, 0.0f));
+    scene_set_z(scene, eye, 1);
+    scene_set_z(scene, pupil, 2);
+  }
+  return root;
+}
+
+// Function to time the scene graph with BENCH_SCENE_CREATURES rigs standing still, flapping their fins and swimming, and print its `scene,` line
+static void bench_scene() {
+  debugf("scene,creatures,nodes,draws,frames,idle_us,idle_nodes,fins_us,fins_nodes,swim_us,swim_nodes,sort_us,draw_ms,tris\n");
+  int* roots = (int*)mem_malloc(sizeof(int) * BENCH_SCENE_CREATURES);
+  if (roots == NULL) {
+    debugf("Scene benchmark allocation failed\n");
+    return;
+  }
+
+  // Every creature shares the same five parts, in the space of their nodes
+  Shape parts[5];
+  fan2_init(&parts[0], point_new(0.0f, 0.0f), 14.0f, 9.0f, 3, GREEN);
+  shape_init(&parts[1]);
+  shape_init(&parts[2]);
+  add_point(parts[1].currPoints, 0.0f, 0.0f);
+  add_point(parts[1].currPoints, -12.0f, -8.0f);
+  add_point(parts[1].currPoints, -12.0f, 8.0f);
+  add_point(parts[2].currPoints, -5.0f, 0.0f);
+  add_point(parts[2].currPoints, 4.0f, 0.0f);
+  add_point(parts[2].currPoints, -4.0f, -7.0f);
+  set_fill_color(&parts[1], DARK_GREEN);
+  set_fill_color(&parts[2], DARK_GREEN);
+  fan2_init(&parts[3], point_new(0.0f, 0.0f), 3.0f, 3.0f, 3, WHITE);
+  fan2_init(&parts[4], point_new(0.0f, 0.0f), 1.5f, 1.5f, 3, BLACK);
+
+  Scene scene;
+  scene_init(&scene);
+  uint32_t seed = 11;
+  for (int i = 0; i < BENCH_SCENE_CREATURES; ++i) {
+    roots[i] = bench_scene_creature(&scene, parts);
+    Point p = point_new(bench_random(&seed, 0.0f, display_get_width()), bench_random(&seed, 0.0f, display_get_height()));
+    scene_set_transform(&scene, roots[i], p, bench_random(&seed, 0.0f, 2.0f * M_PI), 1.0f, 1.0f);
+  }
+  scene_update(&scene);
 
-//=========== ~ CONTROLS ~ ==============//
+  // Standing still, then only the fins and tail move, then the whole creatures swim while drawn
+  uint64_t ticks[3] = { 0 }, nodes[3] = { 0 }, drawTicks = 0;
+  int tris = 0;
+  for (int phase = 0; phase < 3; ++phase) {
+    for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+      float flap = 0.5f * fm_sinf((float)f * 0.3f);
+      for (int i = 0; phase > 0 && i < BENCH_SCENE_CREATURES; ++i) {
+        // Nodes of a rig follow its root in the order bench_scene_creature adds them
+        scene_set_angle(&scene, roots[i] + 2, flap);
+        scene_set_angle(&scene, roots[i] + 3, flap);
+        scene_set_angle(&scene, roots[i] + 4, -flap);
+        if (phase == 2) {
+          const SceneNode* root = scene_node(&scene, roots[i]);
+          Point heading = point_from_angle(root->angle);
+          Point p = point_new(root->position.x + heading.x, root->position.y + heading.y);
+          p.x = p.x < 0.0f ? p.x + display_get_width() : p.x > display_get_width() ? p.x - display_get_width() : p.x;
+          p.y = p.y < 0.0f ? p.y + display_get_height() : p.y > display_get_height() ? p.y - display_get_height() : p.y;
+          scene_set_transform(&scene, roots[i], p, root->angle + 0.02f, 1.0f, 1.0f);
+        }
+      }
 
-//=========== ~ UI ~ =============//
+      uint32_t start = get_ticks();
+      scene_update(&scene);
+      if (f >= BENCH_WARMUP) {
+        ticks[phase] += get_ticks() - start;
+        nodes[phase] += scene.transformed;
+      }
+      if (phase < 2) {
+        continue;
+      }
 
-    rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, 20, 20, "RAM %dKB/%dKB", (ramUsed / 1024), totalMem);
+      surface_t* fb = display_get();
+      rdpq_attach(fb, &disp);
+      rdpcap_clear(GREY);
+      rdpcap_sync_pipe();
+      rdpcap_set_mode_standard();
+      rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+      rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+      start = get_ticks();
+      scene_draw(&scene);
+      if (f >= BENCH_WARMUP) {
+        drawTicks += get_ticks() - start;
+        tris += triCount;
+      }
+      accums_reset();
+      rdpq_detach_show();
+      rdpcap_frame_end();
+      mem_frame_end();
+      lod_frame_end();
+      budget_frame_end();
+      fillrate_frame_end();
+      arena_frame_end();
+    }
+  }
+
+  // One pupil in front of everything sorts the whole draw list again
+  scene_set_z(&scene, roots[0] + 8, 3);
+  uint32_t start = get_ticks();
+  scene_update(&scene);
+  uint32_t sortTicks = get_ticks() - start;
+
+  float toUs = 1000000.0f / (float)TICKS_PER_SECOND / BENCH_FRAMES;
+  debugf("scene,%d,%d,%d,%d,%.1f,%.0f,%.1f,%.0f,%.1f,%.0f,%.1f,%.3f,%d\n",
+    BENCH_SCENE_CREATURES,
+    scene.count,
+    scene.drawCount,
+    BENCH_FRAMES,
+    ticks[0] * toUs,
+    (double)nodes[0] / BENCH_FRAMES,
+    ticks[1] * toUs,
+    (double)nodes[1] / BENCH_FRAMES,
+    ticks[2] * toUs,
+    (double)nodes[2] / BENCH_FRAMES,
+    sortTicks * 1000000.0f / (float)TICKS_PER_SECOND,
+    drawTicks * toUs / 1000.0f,
+    tris / BENCH_FRAMES
+  );
+
+  scene_free(&scene);
+  for (int i = 0; i < 5; ++i) {
+    destroy(&parts[i]);
+  }
+  mem_free(roots);
+}
 
-    frameCounter++;
-    
+// Function to time moving, rotating and drawing BENCH_MESH_SHAPES cached outlines stored as float and packed points, and print its `mesh,` line
+static void bench_mesh() {
+  debugf("mesh,shapes,points,float_bytes,packed_bytes,frames,translate_float_us,translate_packed_us,rotate_float_us,rotate_packed_us,draw_float_ms,draw_packed_ms,matches\n");
+  PointArray* meshes = (PointArray*)mem_malloc(sizeof(PointArray) * BENCH_MESH_SHAPES);
+  PointArrayQ* packed = (PointArrayQ*)mem_malloc(sizeof(PointArrayQ) * BENCH_MESH_SHAPES);
+  PointArray rotated;
+  PointArrayQ rotatedQ = { NULL, 0 };
+  init_point_array(&rotated);
+  if (meshes == NULL || packed == NULL) {
+    debugf("Mesh benchmark allocation failed\n");
+    mem_free(meshes);
+    mem_free(packed);
+    return;
+  }
+
+  // Points on quarter pixels, so both copies hold the same positions and moving by whole pixels keeps them exact
+  uint32_t seed = 5;
+  for (int i = 0; i < BENCH_MESH_SHAPES; ++i) {
+    float cx = bench_random(&seed, 20.0f, display_get_width() - 20.0f);
+    float cy = bench_random(&seed, 20.0f, display_get_height() - 20.0f);
+    float r = bench_random(&seed, 4.0f, 16.0f);
+    init_point_array(&meshes[i]);
+    for (int k = 0; k < BENCH_MESH_POINTS; ++k) {
+      float a = 2.0f * M_PI * k / BENCH_MESH_POINTS;
+      add_point(&meshes[i], floorf((cx + r * fm_cosf(a)) * 4.0f) * 0.25f, floorf((cy + r * fm_sinf(a)) * 4.0f) * 0.25f);
+    }
+    packed[i] = (PointArrayQ){ NULL, 0 };
+    point_array_quantize(&packed[i], &meshes[i]);
+  }
+  for (int k = 0; k < BENCH_MESH_POINTS; ++k) {
+    add_point(&rotated, 0.0f, 0.0f);
+  }
+  point_array_quantize(&rotatedQ, &rotated);
+
+  // Float points first, then packed, the same moves and draws for both
+  uint64_t translateTicks[2] = { 0 }, rotateTicks[2] = { 0 }, drawTicks[2] = { 0 };
+  int matches = 1;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+      int dx = f & 1 ? -1 : 1;
+      uint32_t start = get_ticks();
+      for (int i = 0; i < BENCH_MESH_SHAPES; ++i) {
+        if (pass == 0) {
+          render_move_shape_points(&meshes[i], (float)dx, 0.0f);
+        } else {
+          point_array_q_translate(&packed[i], dx * POINTQ_ONE, 0);
+        }
+      }
+      uint32_t translated = get_ticks();
+      for (int i = 0; i < BENCH_MESH_SHAPES; ++i) {
+        if (pass == 0) {
+          memcpy(rotated.points, meshes[i].points, sizeof(Point) * BENCH_MESH_POINTS);
+          render_rotate_shape_points(&rotated, meshes[i].points[0], 0.1f * f);
+        } else {
+          point_array_q_rotate(&rotatedQ, &packed[i], packed[i].points[0], 0.1f * f);
+        }
+      }
+      uint32_t rotatedTicks = get_ticks();
+      if (f >= BENCH_WARMUP) {
+        translateTicks[pass] += translated - start;
+        rotateTicks[pass] += rotatedTicks - translated;
+      }
+
+      surface_t* fb = display_get();
+      rdpq_attach(fb, &disp);
+      rdpcap_clear(GREY);
+      rdpcap_sync_pipe();
+      rdpcap_set_mode_standard();
+      rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+      rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+      set_render_color(GREEN);
+      start = get_ticks();
+      for (int i = 0; i < BENCH_MESH_SHAPES; ++i) {
+        if (pass == 0) {
+          draw_convex_strip(&meshes[i]);
+        } else {
+          draw_convex_strip_q(&packed[i]);
+        }
+      }
+      if (f >= BENCH_WARMUP) {
+        drawTicks[pass] += get_ticks() - start;
+      }
+      accums_reset();
+      rdpq_detach_show();
+#ifdef N64_HOST
+      if (f == BENCH_WARMUP + BENCH_FRAMES - 1) {
+        static uint32_t hash;
+        matches &= pass == 0 || bench_frame_hash(fb) == hash;
+        hash = bench_frame_hash(fb);
+      }
+#endif // N64_HOST
+      rdpcap_frame_end();
+      mem_frame_end();
+      lod_frame_end();
+      budget_frame_end();
+      fillrate_frame_end();
+      arena_frame_end();
+    }
+  }
+
+  float toUs = 1000000.0f / (float)TICKS_PER_SECOND / BENCH_FRAMES;
+  debugf("mesh,%d,%d,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.3f,%.3f,%d\n",
+    BENCH_MESH_SHAPES,
+    BENCH_MESH_POINTS,
+    (int)(sizeof(Point) * BENCH_MESH_POINTS * BENCH_MESH_SHAPES),
+    (int)(sizeof(PointQ) * BENCH_MESH_POINTS * BENCH_MESH_SHAPES),
+    BENCH_FRAMES,
+    translateTicks[0] * toUs,
+    translateTicks[1] * toUs,
+    rotateTicks[0] * toUs,
+    rotateTicks[1] * toUs,
+    drawTicks[0] * toUs / 1000.0f,
+    drawTicks[1] * toUs / 1000.0f,
+    matches
+  );
+
+  for (int i = 0; i < BENCH_MESH_SHAPES; ++i) {
+    mem_free(meshes[i].points);
+    point_array_q_free(&packed[i]);
+  }
+  mem_free(rotated.points);
+  point_array_q_free(&rotatedQ);
+  mem_free(meshes);
+  mem_free(packed);
+}
+
+static volatile float benchFixedSink;
+
+// Function to time the float or fixed point geometry math this was built with against double precision, and print its `fixed,` line
+static void bench_fixed() {
+  debugf("fixed,backend,points,normalize_ns,heading_ns,from_angle_ns,rotate_ns,circles_ms,chain_us,normalize_err,heading_err,rotate_err,chain_err\n");
+  Point* points = (Point*)mem_malloc(sizeof(Point) * BENCH_FIXED_POINTS);
+  float* angles = (float*)mem_malloc(sizeof(float) * BENCH_FIXED_POINTS);
+  if (points == NULL || angles == NULL) {
+    debugf("Fixed benchmark allocation failed\n");
+    mem_free(points);
+    mem_free(angles);
+    return;
+  }
+  uint32_t seed = 9;
+  for (int i = 0; i < BENCH_FIXED_POINTS; ++i) {
+    points[i] = point_new(bench_random(&seed, -500.0f, 500.0f), bench_random(&seed, -500.0f, 500.0f));
+    angles[i] = bench_random(&seed, -2.0f * M_PI, 2.0f * M_PI);
+  }
+
+  // Every function over all the points BENCH_FIXED_REPS times, the sum keeps the calls from being optimized away
+  Point center = point_new(20.0f, -10.0f);
+  uint32_t ticks[4] = { 0 };
+  float sum = 0.0f;
+  for (int kind = 0; kind < 4; ++kind) {
+    uint32_t start = get_ticks();
+    for (int r = 0; r < BENCH_FIXED_REPS; ++r) {
+      for (int i = 0; i < BENCH_FIXED_POINTS; ++i) {
+        if (kind == 0) {
+          sum += point_normalized(&points[i]).x;
+        } else if (kind == 1) {
+          sum += point_heading(points[i]);
+        } else if (kind == 2) {
+          sum += point_from_angle(angles[i]).y;
+        } else {
+          Point p = points[i];
+          point_rotate(&p, &center, angles[i]);
+          sum += p.x;
+        }
+      }
+    }
+    ticks[kind] = get_ticks() - start;
+  }
+
+  // Largest errors against double precision, the heading one wrapped to half a turn
+  double normalizeErr = 0.0, headingErr = 0.0, rotateErr = 0.0;
+  for (int i = 0; i < BENCH_FIXED_POINTS; ++i) {
+    double x = points[i].x, y = points[i].y, length = sqrt(x * x + y * y);
+    Point n = point_normalized(&points[i]);
+    normalizeErr = fmax(normalizeErr, fmax(fabs(n.x - x / length), fabs(n.y - y / length)));
+    headingErr = fmax(headingErr, fabs(remainder(point_heading(points[i]) - atan2(y, x), 2.0 * M_PI)));
+    Point p = points[i];
+    point_rotate(&p, &center, angles[i]);
+    double c = cos(angles[i]), s = sin(angles[i]);
+    double rx = center.x + (x - center.x) * c - (y - center.y) * s;
+    double ry = center.y + (x - center.x) * s + (y - center.y) * c;
+    rotateErr = fmax(rotateErr, fmax(fabs(p.x - rx), fabs(p.y - ry)));
+  }
+
+  // Outlines of circles, the host rasterizes at rdpq_detach_show so this is only tessellating and submitting
+  uint64_t circleTicks = 0;
+  for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+    surface_t* fb = display_get();
+    rdpq_attach(fb, &disp);
+    rdpcap_clear(GREY);
+    rdpcap_sync_pipe();
+    rdpcap_set_mode_standard();
+    rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+    rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+    set_render_color(GREEN);
+    uint32_t start = get_ticks();
+    for (int i = 0; i < BENCH_FIXED_CIRCLES; ++i) {
+      draw_circle(20.0f + (i % 20) * 15.0f, 20.0f + (i / 20) * 20.0f, 12.0f, 12.0f, 0.01f * (f + i), 1.0f);
+    }
+    if (f >= BENCH_WARMUP) {
+      circleTicks += get_ticks() - start;
+    }
+    accums_reset();
     rdpq_detach_show();
+    rdpcap_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+    arena_frame_end();
+  }
+
+  // A chain following a target around a circle, its links should keep their length
+  Chain chain;
+  Point middle = point_new(display_get_width() * 0.5f, display_get_height() * 0.5f);
+  chain_init(&chain, middle, BENCH_FIXED_JOINTS, 8, M_PI / 8.0f);
+  int resolves = BENCH_FIXED_REPS * 20;
+  uint32_t start = get_ticks();
+  for (int i = 0; i < resolves; ++i) {
+    float t = 0.01f * i;
+    chain_resolve(&chain, point_new(middle.x + 100.0f * fm_cosf(t), middle.y + 80.0f * fm_sinf(2.0f * t)));
+  }
+  uint32_t chainTicks = get_ticks() - start;
+  double chainErr = 0.0;
+  for (size_t i = 1; i < chain.joints->count; ++i) {
+    Point d = point_sub(&chain.joints->points[i - 1], &chain.joints->points[i]);
+    chainErr = fmax(chainErr, fabs(sqrt((double)d.x * d.x + (double)d.y * d.y) - chain.linkSize));
+  }
+
+  double toNs = 1000000000.0 / TICKS_PER_SECOND / ((double)BENCH_FIXED_POINTS * BENCH_FIXED_REPS);
+  debugf("fixed,%s,%d,%.1f,%.1f,%.1f,%.1f,%.3f,%.2f,%.2e,%.2e,%.2e,%.2e\n",
+    POINT_FIXED ? "fixed" : "float",
+    BENCH_FIXED_POINTS,
+    ticks[0] * toNs,
+    ticks[1] * toNs,
+    ticks[2] * toNs,
+    ticks[3] * toNs,
+    circleTicks * 1000.0 / TICKS_PER_SECOND / BENCH_FRAMES,
+    chainTicks * 1000000.0 / TICKS_PER_SECOND / resolves,
+    normalizeErr,
+    headingErr,
+    rotateErr,
+    chainErr
+  );
+  benchFixedSink = sum;
+
+  mem_free(chain.angles);
+  mem_free(chain.joints->points);
+  mem_free(chain.joints);
+  mem_free(points);
+  mem_free(angles);
+}
 
-#if defined(RSPQ_PROFILE) && RSPQ_PROFILE
-    rspq_profile_next_frame();
+#ifdef N64_HOST
+// Function to draw shape i of the jobs scene scaled by s, a row of curves, filled bezier shapes and circles
+static void bench_scene_shape(int i, float s) {
+  float x = s * (10.0f + (float)((i * 37) % 300));
+  float y = s * (10.0f + (float)((i * 53) % 220));
+  Point p0 = point_new(x - 12.0f * s, y + 6.0f * s);
+  Point p1 = point_new(x - 6.0f * s, y - 12.0f * s);
+  Point p2 = point_new(x + 6.0f * s, y - 12.0f * s);
+  Point p3 = point_new(x + 12.0f * s, y + 6.0f * s);
 
-  // Every second we profile the RSPQ
-    if(frameCounter > 59){
-      rspq_profile_dump();
-      rspq_profile_reset();  
+  const color_t colors[] = { RED, ORANGE, YELLOW, GREEN, BLUE, INDIGO, VIOLET };
+  set_render_color(colors[i % 7]);
+  switch (i % 3) {
+    case 0:
+      draw_bezier_curve(&p0, &p1, &p2, &p3, 50, 0.0f, 2.0f * s);
+      break;
+    case 1:
+      draw_filled_bezier_shape(&p0, &p1, &p2, &p3, 25);
+      break;
+    default:
+      draw_circle(x, y, s * (4.0f + (float)(i % 11)), s * (4.0f + (float)(i % 11)), 0.0f, 0.05f);
+      break;
+  }
+}
+
+static void bench_jobs_shape(void* arg) {
+  bench_scene_shape((int)(intptr_t)arg, 1.0f);
+}
+
+static void bench_jobs_snake(void* arg) {
+  int i = (int)(intptr_t)arg;
+  Point* verts[] = { snake1Verts, snake2Verts, snake3Verts, snake4Verts };
+  Point* shadowVerts[] = { snake1ShadowVerts, snake2ShadowVerts, snake3ShadowVerts, snake4ShadowVerts };
+  draw_snake_shape(benchSnakes[i], verts[i], shadowVerts[i]);
+}
+
+// Function to draw the jobs scene with threads workers, 0 draws it on this thread, and print its `jobs,` line
+static void bench_jobs_run(int threads, double* serialMs, int* serialTris, uint32_t* serialHash) {
+  if (threads > 0) {
+    jobs_init(threads);
+    if (jobs_threads() != threads) {
+      return;
     }
+  } else {
+    jobs_shutdown();
+    memset(&jobsRun, 0, sizeof(JobStats));
+  }
 
-    rspq_profile_get_data(&profile_data);
-#endif // RSPQ_PROFILE
+  uint64_t totalTicks = 0;
+  int tris = 0;
+  uint32_t hash = 0;
+  for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+    surface_t* fb = display_get();
+    rdpq_attach(fb, &disp);
+    rdpcap_clear(GREY);
+    rdpcap_clear_z(0xFFFC);
+    rdpcap_sync_pipe();
+    rdpcap_set_mode_standard();
+    rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+    rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+    set_render_color(RED);
+
+    uint32_t start = get_ticks();
+    for (int i = 0; i < 4; ++i) {
+      jobs_add(bench_jobs_snake, (void*)(intptr_t)i);
+    }
+    for (int i = 0; i < BENCH_JOBS_SHAPES; ++i) {
+      jobs_add(bench_jobs_shape, (void*)(intptr_t)i);
+    }
+    jobs_run();
+    if (f >= BENCH_WARMUP) {
+      totalTicks += get_ticks() - start;
+    }
+
+    tris = triCount;
+    accums_reset();
+    rdpq_detach_show();
+    hash = bench_frame_hash(fb);
+    rdpcap_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+    arena_frame_end();
+  }
+
+  double ms = totalTicks * 1000.0 / TICKS_PER_SECOND / BENCH_FRAMES;
+  if (threads == 0) {
+    *serialMs = ms;
+    *serialTris = tris;
+    *serialHash = hash;
+  }
+  double runs = jobsRun.runs > 0 ? jobsRun.runs : 1;
+  debugf("jobs,%d,%d,%d,%d,%.3f,%.2f,%.3f,%.3f,%.1f,%d,%d\n",
+    threads,
+    jobs_cores(),
+    BENCH_JOBS_SHAPES + 4,
+    BENCH_FRAMES,
+    ms,
+    ms > 0.0 ? *serialMs / ms : 0.0,
+    jobsRun.tessTicks * 1000.0 / TICKS_PER_SECOND / runs,
+    jobsRun.replayTicks * 1000.0 / TICKS_PER_SECOND / runs,
+    jobsRun.steals / runs,
+    tris,
+    tris == *serialTris && hash == *serialHash
+  );
+  jobs_shutdown();
+}
+
+// Function to draw the jobs scene single threaded, then on 1 up to at least one worker per core
+static void bench_jobs() {
+  debugf("jobs,threads,cores,shapes,frames,cpu_avg_ms,speedup,tess_ms,replay_ms,steals,tris,identical\n");
+  double serialMs = 0.0;
+  int serialTris = 0;
+  uint32_t serialHash = 0;
+  bench_jobs_run(0, &serialMs, &serialTris, &serialHash);
+  int maxThreads = jobs_cores() > BENCH_JOBS_THREADS ? jobs_cores() : BENCH_JOBS_THREADS;
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    bench_jobs_run(threads, &serialMs, &serialTris, &serialHash);
+  }
+}
+
+// Function to draw the jobs scene on a BENCH_TILES_WIDTH x BENCH_TILES_HEIGHT target with the rasterizer on threads, 0 for the reference one, and print its `tiles,` line
+static void bench_tiles_run(int threads, double* refMs, uint32_t* refHash) {
+  raster_set_threads(threads);
+  if (raster_threads() != threads) {
+    return;
+  }
+
+  // Same triangles every frame, whatever the budget makes of the large shapes
+  uint32_t budgetTrisWas = budgetTris;
+  float budgetPixelsWas = budgetPixels;
+  budget_set(UINT32_MAX, 1e12f);
+  surface_t target = surface_alloc(FMT_RGBA16, BENCH_TILES_WIDTH, BENCH_TILES_HEIGHT);
+  float scale = (float)BENCH_TILES_WIDTH / display_get_width();
+  uint64_t totalTicks = 0;
+  int tris = 0;
+  for (int f = 0; f < 2 + BENCH_TILES_FRAMES; ++f) {
+    rdpq_attach(&target, NULL);
+    rdpcap_clear(GREY);
+    rdpcap_sync_pipe();
+    rdpcap_set_mode_standard();
+    rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+    rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+    for (int i = 0; i < BENCH_JOBS_SHAPES; ++i) {
+      bench_scene_shape(i, scale);
+    }
+    tris = triCount;
+    accums_reset();
+
+    uint32_t start = get_ticks();
+    rdpq_detach_show();
+    if (f >= 2) {
+      totalTicks += get_ticks() - start;
+    }
+    rdpcap_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+    arena_frame_end();
+  }
+  uint32_t hash = bench_frame_hash(&target);
+  surface_free(&target);
+  budget_set(budgetTrisWas, budgetPixelsWas);
 
+  double ms = totalTicks * 1000.0 / TICKS_PER_SECOND / BENCH_TILES_FRAMES;
+  if (threads == 0) {
+    *refMs = ms;
+    *refHash = hash;
+  }
+  debugf("tiles,%d,%d,%d,%d,%d,%d,%.3f,%.2f,%d\n",
+    threads,
+    jobs_cores(),
+    BENCH_TILES_WIDTH,
+    BENCH_TILES_HEIGHT,
+    BENCH_TILES_FRAMES,
+    tris,
+    ms,
+    ms > 0.0 ? *refMs / ms : 0.0,
+    hash == *refHash
+  );
+}
+
+// Function to rasterize the large scene with the reference rasterizer, then tiled on 1 up to at least one thread per core
+static void bench_tiles() {
+  debugf("tiles,threads,cores,width,height,frames,tris,raster_ms,speedup,identical\n");
+  int threads = raster_threads();
+  double refMs = 0.0;
+  uint32_t refHash = 0;
+  bench_tiles_run(0, &refMs, &refHash);
+  int maxThreads = jobs_cores() > BENCH_JOBS_THREADS ? jobs_cores() : BENCH_JOBS_THREADS;
+  for (int t = 1; t <= maxThreads && t <= RASTER_MAX_THREADS; t *= 2) {
+    bench_tiles_run(t, &refMs, &refHash);
+  }
+  raster_set_threads(threads);
+}
+
+typedef struct {
+  pthread_t thread;
+  int first;
+  int count;
+} BenchProducer;
+
+// Function to submit the draws of one producer to the command queue, one segment per shape
+static void* bench_cmdq_producer(void* arg) {
+  BenchProducer* p = (BenchProducer*)arg;
+  for (int i = p->first; i < p->first + p->count; ++i) {
+    cmdq_begin();
+    bench_scene_shape(i % BENCH_JOBS_SHAPES, 1.0f);
+    cmdq_end();
+  }
+  cmdq_release();
+  return NULL;
+}
+
+// Function to draw BENCH_CMDQ_DRAWS shapes submitted by producers threads while this thread drains them, and print its `cmdq,` line
+static void bench_cmdq_run(int producers) {
+  BenchProducer threads[BENCH_CMDQ_PRODUCERS];
+  uint64_t totalTicks = 0;
+  uint64_t segments = 0;
+  cmdq_reset();
+  for (int f = 0; f < BENCH_WARMUP + BENCH_FRAMES; ++f) {
+    surface_t* fb = display_get();
+    rdpq_attach(fb, &disp);
+    rdpcap_clear(GREY);
+    rdpcap_clear_z(0xFFFC);
+    rdpcap_sync_pipe();
+    rdpcap_set_mode_standard();
+    rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+    rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
+    set_render_color(RED);
+    RenderState state;
+    render_get_state(&state);
+    cmdq_set_state(&state);
+
+    uint32_t start = get_ticks();
+    int started = 0;
+    for (int i = 0; i < producers; ++i) {
+      threads[i].first = BENCH_CMDQ_DRAWS * i / producers;
+      threads[i].count = BENCH_CMDQ_DRAWS * (i + 1) / producers - threads[i].first;
+      if (pthread_create(&threads[i].thread, NULL, bench_cmdq_producer, &threads[i]) != 0) {
+        debugf("Failed to start producer %d\n", i);
+        break;
+      }
+      started++;
+    }
+    uint32_t drained = 0;
+    int target = started == producers ? BENCH_CMDQ_DRAWS : threads[started].first;
+    while (drained < (uint32_t)target) {
+      uint32_t n = cmdq_drain();
+      if (n == 0) {
+        sched_yield();
+      }
+      drained += n;
+    }
+    for (int i = 0; i < started; ++i) {
+      pthread_join(threads[i].thread, NULL);
+    }
+    if (f >= BENCH_WARMUP) {
+      totalTicks += get_ticks() - start;
+      segments += drained;
+    }
+
+    accums_reset();
+    rdpq_detach_show();
+    rdpcap_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+    arena_frame_end();
+  }
+
+  double ms = totalTicks * 1000.0 / TICKS_PER_SECOND / BENCH_FRAMES;
+  debugf("cmdq,%d,%d,%d,%d,%.3f,%.1f,%llu,%llu,%llu\n",
+    producers,
+    jobs_cores(),
+    BENCH_CMDQ_DRAWS,
+    BENCH_FRAMES,
+    ms,
+    ms > 0.0 ? segments / (double)BENCH_FRAMES / ms : 0.0,
+    (unsigned long long)cmdqRun.waits,
+    (unsigned long long)cmdqRun.stalls,
+    (unsigned long long)(cmdqRun.segments ? cmdqRun.bytes / cmdqRun.segments : 0)
+  );
+}
+
+// Function to run the command queue from 1 to BENCH_CMDQ_PRODUCERS producer threads
+static void bench_cmdq() {
+  debugf("cmdq,producers,cores,draws,frames,cpu_avg_ms,draws_per_ms,waits,stalls,segment_bytes\n");
+  for (int producers = 1; producers <= BENCH_CMDQ_PRODUCERS; producers *= 2) {
+    bench_cmdq_run(producers);
+  }
+  cmdq_reset();
+}
+#endif // N64_HOST
+
+// Main function, runs every case once then idles on the console
+int main() {
+  setup();
+
+  debugf("bench,case,param,value,frames,reps,cpu_min_us,cpu_avg_us,cpu_max_us,tris,verts,rspq_bytes,rdp_bytes,allocs,alloc_bytes,fill_cost\n");
+#ifdef N64_HOST
+  debugf("raster,case,value,tested,tri_us\n");
+  debugf("edge,case,value,tris,alias_err,shape_err\n");
+#endif // N64_HOST
+
+  for (size_t i = 0; i < BENCH_CASE_COUNT; ++i) {
+    const BenchCase* c = &benchCases[i];
+    for (int v = 0; v < c->valueCount; ++v) {
+      bench_run(c, c->values[v], i);
+    }
+  }
+
+  bench_spatial();
+  bench_collide();
+  bench_bvh();
+  bench_scene();
+  bench_mesh();
+  bench_fixed();
+
+#ifdef N64_HOST
+  bench_jobs();
+  bench_cmdq();
+  bench_tiles();
+#endif // N64_HOST
+
+  mem_dump();
+  arena_dump();
+
+#ifdef N64_HOST
+  return 0;
+#endif // N64_HOST
+
+  for (;;) {
+    surface_t* fb = display_get();
+    rdpq_attach(fb, &disp);
+    rdpcap_clear(GREY);
+    rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, 20, 20,
+      "Benchmark done\n\n"
+      "%d cases, results are in\n"
+      "the debug log as bench, lines",
+      (int)BENCH_CASE_COUNT
+    );
+    rdpq_detach_show();
   }
 
   //=========== ~ CLEAN UP ~ =============//
@@ -0,0 +1,185 @@
+#include <libdragon.h>
+#include "lod.h"
+#include "budget.h"
+
+float lodQuality = LOD_QUALITY;
+THREAD_LOCAL LodState* lodState;
+THREAD_LOCAL LodStats lodFrame;
+LodStats lodLast;
+
+// Last count handed out and what it would have been without the budget, read by lod_count
+static THREAD_LOCAL struct {
+  int segments;
+  int full;
+} lodPick;
+
+void lod_init() {
+  lodState = NULL;
+  lodPick.segments = lodPick.full = 0;
+  memset(&lodFrame, 0, sizeof(LodStats));
+  memset(&lodLast, 0, sizeof(LodStats));
+  lod_set_quality(LOD_QUALITY);
+
+#ifdef N64_HOST
+  const char* quality = getenv("LOD_QUALITY");
+  if (quality && *quality) {
+    lod_set_quality(strtof(quality, NULL));
+  }
+#endif // N64_HOST
+}
+
+void lod_set_quality(float quality) {
+  lodQuality = fminf(fmaxf(quality, LOD_QUALITY_MIN), LOD_QUALITY_MAX);
+}
+
+// Function to keep a count steady in the current LodState, going up right away and down with some margin
+static int lod_hold(int wanted) {
+  if (!lodState) {
+    return wanted;
+  }
+  int held = lodState->segments;
+  if (held == 0 || wanted > held || (float)wanted < (float)held * (1.0f - LOD_HYSTERESIS)) {
+    held = wanted;
+  }
+  lodState->segments = held;
+  return held;
+}
+
+// Function to remember a count for lod_count and hand it out
+static int lod_pick(int segments, int full) {
+  lodPick.segments = segments;
+  lodPick.full = full;
+  return segments;
+}
+
+// Segments for an arc of a circle so no chord is further than the error from it
+static int lod_arc_count(float radius, float span, float quality) {
+  float error = LOD_ERROR / quality;
+  if (radius <= error) {
+    return 1;
+  }
+  float step = 2.0f * acosf(1.0f - error / radius);
+  int segments = (int)ceilf(fabsf(span) / step);
+  return segments < 1 ? 1 : (segments > LOD_MAX_SEGMENTS ? LOD_MAX_SEGMENTS : segments);
+}
+
+// Function to get the segments of an ellipse, LOD_CULL when too small to see and LOD_QUAD when a quad will do
+int lod_ellipse_segments(float rx, float ry) {
+  float radius = fmaxf(fabsf(rx), fabsf(ry));
+  float size = radius * 2.0f;
+  if (size <= LOD_CULL_SIZE) {
+    return lod_pick(LOD_CULL, LOD_CULL);
+  }
+  if (size < LOD_QUAD_SIZE) {
+    return lod_pick(LOD_QUAD, LOD_QUAD);
+  }
+
+  // The larger radius bounds the error all around the ellipse
+  int full = lod_arc_count(radius, 2.0f * M_PI, lodQuality);
+  full = full < LOD_MIN_SEGMENTS ? LOD_MIN_SEGMENTS : full;
+  if (budget_scale() >= 1.0f) {
+    return lod_pick(lod_hold(full), full);
+  }
+
+  // Over budget, small detail is the first to become a quad
+  if (budgetPriority == BUDGET_DETAIL && size < BUDGET_SMALL_SIZE) {
+    return lod_pick(LOD_QUAD, full);
+  }
+  int segments = lod_arc_count(radius, 2.0f * M_PI, lodQuality * budget_scale());
+  segments = segments < LOD_MIN_SEGMENTS ? LOD_MIN_SEGMENTS : segments;
+  return lod_pick(lod_hold(segments), full);
+}
+
+// Function to get the segments the fixed area rules picked before the policy, kept to report the savings
+int lod_fixed_ellipse_segments(float rx, float lod) {
+  float area = rx * 2.0f;
+  if (area <= 0.9f) {
+    return LOD_CULL;
+  }
+  if (area < 2.9f) {
+    return LOD_QUAD;
+  }
+  int segments = (int)((area < 3.0f) ? 3.0f : area) / ((area >= 9.9f) ? 2 : 3);
+  segments = segments < 6 ? 6 : segments;
+  if (area > 9.9f) {
+    segments = (segments > 200 || lod > 2.0f) ? 200 : segments;
+  }
+  return segments;
+}
+
+// Raw segments of a cubic bezier, Wang's formula: the second differences bound how far it bends from a chord
+static int lod_bezier_count(const Point* p0, const Point* p1, const Point* p2, const Point* p3, float quality) {
+  float ax = p0->x - 2.0f * p1->x + p2->x;
+  float ay = p0->y - 2.0f * p1->y + p2->y;
+  float bx = p1->x - 2.0f * p2->x + p3->x;
+  float by = p1->y - 2.0f * p2->y + p3->y;
+  float bend = fmaxf(sqrtf(ax * ax + ay * ay), sqrtf(bx * bx + by * by));
+
+  float error = LOD_ERROR / quality;
+  int segments = (int)ceilf(sqrtf(0.75f * bend / error));
+  return segments < 1 ? 1 : segments;
+}
+
+static int lod_cap(int segments, int maxSegments) {
+  int cap = maxSegments > 0 ? maxSegments : LOD_MAX_SEGMENTS;
+  return segments > cap ? cap : segments;
+}
+
+// Function to get the segments of a cubic bezier, at most maxSegments unless it is LOD_AUTO
+int lod_bezier_segments(const Point* p0, const Point* p1, const Point* p2, const Point* p3, int maxSegments) {
+  int full = lod_cap(lod_bezier_count(p0, p1, p2, p3, lodQuality), maxSegments);
+  return lod_pick(lod_cap(lod_hold(lod_bezier_count(p0, p1, p2, p3, lodQuality * budget_scale())), maxSegments), full);
+}
+
+// Function to get one count for two beziers that are drawn point to point, the one bending more decides
+int lod_bezier_pair_segments(const Point* p0, const Point* p1, const Point* p2, const Point* p3,
+                             const Point* q0, const Point* q1, const Point* q2, const Point* q3, int maxSegments) {
+  float quality = lodQuality * budget_scale();
+  int full = lod_bezier_count(p0, p1, p2, p3, lodQuality);
+  int fullBottom = lod_bezier_count(q0, q1, q2, q3, lodQuality);
+  int top = lod_bezier_count(p0, p1, p2, p3, quality);
+  int bottom = lod_bezier_count(q0, q1, q2, q3, quality);
+  full = lod_cap(full > fullBottom ? full : fullBottom, maxSegments);
+  return lod_pick(lod_cap(lod_hold(top > bottom ? top : bottom), maxSegments), full);
+}
+
+// Function to count a shape drawn through the policy against what the fixed counts would have drawn
+void lod_count(int fixedTris, int tris) {
+  lodFrame.shapes++;
+  lodFrame.tris += tris;
+  lodFrame.trisSaved += fixedTris - tris;
+
+  // The budget plans the next frame from what the shape would have cost at full detail
+  // A quad drawn as a rectangle has no triangles, its full detail is the ellipse's segment count
+  int fullTris = tris;
+  if (lodPick.segments > 0) {
+    fullTris = tris > 0 ? tris * lodPick.full / lodPick.segments : lodPick.full;
+  }
+  budget_lod(fullTris, tris);
+  lodPick.segments = lodPick.full = 0;
+}
+
+void lod_frame_end() {
+  lodLast = lodFrame;
+  memset(&lodFrame, 0, sizeof(LodStats));
+}
+
+void lod_draw_overlay(float x, float y) {
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y,
+    "LOD q%.2f %3lu shapes %4ld tris saved",
+    lodQuality,
+    (unsigned long)lodLast.shapes,
+    (long)lodLast.trisSaved
+  );
+}
+
+// Function to print the last frame's LOD stats to the debug log as a `lod,` line
+void lod_dump() {
+  debugf("lod,quality,shapes,tris,tris_saved\n");
+  debugf("lod,%.2f,%lu,%lu,%ld\n",
+    lodQuality,
+    (unsigned long)lodLast.shapes,
+    (unsigned long)lodLast.tris,
+    (long)lodLast.trisSaved
+  );
+}
@@ -0,0 +1,88 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <libdragon.h>
+#include "thread.h"
+#include "point.h"
+
+// Default for the global quality knob, higher draws more segments
+#ifndef LOD_QUALITY
+#define LOD_QUALITY 1.0f
+#endif
+
+#define LOD_QUALITY_MIN 0.25f
+#define LOD_QUALITY_MAX 4.0f
+
+#define LOD_ERROR 0.5f // Allowed distance in pixels between a curve and its segments at quality 1
+#define LOD_HYSTERESIS 0.2f // Share a count must drop by before a held count follows it down
+#define LOD_CULL_SIZE 0.9f // Ellipses this wide or smaller are skipped
+#define LOD_QUAD_SIZE 2.9f // Ellipses smaller than this are drawn as a quad
+#define LOD_MIN_SEGMENTS 5
+#define LOD_MAX_SEGMENTS 200
+#define LOD_AUTO 0 // Segment argument that lets the policy pick without a cap
+
+// Ellipse segment counts with a special meaning
+#define LOD_CULL 0
+#define LOD_QUAD 2
+
+/*
+  Screen size driven level of detail for every curved primitive.
+
+  Segment counts come from the chord error: a curve is split until no
+  segment is further than LOD_ERROR / lodQuality pixels from it. Ellipses
+  use their larger radius, beziers the largest second difference of their
+  control points (Wang's formula), so flat curves get few segments however
+  long they are.
+
+  Counts only hold steady between frames for shapes drawn inside a LOD_SCOPE
+  with their own LodState: a count goes up as soon as it is needed but only
+  comes down once the wanted count is LOD_HYSTERESIS lower, so a shape
+  growing and shrinking by a pixel does not flicker between two counts.
+  The draw calls know nothing of the shape they draw, so outside a scope
+  every call picks its count anew and a scaling shape pops between counts.
+  A shape that lives across frames keeps a LodState next to its other data
+  and opens a scope around its draw, like the examples and every SceneNode
+  do. One state is for one shape, shapes sharing it fight over its count.
+*/
+typedef struct {
+  int segments; // Count in use, 0 before the first draw
+} LodState;
+
+typedef struct {
+  uint32_t shapes; // Shapes that went through the policy
+  uint32_t tris; // Triangles drawn by them
+  int32_t trisSaved; // Against the fixed counts used before the policy
+} LodStats;
+
+extern float lodQuality;
+extern THREAD_LOCAL LodState* lodState;
+extern THREAD_LOCAL LodStats lodFrame;
+extern LodStats lodLast;
+
+void lod_init();
+void lod_set_quality(float quality);
+int lod_ellipse_segments(float rx, float ry);
+int lod_fixed_ellipse_segments(float rx, float lod);
+int lod_bezier_segments(const Point* p0, const Point* p1, const Point* p2, const Point* p3, int maxSegments);
+int lod_bezier_pair_segments(const Point* p0, const Point* p1, const Point* p2, const Point* p3,
+                             const Point* q0, const Point* q1, const Point* q2, const Point* q3, int maxSegments);
+void lod_count(int fixedTris, int tris);
+void lod_frame_end();
+void lod_draw_overlay(float x, float y);
+void lod_dump();
+
+// Function to keep the counts of the rest of a scope in a state, inner scopes win
+static inline LodState* lod_scope_begin(LodState* state) {
+  LodState* prev = lodState;
+  lodState = state;
+  return prev;
+}
+
+static inline void lod_scope_end(LodState** prev) {
+  lodState = *prev;
+}
+
+#define LOD_SCOPE(state) \
+  LodState* __attribute__((cleanup(lod_scope_end), unused)) _lod_scope = lod_scope_begin(state)
+
+#endif // LOD_H
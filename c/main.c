@@ -11,15 +11,22 @@
 #include "examples/chain.h"
 #include "examples/snake.h"
 
+#include "input.h"
+
 #include "rspq_constants.h"
 #if defined(RSPQ_PROFILE) && RSPQ_PROFILE
 #include "rspq_profile.h"
 static rspq_profile_data_t profile_data;
+static uint64_t profile_slot_ticks[sizeof(profile_data.slots) / sizeof(profile_data.slots[0])];
+static const char* profile_slot_names[sizeof(profile_data.slots) / sizeof(profile_data.slots[0])];
 #endif // RSPQ_PROFILE
 
 // Texture test
 static sprite_t *test_sprite;
 
+// AA fringe along the outlines, C-Up in the circle and snake examples
+static bool aaFringe;
+
 //DEFINE_RSP_UCODE(rsp_rdpq_fan);
 //uint32_t fan_add_id;
 
@@ -28,8 +35,14 @@ int ramUsed = 0;
 // Initialize libdragon
 void setup() {
 
+  // Before anything is allocated
+  mem_init();
+
   debug_init_isviewer();
   debug_init_usblog();
+#if RDPCAP || INPUT_RECORD || INPUT_REPLAY
+  debug_init_sdfs("sd:/", -1);
+#endif // RDPCAP || INPUT_RECORD || INPUT_REPLAY
     
   dfs_init(DFS_DEFAULT_LOCATION);
 
@@ -55,34 +68,55 @@ void setup() {
 #endif // RSPQ_PROFILE
 
   joypad_init();
+  input_init();
 
+  // The font is allocated inside Libdragon, so it is measured on the heap once here
+  uint32_t heapBefore = mem_heap_used();
   rdpq_text_register_font(FONT_BUILTIN_DEBUG_MONO, rdpq_font_load_builtin(FONT_BUILTIN_DEBUG_MONO));
+  mem_track_external(MEM_TAG_TEXT, mem_heap_used() - heapBefore);
 
   // Texture test
   test_sprite = sprite_load("rom:/n64brew.sprite");
   rdpq_sprite_upload(TILE0, test_sprite, NULL);
+  circleSprite = test_sprite;
 
   accums_init();
+  prof_init();
+  lod_init();
+  budget_init();
+  fillrate_init();
+  arena_init();
+  rdpcap_init();
+#if RDPCAP
+  if (rdpcap_open(RDPCAP_PATH)) {
+    atexit(rdpcap_close);
+  }
+#endif // RDPCAP
+  int prevTag = mem_tag_begin(MEM_TAG_SHAPES);
   shape_control_init();
   create_circle();
   create_quad();
   create_fan();
   create_bezier();
   init_snakes();
+  mem_tag_end(&prevTag);
 
   // For quick fan testing
   example = SNAKES;
 
   // RAM usage
-  mem_info = mallinfo(); // Setting this every frame leads to memory leak
-  ldRAM = 916; // Precalculated RAM used by Libdragon
   totalRAM = (get_memory_size() / 1024); // Either 4096 or 8192
+#ifdef N64_HOST
+  atexit(mem_dump);
+  atexit(arena_dump);
+#endif // N64_HOST
 
 }
 
 // Main rendering function
 void draw() {
-  
+  set_render_fringe(aaFringe);
+
   switch (example) {
     case CIRCLE:
       circle_draw();
@@ -101,7 +135,10 @@ void draw() {
       break;
   }
 
-  rdpq_sync_pipe(); // Since i don't have access to the internal autosync
+  // Back to flat before the text and the next frame's mode
+  set_render_fringe(false);
+
+  rdpcap_sync_pipe(); // Since i don't have access to the internal autosync
 
 }
 
@@ -139,7 +176,6 @@ void reset_example() {
 
 void switch_example() {
   reset_example();
-  mem_info = mallinfo();
   ramUsed = 0;
   if (++example > SNAKES) {
     example = CIRCLE;
@@ -149,56 +185,70 @@ void switch_example() {
 // Main function with rendering loop
 int main() {
   setup();
-  bootTime = get_ticks_ms();
 
   for (;;) {
 
+    prof_begin(ZONE_FRAME);
+
     if(example == SNAKES) {
       display_set_fps_limit(30.0f); // FIXME TODO YOU WILL BE 60 MY LITTLE FRIENDS
     } else {
       display_set_fps_limit(0); // Disable limiter
     }
 
-    firstTime = get_ticks_ms();// set loop time
-
-    rdpq_attach(display_get(), &disp);
-    rdpq_clear(GREY);
-    rdpq_clear_z(0xFFFC);
-
-    rdpq_sync_pipe();
-    rdpq_set_mode_standard();
-    rdpq_mode_combiner(RDPQ_COMBINER_FLAT);
-    if(example == FAN || example == BEZIER || example == SNAKES){
-      rdpq_mode_blender(RDPQ_BLENDER_MULTIPLY);
+    // Waiting for a free framebuffer is counted as sync
+    prof_begin(ZONE_SYNC);
+    surface_t* fb = display_get();
+    prof_end(ZONE_SYNC);
+
+    prof_begin(ZONE_DISPLAY);
+    rdpq_attach(fb, &disp);
+    rdpcap_clear(GREY);
+    rdpcap_clear_z(0xFFFC);
+
+    rdpcap_sync_pipe();
+    rdpcap_set_mode_standard();
+    rdpcap_mode_combiner(RDPQ_COMBINER_FLAT);
+    if(example == FAN || example == BEZIER || example == SNAKES || aaFringe){
+      rdpcap_mode_blender(RDPQ_BLENDER_MULTIPLY);
     } else {
-      rdpq_mode_blender(0);
+      rdpcap_mode_blender(0);
     }
+    prof_end(ZONE_DISPLAY);
 
-    dispTime = get_ticks_ms() - firstTime; // set display time
-    secondTime = get_ticks_ms();
-
+    prof_begin(ZONE_INPUT);
+    // Live, recorded or replayed, see input.h
     joypad_poll();
-    joypad_inputs_t input = joypad_get_inputs(JOYPAD_PORT_1);
-    joypad_buttons_t keys = joypad_get_buttons_pressed(JOYPAD_PORT_1);
-    joypad_buttons_t keysDown = joypad_get_buttons_held(JOYPAD_PORT_1);
+    joypad_inputs_t input;
+    joypad_buttons_t keys, keysDown;
+    input_get(JOYPAD_PORT_1, &input, &keys, &keysDown);
 
-    // RAM used from RDPQ Demo
-    ramUsed = mem_info.uordblks - (size_t) (((display_get_width() * display_get_height()) * 2) - ((unsigned int) HEAP_START_ADDR - 0x80000000) - 0x10000);
-    ramUsed = (ramUsed / 1024);
+    // RAM allocated by this program, tracked by memtrack.c
+    ramUsed = memTotal.live / 1024;
 
     stickX = (float)input.stick_x;
     stickY = (float)input.stick_y;
 
-    jpTime = get_ticks_ms() - secondTime; // set input time
-
     if (keys.l)switch_example();
 
-    if (keys.start)reset_example();
+    // Z + Start toggles the profiler overlay, Start alone resets
+    if (keys.start && keysDown.z) {
+      showProfiler = !showProfiler;
+    } else if (keys.start) {
+      reset_example();
+    }
+
+    // With the overlay shown D-Up/D-Down double or halve the LOD quality
+    if (showProfiler && keys.d_up) lod_set_quality(lodQuality * 2.0f);
+    if (showProfiler && keys.d_down) lod_set_quality(lodQuality * 0.5f);
+    prof_end(ZONE_INPUT);
 
 
 //=========== ~ UPDATE ~ ==============//
 
+    prof_begin(ZONE_UPDATE);
     draw();
+    prof_end(ZONE_UPDATE);
 
 //=========== ~ CONTROLS ~ ==============//
 
@@ -215,6 +265,10 @@ int main() {
       case CIRCLE:
         // Color
         if(keys.a)set_fill_color(currShape, get_random_render_color());
+        // Texture
+        if(keysDown.b)circleTexMode = (circleTexMode + 1) % 3;
+        // Antialiasing
+        if(keysDown.c_up)aaFringe = !aaFringe;
         // Scale
         if(keysDown.r)increase_scale(currShape);
         if(keysDown.z)decrease_scale(currShape);
@@ -255,8 +309,8 @@ int main() {
         if(keysDown.c_right)increase_x_scale(currShape);
         if(keysDown.c_left)decrease_x_scale(currShape);
         // Segments
-        if(keys.d_up)increase_segments(currShape);
-        if(keys.d_down)decrease_segments(currShape);
+        if(keys.d_up && !showProfiler)increase_segments(currShape);
+        if(keys.d_down && !showProfiler)decrease_segments(currShape);
         if(keys.d_right)cycle_control_point();
         if(keys.d_left)cycle_control_point();
         // Rotation
@@ -282,12 +336,16 @@ int main() {
         break;
       case SNAKES:
         if(keysDown.a)chain_display(snake1->spine, 3.0f);
+        if(keysDown.b)snakeGradient = !snakeGradient;
+        if(keysDown.c_up)aaFringe = !aaFringe;
         break;
     }
 
 
 //=========== ~ UI ~ =============//
 
+    prof_begin(ZONE_UI);
+
     uint32_t frameLimit = 0;
     if(example == SNAKES){
       frameLimit = 29;
@@ -296,13 +354,31 @@ int main() {
     }
 
     if(frameCounter > frameLimit){
-      drawTime = ((get_ticks_ms() - secondTime) + dispTime + jpTime); // CPU time after draw and transform
+      // CPU time is the whole frame minus waiting on the display
+      prof_update_stats();
+      mem_update_stats();
+      cpuTime = prof_ticks_to_ms(prof_get_stats(ZONE_FRAME)->avg - prof_get_stats(ZONE_SYNC)->avg);
+      if(showProfiler){
+        prof_dump();
+        mem_dump();
+        lod_dump();
+        budget_dump();
+        fillrate_dump();
+        arena_dump();
+      }
       frameCounter = 0;
     }
 
 
 
-    if(example == CIRCLE){
+    if(showProfiler){
+
+      prof_draw_overlay(20, 20);
+      mem_draw_overlay(20, 144);
+      lod_draw_overlay(20, 212);
+      budget_draw_overlay(20, 221);
+      fillrate_draw_overlay(20, 230);
+    } else if(example == CIRCLE){
 
       rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, 20, 20, 
         "Circle\n\n"
@@ -311,10 +387,12 @@ int main() {
         "LOD: %.2f\n"
         "Tris: %u\n"
         "FPS: %.2f\n"
-        "CPU Time: %lldms\n\n"
+        "CPU Time: %.2fms\n\n"
         "Control Stick: Move\n"
         "R/Z: Scale\n"
         "A: Color\n"
+        "B: Texture\n"
+        "C-Up: AA Fringe\n"
         "Start: Reset Example\n"
         "L: Switch Example\n\n"
         "RAM: %dKB/%dKB",
@@ -323,7 +401,7 @@ int main() {
         triCount * 0.01f,
         triCount,
         display_get_fps(),
-        drawTime,
+        cpuTime,
         ramUsed, totalRAM
       );
     } else if (example == QUAD) {
@@ -336,7 +414,7 @@ int main() {
         "Verts: %u\n"
         "Tris: %u\n"
         "FPS: %.2f\n"
-        "CPU Time: %lldms\n"
+        "CPU Time: %.2fms\n"
         "Control Stick: Move\n"
         "R/Z: Scale\n"
         "CL/CR: Width\n"
@@ -351,7 +429,7 @@ int main() {
         vertCount, // Always 4 vertices per quad
         triCount, // Always 2 triangles per quad
         display_get_fps(),
-        drawTime,
+        cpuTime,
         ramUsed, totalRAM
       );
     } else if (example == BEZIER) {
@@ -364,7 +442,7 @@ int main() {
         "Fill Tris: %u\n"
         "Curve Tris: %u\n"
         "FPS: %.2f\n"
-        "CPU Time: %lldms\n\n"
+        "CPU Time: %.2fms\n\n"
         "Control Stick: Move\n"
         "Z/R: Cycle Segments\n"
         "CL/CD: Cycle Control\n"
@@ -381,7 +459,7 @@ int main() {
         fillTris,
         currTris,
         display_get_fps(),
-        drawTime,
+        cpuTime,
         ramUsed, totalRAM
       );
     } else if (example == FAN) {
@@ -394,7 +472,7 @@ int main() {
         "Verts: %d/%d\n"
         "Tris: %u\n"
         "FPS: %.2f\n"
-        "CPU Time: %lldms\n"
+        "CPU Time: %.2fms\n"
         "Control Stick: Move\n"
         "R/Z: Scale\n"
         "CL/CR: X Scale\n"
@@ -413,7 +491,7 @@ int main() {
         vertCount - 14, // Subtract the UX circle's verts
         triCount - 12, // Subtract the UX circle's tris
         display_get_fps(),
-        drawTime,
+        cpuTime,
         ramUsed, totalRAM
       );
     } else if (example == SNAKES) {
@@ -425,49 +503,71 @@ int main() {
         "Joints: %d\n\n"
         "RAM: %dKB/%dKB\n"
         "FPS: %.2f\n"
-        "CPU Time: %lldms\n\n"
+        "CPU Time: %.2fms\n\n"
         "Control Stick: Move\n"
         "A: Display Spine\n"
+        "B: Gradient\n"
+        "C-Up: AA Fringe\n"
         "L: Switch Example\n",
         triCount,
         snake1->spine->joints->count,
         ramUsed, totalRAM,
         display_get_fps(),
-        (drawTime + (drawTime % 2)) / 2 // Because of the frame limiter
+        cpuTime
       );
     }
 
+    prof_end(ZONE_UI);
+
     // Reset acummulators
     accums_reset();
 
     frameCounter++;
     
+    prof_begin(ZONE_SYNC);
     rdpq_detach_show();
+    prof_end(ZONE_SYNC);
 
 #if defined(RSPQ_PROFILE) && RSPQ_PROFILE
     rspq_profile_next_frame();
 
+    // Per frame RSP overlay and RDP busy counters for the capture log
+    rspq_profile_get_data(&profile_data);
+    for (size_t i = 0; i < sizeof(profile_data.slots) / sizeof(profile_data.slots[0]); ++i) {
+      profile_slot_ticks[i] = profile_data.slots[i].total_ticks;
+      profile_slot_names[i] = profile_data.slots[i].name;
+    }
+    rdpcap_set_rcp(profile_data.total_ticks, profile_data.rdp_busy_ticks,
+      profile_slot_ticks, profile_slot_names, sizeof(profile_data.slots) / sizeof(profile_data.slots[0]));
+
   // Every second we profile the RSPQ
     if(frameCounter > frameLimit){
       rspq_profile_dump();
       rspq_profile_reset();    
     }
-  
-
-    rspq_profile_get_data(&profile_data);
 #endif // RSPQ_PROFILE
 
+    prof_end(ZONE_FRAME);
+    rdpcap_set_cpu(profZones[ZONE_FRAME].frameTicks - profZones[ZONE_SYNC].frameTicks);
+    prof_frame_end();
+    rdpcap_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+    arena_frame_end();
+
   }
 
   //=========== ~ CLEAN UP ~ =============//
-  free_uncached(currShape);
-  free_uncached(circle);
-  free_uncached(quad);
-  free_uncached(fan);
-  free_uncached(curve);
-  free_uncached(curve2);
-  free_uncached(bezierPoints);
-  free_uncached(basePoints);
-  free_uncached(currPoints);
+  mem_free(currShape);
+  mem_free(circle);
+  mem_free(quad);
+  mem_free(fan);
+  mem_free(curve);
+  mem_free(curve2);
+  mem_free(bezierPoints);
+  mem_free(basePoints);
+  mem_free(currPoints);
   return 0;
 }
@@ -0,0 +1,237 @@
+#include <libdragon.h>
+#include <malloc.h>
+#include "memtrack.h"
+
+#define MEM_MAGIC 0x4D54
+
+// Kept in front of every block, 16 bytes so the block keeps malloc's and the cache line alignment
+typedef struct {
+  uint32_t size;
+  uint16_t magic;
+  uint8_t tag;
+  uint8_t uncached;
+  uint32_t pad[2];
+} MemHeader;
+
+const char* memTagNames[MEM_TAG_COUNT] = {
+  [MEM_TAG_OTHER]        = "other",
+  [MEM_TAG_TESSELLATION] = "tessellation",
+  [MEM_TAG_SHAPES]       = "shapes",
+  [MEM_TAG_FAN]          = "fan",
+  [MEM_TAG_TEXT]         = "text",
+};
+
+MemStats memTags[MEM_TAG_COUNT];
+MemStats memTotal;
+THREAD_LOCAL int memTag;
+
+// Host job workers allocate too, the stats are shared
+static THREAD_MUTEX(memLock);
+
+// Allocation counts since the last mem_update_stats
+static uint32_t memWindowFrames;
+static uint32_t memWindowAllocs[MEM_TAG_COUNT];
+static uint32_t memWindowBytes[MEM_TAG_COUNT];
+
+void mem_init() {
+  memset(memTags, 0, sizeof(memTags));
+  memset(&memTotal, 0, sizeof(MemStats));
+  memset(memWindowAllocs, 0, sizeof(memWindowAllocs));
+  memset(memWindowBytes, 0, sizeof(memWindowBytes));
+  memWindowFrames = 0;
+  memTag = MEM_TAG_OTHER;
+}
+
+static void mem_add(MemStats* s, uint32_t size) {
+  THREAD_LOCK(memLock);
+  s->live += size;
+  if (s->live > s->peak) {
+    s->peak = s->live;
+  }
+  s->allocs++;
+  s->frameAllocs++;
+  s->frameBytes += size;
+}
+
+static void mem_remove(MemStats* s, uint32_t size) {
+  THREAD_LOCK(memLock);
+  s->live = size > s->live ? 0 : s->live - size;
+  s->frees++;
+}
+
+// Function to fill in the header of a new block and count it
+static void* mem_track(MemHeader* header, size_t size, bool uncached) {
+  if (!header) {
+    debugf("Allocation of %u bytes failed\n", (unsigned int)size);
+    return NULL;
+  }
+  header->size = size;
+  header->magic = MEM_MAGIC;
+  header->tag = memTag;
+  header->uncached = uncached;
+  mem_add(&memTags[memTag], size);
+  mem_add(&memTotal, size);
+  return header + 1;
+}
+
+static MemHeader* mem_header(void* ptr) {
+  MemHeader* header = (MemHeader*)ptr - 1;
+  if (header->magic != MEM_MAGIC) {
+    debugf("Freeing untracked block %p\n", ptr);
+    return NULL;
+  }
+  return header;
+}
+
+static void mem_untrack(MemHeader* header) {
+  mem_remove(&memTags[header->tag], header->size);
+  mem_remove(&memTotal, header->size);
+  header->magic = 0;
+}
+
+void* mem_malloc(size_t size) {
+  return mem_track((MemHeader*)malloc(sizeof(MemHeader) + size), size, false);
+}
+
+void* mem_malloc_uncached(size_t size) {
+  return mem_track((MemHeader*)malloc_uncached(sizeof(MemHeader) + size), size, true);
+}
+
+// Function to resize a block, the block keeps the tag it was allocated with
+void* mem_realloc(void* ptr, size_t size) {
+  if (!ptr) {
+    return mem_malloc(size);
+  }
+
+  MemHeader* header = mem_header(ptr);
+  if (!header) {
+    return NULL;
+  }
+  MEM_TAG(header->tag);
+
+  // Uncached blocks can't be resized in place
+  if (header->uncached) {
+    void* newPtr = mem_malloc_uncached(size);
+    if (newPtr) {
+      memcpy(newPtr, ptr, size < header->size ? size : header->size);
+      mem_free(ptr);
+    }
+    return newPtr;
+  }
+
+  MemHeader old = *header;
+  MemHeader* newHeader = (MemHeader*)realloc(header, sizeof(MemHeader) + size);
+  if (!newHeader) {
+    return NULL;
+  }
+  mem_untrack(&old);
+  return mem_track(newHeader, size, false);
+}
+
+// Function to free a tracked block, uncached blocks are given back with free_uncached
+void mem_free(void* ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  MemHeader* header = mem_header(ptr);
+  if (!header) {
+    return;
+  }
+
+  bool uncached = header->uncached;
+  mem_untrack(header);
+  if (uncached) {
+    free_uncached(header);
+  } else {
+    free(header);
+  }
+}
+
+// Function to charge memory allocated inside Libdragon (ie font atlases) to a tag
+void mem_track_external(int tag, int32_t bytes) {
+  if (bytes > 0) {
+    mem_add(&memTags[tag], bytes);
+    mem_add(&memTotal, bytes);
+  } else if (bytes < 0) {
+    mem_remove(&memTags[tag], -bytes);
+    mem_remove(&memTotal, -bytes);
+  }
+}
+
+// Bytes in use on the whole heap, only call this at load time, mallinfo leaks when called every frame
+uint32_t mem_heap_used() {
+  struct mallinfo info = mallinfo();
+  return info.uordblks;
+}
+
+// Function to close the allocation counts of this frame
+void mem_frame_end() {
+  for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+    memWindowAllocs[i] += memTags[i].frameAllocs;
+    memWindowBytes[i] += memTags[i].frameBytes;
+    memTags[i].frameAllocs = 0;
+    memTags[i].frameBytes = 0;
+  }
+  memTotal.frameAllocs = 0;
+  memTotal.frameBytes = 0;
+  memWindowFrames++;
+}
+
+// Function to average the allocation rate over the frames since the last call
+void mem_update_stats() {
+  if (memWindowFrames == 0) {
+    return;
+  }
+
+  float allocs = 0.0f;
+  float bytes = 0.0f;
+  for (int i = 0; i < MEM_TAG_COUNT; ++i) {
+    memTags[i].allocsPerFrame = (float)memWindowAllocs[i] / memWindowFrames;
+    memTags[i].bytesPerFrame = (float)memWindowBytes[i] / memWindowFrames;
+    allocs += memTags[i].allocsPerFrame;
+    bytes += memTags[i].bytesPerFrame;
+    memWindowAllocs[i] = 0;
+    memWindowBytes[i] = 0;
+  }
+  memTotal.allocsPerFrame = allocs;
+  memTotal.bytesPerFrame = bytes;
+  memWindowFrames = 0;
+}
+
+// Function to draw live/peak KB and allocations per frame for every tag
+void mem_draw_overlay(float x, float y) {
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y, "Memory     KB peak  al/f  B/f");
+  y += 10.0f;
+
+  for (int i = 0; i <= MEM_TAG_COUNT; ++i) {
+    const MemStats* s = i < MEM_TAG_COUNT ? &memTags[i] : &memTotal;
+    rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y,
+      "%-9s %4lu %4lu %5.1f %4.0f",
+      i < MEM_TAG_COUNT ? memTagNames[i] : "total",
+      (unsigned long)(s->live / 1024),
+      (unsigned long)(s->peak / 1024),
+      s->allocsPerFrame,
+      s->bytesPerFrame
+    );
+    y += 10.0f;
+  }
+}
+
+// Function to print the memory stats to the debug log, one `mem,` line per tag
+void mem_dump() {
+  debugf("mem,tag,live,peak,allocs,frees,allocs_per_frame,bytes_per_frame\n");
+
+  for (int i = 0; i <= MEM_TAG_COUNT; ++i) {
+    const MemStats* s = i < MEM_TAG_COUNT ? &memTags[i] : &memTotal;
+    debugf("mem,%s,%lu,%lu,%lu,%lu,%.2f,%.1f\n",
+      i < MEM_TAG_COUNT ? memTagNames[i] : "total",
+      (unsigned long)s->live,
+      (unsigned long)s->peak,
+      (unsigned long)s->allocs,
+      (unsigned long)s->frees,
+      s->allocsPerFrame,
+      s->bytesPerFrame
+    );
+  }
+}
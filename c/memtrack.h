@@ -0,0 +1,64 @@
+#ifndef MEMTRACK_H
+#define MEMTRACK_H
+
+#include <libdragon.h>
+#include "thread.h"
+
+/*
+  Allocation tracking. Every allocation made by this repo goes through the
+  mem_* functions, which keep a small header in front of the block so frees
+  are charged to the tag and size they were allocated with. The tag is the
+  innermost MEM_TAG scope at the time of the allocation.
+*/
+typedef enum {
+  MEM_TAG_OTHER,
+  MEM_TAG_TESSELLATION,
+  MEM_TAG_SHAPES,
+  MEM_TAG_FAN,
+  MEM_TAG_TEXT,
+  MEM_TAG_COUNT
+} MEM_TAGS;
+
+typedef struct {
+  uint32_t live; // Bytes currently allocated
+  uint32_t peak;
+  uint32_t allocs; // Totals since boot
+  uint32_t frees;
+  uint32_t frameAllocs; // This frame
+  uint32_t frameBytes;
+  float allocsPerFrame; // Averages since the last mem_update_stats
+  float bytesPerFrame;
+} MemStats;
+
+extern const char* memTagNames[MEM_TAG_COUNT];
+extern MemStats memTags[MEM_TAG_COUNT];
+extern MemStats memTotal;
+extern THREAD_LOCAL int memTag;
+
+void mem_init();
+void* mem_malloc(size_t size);
+void* mem_malloc_uncached(size_t size);
+void* mem_realloc(void* ptr, size_t size);
+void mem_free(void* ptr);
+void mem_track_external(int tag, int32_t bytes);
+uint32_t mem_heap_used();
+void mem_frame_end();
+void mem_update_stats();
+void mem_draw_overlay(float x, float y);
+void mem_dump();
+
+// Function to set the tag of allocations for the rest of a scope, inner scopes win
+static inline int mem_tag_begin(int tag) {
+  int prev = memTag;
+  memTag = tag;
+  return prev;
+}
+
+static inline void mem_tag_end(int* prev) {
+  memTag = *prev;
+}
+
+#define MEM_TAG(tag) \
+  int __attribute__((cleanup(mem_tag_end), unused)) _mem_tag = mem_tag_begin(tag)
+
+#endif // MEMTRACK_H
@@ -1,5 +1,7 @@
 #include <libdragon.h>
 #include "point.h"
+#include "memtrack.h"
+#include "fixed.h"
 
 // Constructors
 Point point_new(float x, float y) {
@@ -25,11 +27,23 @@ Point point_multiply(const Point* p, float scalar) {
 }
 
 Point point_normalized(const Point* p) {
+#if POINT_FIXED
+    fixed_t x = fixed_from_float(p->x);
+    fixed_t y = fixed_from_float(p->y);
+    fixed_t length = fixed_length(x, y);
+    if (length == 0) {
+        return (Point){0, 0};
+    }
+    // One division for both, x and y are at most the length so the products fit 64 bits
+    int64_t inverse = ((int64_t)1 << 47) / length;
+    return (Point){fixed_to_float((fixed_t)((x * inverse) >> 31)), fixed_to_float((fixed_t)((y * inverse) >> 31))};
+#else
     float magnitude = sqrtf(p->x * p->x + p->y * p->y);
     if (magnitude == 0.0f) {
         return (Point){0, 0}; // Return a zero vector if the magnitude is zero
     }
     return (Point){p->x / magnitude, p->y / magnitude};
+#endif
 }
 
 // Member functions
@@ -47,23 +61,40 @@ Point point_sub(const Point* v1, const Point* v2) {
 }
 
 float point_heading(Point p) {
+#if POINT_FIXED
+    return fixed_angle_to_float(fixed_atan2(fixed_from_float(p.y), fixed_from_float(p.x)));
+#else
     return fm_atan2f(p.y, p.x);
+#endif
 }
 
 Point point_from_angle(float angle) {
+#if POINT_FIXED
+    int32_t a = fixed_angle_from_float(angle);
+    return point_new(fixed_to_float(fixed_cos(a)), fixed_to_float(fixed_sin(a)));
+#else
     return point_new(fm_cosf(angle), fm_sinf(angle));
+#endif
 }
 
 float point_magnitude(const Point* p) {
+#if POINT_FIXED
+    return fixed_to_float(fixed_length(fixed_from_float(p->x), fixed_from_float(p->y)));
+#else
     return sqrtf(p->x * p->x + p->y * p->y);
+#endif
 }
 
 void point_normalize(Point* p) {
+#if POINT_FIXED
+    *p = point_normalized(p);
+#else
     float length = point_magnitude(p);
     if(length != 0) {
         p->x /= length;
         p->y /= length;
     }
+#endif
 }
 
 Point point_set_mag(Point* p, float newMag) {
@@ -91,6 +122,15 @@ Point point_translate(Point p, float dx, float dy) {
 }
 
 void point_rotate(Point* p, const Point* center, float angle) {
+#if POINT_FIXED
+    int32_t a = fixed_angle_from_float(angle);
+    fixed_t fs = fixed_sin(a);
+    fixed_t fc = fixed_cos(a);
+    fixed_t x = fixed_from_float(p->x - center->x);
+    fixed_t y = fixed_from_float(p->y - center->y);
+    p->x = fixed_to_float(fixed_mul(x, fc) - fixed_mul(y, fs)) + center->x;
+    p->y = fixed_to_float(fixed_mul(x, fs) + fixed_mul(y, fc)) + center->y;
+#else
     float s = fm_sinf(angle);
     float c = fm_cosf(angle);
     
@@ -102,6 +142,7 @@ void point_rotate(Point* p, const Point* center, float angle) {
 
     p->x = xnew + center->x;
     p->y = ynew + center->y;
+#endif
 }
 
 Point point_transform(const Point* point, float angle, float width) {
@@ -166,7 +207,7 @@ Point point_lerp(Point* p1, Point* p2, float t) {
 // Function to initialize a PointArray
 void init_point_array(PointArray* array) {
     if (array) {
-        array->points = (Point*)malloc(sizeof(Point));
+        array->points = (Point*)mem_malloc(sizeof(Point));
         if (array->points) {
             array->count = 0;
         } else {
@@ -177,7 +218,7 @@ void init_point_array(PointArray* array) {
 
 // Function to initialize a PointArray from existing points
 void init_point_array_from_points(PointArray* array, Point* points, size_t count) {
-    array->points = (Point*)malloc(sizeof(Point) * count);
+    array->points = (Point*)mem_malloc(sizeof(Point) * count);
     if (array->points == NULL) {
         // Handle memory allocation failure
         debugf("Point allocation failed\n");
@@ -189,7 +230,7 @@ void init_point_array_from_points(PointArray* array, Point* points, size_t count
 
 // Function to add a point to a PointArray
 void add_point(PointArray* array, float x, float y) {
-    Point* new_points = (Point*)realloc(array->points, sizeof(Point) * (array->count + 1));
+    Point* new_points = (Point*)mem_realloc(array->points, sizeof(Point) * (array->count + 1));
     if (new_points == NULL) {
         debugf("Point reallocation failed\n");
         return;
@@ -202,7 +243,7 @@ void add_point(PointArray* array, float x, float y) {
 
 // Function to add an existing point to the PointArray
 void add_existing_point(PointArray* array, Point p) {
-    Point* new_points = (Point*)realloc(array->points, sizeof(Point) * (array->count + 1));
+    Point* new_points = (Point*)mem_realloc(array->points, sizeof(Point) * (array->count + 1));
     if (new_points == NULL) {
         debugf("Point reallocation failed\n");
         return;
@@ -228,5 +269,66 @@ void calculate_array_center(const PointArray* points, Point* center) {
 
 // Function to free a PointArray
 void free_point_array(PointArray* array) {
-    free_uncached(array);
+    mem_free(array);
+}
+
+// Function to store points packed, dst keeps its memory when it has the same count
+void point_array_quantize(PointArrayQ* dst, const PointArray* src) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    if (dst->points == NULL || dst->count != src->count) {
+        PointQ* points = (PointQ*)mem_realloc(dst->points, sizeof(PointQ) * (src->count ? src->count : 1));
+        if (points == NULL) {
+            debugf("Packed point allocation failed\n");
+            return;
+        }
+        dst->points = points;
+        dst->count = src->count;
+    }
+    for (size_t i = 0; i < src->count; ++i) {
+        dst->points[i] = point_quantize(src->points[i]);
+    }
+}
+
+// Function to move packed points by dx, dy quarter pixels, clamped to s13.2
+void point_array_q_translate(PointArrayQ* array, int dx, int dy) {
+    for (size_t i = 0; i < array->count; ++i) {
+        int x = array->points[i].x + dx;
+        int y = array->points[i].y + dy;
+        array->points[i].x = x < -32768 ? -32768 : x > 32767 ? 32767 : x;
+        array->points[i].y = y < -32768 ? -32768 : y > 32767 ? 32767 : y;
+    }
+}
+
+/*
+  Function to rotate packed points around center in integer math, the angle
+  only costs one sine and cosine for the whole array. Every rotation rounds
+  to quarter pixels, rotate from the same source every frame instead of
+  rotating the result again or the rounding adds up. dst needs room for the
+  points of src.
+*/
+void point_array_q_rotate(PointArrayQ* dst, const PointArrayQ* src, PointQ center, float angle) {
+    // s1.14 sine and cosine, the products fit 32 bits for s13.2 positions
+#if POINT_FIXED
+    int32_t a = fixed_angle_from_float(angle);
+    int32_t c = (fixed_cos(a) + 2) >> 2;
+    int32_t s = (fixed_sin(a) + 2) >> 2;
+#else
+    int32_t c = (int32_t)lrintf(fm_cosf(angle) * 16384.0f);
+    int32_t s = (int32_t)lrintf(fm_sinf(angle) * 16384.0f);
+#endif
+    for (size_t i = 0; i < src->count; ++i) {
+        int32_t x = src->points[i].x - center.x;
+        int32_t y = src->points[i].y - center.y;
+        int32_t rx = center.x + ((x * c - y * s + 8192) >> 14);
+        int32_t ry = center.y + ((x * s + y * c + 8192) >> 14);
+        dst->points[i].x = rx < -32768 ? -32768 : rx > 32767 ? 32767 : rx;
+        dst->points[i].y = ry < -32768 ? -32768 : ry > 32767 ? 32767 : ry;
+    }
+    dst->count = src->count;
+}
+
+void point_array_q_free(PointArrayQ* array) {
+    mem_free(array->points);
+    array->points = NULL;
+    array->count = 0;
 }
@@ -14,6 +14,24 @@ typedef struct {
     size_t count;
 } PointArray;
 
+/*
+  Packed position for stored geometry, x and y in quarter pixels as s13.2
+  fixed point, the format the RDP takes positions in. Half the size of a
+  Point, and the submit path (draw_convex_strip_q) hands them to rdpq as
+  they are instead of converting every vertex from float. Covers -8192 to
+  8191.75 pixels, positions outside are clamped.
+*/
+typedef struct {
+    int16_t x, y;
+} PointQ;
+
+typedef struct {
+    PointQ* points;
+    size_t count;
+} PointArrayQ;
+
+#define POINTQ_ONE 4 // Steps per pixel
+
 // Constructors
 Point point_new(float x, float y);
 Point point_default();
@@ -55,4 +73,27 @@ void add_existing_point(PointArray* array, Point p);
 void calculate_array_center(const PointArray* points, Point* center);
 void free_point_array(PointArray* array);
 
+// PointArrayQ functions
+void point_array_quantize(PointArrayQ* dst, const PointArray* src);
+void point_array_q_translate(PointArrayQ* array, int dx, int dy);
+void point_array_q_rotate(PointArrayQ* dst, const PointArrayQ* src, PointQ center, float angle);
+void point_array_q_free(PointArrayQ* array);
+
+// Function to round a coordinate down to quarter pixels like rdpq does, clamped to s13.2
+static inline int16_t point_quantize_coord(float v) {
+    float q = v * POINTQ_ONE;
+    q = q < -32768.0f ? -32768.0f : q > 32767.0f ? 32767.0f : q;
+    // Truncation with the step back for negative fractions, floorf without the call
+    int i = (int)q;
+    return (int16_t)(i - (q < (float)i));
+}
+
+static inline PointQ point_quantize(Point p) {
+    return (PointQ){ point_quantize_coord(p.x), point_quantize_coord(p.y) };
+}
+
+static inline Point point_dequantize(PointQ q) {
+    return (Point){ q.x * (1.0f / POINTQ_ONE), q.y * (1.0f / POINTQ_ONE) };
+}
+
 #endif // POINT_H
@@ -0,0 +1,157 @@
+#include <libdragon.h>
+#include "profiler.h"
+
+THREAD_LOCAL ProfZone profZones[ZONE_COUNT] = {
+  [ZONE_FRAME]      = { .name = "frame",      .parent = -1 },
+  [ZONE_DISPLAY]    = { .name = "display",    .parent = ZONE_FRAME },
+  [ZONE_INPUT]      = { .name = "input",      .parent = ZONE_FRAME },
+  [ZONE_UPDATE]     = { .name = "update",     .parent = ZONE_FRAME },
+  [ZONE_SOLVE]      = { .name = "solve",      .parent = ZONE_UPDATE },
+  [ZONE_TESSELLATE] = { .name = "tessellate", .parent = ZONE_UPDATE },
+  [ZONE_SUBMIT]     = { .name = "submit",     .parent = ZONE_UPDATE },
+  [ZONE_UI]         = { .name = "ui",         .parent = ZONE_FRAME },
+  [ZONE_SYNC]       = { .name = "sync",       .parent = ZONE_FRAME },
+};
+
+uint32_t profFrames;
+
+// Function to clear all zones and their history
+void prof_init() {
+  for (int i = 0; i < ZONE_COUNT; ++i) {
+    ProfZone* z = &profZones[i];
+    z->depth = 0;
+    z->start = 0;
+    z->frameTicks = 0;
+    z->frameCalls = 0;
+    memset(z->history, 0, sizeof(z->history));
+    memset(z->callHistory, 0, sizeof(z->callHistory));
+    memset(&z->stats, 0, sizeof(ProfStats));
+  }
+  profFrames = 0;
+}
+
+// Function to store the ticks of every zone for this frame in the ring buffer
+void prof_frame_end() {
+  uint32_t slot = profFrames & (PROF_HISTORY - 1);
+  for (int i = 0; i < ZONE_COUNT; ++i) {
+    ProfZone* z = &profZones[i];
+    z->history[slot] = z->frameTicks;
+    z->callHistory[slot] = z->frameCalls;
+    z->frameTicks = 0;
+    z->frameCalls = 0;
+  }
+  profFrames++;
+}
+
+// Function to compute min/avg/max/p99 over the stored frames, sorting is done here and not per frame
+void prof_update_stats() {
+  uint32_t count = profFrames < PROF_HISTORY ? profFrames : PROF_HISTORY;
+  if (count == 0) {
+    return;
+  }
+
+  uint32_t sorted[PROF_HISTORY];
+
+  for (int i = 0; i < ZONE_COUNT; ++i) {
+    ProfZone* z = &profZones[i];
+    uint64_t sum = 0;
+    uint64_t callSum = 0;
+
+    // Insertion sort, the history is small enough
+    for (uint32_t j = 0; j < count; ++j) {
+      uint32_t v = z->history[j];
+      uint32_t k = j;
+      while (k > 0 && sorted[k - 1] > v) {
+        sorted[k] = sorted[k - 1];
+        k--;
+      }
+      sorted[k] = v;
+      sum += v;
+      callSum += z->callHistory[j];
+    }
+
+    // Nearest rank percentile
+    uint32_t rank = (count * 99 + 99) / 100;
+
+    z->stats.min = sorted[0];
+    z->stats.max = sorted[count - 1];
+    z->stats.avg = (uint32_t)(sum / count);
+    z->stats.p99 = sorted[rank - 1];
+    z->stats.calls = (uint32_t)(callSum / count);
+  }
+}
+
+const ProfStats* prof_get_stats(int zone) {
+  return &profZones[zone].stats;
+}
+
+float prof_ticks_to_ms(uint32_t ticks) {
+  return (float)ticks * 1000.0f / (float)TICKS_PER_SECOND;
+}
+
+// Function to get the depth of a zone in the hierarchy for indentation
+static int prof_zone_level(int zone) {
+  int level = 0;
+  while (profZones[zone].parent >= 0) {
+    zone = profZones[zone].parent;
+    level++;
+  }
+  return level;
+}
+
+// Function to draw the zone tree with avg/max/p99 in milliseconds
+void prof_draw_overlay(float x, float y) {
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y, "Zone         avg  max  p99");
+  y += 10.0f;
+
+  for (int i = 0; i < ZONE_COUNT; ++i) {
+    const ProfStats* s = &profZones[i].stats;
+    int level = prof_zone_level(i);
+    rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y,
+      "%*s%-*s %4.1f %4.1f %4.1f",
+      level, "",
+      11 - level, profZones[i].name,
+      prof_ticks_to_ms(s->avg),
+      prof_ticks_to_ms(s->max),
+      prof_ticks_to_ms(s->p99)
+    );
+    y += 10.0f;
+  }
+
+  rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, x, y + 4.0f,
+    "Frames: %lu (%d kept)", (unsigned long)profFrames, PROF_HISTORY);
+}
+
+/*
+  Function to print the zone stats to the debug log, which is read on the host
+  through the ISViewer/USB log. Each zone is one `prof,` line so it can be grepped.
+  Self time is the zone's average minus the averages of its direct children.
+*/
+void prof_dump() {
+  debugf("prof,zone,parent,calls,min_us,avg_us,max_us,p99_us,self_us\n");
+
+  for (int i = 0; i < ZONE_COUNT; ++i) {
+    const ProfZone* z = &profZones[i];
+
+    int64_t self = z->stats.avg;
+    for (int j = 0; j < ZONE_COUNT; ++j) {
+      if (profZones[j].parent == i) {
+        self -= profZones[j].stats.avg;
+      }
+    }
+    if (self < 0) {
+      self = 0;
+    }
+
+    debugf("prof,%s,%s,%lu,%lu,%lu,%lu,%lu,%lu\n",
+      z->name,
+      z->parent >= 0 ? profZones[z->parent].name : "-",
+      (unsigned long)z->stats.calls,
+      (unsigned long)TICKS_TO_US(z->stats.min),
+      (unsigned long)TICKS_TO_US(z->stats.avg),
+      (unsigned long)TICKS_TO_US(z->stats.max),
+      (unsigned long)TICKS_TO_US(z->stats.p99),
+      (unsigned long)TICKS_TO_US(self)
+    );
+  }
+}
@@ -0,0 +1,101 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <libdragon.h>
+#include "thread.h"
+
+// Define whether to compile in the zone profiler
+#ifndef PROFILER
+#define PROFILER 1
+#endif
+
+// Frames of history kept per zone, must be a power of 2
+#define PROF_HISTORY 128
+
+/*
+  Zones form a fixed hierarchy, the parent of each zone is set in profiler.c.
+  Zones may be entered any number of times per frame, the time of every
+  entry is summed into one sample per frame. Re-entering a zone that is
+  already open (ie draw_circle falling back to draw_quad) is not counted twice.
+*/
+typedef enum {
+  ZONE_FRAME,
+  ZONE_DISPLAY,
+  ZONE_INPUT,
+  ZONE_UPDATE,
+  ZONE_SOLVE,
+  ZONE_TESSELLATE,
+  ZONE_SUBMIT,
+  ZONE_UI,
+  ZONE_SYNC,
+  ZONE_COUNT
+} PROF_ZONES;
+
+typedef struct {
+  uint32_t min;
+  uint32_t avg;
+  uint32_t max;
+  uint32_t p99;
+  uint32_t calls; // Average entries per frame
+} ProfStats;
+
+typedef struct {
+  const char* name;
+  int parent;
+  int depth; // Open entries, only the outermost one is timed
+  uint32_t start;
+  uint32_t frameTicks;
+  uint32_t frameCalls;
+  uint32_t history[PROF_HISTORY];
+  uint32_t callHistory[PROF_HISTORY];
+  ProfStats stats;
+} ProfZone;
+
+extern THREAD_LOCAL ProfZone profZones[ZONE_COUNT];
+extern uint32_t profFrames;
+
+void prof_init();
+void prof_frame_end();
+void prof_update_stats();
+const ProfStats* prof_get_stats(int zone);
+float prof_ticks_to_ms(uint32_t ticks);
+void prof_draw_overlay(float x, float y);
+void prof_dump();
+
+#if PROFILER
+
+// Start timing a zone
+static inline void prof_begin(int zone) {
+  ProfZone* z = &profZones[zone];
+  if (z->depth++ == 0) {
+    z->start = get_ticks();
+  }
+  z->frameCalls++;
+}
+
+// Stop timing a zone and add the elapsed ticks to the current frame
+static inline void prof_end(int zone) {
+  ProfZone* z = &profZones[zone];
+  if (--z->depth == 0) {
+    z->frameTicks += get_ticks() - z->start;
+  }
+}
+
+// Used by PROF_SCOPE to close the zone when the variable goes out of scope
+static inline void prof_scope_end(int* zone) {
+  prof_end(*zone);
+}
+
+// Times the rest of the enclosing block
+#define PROF_SCOPE(zone) \
+  int __attribute__((cleanup(prof_scope_end), unused)) _prof_scope_##zone = (prof_begin(zone), zone)
+
+#else
+
+static inline void prof_begin(int zone) { (void)zone; }
+static inline void prof_end(int zone) { (void)zone; }
+#define PROF_SCOPE(zone)
+
+#endif // PROFILER
+
+#endif // PROFILER_H
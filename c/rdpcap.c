@@ -0,0 +1,275 @@
+#include <libdragon.h>
+#include "rdpcap.h"
+
+/*
+  RSPQ bytes each command writes to the command buffer and RDP bytes of what
+  the RSP forwards, as libdragon encodes them. rdpq_triangle is 3 TRIANGLE_DATA
+  of 7 words and a 1 word TRIANGLE, like the fan writes in rdpq_fan.h, the RDP
+  triangle is 32 bytes of edges plus 64 for shade and 64 for texture.
+  Mode fixups are 2 or 4 words, the RSP answers them with SET_COMBINE and
+  SET_OTHER_MODES. Clear, clear_z and tex_load are the sums of the commands
+  libdragon issues for them: push, fill mode and color, (z image,) rectangle,
+  (color image,) pop, and texture image, 2 tiles, load and tile size.
+*/
+const CapCmdInfo capCmdInfo[CAP_CMD_COUNT] = {
+  [CAP_CMD_TRI]               = { "tri",               88,  32 },
+  [CAP_CMD_TRI_SHADE]         = { "tri_shade",         88,  96 },
+  [CAP_CMD_TRI_TEX]           = { "tri_tex",           88,  96 },
+  [CAP_CMD_TRI_SHADE_TEX]     = { "tri_shade_tex",     88, 160 },
+  [CAP_CMD_FAN_VTX]           = { "fan_vtx",           28,   0 },
+  [CAP_CMD_FAN_TRI]           = { "fan_tri",            4,  32 },
+  [CAP_CMD_FAN_TRI_SHADE]     = { "fan_tri_shade",      4,  96 },
+  [CAP_CMD_FAN_TRI_TEX]       = { "fan_tri_tex",        4,  96 },
+  [CAP_CMD_FAN_TRI_SHADE_TEX] = { "fan_tri_shade_tex",  4, 160 },
+  [CAP_CMD_SYNC_PIPE]         = { "sync_pipe",          8,   8 },
+  [CAP_CMD_SYNC_TILE]         = { "sync_tile",          8,   8 },
+  [CAP_CMD_SYNC_LOAD]         = { "sync_load",          8,   8 },
+  [CAP_CMD_PRIM_COLOR]        = { "prim_color",         8,   8 },
+  [CAP_CMD_MODE_STANDARD]     = { "mode_standard",     16,  16 },
+  [CAP_CMD_COMBINER]          = { "combiner",          16,  16 },
+  [CAP_CMD_BLENDER]           = { "blender",            8,  16 },
+  [CAP_CMD_MODE_FILL]         = { "mode_fill",         24,  24 },
+  [CAP_CMD_MODE_PUSH]         = { "mode_push",          8,   0 },
+  [CAP_CMD_MODE_POP]          = { "mode_pop",           8,  16 },
+  [CAP_CMD_CLEAR]             = { "clear",             48,  48 },
+  [CAP_CMD_CLEAR_Z]           = { "clear_z",           64,  64 },
+  [CAP_CMD_RECT]              = { "rect",               8,   8 },
+  [CAP_CMD_TEX_LOAD]          = { "tex_load",          40,  40 },
+};
+
+const char* capTagNames[CAP_TAG_COUNT] = {
+  [CAP_TAG_STATE]        = "state",
+  [CAP_TAG_CIRCLE]       = "draw_circle",
+  [CAP_TAG_LINE]         = "draw_line",
+  [CAP_TAG_QUAD]         = "draw_quad",
+  [CAP_TAG_FAN]          = "draw_fan",
+  [CAP_TAG_STRIP]        = "draw_strip",
+  [CAP_TAG_INDEXED]      = "draw_indexed_triangles",
+  [CAP_TAG_BEZIER]       = "draw_bezier_curve",
+  [CAP_TAG_FILL_BEZIERS] = "draw_filled_beziers",
+  [CAP_TAG_BEZIER_SHAPE] = "draw_filled_bezier_shape",
+  [CAP_TAG_ELLIPSE_EDGE] = "fill_edge_ellipse_to_line",
+  [CAP_TAG_SNAKE]        = "draw_snake_shape",
+};
+
+THREAD_LOCAL CapFrame capFrame;
+THREAD_LOCAL int capTag;
+
+static CapFrame capLast;
+static uint64_t capPrevTotal, capPrevBusy;
+static uint64_t capPrevSlots[RDPCAP_MAX_SLOTS];
+static const char* const* capSlotNames;
+static int capSlotCount;
+static bool capSlotNamesWritten;
+
+// Log output, records are buffered and written in one go
+static FILE* capFile;
+static uint8_t capBuffer[8192];
+static size_t capUsed;
+
+// Big endian writers, so logs from the console and the host read the same
+static void cap_put_u8(uint8_t v) {
+  capBuffer[capUsed++] = v;
+}
+
+static void cap_put_u16(uint16_t v) {
+  cap_put_u8(v >> 8);
+  cap_put_u8(v & 0xFF);
+}
+
+static void cap_put_u32(uint32_t v) {
+  cap_put_u16(v >> 16);
+  cap_put_u16(v & 0xFFFF);
+}
+
+static void cap_put_str(const char* s) {
+  size_t len = strlen(s);
+  if (len > 255) {
+    len = 255;
+  }
+  cap_put_u8(len);
+  memcpy(&capBuffer[capUsed], s, len);
+  capUsed += len;
+}
+
+static void cap_flush() {
+  if (capFile && capUsed > 0) {
+    fwrite(capBuffer, 1, capUsed, capFile);
+  }
+  capUsed = 0;
+}
+
+void rdpcap_init() {
+  memset(&capFrame, 0, sizeof(CapFrame));
+  memset(&capLast, 0, sizeof(CapFrame));
+  memset(capPrevSlots, 0, sizeof(capPrevSlots));
+  capPrevTotal = 0;
+  capPrevBusy = 0;
+  capSlotNames = NULL;
+  capSlotCount = 0;
+  capSlotNamesWritten = false;
+  capTag = CAP_TAG_STATE;
+  capUsed = 0;
+}
+
+// Function to start a capture log and write the command/tag tables so the analyzer needs no hardcoded sizes
+bool rdpcap_open(const char* path) {
+  capFile = fopen(path, "wb");
+  if (!capFile) {
+    debugf("Failed to open capture log %s\n", path);
+    return false;
+  }
+
+  capUsed = 0;
+  cap_put_u8('R');
+  cap_put_u8('C');
+  cap_put_u8('A');
+  cap_put_u8('P');
+  cap_put_u16(RDPCAP_VERSION);
+  cap_put_u8(CAP_CMD_COUNT);
+  cap_put_u8(CAP_TAG_COUNT);
+
+  for (int i = 0; i < CAP_CMD_COUNT; ++i) {
+    cap_put_str(capCmdInfo[i].name);
+    cap_put_u16(capCmdInfo[i].rspqBytes);
+    cap_put_u16(capCmdInfo[i].rdpBytes);
+  }
+  for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+    cap_put_str(capTagNames[i]);
+  }
+
+  capSlotNamesWritten = false;
+  cap_flush();
+  return true;
+}
+
+void rdpcap_close() {
+  if (capFile) {
+    cap_flush();
+    fclose(capFile);
+    capFile = NULL;
+  }
+}
+
+/*
+  Function to take the RSPQ profiler counters for this frame. libdragon keeps
+  running totals that are reset every second, so the difference to the last
+  call is stored and a reset is detected by the totals going down.
+*/
+void rdpcap_set_rcp(uint64_t totalTicks, uint64_t rdpBusyTicks, const uint64_t* slotTicks, const char* const* slotNames, int slotCount) {
+  if (slotCount > RDPCAP_MAX_SLOTS) {
+    slotCount = RDPCAP_MAX_SLOTS;
+  }
+
+  bool reset = totalTicks < capPrevTotal;
+  capFrame.rcpTicks = reset ? totalTicks : totalTicks - capPrevTotal;
+  capFrame.rdpBusy = (reset || rdpBusyTicks < capPrevBusy) ? rdpBusyTicks : rdpBusyTicks - capPrevBusy;
+
+  for (int i = 0; i < slotCount; ++i) {
+    uint64_t prev = reset || slotTicks[i] < capPrevSlots[i] ? 0 : capPrevSlots[i];
+    capFrame.slotTicks[i] = slotTicks[i] - prev;
+    capPrevSlots[i] = slotTicks[i];
+  }
+
+  capPrevTotal = totalTicks;
+  capPrevBusy = rdpBusyTicks;
+
+  if (slotNames != capSlotNames || slotCount != capSlotCount) {
+    capSlotNames = slotNames;
+    capSlotCount = slotCount;
+    capSlotNamesWritten = false;
+  }
+}
+
+// Function to take the CPU time of this frame, set by the main loop from the profiler
+void rdpcap_set_cpu(uint32_t ticks) {
+  capFrame.cpuTicks = ticks;
+}
+
+// Function to write the frame record and start counting the next frame
+void rdpcap_frame_end() {
+  capLast = capFrame;
+
+#if RDPCAP
+  if (capFile) {
+    // Slot names, written again only when they change
+    if (!capSlotNamesWritten && capSlotNames) {
+      cap_put_u8('S');
+      cap_put_u8(capSlotCount);
+      for (int i = 0; i < capSlotCount; ++i) {
+        cap_put_str(capSlotNames[i] ? capSlotNames[i] : "");
+      }
+      capSlotNamesWritten = true;
+    }
+
+    cap_put_u8('F');
+    cap_put_u32(capFrame.frame);
+    cap_put_u32(capFrame.rcpTicks);
+    cap_put_u32(capFrame.rdpBusy);
+    cap_put_u32(capFrame.cpuTicks);
+    for (int i = 0; i < CAP_CMD_COUNT; ++i) {
+      cap_put_u16(capFrame.cmds[i] > 0xFFFF ? 0xFFFF : capFrame.cmds[i]);
+    }
+    for (int i = 0; i < CAP_TAG_COUNT; ++i) {
+      cap_put_u32(capFrame.tagBytes[i]);
+      cap_put_u16(capFrame.tagTris[i] > 0xFFFF ? 0xFFFF : capFrame.tagTris[i]);
+    }
+
+    // Only the slots that ran this frame
+    int used = 0;
+    for (int i = 0; i < capSlotCount; ++i) {
+      if (capFrame.slotTicks[i]) used++;
+    }
+    cap_put_u8(used);
+    for (int i = 0; i < capSlotCount; ++i) {
+      if (capFrame.slotTicks[i]) {
+        cap_put_u8(i);
+        cap_put_u32(capFrame.slotTicks[i]);
+      }
+    }
+
+    // The main loop never returns, so write out regularly instead of at close
+    if (capUsed > sizeof(capBuffer) / 2 || (capFrame.frame & 63) == 63) {
+      cap_flush();
+    }
+  }
+#endif // RDPCAP
+
+  uint32_t next = capFrame.frame + 1;
+  memset(&capFrame, 0, sizeof(CapFrame));
+  capFrame.frame = next;
+  capTag = CAP_TAG_STATE;
+}
+
+const CapFrame* rdpcap_last_frame() {
+  return &capLast;
+}
+
+// Function to get the total command bytes of a frame, either RSPQ or RDP side
+uint32_t rdpcap_frame_bytes(const CapFrame* f, bool rdp) {
+  uint32_t total = 0;
+  for (int i = 0; i < CAP_CMD_COUNT; ++i) {
+    total += f->cmds[i] * (rdp ? capCmdInfo[i].rdpBytes : capCmdInfo[i].rspqBytes);
+  }
+  return total;
+}
+
+// Function to get the triangles of a frame, fan triangles included
+uint32_t rdpcap_frame_tris(const CapFrame* f) {
+  uint32_t tris = 0;
+  for (int i = 0; i < CAP_CMD_COUNT; ++i) {
+    if (rdpcap_is_tri(i)) {
+      tris += f->cmds[i];
+    }
+  }
+  return tris;
+}
+
+// Function to get the vertices sent to the RSP, 3 per triangle and 1 per fan vertex
+uint32_t rdpcap_frame_verts(const CapFrame* f) {
+  uint32_t tris = 0;
+  for (int i = CAP_CMD_TRI; i <= CAP_CMD_TRI_SHADE_TEX; ++i) {
+    tris += f->cmds[i];
+  }
+  return tris * 3 + f->cmds[CAP_CMD_FAN_VTX];
+}
@@ -0,0 +1,183 @@
+#ifndef RDPCAP_H
+#define RDPCAP_H
+
+#include <libdragon.h>
+#include "thread.h"
+
+// Define whether to write the capture log, counting is always enabled
+#ifndef RDPCAP
+#define RDPCAP 0
+#endif
+
+// Default log location, the host build passes its own
+#ifndef RDPCAP_PATH
+#define RDPCAP_PATH "sd:/rdpcap.bin"
+#endif
+
+#define RDPCAP_VERSION 2
+#define RDPCAP_MAX_SLOTS 32
+
+/*
+  Commands counted by the rdpcap_ wrappers below, one kind per command
+  libdragon encodes, so each has one RSPQ and one RDP size, see capCmdInfo in
+  rdpcap.c. Everything this repo sends goes through them except the attach,
+  show and debug text.
+*/
+typedef enum {
+  CAP_CMD_TRI,
+  CAP_CMD_TRI_SHADE,
+  CAP_CMD_TRI_TEX,
+  CAP_CMD_TRI_SHADE_TEX,
+  CAP_CMD_FAN_VTX,
+  CAP_CMD_FAN_TRI,
+  CAP_CMD_FAN_TRI_SHADE,
+  CAP_CMD_FAN_TRI_TEX,
+  CAP_CMD_FAN_TRI_SHADE_TEX,
+  CAP_CMD_SYNC_PIPE,
+  CAP_CMD_SYNC_TILE,
+  CAP_CMD_SYNC_LOAD,
+  CAP_CMD_PRIM_COLOR,
+  CAP_CMD_MODE_STANDARD,
+  CAP_CMD_COMBINER,
+  CAP_CMD_BLENDER,
+  CAP_CMD_MODE_FILL,
+  CAP_CMD_MODE_PUSH,
+  CAP_CMD_MODE_POP,
+  CAP_CMD_CLEAR,
+  CAP_CMD_CLEAR_Z,
+  CAP_CMD_RECT,
+  CAP_CMD_TEX_LOAD,
+  CAP_CMD_COUNT
+} CAP_CMDS;
+
+// Draw calls that commands are attributed to, the outermost tag wins
+typedef enum {
+  CAP_TAG_STATE,
+  CAP_TAG_CIRCLE,
+  CAP_TAG_LINE,
+  CAP_TAG_QUAD,
+  CAP_TAG_FAN,
+  CAP_TAG_STRIP,
+  CAP_TAG_INDEXED,
+  CAP_TAG_BEZIER,
+  CAP_TAG_FILL_BEZIERS,
+  CAP_TAG_BEZIER_SHAPE,
+  CAP_TAG_ELLIPSE_EDGE,
+  CAP_TAG_SNAKE,
+  CAP_TAG_COUNT
+} CAP_TAGS;
+
+typedef struct {
+  const char* name;
+  uint16_t rspqBytes;
+  uint16_t rdpBytes;
+} CapCmdInfo;
+
+typedef struct {
+  uint32_t frame;
+  uint32_t cmds[CAP_CMD_COUNT];
+  uint32_t tagBytes[CAP_TAG_COUNT]; // RSPQ bytes per draw call
+  uint32_t tagTris[CAP_TAG_COUNT];
+  uint32_t rcpTicks; // RCP ticks of the frame, 0 without RSPQ_PROFILE
+  uint32_t rdpBusy;
+  uint32_t cpuTicks; // CPU ticks of the frame without the wait for the display
+  uint32_t slotTicks[RDPCAP_MAX_SLOTS];
+} CapFrame;
+
+extern const CapCmdInfo capCmdInfo[CAP_CMD_COUNT];
+extern const char* capTagNames[CAP_TAG_COUNT];
+extern THREAD_LOCAL CapFrame capFrame;
+extern THREAD_LOCAL int capTag;
+
+void rdpcap_init();
+bool rdpcap_open(const char* path);
+void rdpcap_close();
+void rdpcap_set_rcp(uint64_t totalTicks, uint64_t rdpBusyTicks, const uint64_t* slotTicks, const char* const* slotNames, int slotCount);
+void rdpcap_set_cpu(uint32_t ticks);
+void rdpcap_frame_end();
+const CapFrame* rdpcap_last_frame();
+uint32_t rdpcap_frame_bytes(const CapFrame* f, bool rdp);
+uint32_t rdpcap_frame_tris(const CapFrame* f);
+uint32_t rdpcap_frame_verts(const CapFrame* f);
+
+// Function to check whether a command draws a triangle
+static inline bool rdpcap_is_tri(int cmd) {
+  return (cmd >= CAP_CMD_TRI && cmd <= CAP_CMD_TRI_SHADE_TEX) || (cmd >= CAP_CMD_FAN_TRI && cmd <= CAP_CMD_FAN_TRI_SHADE_TEX);
+}
+
+// Function to count one command for the current draw call, use the wrappers below instead of calling it next to rdpq
+static inline void rdpcap_cmd(int cmd) {
+  capFrame.cmds[cmd]++;
+  capFrame.tagBytes[capTag] += capCmdInfo[cmd].rspqBytes;
+  if (rdpcap_is_tri(cmd)) {
+    capFrame.tagTris[capTag]++;
+  }
+}
+
+// Function to get the triangle command type of a triangle format
+static inline int rdpcap_tri_cmd(const rdpq_trifmt_t* fmt) {
+  if (fmt->tex_offset >= 0) return fmt->shade_offset >= 0 ? CAP_CMD_TRI_SHADE_TEX : CAP_CMD_TRI_TEX;
+  if (fmt->shade_offset >= 0) return CAP_CMD_TRI_SHADE;
+  return CAP_CMD_TRI;
+}
+
+// Function to get the fan triangle command type of an RDPQ triangle command id
+static inline int rdpcap_fan_tri_cmd(uint32_t cmd_id) {
+  if (cmd_id & 0x2) return cmd_id & 0x4 ? CAP_CMD_FAN_TRI_SHADE_TEX : CAP_CMD_FAN_TRI_TEX;
+  if (cmd_id & 0x4) return CAP_CMD_FAN_TRI_SHADE;
+  return CAP_CMD_FAN_TRI;
+}
+
+/*
+  rdpq calls that count themselves, the call and its count cannot drift apart
+  or be counted twice. Call these instead of the rdpq functions of the same name.
+*/
+static inline void rdpcap_sync_pipe() { rdpq_sync_pipe(); rdpcap_cmd(CAP_CMD_SYNC_PIPE); }
+static inline void rdpcap_sync_tile() { rdpq_sync_tile(); rdpcap_cmd(CAP_CMD_SYNC_TILE); }
+static inline void rdpcap_sync_load() { rdpq_sync_load(); rdpcap_cmd(CAP_CMD_SYNC_LOAD); }
+static inline void rdpcap_set_prim_color(color_t color) { rdpq_set_prim_color(color); rdpcap_cmd(CAP_CMD_PRIM_COLOR); }
+static inline void rdpcap_set_mode_standard() { rdpq_set_mode_standard(); rdpcap_cmd(CAP_CMD_MODE_STANDARD); }
+static inline void rdpcap_mode_combiner(rdpq_combiner_t comb) { rdpq_mode_combiner(comb); rdpcap_cmd(CAP_CMD_COMBINER); }
+static inline void rdpcap_mode_blender(rdpq_blender_t blend) { rdpq_mode_blender(blend); rdpcap_cmd(CAP_CMD_BLENDER); }
+static inline void rdpcap_set_mode_fill(color_t color) { rdpq_set_mode_fill(color); rdpcap_cmd(CAP_CMD_MODE_FILL); }
+static inline void rdpcap_mode_push() { rdpq_mode_push(); rdpcap_cmd(CAP_CMD_MODE_PUSH); }
+static inline void rdpcap_mode_pop() { rdpq_mode_pop(); rdpcap_cmd(CAP_CMD_MODE_POP); }
+static inline void rdpcap_clear(color_t color) { rdpq_clear(color); rdpcap_cmd(CAP_CMD_CLEAR); }
+static inline void rdpcap_clear_z(uint16_t z) { rdpq_clear_z(z); rdpcap_cmd(CAP_CMD_CLEAR_Z); }
+static inline void rdpcap_fill_rectangle(float x0, float y0, float x1, float y1) { rdpq_fill_rectangle(x0, y0, x1, y1); rdpcap_cmd(CAP_CMD_RECT); }
+
+static inline void rdpcap_triangle(const rdpq_trifmt_t* fmt, const float* v1, const float* v2, const float* v3) {
+  rdpq_triangle(fmt, v1, v2, v3);
+  rdpcap_cmd(rdpcap_tri_cmd(fmt));
+}
+
+static inline int rdpcap_sprite_upload(rdpq_tile_t tile, sprite_t* sprite, const rdpq_texparms_t* parms) {
+  int tmem = rdpq_sprite_upload(tile, sprite, parms);
+  rdpcap_cmd(CAP_CMD_TEX_LOAD);
+  return tmem;
+}
+
+// rspq_write of this repo's own commands, counted where the words are written
+#define rdpcap_rspq_write(cmd, ovl_id, cmd_id, ...) do { \
+  rspq_write(ovl_id, cmd_id, __VA_ARGS__); \
+  rdpcap_cmd(cmd); \
+} while (0)
+
+// Function to attribute commands to a draw call, nested draw calls keep the outer tag
+static inline int rdpcap_tag_begin(int tag) {
+  int prev = capTag;
+  if (prev == CAP_TAG_STATE) {
+    capTag = tag;
+  }
+  return prev;
+}
+
+static inline void rdpcap_tag_end(int* prev) {
+  capTag = *prev;
+}
+
+// Tags the rest of the enclosing block
+#define RDPCAP_TAG(tag) \
+  int __attribute__((cleanup(rdpcap_tag_end), unused)) _cap_tag = rdpcap_tag_begin(tag)
+
+#endif // RDPCAP_H
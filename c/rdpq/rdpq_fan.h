@@ -2,6 +2,10 @@
 #define RDPQ_FAN_H
 
 #include <libdragon.h>
+#include "../rdpcap.h"
+#include "../memtrack.h"
+#include "../thread.h"
+#include "../render.h" // RENDER_VTX_FLOATS
 
 // ====~ Required functions from RDPQ - start ~==== //
 
@@ -47,25 +51,22 @@ typedef enum {
 } TRI_DATA_SLOT;
 
 typedef struct rdpq_fan_s {
-    float cv[8]; // Center vertex
-    float v1[8]; // First vertex of the fan after the center
-    float pv[8]; // Holds the previous vertex
+    float cv[RENDER_VTX_FLOATS]; // Center vertex
+    float v1[RENDER_VTX_FLOATS]; // First vertex of the fan after the center
+    float pv[RENDER_VTX_FLOATS]; // Holds the previous vertex
     const rdpq_trifmt_t* fmt; // Triangle format
     uint32_t cmd_id; // RPDQ command ID
     bool v1Added; // Check to see any vertices have been added after rdpq_fan_begin
     int vtxCount; // Counts number of vertices
 } rdpq_fan_t;
 
-rdpq_fan_t* state; // TODO: This will eventually be a argument in the higher level functions to allow for multiple fans
+THREAD_LOCAL rdpq_fan_t* state; // TODO: This will eventually be a argument in the higher level functions to allow for multiple fans
 
 // Re-implementation of internal auto sync
+// Tile and load syncs belong before a texture upload, see set_render_texture, not before every vertex
 void rdpq_tri_auto_sync(const rdpq_trifmt_t *fmt){
 
-    rdpq_sync_pipe();
-    if (fmt->tex_offset >= 0) {
-        rdpq_sync_tile();
-        rdpq_sync_load();
-    }
+    rdpcap_sync_pipe();
 
 }
 
@@ -107,7 +108,7 @@ void rdpq_fan_add_new(const rdpq_trifmt_t *fmt, const float* vtx) {
     }
 
     // Write vertex and send tri async using overlay cmd
-    rspq_write(fan_add_id, RDPQ_CMD_FAN_ADD,
+    rdpcap_rspq_write(CAP_CMD_FAN_VTX, fan_add_id, RDPQ_CMD_FAN_ADD,
         TRI_DATA_NEXT, 
         (x << 16) | (y & 0xFFFF), 
         (z << 16), 
@@ -118,8 +119,8 @@ void rdpq_fan_add_new(const rdpq_trifmt_t *fmt, const float* vtx) {
 
 }
 
-// This is the higher level call to add to TRI_DATA
-void rdpq_add_tri_data(const float* vtx, int triDataSlot) {
+// Same as rdpq_add_tri_data with the position already in s13.2 (PointQ), only the other attributes are read from vtx
+void rdpq_add_tri_data_xy(int16_t x, int16_t y, const float* vtx, int triDataSlot) {
 
     if (!vtx) {
         debugf("rdpq_add_tri_data: Invalid arguments\n");
@@ -135,10 +136,6 @@ void rdpq_add_tri_data(const float* vtx, int triDataSlot) {
     if (state->fmt->tex_offset >= 0)   state->cmd_id |= 0x2;
     if (state->fmt->z_offset >= 0)     state->cmd_id |= 0x1;
 
-
-    int16_t x = floorf(vtx[state->fmt->pos_offset + 0] * 4.0f);
-    int16_t y = floorf(vtx[state->fmt->pos_offset + 1] * 4.0f);
-
     int16_t z = 0;
     if (state->fmt->z_offset >= 0) {
         z = vtx[state->fmt->z_offset + 0] * 0x7FFF;
@@ -162,7 +159,7 @@ void rdpq_add_tri_data(const float* vtx, int triDataSlot) {
     }
 
     // Write vertex one at a time
-    rspq_write(RDPQ_OVL_ID, RDPQ_CMD_TRIANGLE_DATA,
+    rdpcap_rspq_write(CAP_CMD_FAN_VTX, RDPQ_OVL_ID, RDPQ_CMD_TRIANGLE_DATA,
         TRI_DATA_LEN * triDataSlot, 
         (x << 16) | (y & 0xFFFF), 
         (z << 16), 
@@ -173,8 +170,23 @@ void rdpq_add_tri_data(const float* vtx, int triDataSlot) {
 
 }
 
+// This is the higher level call to add to TRI_DATA
+void rdpq_add_tri_data(const float* vtx, int triDataSlot) {
+
+    if (!vtx) {
+        debugf("rdpq_add_tri_data: Invalid arguments\n");
+        return;
+    }
+
+    int16_t x = floorf(vtx[state->fmt->pos_offset + 0] * 4.0f);
+    int16_t y = floorf(vtx[state->fmt->pos_offset + 1] * 4.0f);
+    rdpq_add_tri_data_xy(x, y, vtx, triDataSlot);
+
+}
+
 rdpq_fan_t* rdpq_fan_init() {
-    state = (rdpq_fan_t*)malloc_uncached(sizeof(rdpq_fan_t));
+    MEM_TAG(MEM_TAG_FAN);
+    state = (rdpq_fan_t*)mem_malloc_uncached(sizeof(rdpq_fan_t));
     memset(state, 0, sizeof(rdpq_fan_t)); // Initialize all values to 0
     return state;
 }
@@ -193,7 +205,7 @@ void rdpq_fan_begin(const rdpq_trifmt_t *fmt, const float *cv) {
         return;
     }
 
-    memcpy(state->cv, cv, sizeof(float) * 8);
+    memcpy(state->cv, cv, sizeof(float) * RENDER_VTX_FLOATS);
 
     state->fmt = fmt;
     state->cmd_id = RDPQ_CMD_TRI;
@@ -203,6 +215,18 @@ void rdpq_fan_begin(const rdpq_trifmt_t *fmt, const float *cv) {
 
 }
 
+// Function to draw the three vertices in the TRI_DATA slots
+void rdpq_fan_draw_triangle() {
+
+    rdpq_tri_auto_sync(state->fmt);
+
+    rdpcap_rspq_write(rdpcap_fan_tri_cmd(state->cmd_id), RDPQ_OVL_ID, RDPQ_CMD_TRIANGLE, 
+            0xC000 | (state->cmd_id << 8) | 
+            (state->fmt->tex_mipmaps ? (state->fmt->tex_mipmaps-1) << 3 : 0) | 
+            (state->fmt->tex_tile & 7));
+
+}
+
 // This is the higher level CPU implementation of the RSP code
 void rdpq_fan_add_new_triangle_cpu(const float* pv, const float* v) {
     // Move last position and store current vertex
@@ -210,7 +234,7 @@ void rdpq_fan_add_new_triangle_cpu(const float* pv, const float* v) {
     rdpq_add_tri_data(pv, TRI_DATA_LAST);
 
     // Store current vertex and increment counter
-    memcpy(state->pv, v, sizeof(float) * 8);
+    memcpy(state->pv, v, sizeof(float) * RENDER_VTX_FLOATS);
     state->vtxCount++;
 }
 
@@ -219,7 +243,7 @@ void rdpq_fan_add_vertex(const float* v) {
 
     if (state->vtxCount == 0) {
         // Store the first vertex
-        memcpy(state->v1, v, sizeof(float) * 8);
+        memcpy(state->v1, v, sizeof(float) * RENDER_VTX_FLOATS);
         state->v1Added = true;
         state->vtxCount++;
         rdpq_add_tri_data(state->v1, TRI_DATA_LAST);
@@ -231,7 +255,7 @@ void rdpq_fan_add_vertex(const float* v) {
 
 
             // Store first vertex as previous point
-            memcpy(state->pv, state->v1, sizeof(float) * 8);
+            memcpy(state->pv, state->v1, sizeof(float) * RENDER_VTX_FLOATS);
             state->vtxCount++;
         }
 
@@ -239,12 +263,7 @@ void rdpq_fan_add_vertex(const float* v) {
         // Move last position and store current vertex
         rdpq_fan_add_new_triangle_cpu(state->pv, v);
 
-        rdpq_tri_auto_sync(state->fmt);
-
-        rspq_write(RDPQ_OVL_ID, RDPQ_CMD_TRIANGLE, 
-                0xC000 | (state->cmd_id << 8) | 
-                (state->fmt->tex_mipmaps ? (state->fmt->tex_mipmaps-1) << 3 : 0) | 
-                (state->fmt->tex_tile & 7));
+        rdpq_fan_draw_triangle();
 
 
     }
@@ -257,9 +276,64 @@ void rdpq_fan_end() {
 
     rdpq_fan_add_vertex(state->v1);
 
-    free_uncached(state);
+    mem_free(state);
     state = NULL;
 }
 
+// ================~ Strip API ~================== //
+
+/*
+  Strips use the same TRI_DATA slots as fans. Vertices rotate through the
+  three slots, so every TRIANGLE after the second vertex draws the last
+  three: one vertex write and one triangle per vertex, like a fan, but
+  without a shared center. The RDP does not cull, winding is not kept.
+*/
+void rdpq_strip_begin(const rdpq_trifmt_t *fmt) {
+
+    if (!fmt) {
+        debugf("rdpq_strip_begin: Invalid arguments\n");
+        return;
+    }
+
+    state = rdpq_fan_init();
+    if (!state) {
+        debugf("rdpq_strip_begin: Memory allocation failed\n");
+        return;
+    }
+
+    state->fmt = fmt;
+    state->cmd_id = RDPQ_CMD_TRI;
+
+}
+
+// Function to add the next vertex of the strip, drawing a triangle from the third one on
+void rdpq_strip_add_vertex(const float* v) {
+
+    rdpq_add_tri_data(v, state->vtxCount % 3);
+    state->vtxCount++;
+
+    if (state->vtxCount >= 3) {
+        rdpq_fan_draw_triangle();
+    }
+
+}
+
+// Function to add the next vertex of the strip with its position already in s13.2
+void rdpq_strip_add_vertex_xy(int16_t x, int16_t y, const float* v) {
+
+    rdpq_add_tri_data_xy(x, y, v, state->vtxCount % 3);
+    state->vtxCount++;
+
+    if (state->vtxCount >= 3) {
+        rdpq_fan_draw_triangle();
+    }
+
+}
+
+void rdpq_strip_end() {
+
+    mem_free(state);
+    state = NULL;
+}
 
 #endif // RDPQ_FAN_H
\ No newline at end of file
@@ -3,10 +3,221 @@
 #include "point.h"
 #include "shapes.h"
 #include "render.h"
+#include "profiler.h"
+#include "rdpcap.h"
+#include "memtrack.h"
+#include "lod.h"
+#include "budget.h"
+#include "fillrate.h"
+#include "gradient.h"
+#include "texmap.h"
+#include "arena.h"
+#include "thread.h"
+#include "fixed.h"
+
+// Last color set, rectangles in fill mode need to know if it is opaque
+// The attributes are per thread, host jobs start from those of the thread that queued them
+static THREAD_LOCAL color_t renderColor;
+RenderConvexMode renderConvexMode = RENDER_CONVEX_STRIP;
+
+// Gradient the vertices are shaded with while renderGradientSet, otherwise shading is the flat color
+static THREAD_LOCAL Gradient renderGradient;
+static THREAD_LOCAL bool renderGradientSet;
+static THREAD_LOCAL bool renderShade;
+
+// Shapes get an alpha ramped fringe along their outline, needs the shade combiner and alpha blending
+static THREAD_LOCAL bool renderFringe;
+
+// Texture map of the current batch while renderTex is set, bounds of the draw call for TEXMAP_BOUNDS
+static THREAD_LOCAL TexMap renderTexMap;
+static THREAD_LOCAL bool renderTex;
+static THREAD_LOCAL float renderBounds[4];
 
 void set_render_color(color_t color){
-  rdpq_sync_pipe();
-  rdpq_set_prim_color(color);
+  PROF_SCOPE(ZONE_SUBMIT);
+  renderColor = color;
+  rdpcap_sync_pipe();
+  rdpcap_set_prim_color(color);
+}
+
+// Function to pick the combiner for the vertex attributes, only a change costs a mode command
+static void render_set_attributes(bool shade, bool tex) {
+  if (shade == renderShade && tex == renderTex) {
+    return;
+  }
+  rdpq_combiner_t comb = tex
+    ? (shade ? RDPQ_COMBINER_TEX_SHADE : RDPQ_COMBINER_TEX)
+    : (shade ? RDPQ_COMBINER_SHADE : RDPQ_COMBINER_FLAT);
+  rdpcap_mode_combiner(comb);
+  renderShade = shade;
+  renderTex = tex;
+}
+
+/*
+  Function to shade the vertices of everything drawn from now on with a gradient, see gradient.h.
+  The combiner only changes when shading is switched on or off, a new gradient costs nothing.
+  NULL goes back to the prim color, set it before the frame's mode is reset.
+*/
+void set_render_gradient(const Gradient* gradient) {
+  PROF_SCOPE(ZONE_SUBMIT);
+  if (gradient) {
+    renderGradient = *gradient;
+  }
+  renderGradientSet = gradient != NULL;
+  render_set_attributes(renderGradientSet || renderFringe, renderTex);
+}
+
+/*
+  Function to give the outlines of the shapes drawn from now on a RENDER_FRINGE_WIDTH
+  wide fringe that fades from their color to nothing, see draw_fringe. The vertices
+  are shaded for as long as it is on, so a fringe costs no combiner change per shape.
+  Needs alpha blending, switch it off before the frame's mode is reset.
+*/
+void set_render_fringe(bool fringe) {
+  PROF_SCOPE(ZONE_SUBMIT);
+  renderFringe = fringe;
+  render_set_attributes(renderGradientSet || renderFringe, renderTex);
+}
+
+/*
+  Function to texture everything drawn from now on, see texmap.h. Starting a batch uploads the
+  sprite, later maps only upload when the sprite changes, so many shapes share one load.
+  Text loads its glyphs into TMEM, end the batch with NULL before drawing any.
+*/
+void set_render_texture(const TexMap* map) {
+  PROF_SCOPE(ZONE_SUBMIT);
+  if (map && (!renderTex || map->sprite != renderTexMap.sprite)) {
+    rdpcap_sync_tile();
+    rdpcap_sync_load();
+    rdpq_texparms_t parms = { .s.repeats = REPEAT_INFINITE, .t.repeats = REPEAT_INFINITE };
+    rdpcap_sprite_upload(TILE0, map->sprite, &parms);
+  }
+  if (map) {
+    renderTexMap = *map;
+  }
+  render_set_attributes(renderShade, map != NULL);
+}
+
+// Function to get the attributes set through the set_render_* calls
+void render_get_state(RenderState* state) {
+  state->color = renderColor;
+  state->gradient = renderGradient;
+  state->gradientSet = renderGradientSet;
+  state->shade = renderShade;
+  state->fringe = renderFringe;
+  state->texMap = renderTexMap;
+  state->tex = renderTex;
+}
+
+// Function to take over attributes the RDP already has, like those of another thread, without any command
+void render_set_state(const RenderState* state) {
+  renderColor = state->color;
+  renderGradient = state->gradient;
+  renderGradientSet = state->gradientSet;
+  renderShade = state->shade;
+  renderFringe = state->fringe;
+  renderTexMap = state->texMap;
+  renderTex = state->tex;
+}
+
+// Function to go back to earlier attributes, submitting only the commands for what changed since
+void render_restore_state(const RenderState* state) {
+  if (color_to_packed32(state->color) != color_to_packed32(renderColor)) {
+    set_render_color(state->color);
+  }
+  if (state->tex) {
+    set_render_texture(&state->texMap);
+  }
+  renderGradient = state->gradient;
+  renderGradientSet = state->gradientSet;
+  renderFringe = state->fringe;
+  render_set_attributes(state->shade, state->tex);
+  renderTexMap = state->texMap;
+}
+
+// Function to get the triangle format the tessellators submit with
+static const rdpq_trifmt_t* render_trifmt() {
+  if (renderTex) {
+    return renderShade ? &TRIFMT_SHADE_TEX : &TRIFMT_TEX;
+  }
+  return renderShade ? &TRIFMT_SHADE : &TRIFMT_FILL;
+}
+
+// Function to set the bounds TEXMAP_BOUNDS stretches the sprite over from count x, y pairs, extend keeps the previous ones
+static void render_bounds(const float* xy, size_t count, bool extend) {
+  if (!renderTex || renderTexMap.mode != TEXMAP_BOUNDS) {
+    return;
+  }
+  if (!extend) {
+    renderBounds[0] = renderBounds[1] = INFINITY;
+    renderBounds[2] = renderBounds[3] = -INFINITY;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    renderBounds[0] = fminf(renderBounds[0], xy[i * 2]);
+    renderBounds[1] = fminf(renderBounds[1], xy[i * 2 + 1]);
+    renderBounds[2] = fmaxf(renderBounds[2], xy[i * 2]);
+    renderBounds[3] = fmaxf(renderBounds[3], xy[i * 2 + 1]);
+  }
+}
+
+// Point has the layout of an x, y pair
+static void render_bounds_points(const PointArray* pa, bool extend) {
+  render_bounds((const float*)pa->points, pa->count, extend);
+}
+
+static void render_bounds_points_q(const PointArrayQ* pa) {
+  if (!renderTex || renderTexMap.mode != TEXMAP_BOUNDS) {
+    return;
+  }
+  for (size_t i = 0; i < pa->count; ++i) {
+    Point p = point_dequantize(pa->points[i]);
+    render_bounds(&p.x, 1, i > 0);
+  }
+}
+
+/*
+  Function to write a vertex in the render_trifmt layout, v has room for RENDER_VTX_FLOATS.
+  path is the distance along the strip or curve and 0 or 1 across it, NULL for other shapes.
+*/
+static void render_vertex_path(float* v, float x, float y, const float* path) {
+  v[0] = x;
+  v[1] = y;
+  if (renderShade && renderGradientSet) {
+    gradient_shade(&renderGradient, v);
+  } else if (renderShade) {
+    // Shaded for the fringe only: the flat color, or white so the texture is not tinted
+    float* shade = v + TRIFMT_SHADE.shade_offset;
+    shade[0] = renderTex ? 1.0f : renderColor.r / 255.0f;
+    shade[1] = renderTex ? 1.0f : renderColor.g / 255.0f;
+    shade[2] = renderTex ? 1.0f : renderColor.b / 255.0f;
+    shade[3] = renderTex ? 1.0f : renderColor.a / 255.0f;
+  }
+  if (renderTex) {
+    texmap_uv(&renderTexMap, renderBounds, path, x, y, v + (renderShade ? TRIFMT_SHADE_TEX.tex_offset : TRIFMT_TEX.tex_offset));
+  }
+}
+
+static void render_vertex(float* v, float x, float y) {
+  render_vertex_path(v, x, y, NULL);
+}
+
+// Function to submit one triangle with the path coordinates of its vertices, or NULL
+static void render_triangle_path(const float* a, const float* b, const float* c, const float* pa, const float* pb, const float* pc) {
+  if (!renderShade && !renderTex) {
+    rdpcap_triangle(&TRIFMT_FILL, a, b, c);
+    return;
+  }
+  float v1[RENDER_VTX_FLOATS], v2[RENDER_VTX_FLOATS], v3[RENDER_VTX_FLOATS];
+  render_vertex_path(v1, a[0], a[1], pa);
+  render_vertex_path(v2, b[0], b[1], pb);
+  render_vertex_path(v3, c[0], c[1], pc);
+  const rdpq_trifmt_t* fmt = render_trifmt();
+  rdpcap_triangle(fmt, v1, v2, v3);
+}
+
+// Function to submit one triangle, flat with the prim color or with the render gradient and texture
+static void render_triangle(const float* a, const float* b, const float* c) {
+  render_triangle_path(a, b, c, NULL, NULL, NULL);
 }
 
 color_t get_random_render_color() {
@@ -49,13 +260,28 @@ void render_rotate_point(PointArray* pa, size_t index, Point center, float angle
 }
 
 void render_rotate_shape_points(PointArray* pa, Point center, float angle) {
+#if POINT_FIXED
+  // One sine and cosine for the whole array instead of one per point_rotate
+  int32_t a = fixed_angle_from_float(angle);
+  fixed_t s = fixed_sin(a), c = fixed_cos(a);
+  for (int i = 0; i < pa->count; ++i) {
+    fixed_t x = fixed_from_float(pa->points[i].x - center.x);
+    fixed_t y = fixed_from_float(pa->points[i].y - center.y);
+    pa->points[i].x = fixed_to_float(fixed_mul(x, c) - fixed_mul(y, s)) + center.x;
+    pa->points[i].y = fixed_to_float(fixed_mul(x, s) + fixed_mul(y, c)) + center.y;
+  }
+#else
   for (int i = 0; i < pa->count; ++i) {
     point_rotate(&pa->points[i], &center, angle);
   }
+#endif
 }
 
 // Function to get points around an ellipse
 void render_get_ellipse_points(PointArray* previousPoints, Point center, float rx, float ry, int segments) {
+  PROF_SCOPE(ZONE_TESSELLATE);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+
   // Ensure previousPoints is properly initialized
   if (previousPoints == NULL) {
     debugf("point array is NULL\n");
@@ -78,11 +304,21 @@ void render_get_ellipse_points(PointArray* previousPoints, Point center, float r
   previousPoints->count = 0;
 
   // Compute points for the ellipse
+#if POINT_FIXED
+  fixed_t frx = fixed_from_float(rx), fry = fixed_from_float(ry);
+#else
   float angleStep = 2.0f * M_PI / (float)segments;
+#endif
   for (int i = 0; i < segments; ++i) {
+#if POINT_FIXED
+    int32_t angle = (int32_t)(((int64_t)i * FIXED_TURN) / segments);
+    float x = center.x + fixed_to_float(fixed_mul(frx, fixed_cos(angle)));
+    float y = center.y + fixed_to_float(fixed_mul(fry, fixed_sin(angle)));
+#else
     float angle = i * angleStep;
     float x = center.x + rx * fm_cosf(angle);
     float y = center.y + ry * fm_sinf(angle);
+#endif
     add_point(previousPoints, x, y);
 
     // Check if point addition failed
@@ -94,26 +330,25 @@ void render_get_ellipse_points(PointArray* previousPoints, Point center, float r
 }
 
 
-// Texture test
+// Function to draw one triangle, textured by the map of set_render_texture when there is one
 void draw_triangle(float* v1, float* v2, float* v3) {
+  PROF_SCOPE(ZONE_SUBMIT);
 
-  //const rdpq_trifmt_t trifmt = (rdpq_trifmt_t){
-  //  .pos_offset = 0,
-  //  .tex_offset = 3,
-  //  .tex_tile = TILE0,
-  //};
-
-  float A[] = {v1[0],v1[1],0,0,1};
-  float B[] = {v2[0],v2[1],0,0,1};
-  float C[] = {v3[0],v3[1],0,0,1};
-
-        
-  rdpq_triangle(&TRIFMT_TEX, A, B, C);
+  float xy[] = { v1[0], v1[1], v2[0], v2[1], v3[0], v3[1] };
+  render_bounds(xy, 3, false);
+  render_triangle(v1, v2, v3);
+  budget_tri(fillrate_tri(v1, v2, v3));
+  triCount++;
+  vertCount += 3;
 
 }
 
-// Function to draw RDPQ triangles using vertex arrays
-void draw_indexed_triangles(float* vertices, int vertex_count, int* indices, int index_count) {
+// Function to draw indexed triangles, path has the distance along and 0 or 1 across for every vertex, or is NULL
+static void render_indexed_triangles(const float* vertices, const float* path, int vertex_count, const int* indices, int index_count) {
+  RDPCAP_TAG(CAP_TAG_INDEXED);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  PROF_SCOPE(ZONE_SUBMIT);
+  render_bounds(vertices, vertex_count / 2, false);
 
   for (int i = 0; i < index_count; i += 3) {
     if (i + 2 >= index_count) {
@@ -136,35 +371,235 @@ void draw_indexed_triangles(float* vertices, int vertex_count, int* indices, int
     float v3[] = { vertices[idx3 * 2], vertices[idx3 * 2 + 1] };
 
     // Draw the triangle
-    rdpq_triangle(&TRIFMT_FILL, v1, v2, v3);
+    if (path) {
+      render_triangle_path(v1, v2, v3, &path[idx1 * 2], &path[idx2 * 2], &path[idx3 * 2]);
+    } else {
+      render_triangle(v1, v2, v3);
+    }
+    budget_tri(fillrate_tri(v1, v2, v3));
     triCount++;
     vertCount++;
   }
 }
 
+// Function to draw RDPQ triangles using vertex arrays
+void draw_indexed_triangles(float* vertices, int vertex_count, int* indices, int index_count) {
+  render_indexed_triangles(vertices, NULL, vertex_count, indices, index_count);
+}
+
 void draw_rdp_fan(const PointArray* pa, const Point center) {
+  RDPCAP_TAG(CAP_TAG_FAN);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  PROF_SCOPE(ZONE_SUBMIT);
 
-  float cv[] = { center.x, center.y };
-  float v1[] = { pa->points[0].x, pa->points[0].y };
+  float cv[RENDER_VTX_FLOATS], v1[RENDER_VTX_FLOATS];
+  render_bounds_points(pa, false);
+  render_bounds(&center.x, 1, true);
+  render_vertex(cv, center.x, center.y);
+  render_vertex(v1, pa->points[0].x, pa->points[0].y);
 
-  rdpq_fan_begin(&TRIFMT_FILL, cv);
+  rdpq_fan_begin(render_trifmt(), cv);
   rdpq_fan_add_vertex(v1);
   vertCount++;
 
+  float prev[] = { v1[0], v1[1] };
   for (size_t i = 0; i < pa->count; ++i) {
-    float vertex[] = { pa->points[i].x, pa->points[i].y };
+    float vertex[RENDER_VTX_FLOATS];
+    render_vertex(vertex, pa->points[i].x, pa->points[i].y);
     rdpq_fan_add_vertex(vertex);
+    budget_tri(fillrate_tri(cv, prev, vertex));
+    prev[0] = vertex[0];
+    prev[1] = vertex[1];
     triCount++;
     vertCount++;
   }
 
+  // rdpq_fan_end closes the fan back to the first vertex
+  budget_tri(fillrate_tri(cv, prev, v1));
   rdpq_fan_end();
 
 }
 
+/*
+  Convex polygons as a zig-zag strip down from the topmost point: top,
+  top+1, top-1, top+2, top-2, ... Every triangle spans the polygon from one
+  side to the other over a few scanlines, so none of them get as thin as
+  the ones a fan from a perimeter point makes near that point, the RDP walks
+  each scanline about twice instead of once per triangle, and there are n-2
+  triangles where draw_rdp_fan needs n+1, two of which are empty.
+*/
+void draw_convex_strip(const PointArray* pa) {
+  RDPCAP_TAG(CAP_TAG_STRIP);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  if (pa->count < 3){ debugf("Need at least 3 points to form a triangle"); return; }
+  PROF_SCOPE(ZONE_SUBMIT);
+
+  size_t top = 0;
+  for (size_t i = 1; i < pa->count; ++i) {
+    if (pa->points[i].y < pa->points[top].y) {
+      top = i;
+    }
+  }
+
+  render_bounds_points(pa, false);
+  float strip[3][RENDER_VTX_FLOATS];
+  size_t lo = top + 1, hi = top + pa->count - 1;
+
+  rdpq_strip_begin(render_trifmt());
+  for (size_t i = 0; i < pa->count; ++i) {
+    size_t index = (i == 0 ? top : (i & 1 ? lo++ : hi--)) % pa->count;
+    float* vertex = strip[i % 3];
+    render_vertex(vertex, pa->points[index].x, pa->points[index].y);
+    rdpq_strip_add_vertex(vertex);
+    vertCount++;
+
+    if (i >= 2) {
+      budget_tri(fillrate_tri(strip[0], strip[1], strip[2]));
+      triCount++;
+    }
+  }
+  rdpq_strip_end();
+
+}
+
+// Same as draw_convex_strip for packed points, the s13.2 positions go to the RDP as they are
+void draw_convex_strip_q(const PointArrayQ* pa) {
+  RDPCAP_TAG(CAP_TAG_STRIP);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  if (pa->count < 3){ debugf("Need at least 3 points to form a triangle"); return; }
+  PROF_SCOPE(ZONE_SUBMIT);
+
+  size_t top = 0;
+  for (size_t i = 1; i < pa->count; ++i) {
+    if (pa->points[i].y < pa->points[top].y) {
+      top = i;
+    }
+  }
+
+  render_bounds_points_q(pa);
+  float strip[3][RENDER_VTX_FLOATS];
+  size_t lo = top + 1, hi = top + pa->count - 1;
+
+  rdpq_strip_begin(render_trifmt());
+  for (size_t i = 0; i < pa->count; ++i) {
+    PointQ q = pa->points[(i == 0 ? top : (i & 1 ? lo++ : hi--)) % pa->count];
+    float* vertex = strip[i % 3];
+    // The float position is only for the other attributes and the fill rate estimate
+    render_vertex(vertex, q.x * (1.0f / POINTQ_ONE), q.y * (1.0f / POINTQ_ONE));
+    rdpq_strip_add_vertex_xy(q.x, q.y, vertex);
+    vertCount++;
+
+    if (i >= 2) {
+      budget_tri(fillrate_tri(strip[0], strip[1], strip[2]));
+      triCount++;
+    }
+  }
+  rdpq_strip_end();
+
+}
+
+// Function to get the outward unit normal of the edge a to b, false for an edge of no length
+static bool render_edge_normal(const Point* a, const Point* b, float side, float* n) {
+  float dx = b->x - a->x, dy = b->y - a->y;
+  float length = sqrtf(dx * dx + dy * dy);
+  if (length == 0.0f) {
+    return false;
+  }
+  n[0] = dy / length * side;
+  n[1] = -dx / length * side;
+  return true;
+}
+
+/*
+  Edge-fringe antialiasing. The fringe is a strip RENDER_FRINGE_WIDTH wide
+  centered on a closed outline, inner vertices get the shape's color and
+  outer ones the same with alpha 0, so the edge fades out over about a pixel
+  instead of stepping. It reuses the outline the shape was tessellated from
+  and adds 2 triangles per outline point. On the host that halves the
+  aliasing of an edge at any segment count, where more segments alone only
+  make the outline rounder, see the aa_ cases of ld_benchmark.c. Corners are
+  pushed out along the bisector of their edges, at most RENDER_FRINGE_MITER
+  half widths.
+
+  Shapes drawn after set_render_fringe(true) call it themselves, for other
+  outlines call it right after the shape. Without a fringe set it does nothing.
+*/
+void draw_fringe(const PointArray* outline) {
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  if (!renderFringe || outline->count < 3) {
+    return;
+  }
+  PROF_SCOPE(ZONE_SUBMIT);
+
+  // Twice the signed area, the outward normal is on the right of the edges when it is positive
+  const Point* p = outline->points;
+  size_t n = outline->count;
+  float area = 0.0f;
+  for (size_t i = 0; i < n; ++i) {
+    const Point* q = &p[(i + 1) % n];
+    area += p[i].x * q->y - q->x * p[i].y;
+  }
+  if (area == 0.0f) {
+    return;
+  }
+  float side = area > 0.0f ? 1.0f : -1.0f;
+  float half = RENDER_FRINGE_WIDTH * 0.5f;
+  int alpha = TRIFMT_SHADE.shade_offset + 3; // Same in TRIFMT_SHADE_TEX
+
+  // Normal of the edge into the first point, zero length edges keep the one before
+  float prev[2] = { 0.0f, 0.0f };
+  for (size_t i = n; i > 0; --i) {
+    if (render_edge_normal(&p[i - 1], &p[i % n], side, prev)) {
+      break;
+    }
+  }
+
+  float strip[3][RENDER_VTX_FLOATS];
+  int vertex = 0;
+  rdpq_strip_begin(render_trifmt());
+  for (size_t i = 0; i <= n; ++i) {
+    const Point* a = &p[i % n];
+    float next[2] = { prev[0], prev[1] };
+    render_edge_normal(a, &p[(i + 1) % n], side, next);
+
+    // Miter: the offset whose distance to both edges is 1, capped for sharp corners
+    float mx = prev[0] + next[0], my = prev[1] + next[1];
+    float bend = 1.0f + prev[0] * next[0] + prev[1] * next[1]; // 1 + cosine of the turn
+    float scale = bend > 2.0f / (RENDER_FRINGE_MITER * RENDER_FRINGE_MITER) ? 1.0f / bend : 0.0f;
+    if (scale == 0.0f) {
+      float length = sqrtf(mx * mx + my * my);
+      scale = length > 0.0f ? RENDER_FRINGE_MITER / length : 0.0f;
+    }
+    mx *= scale * half;
+    my *= scale * half;
+    prev[0] = next[0];
+    prev[1] = next[1];
+
+    for (int outer = 0; outer < 2; ++outer) {
+      float* v = strip[vertex % 3];
+      render_vertex(v, outer ? a->x + mx : a->x - mx, outer ? a->y + my : a->y - my);
+      if (outer) {
+        v[alpha] = 0.0f;
+      }
+      rdpq_strip_add_vertex(v);
+      vertCount++;
+      if (++vertex >= 3) {
+        budget_tri(fillrate_tri(strip[0], strip[1], strip[2]));
+        triCount++;
+      }
+    }
+  }
+  rdpq_strip_end();
+}
+
 // Function to draw a triangle fan from an array of points
 void draw_fan(const PointArray* pa, const Point center) {
+  RDPCAP_TAG(CAP_TAG_FAN);
+  MEM_TAG(MEM_TAG_TESSELLATION);
   if (pa->count < 2){ debugf("Need at least 3 points to form a triangle"); return; }
+  PROF_SCOPE(ZONE_SUBMIT);
+  render_bounds_points(pa, false);
+  render_bounds(&center.x, 1, true);
 
   for (size_t i = 0; i < pa->count - 1; ++i) {
     Point p2 = pa->points[i];
@@ -174,7 +609,8 @@ void draw_fan(const PointArray* pa, const Point center) {
     float v2[] = { p2.x, p2.y };
     float v3[] = { p3.x, p3.y };
 
-    rdpq_triangle(&TRIFMT_FILL, v1, v2, v3);
+    render_triangle(v1, v2, v3);
+    budget_tri(fillrate_tri(v1, v2, v3));
     triCount++;
     vertCount += 2;
   }
@@ -187,17 +623,33 @@ void draw_fan(const PointArray* pa, const Point center) {
   float lastV2[] = { lastPoint.x, lastPoint.y };
   float lastV3[] = { firstPoint.x, firstPoint.y };
 
-  rdpq_triangle(&TRIFMT_FILL, lastV1, lastV2, lastV3);
+  render_triangle(lastV1, lastV2, lastV3);
+  budget_tri(fillrate_tri(lastV1, lastV2, lastV3));
   triCount++;
 
 }
 
-// Function to draw a triangle fan from an array of points
+// Function to draw a quad as 2 triangles, v1 and v2 are its start and v3 and v4 its end along a path
 void draw_strip(float* v1, float* v2, float* v3, float* v4) {
-
-  rdpq_triangle(&TRIFMT_FILL, v1, v2, v3);
-  rdpq_triangle(&TRIFMT_FILL, v2, v4, v3);
-  rdpq_sync_pipe();
+  RDPCAP_TAG(CAP_TAG_STRIP);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  PROF_SCOPE(ZONE_SUBMIT);
+
+  float xy[] = { v1[0], v1[1], v2[0], v2[1], v3[0], v3[1], v4[0], v4[1] };
+  render_bounds(xy, 4, false);
+
+  // Length between the middles of the start and the end
+  float length = hypotf((v3[0] + v4[0] - v1[0] - v2[0]) * 0.5f, (v3[1] + v4[1] - v1[1] - v2[1]) * 0.5f);
+  float p1[] = { 0.0f, 0.0f };
+  float p2[] = { 0.0f, 1.0f };
+  float p3[] = { length, 0.0f };
+  float p4[] = { length, 1.0f };
+
+  render_triangle_path(v1, v2, v3, p1, p2, p3);
+  budget_tri(fillrate_tri(v1, v2, v3));
+  render_triangle_path(v2, v4, v3, p2, p4, p3);
+  budget_tri(fillrate_tri(v2, v4, v3));
+  rdpcap_sync_pipe();
   triCount += 2;
   vertCount += 4;
 
@@ -206,18 +658,23 @@ void draw_strip(float* v1, float* v2, float* v3, float* v4) {
 
 // Function to draw a strip of triangles from an array of vertices
 void draw_strip_from_array(float* vertices, int vertexCount, float width) {
+  RDPCAP_TAG(CAP_TAG_STRIP);
+  MEM_TAG(MEM_TAG_TESSELLATION);
   if (vertexCount < 2) {
     debugf("Not enough vertices to draw a strip\n");
     return;
   }
 
+  prof_begin(ZONE_TESSELLATE);
+
   // Calculate the number of quads and the total number of vertices needed
   int quadCount = vertexCount - 1;
   int totalVertices = quadCount * 8; // 8 floats per quad (4 vertices, 2 coords each)
-  float* stripVertices = (float*)malloc(totalVertices * sizeof(float));
+  float* stripVertices = (float*)arena_alloc(totalVertices * sizeof(float));
 
   if (!stripVertices) {
     debugf("Strip vertices allocation failed\n");
+    prof_end(ZONE_TESSELLATE);
     return;
   }
 
@@ -248,26 +705,54 @@ void draw_strip_from_array(float* vertices, int vertexCount, float width) {
     stripVertices[index + 7] = vertices[(i + 1) * 2 + 1] - offsetY;
   }
 
-  // Draw the quads
+  prof_end(ZONE_TESSELLATE);
+  prof_begin(ZONE_SUBMIT);
+  render_bounds(stripVertices, quadCount * 4, false);
+
+  // Draw the quads, the path runs along the input vertices
+  float along = 0.0f;
   for (int i = 0; i < quadCount; ++i) {
     float v1[] = { stripVertices[i * 8], stripVertices[i * 8 + 1] };
     float v2[] = { stripVertices[i * 8 + 2], stripVertices[i * 8 + 3] };
     float v3[] = { stripVertices[i * 8 + 4], stripVertices[i * 8 + 5] };
     float v4[] = { stripVertices[i * 8 + 6], stripVertices[i * 8 + 7] };
 
+    float next = along + hypotf(vertices[(i + 1) * 2] - vertices[i * 2], vertices[(i + 1) * 2 + 1] - vertices[i * 2 + 1]);
+    float p1[] = { along, 0.0f };
+    float p2[] = { along, 1.0f };
+    float p3[] = { next, 0.0f };
+    float p4[] = { next, 1.0f };
+    along = next;
+
     // Draw the two triangles for each quad
-    rdpq_triangle(&TRIFMT_FILL, v1, v2, v3);
-    rdpq_triangle(&TRIFMT_FILL, v2, v4, v3);
+    render_triangle_path(v1, v2, v3, p1, p2, p3);
+    budget_tri(fillrate_tri(v1, v2, v3));
+    render_triangle_path(v2, v4, v3, p2, p4, p3);
+    budget_tri(fillrate_tri(v2, v4, v3));
     triCount += 2;
     vertCount += 4;
   }
 
-  // Free the allocated memory
-  free(stripVertices);
+  prof_end(ZONE_SUBMIT);
+
+  // Outline for the fringe: one side of the quads forward, the other back
+  if (renderFringe) {
+    PointArray outline = { .points = arena_alloc((quadCount + 1) * 2 * sizeof(Point)), .count = (quadCount + 1) * 2 };
+    if (outline.points) {
+      for (int i = 0; i <= quadCount; ++i) {
+        int index = i < quadCount ? i * 8 : (quadCount - 1) * 8 + 4;
+        outline.points[i] = point_new(stripVertices[index], stripVertices[index + 1]);
+        outline.points[outline.count - 1 - i] = point_new(stripVertices[index + 2], stripVertices[index + 3]);
+      }
+      draw_fringe(&outline);
+    }
+  }
 }
 
-// Draw a uniformed circle of any number of vertices as a triangle fan
+// Draw a uniformed circle of any number of vertices as a convex strip, or a fan in RENDER_CONVEX_FAN
 void draw_circle(float cx, float cy, float rx, float ry, float angle, float lod) {
+  RDPCAP_TAG(CAP_TAG_CIRCLE);
+  MEM_TAG(MEM_TAG_TESSELLATION);
 
   /*
     Segments directly related to the number of triangles to be drawn.
@@ -297,38 +782,55 @@ void draw_circle(float cx, float cy, float rx, float ry, float angle, float lod)
 
   */
 
-  int base_segments = 100; // Base number of segments for the highest LOD
-  int segments = (int)fmaxf((float)base_segments * lod, 3.0f);
+  // Small circles count as detail for the budget unless their caller says otherwise
+  BUDGET_PRIORITY(budget_size_priority(fmaxf(rx, ry) * 2.0f));
+  prof_begin(ZONE_TESSELLATE);
 
-  // Area thresholds
-  float area = rx * 2.0f;
-  float offset = (float)area * 0.3f;
+  // Segments come from the LOD policy, lod > 2 still asks for the most detail
+  int segments = lod > 2.0f ? LOD_MAX_SEGMENTS : lod_ellipse_segments(rx, ry);
+  int fixedSegments = lod_fixed_ellipse_segments(rx, lod);
 
-  //debugf("Area %.0f\n", area);
-
-  if (area <= 0.9f) {
+  if (segments == LOD_CULL) {
     // If only drawing subpixels, exit
-    debugf("Do you really need subpixels?\n");
+    prof_end(ZONE_TESSELLATE);
+    lod_count(fixedSegments, 0);
     return;
-  } else if (area >= 1.0f && area < 2.9f) {
+  } else if (segments == LOD_QUAD) {
     // If only drawing ~4 pixels or less, just draw a quad to save triangles
-    draw_quad(cx - offset, cy - offset, cx + offset, cy + offset, angle, 1.0f);
-    return;
-  } else {
-    // Default segments calculation for areas > 2.9f
-    segments = (int)((area < 3.0f) ? 3.0f : area) / ((area >= 9.9f) ? 2 : 3);
+    float offset = fmaxf(rx, ry) * 2.0f * 0.3f;
+    prof_end(ZONE_TESSELLATE);
 
-    // Enforce a minimum of 6 segments
-    segments = segments < 6 ? 6 : segments;
-
-    // Enforce a maximum of 200 segments for high detail levels
-    if (area > 9.9f) {
-      segments = (segments > 200 || lod > 2.0f) ? 200 : segments;
-    }
+    // Rotation does not show at this size, so it is one rectangle
+    lod_count(fixedSegments, 0);
+    draw_rect(cx - offset, cy - offset, cx + offset, cy + offset);
+    return;
+  }
+  lod_count(fixedSegments, segments);
 
-    // debugf("Segments %u\n", segments);
+  // Initialize PointArray, the points live in the frame's arena
+  PointArray pa = { .count = segments, .points = arena_alloc(segments * sizeof(Point)) };
+  if (!pa.points) {
+    debugf("Point array allocation failed\n");
+    prof_end(ZONE_TESSELLATE);
+    return;
   }
 
+#if POINT_FIXED
+  // Every point from the sine table at its own angle, so nothing adds up around the outline
+  int32_t rotation = fixed_angle_from_float(angle);
+  fixed_t cosAngle = fixed_cos(rotation), sinAngle = fixed_sin(rotation);
+  fixed_t radius = fixed_from_float(rx); // Round like the float path, which starts at (rx, 0) and turns it
+
+  // Angle of the point in 16.16 binary units, one step per segment
+  int64_t step = ((int64_t)FIXED_TURN << 16) / segments, position = 0;
+  for (int i = 0; i < segments; ++i, position += step) {
+    int32_t a = (int32_t)(position >> 16);
+    fixed_t x = fixed_mul(radius, fixed_cos(a));
+    fixed_t y = fixed_mul(radius, fixed_sin(a));
+    pa.points[i].x = cx + fixed_to_float(fixed_mul(x, cosAngle) - fixed_mul(y, sinAngle));
+    pa.points[i].y = cy + fixed_to_float(fixed_mul(x, sinAngle) + fixed_mul(y, cosAngle));
+  }
+#else
   // Calculate angles for position
   float theta = 2.0f * M_PI / (float)segments;
   float cos_theta = fm_cosf(theta);
@@ -338,13 +840,6 @@ void draw_circle(float cx, float cy, float rx, float ry, float angle, float lod)
   float cos_angle = fm_cosf(angle);
   float sin_angle = fm_sinf(angle);
 
-  // Initialize PointArray
-  PointArray pa = { .count = segments, .points = malloc(segments * sizeof(Point)) };
-  if (!pa.points) {
-    debugf("Point array allocation failed\n");
-    return;
-  }
-
   // Calculate perimeter vertices
   float x = rx;
   float y = 0.0f;
@@ -367,17 +862,46 @@ void draw_circle(float cx, float cy, float rx, float ry, float angle, float lod)
     y = nextY;
   
   }
+#endif
+
+  // The fringe fades out across the outline, so the polygon under it is half a fringe smaller, pa stays the outline for the fringe
+  PointArray fill = pa;
+  if (renderFringe) {
+    // Nothing is left inside a circle narrower than the fringe, it is all fringe
+    float inset = rx > 0.0f ? fmaxf(rx - RENDER_FRINGE_WIDTH * 0.5f, 0.0f) / rx : 0.0f;
+    fill.points = inset > 0.0f ? arena_alloc(segments * sizeof(Point)) : NULL;
+    fill.count = fill.points ? segments : 0;
+    for (size_t i = 0; i < fill.count; ++i) {
+      fill.points[i].x = cx + (pa.points[i].x - cx) * inset;
+      fill.points[i].y = cy + (pa.points[i].y - cy) * inset;
+    }
+  }
 
-  //debugf("Total vertices: %d\n", vertex_count);
-  draw_rdp_fan(&pa, pa.points[0]);
+  prof_end(ZONE_TESSELLATE);
 
-  free(pa.points);
+  if (fill.count >= 3) {
+    if (renderGradientSet && renderGradient.type == GRADIENT_RADIAL) {
+      // A radial gradient needs a vertex inside, the perimeter alone would all get about one color
+      draw_rdp_fan(&fill, point_new(cx, cy));
+    } else if (renderConvexMode == RENDER_CONVEX_STRIP) {
+      draw_convex_strip(&fill);
+    } else {
+      draw_rdp_fan(&fill, fill.points[0]);
+    }
+  }
 
+  if (renderFringe) {
+    draw_fringe(&pa);
+  }
 
 }
 
 // Function to draw a quad/rectangle of certain thickness with rotation and scale, using a 2 triangle strip
 void draw_line(float x1, float y1, float x2, float y2, float thickness) {
+  RDPCAP_TAG(CAP_TAG_LINE);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+
+  prof_begin(ZONE_TESSELLATE);
 
   // Check for subpixel thickness
   if(thickness <= 0.9f){
@@ -397,6 +921,7 @@ void draw_line(float x1, float y1, float x2, float y2, float thickness) {
     point_normalize(&direction);
   } else {
     debugf("Line length cannot be 0");  
+    prof_end(ZONE_TESSELLATE);
     return;
   }
 
@@ -416,12 +941,60 @@ void draw_line(float x1, float y1, float x2, float y2, float thickness) {
   float v3[] = { p2_left.x, p2_left.y };
   float v4[] = { p2_right.x, p2_right.y };
 
+  prof_end(ZONE_TESSELLATE);
+
   // Draw two triangles to form the line
   draw_strip(v1,v2,v3,v4);
+
+  Point outline[] = { p1_left, p2_left, p2_right, p1_right };
+  draw_fringe(&(PointArray){ .points = outline, .count = 4 });
+}
+
+/*
+  Function to draw an axis aligned rectangle with one rectangle command instead of 2 triangles.
+  Triangles only draw the pixels whose center is inside, so the corners snap to the whole
+  pixels that give the same centers and the rectangle covers exactly what the triangles
+  would have. Large opaque rectangles switch to fill mode, which writes several pixels per
+  cycle but costs a mode change either side.
+*/
+void draw_rect(float x0, float y0, float x1, float y1) {
+  float rx0 = ceilf(fminf(x0, x1) - 0.5f), rx1 = ceilf(fmaxf(x0, x1) - 0.5f);
+  float ry0 = ceilf(fminf(y0, y1) - 0.5f), ry1 = ceilf(fmaxf(y0, y1) - 0.5f);
+  if (rx1 <= rx0 || ry1 <= ry0) {
+    return;
+  }
+
+  // Rectangles have no vertex colors or texture coordinates, shaded and textured ones stay triangles
+  if (renderShade || renderTex) {
+    float v1[] = { x0, y0 };
+    float v2[] = { x1, y0 };
+    float v3[] = { x0, y1 };
+    float v4[] = { x1, y1 };
+    draw_strip(v1, v2, v3, v4);
+    return;
+  }
+  PROF_SCOPE(ZONE_SUBMIT);
+
+  // Multiply blending of an opaque color writes the color as is, so fill mode gives the same pixels
+  float area = (rx1 - rx0) * (ry1 - ry0);
+  bool fillMode = renderColor.a == 255 && area >= RENDER_FILL_MIN_AREA;
+  if (fillMode) {
+    rdpcap_mode_push();
+    rdpcap_set_mode_fill(renderColor);
+  }
+  rdpcap_fill_rectangle(rx0, ry0, rx1, ry1);
+  budget_rect(fillrate_rect(rx0, ry0, rx1, ry1, fillMode));
+  if (fillMode) {
+    rdpcap_mode_pop();
+  }
 }
 
 // Function to draw a quad/rectangle of certain thickness with rotation and scale, using a 2 triangle strip
 void draw_quad(float x1, float y1, float x2, float y2, float angle, float thickness) {
+  RDPCAP_TAG(CAP_TAG_QUAD);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+
+  prof_begin(ZONE_TESSELLATE);
 
   // Check for subpixel thickness
   if(thickness <= 0.9f){
@@ -444,6 +1017,7 @@ void draw_quad(float x1, float y1, float x2, float y2, float angle, float thickn
     point_normalize(&direction);
   } else {
     debugf("Line length cannot be 0");  
+    prof_end(ZONE_TESSELLATE);
     return;
   }
 
@@ -451,6 +1025,16 @@ void draw_quad(float x1, float y1, float x2, float y2, float angle, float thickn
   Point perp = point_new(-direction.y, direction.x); // Perpendicular to direction
   perp = point_set_mag(&perp, thickness / 2); // Set the magnitude to half of the thickness
 
+  // Unrotated quads are a single rectangle, with the fringe around its corners
+  if (angle == 0.0f) {
+    prof_end(ZONE_TESSELLATE);
+    float top = start.y - perp.y;
+    draw_rect(x1, top, x2, y2);
+    Point corners[] = { { x1, top }, { x2, top }, { x2, y2 }, { x1, y2 } };
+    draw_fringe(&(PointArray){ .points = corners, .count = 4 });
+    return;
+  }
+
   // Rotation matrix
   float cos_angle = fm_cosf(angle);
   float sin_angle = fm_sinf(angle);
@@ -473,32 +1057,45 @@ void draw_quad(float x1, float y1, float x2, float y2, float angle, float thickn
   float v3[] = { p2_left.x, p2_left.y };
   float v4[] = { p2_right.x, p2_right.y };
 
+  prof_end(ZONE_TESSELLATE);
+
   // Draw two triangles to form the line
   draw_strip(v1,v2,v3,v4);
+
+  Point outline[] = { p1_left, p1_right, p2_right, p2_left };
+  draw_fringe(&(PointArray){ .points = outline, .count = 4 });
 }
 
 
 // Function to draw a Bézier curve as a triangle strip with a given thickness
 void draw_bezier_curve(const Point* p0, const Point* p1, const Point* p2, const Point* p3, int segments, float angle, float thickness) {
-
-  // Initialize array
-  PointArray* curvePoints = (PointArray*)malloc_uncached(sizeof(PointArray)); 
-  if (!curvePoints) {
-    debugf("Failed to allocate memory for curvePoints\n");
-    return;
-  }
-  init_point_array(curvePoints);
-  if (!curvePoints->points) {
-    debugf("Failed to initialize curvePoints->points\n");
+  RDPCAP_TAG(CAP_TAG_BEZIER);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  prof_begin(ZONE_TESSELLATE);
+
+  // Segments come from the LOD policy, the argument is the most that will be drawn
+  int fixedSegments = segments;
+  segments = lod_bezier_segments(p0, p1, p2, p3, segments);
+  lod_count(2 * (fixedSegments > 0 ? fixedSegments : segments), 2 * segments);
+
+  // Sizes are known from the segments, so every array comes from the frame's arena in one go
+  int pointCount = segments + 1;
+  Point* curvePoints = (Point*)arena_alloc(pointCount * sizeof(Point));
+  float* vertices = (float*)arena_alloc(pointCount * 4 * sizeof(float));
+  int* indices = (int*)arena_alloc(segments * 6 * sizeof(int));
+  if (!curvePoints || !vertices || !indices) {
+    debugf("Failed to allocate the curve arrays\n");
+    prof_end(ZONE_TESSELLATE);
     return;
   }
-
-  float* vertices = NULL;
   int vertexCount = 0;
-
-  int* indices = NULL;
   int indexCount = 0;
 
+  // Distance along the curve and across it per vertex, only textures use it
+  bool pathMapped = renderTex && renderTexMap.mode == TEXMAP_PATH;
+  float* path = pathMapped ? (float*)arena_alloc(pointCount * 4 * sizeof(float)) : NULL;
+  float along = 0.0f;
+
   float step = (segments != 0) ? 1.0f / (float)segments : 1.0f;
 
   // Compute Bézier curve points FIXME: precompute?
@@ -513,7 +1110,7 @@ void draw_bezier_curve(const Point* p0, const Point* p1, const Point* p2, const
     float x = uuu * p0->x + 3 * uu * t * p1->x + 3 * u * tt * p2->x + ttt * p3->x;
     float y = uuu * p0->y + 3 * uu * t * p1->y + 3 * u * tt * p2->y + ttt * p3->y;
 
-    add_point(curvePoints, x, y);
+    curvePoints[i] = point_new(x, y);
   }
 
   // Center of the curve for rotation ??? FIXME
@@ -522,14 +1119,14 @@ void draw_bezier_curve(const Point* p0, const Point* p1, const Point* p2, const
   float cos_angle = fm_cosf(angle);
   float sin_angle = fm_sinf(angle);
 
-  for (int i = 0; i < curvePoints->count; ++i) { // FIXME: Use point_normalized and rotate_line_points
-    Point p = curvePoints->points[i];
+  for (int i = 0; i < pointCount; ++i) { // FIXME: Use point_normalized and rotate_line_points
+    Point p = curvePoints[i];
         
     // Compute the normal vector for the curve point
     float nx = 0, ny = 0;
-    if (i < curvePoints->count - 1) {
-      float dx = curvePoints->points[i + 1].x - p.x;
-      float dy = curvePoints->points[i + 1].y - p.y;
+    if (i < pointCount - 1) {
+      float dx = curvePoints[i + 1].x - p.x;
+      float dy = curvePoints[i + 1].y - p.y;
       float length = sqrtf(dx * dx + dy * dy);
       if(length != 0){
         nx = -dy / length * thickness / 2;
@@ -545,37 +1142,62 @@ void draw_bezier_curve(const Point* p0, const Point* p1, const Point* p2, const
     float offsetY = nx * sin_angle + ny * cos_angle;
 
     // Add vertices for the top and bottom of the strip
-    add_vertex(&vertices, &vertexCount, p.x + offsetX, p.y + offsetY);
-    add_vertex(&vertices, &vertexCount, p.x - offsetX, p.y - offsetY);
+    vertices[vertexCount++] = p.x + offsetX;
+    vertices[vertexCount++] = p.y + offsetY;
+    vertices[vertexCount++] = p.x - offsetX;
+    vertices[vertexCount++] = p.y - offsetY;
+    if (path) {
+      if (i > 0) {
+        along += hypotf(p.x - curvePoints[i - 1].x, p.y - curvePoints[i - 1].y);
+      }
+      path[i * 4] = along;
+      path[i * 4 + 1] = 0.0f;
+      path[i * 4 + 2] = along;
+      path[i * 4 + 3] = 1.0f;
+    }
 
     // Add indices
-    if (i < curvePoints->count - 1) {
+    if (i < pointCount - 1) {
       int baseIndex = i * 2;
-      add_index(&indices, &indexCount, baseIndex);
-      add_index(&indices, &indexCount, baseIndex + 1);
-      add_index(&indices, &indexCount, baseIndex + 2);
-      add_index(&indices, &indexCount, baseIndex + 1);
-      add_index(&indices, &indexCount, baseIndex + 3);
-      add_index(&indices, &indexCount, baseIndex + 2);
+      indices[indexCount++] = baseIndex;
+      indices[indexCount++] = baseIndex + 1;
+      indices[indexCount++] = baseIndex + 2;
+      indices[indexCount++] = baseIndex + 1;
+      indices[indexCount++] = baseIndex + 3;
+      indices[indexCount++] = baseIndex + 2;
     }
   }
 
-  // Draw the triangles using the indexed triangle function
-  draw_indexed_triangles(vertices, vertexCount, indices, indexCount);
+  prof_end(ZONE_TESSELLATE);
 
-  free(vertices);
-  free(indices);
+  // Draw the triangles using the indexed triangle function
+  render_indexed_triangles(vertices, path, vertexCount, indices, indexCount);
+
+  // Outline for the fringe: the top vertices forward, the bottom ones back
+  if (renderFringe) {
+    PointArray outline = { .points = arena_alloc(pointCount * 2 * sizeof(Point)), .count = pointCount * 2 };
+    if (outline.points) {
+      for (int i = 0; i < pointCount; ++i) {
+        outline.points[i] = point_new(vertices[i * 4], vertices[i * 4 + 1]);
+        outline.points[outline.count - 1 - i] = point_new(vertices[i * 4 + 2], vertices[i * 4 + 3]);
+      }
+      draw_fringe(&outline);
+    }
+  }
 
   currTris = indexCount / 3;
   currVerts = vertexCount / 2;
-  free(curvePoints->points);
-  free_uncached(curvePoints);
 }
 
 
 // Function to fill area between 2 Bézier curves using quads/rectangles
 void fill_between_beziers(const PointArray* curve1, const PointArray* curve2) {
+  RDPCAP_TAG(CAP_TAG_FILL_BEZIERS);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  PROF_SCOPE(ZONE_SUBMIT);
   size_t size = fminf(curve1->count, curve2->count);
+  render_bounds_points(curve1, false);
+  render_bounds_points(curve2, true);
   for (size_t i = 0; i < size - 1; ++i) {
     float v1[] = { curve1->points[i].x, curve1->points[i].y };
     float v2[] = { curve1->points[i + 1].x, curve1->points[i + 1].y };
@@ -583,8 +1205,10 @@ void fill_between_beziers(const PointArray* curve1, const PointArray* curve2) {
     float v4[] = { curve2->points[i + 1].x, curve2->points[i + 1].y };
 
     // Draw two triangles to fill the quad
-    rdpq_triangle(&TRIFMT_FILL, v1, v2, v3);
-    rdpq_triangle(&TRIFMT_FILL, v2, v3, v4);
+    render_triangle(v1, v2, v3);
+    budget_tri(fillrate_tri(v1, v2, v3));
+    render_triangle(v2, v3, v4);
+    budget_tri(fillrate_tri(v2, v3, v4));
     fillTris += 2;
     currVerts += 4; // Increment vertex count
     //debugf("After quad %d: Triangle count: %u, Vertex count: %u\n", i + 1, fillTris, currVerts);
@@ -595,13 +1219,25 @@ void fill_between_beziers(const PointArray* curve1, const PointArray* curve2) {
 void draw_filled_beziers(const Point* p0, const Point* p1, const Point* p2, const Point* p3, 
                                const Point* q0, const Point* q1, const Point* q2, const Point* q3, 
                                int segments) {
+  RDPCAP_TAG(CAP_TAG_FILL_BEZIERS);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+
 
+  prof_begin(ZONE_TESSELLATE);
 
-  // Set up two arrays
-  PointArray* topCurvePoints = (PointArray*)malloc_uncached(sizeof(PointArray)); 
-  PointArray* bottomCurvePoints = (PointArray*)malloc_uncached(sizeof(PointArray)); 
-  init_point_array(topCurvePoints);
-  init_point_array(bottomCurvePoints);
+  // Segments come from the LOD policy, the argument is the most that will be drawn
+  int fixedSegments = segments;
+  segments = lod_bezier_pair_segments(p0, p1, p2, p3, q0, q1, q2, q3, segments);
+  lod_count(2 * (fixedSegments > 0 ? fixedSegments : segments), 2 * segments);
+
+  // Set up two arrays in the frame's arena
+  PointArray topCurvePoints = { .points = arena_alloc((segments + 1) * sizeof(Point)), .count = segments + 1 };
+  PointArray bottomCurvePoints = { .points = arena_alloc((segments + 1) * sizeof(Point)), .count = segments + 1 };
+  if (!topCurvePoints.points || !bottomCurvePoints.points) {
+    debugf("Failed to allocate the curve arrays\n");
+    prof_end(ZONE_TESSELLATE);
+    return;
+  }
 
   // Reset accumulators
   currVerts = 0;
@@ -623,7 +1259,7 @@ void draw_filled_beziers(const Point* p0, const Point* p1, const Point* p2, cons
     float x = uuu * p0->x + 3 * uu * t * p1->x + 3 * u * tt * p2->x + ttt * p3->x;
     float y = uuu * p0->y + 3 * uu * t * p1->y + 3 * u * tt * p2->y + ttt * p3->y;
 
-    add_point(topCurvePoints, x, y);
+    topCurvePoints.points[i] = point_new(x, y);
   }
 
   // Bottom curve
@@ -638,16 +1274,14 @@ void draw_filled_beziers(const Point* p0, const Point* p1, const Point* p2, cons
     float x = uuu * q0->x + 3 * uu * t * q1->x + 3 * u * tt * q2->x + ttt * q3->x;
     float y = uuu * q0->y + 3 * uu * t * q1->y + 3 * u * tt * q2->y + ttt * q3->y;
 
-    add_point(bottomCurvePoints, x, y);
+    bottomCurvePoints.points[i] = point_new(x, y);
   }
 
+    prof_end(ZONE_TESSELLATE);
+
     // Fill the area between the two curves
-    fill_between_beziers(topCurvePoints, bottomCurvePoints);
+    fill_between_beziers(&topCurvePoints, &bottomCurvePoints);
     //debugf("After fill_between_beziers: Triangle count: %u, Vertex count: %u\n", fillTris, currVerts);
-    free(topCurvePoints->points);
-    free(bottomCurvePoints->points);
-    free_uncached(topCurvePoints);
-    free_uncached(bottomCurvePoints);
 }
 
 // Function to check ear clipping, An "ear" is a triangle formed by three consecutive vertices in a polygon that does not contain any other vertices of the polygon inside it.
@@ -675,7 +1309,7 @@ bool is_ear(const PointArray* polygon, int u, int v, int w, const int* V) {
 // A simple ear clipping algorithm for triangulation
 void triangulate_polygon(const PointArray* polygon, PointArray* triangles) {
 
-  int* V = (int*)malloc(polygon->count * sizeof(int));
+  int* V = (int*)mem_malloc(polygon->count * sizeof(int));
   if (V == NULL) {
     debugf("Polygon point count cannot be 0\n");
     return;
@@ -690,7 +1324,7 @@ void triangulate_polygon(const PointArray* polygon, PointArray* triangles) {
   for (int v = n - 1; n > 2;) {
     if ((count--) <= 0) {
       debugf("No polygon detected\n");
-      free(V);
+      mem_free(V);
       return;
     }
 
@@ -720,13 +1354,21 @@ void triangulate_polygon(const PointArray* polygon, PointArray* triangles) {
     count = 2 * n;
   }
 
-  free(V);
+  mem_free(V);
 }
 
 // Function to draw a Bézier curve using line segments, then fill shape with triangles. Note the base will always be a straight line.
 void draw_filled_bezier_shape(const Point* p0, const Point* p1, const Point* p2, const Point* p3, int segments) {
+  RDPCAP_TAG(CAP_TAG_BEZIER_SHAPE);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  prof_begin(ZONE_TESSELLATE);
+
+  // Segments come from the LOD policy, the argument is the most that will be drawn
+  int fixedSegments = segments;
+  segments = lod_bezier_segments(p0, p1, p2, p3, segments);
+  lod_count(fixedSegments > 0 ? fixedSegments : segments, segments);
 
-  PointArray* curvePoints = (PointArray*)malloc_uncached(sizeof(PointArray)); 
+  PointArray* curvePoints = (PointArray*)mem_malloc_uncached(sizeof(PointArray)); 
   init_point_array(curvePoints);
 
   float step = (segments != 0) ? 1.0f / (float)segments : 1.0f;
@@ -750,29 +1392,44 @@ void draw_filled_bezier_shape(const Point* p0, const Point* p1, const Point* p2,
   add_existing_point(curvePoints, curvePoints->points[0]);
 
   // Triangulate the closed polygon (using a simple ear clipping method)
-  PointArray* triangles = (PointArray*)malloc_uncached(sizeof(PointArray));
+  PointArray* triangles = (PointArray*)mem_malloc_uncached(sizeof(PointArray));
   init_point_array(triangles);
   triangulate_polygon(curvePoints, triangles);
 
+  prof_end(ZONE_TESSELLATE);
+  prof_begin(ZONE_SUBMIT);
+  render_bounds_points(triangles, false);
+
   // Draw the triangles
   for (size_t i = 0; i < triangles->count; i += 3) {
     float v1[] = { triangles->points[i].x, triangles->points[i].y };
     float v2[] = { triangles->points[i + 1].x, triangles->points[i + 1].y };
     float v3[] = { triangles->points[i + 2].x, triangles->points[i + 2].y };
 
-    rdpq_triangle(&TRIFMT_FILL, v1, v2, v3);
+    render_triangle(v1, v2, v3);
+    budget_tri(fillrate_tri(v1, v2, v3));
     triCount++;
     vertCount += 2;
   }
 
-  free(curvePoints->points);
-  free(triangles->points);
-  free_uncached(curvePoints);
-  free_uncached(triangles);
+  prof_end(ZONE_SUBMIT);
+
+  // The curve is the outline, without the point that closes it
+  PointArray outline = { .points = curvePoints->points, .count = curvePoints->count - 1 };
+  draw_fringe(&outline);
+
+  mem_free(curvePoints->points);
+  mem_free(triangles->points);
+  mem_free(curvePoints);
+  mem_free(triangles);
 }
 
 // Function to draw a fully transformable triangle fan
 void draw_fan_transform(const PointArray* fan, float angle, int segments, float rx, float ry) {
+  RDPCAP_TAG(CAP_TAG_CIRCLE);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+
+  prof_begin(ZONE_TESSELLATE);
 
   // Create a transformed copy of the original points
   PointArray transformedFan;
@@ -804,12 +1461,18 @@ void draw_fan_transform(const PointArray* fan, float angle, int segments, float
     ry2 = fmaxf(ry2, fabsf(dy));
   }
 
+  prof_end(ZONE_TESSELLATE);
+
   // Draw the ellipse with the calculated center and radii
   draw_circle(cx, cy, rx2, ry2, angle, (float)segments * 0.01f);
 }
 
 // Function to draw a quad/rectangle from the edge of an ellipse/fan to the edge of a "line" (ie another quad/rectangle)
 void fill_edge_ellipse_to_line(PointArray* previousPoints, PointArray* currentPoints, int segments, float scale) {
+  RDPCAP_TAG(CAP_TAG_ELLIPSE_EDGE);
+  MEM_TAG(MEM_TAG_TESSELLATION);
+  PROF_SCOPE(ZONE_SUBMIT);
+
   Point prevCenter = point_default();
   Point currCenter = point_default();
 
@@ -818,6 +1481,8 @@ void fill_edge_ellipse_to_line(PointArray* previousPoints, PointArray* currentPo
     // Calculate centers for previous and current points
     calculate_array_center(previousPoints, &prevCenter);
     calculate_array_center(currentPoints, &currCenter);
+    render_bounds_points(previousPoints, false);
+    render_bounds_points(currentPoints, true);
 
     // Scale points outward to fill in any gaps
     for (int i = 0; i < segments; ++i) {
@@ -833,8 +1498,10 @@ void fill_edge_ellipse_to_line(PointArray* previousPoints, PointArray* currentPo
       float v4f[] = { v4r.x, v4r.y };
 
       // Draw two triangles to form a quad between the points
-      rdpq_triangle(&TRIFMT_FILL, v1f, v2f, v3f);
-      rdpq_triangle(&TRIFMT_FILL, v2f, v4f, v3f);
+      render_triangle(v1f, v2f, v3f);
+      budget_tri(fillrate_tri(v1f, v2f, v3f));
+      render_triangle(v2f, v4f, v3f);
+      budget_tri(fillrate_tri(v2f, v4f, v3f));
       triCount++;
       vertCount += 4;
     }
@@ -4,11 +4,41 @@
 #include <libdragon.h>
 #include "point.h"
 #include "shapes.h"
+#include "gradient.h"
+#include "texmap.h"
 
+#define RENDER_FILL_MIN_AREA 256.0f // Smallest opaque rectangle worth the mode change to fill mode
+#define RENDER_VTX_FLOATS 9 // Position, RGBA and s, t, inverse w of TRIFMT_SHADE_TEX
+#define RENDER_FRINGE_WIDTH 1.0f // Pixels the AA fringe fades out over, centered on the outline
+#define RENDER_FRINGE_MITER 2.0f // Longest a fringe corner is pushed out, in half widths
 
+// How draw_circle submits its polygon
+typedef enum {
+  RENDER_CONVEX_STRIP, // Zig-zag strip, n-2 triangles
+  RENDER_CONVEX_FAN,   // Fan from the first point, as before
+} RenderConvexMode;
+
+extern RenderConvexMode renderConvexMode;
+
+// Attributes the set_render_* calls leave for the shapes drawn after them
+typedef struct {
+  color_t color;
+  Gradient gradient;
+  bool gradientSet;
+  bool shade; // Combiner in use, shaded and textured
+  bool fringe;
+  TexMap texMap;
+  bool tex;
+} RenderState;
 
 void set_render_color(color_t color);
 void set_random_render_color();
+void set_render_gradient(const Gradient* gradient);
+void set_render_texture(const TexMap* map);
+void set_render_fringe(bool fringe);
+void render_get_state(RenderState* state);
+void render_set_state(const RenderState* state);
+void render_restore_state(const RenderState* state);
 color_t get_random_render_color();
 void render_move_point(PointArray* points, size_t index, float dx, float dy);
 void render_move_shape_points(PointArray* points, float dx, float dy);
@@ -18,11 +48,15 @@ void render_get_ellipse_points(PointArray* previousPoints, Point center, float r
 void draw_triangle(float* v1, float* v2, float* v3);
 void draw_indexed_triangles(float* vertices, int vertex_count, int* indices, int index_count);
 void draw_rdp_fan(const PointArray* pa, const Point center);
+void draw_convex_strip(const PointArray* pa);
+void draw_convex_strip_q(const PointArrayQ* pa);
+void draw_fringe(const PointArray* outline);
 void draw_fan(const PointArray* pa, const Point center);
 void draw_strip(float* v1, float* v2, float* v3, float* v4);
 void draw_strip_from_array(float* vertices, int vertexCount, float width);
 void draw_circle(float cx, float cy, float rx, float ry, float angle, float lod);
 void draw_line(float x1, float y1, float x2, float y2, float thickness);
+void draw_rect(float x0, float y0, float x1, float y1);
 void draw_quad(float x1, float y1, float x2, float y2, float angle, float thickness);
 void draw_bezier_curve(const Point* p0, const Point* p1, const Point* p2, const Point* p3, int segments, float angle, float thickness);
 void fill_between_beziers(const PointArray* curve1, const PointArray* curve2);
@@ -0,0 +1,314 @@
+#include <libdragon.h>
+#include "scene.h"
+#include "render.h"
+#include "lod.h"
+#include "memtrack.h"
+
+void scene_init(Scene* scene) {
+  memset(scene, 0, sizeof(Scene));
+  scene->firstRoot = SCENE_NONE;
+  scene->lastRoot = SCENE_NONE;
+}
+
+void scene_free(Scene* scene) {
+  for (int i = 0; i < scene->count; ++i) {
+    mem_free(scene->nodes[i].points.points);
+  }
+  mem_free(scene->nodes);
+  mem_free(scene->dirty);
+  mem_free(scene->drawList);
+  mem_free(scene->sortKeys);
+  scene_init(scene);
+}
+
+// Function to put a node on the dirty list once
+static void scene_mark(Scene* scene, int id) {
+  SceneNode* node = &scene->nodes[id];
+  if (node->dirty) {
+    return;
+  }
+  if (scene->dirtyCount == scene->dirtyCapacity) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    int capacity = scene->dirtyCapacity ? scene->dirtyCapacity * 2 : 64;
+    int* dirty = (int*)mem_realloc(scene->dirty, sizeof(int) * capacity);
+    if (dirty == NULL) {
+      debugf("Scene dirty list allocation failed\n");
+      return;
+    }
+    scene->dirty = dirty;
+    scene->dirtyCapacity = capacity;
+  }
+  scene->dirty[scene->dirtyCount++] = id;
+  node->dirty = true;
+}
+
+// Function to add a node as the last child of parent, SCENE_NONE for a root, returns its id
+int scene_add(Scene* scene, int parent, int type, Shape* shape) {
+  MEM_TAG(MEM_TAG_SHAPES);
+
+  if (parent != SCENE_NONE && (parent < 0 || parent >= scene->count)) {
+    debugf("Invalid scene parent %d\n", parent);
+    return SCENE_NONE;
+  }
+  if (scene->count == scene->capacity) {
+    int capacity = scene->capacity ? scene->capacity * 2 : 64;
+    SceneNode* nodes = (SceneNode*)mem_realloc(scene->nodes, sizeof(SceneNode) * capacity);
+    int* drawList = nodes ? (int*)mem_realloc(scene->drawList, sizeof(int) * capacity) : NULL;
+    uint64_t* sortKeys = drawList ? (uint64_t*)mem_realloc(scene->sortKeys, sizeof(uint64_t) * capacity) : NULL;
+    if (nodes) {
+      scene->nodes = nodes;
+    }
+    if (drawList) {
+      scene->drawList = drawList;
+    }
+    if (sortKeys == NULL) {
+      debugf("Scene node allocation failed\n");
+      return SCENE_NONE;
+    }
+    scene->sortKeys = sortKeys;
+    scene->capacity = capacity;
+  }
+
+  int id = scene->count++;
+  SceneNode* node = &scene->nodes[id];
+  memset(node, 0, sizeof(SceneNode));
+  node->type = shape ? type : SCENE_GROUP;
+  node->shape = shape;
+  node->scaleX = 1.0f;
+  node->scaleY = 1.0f;
+  node->visible = true;
+  node->parent = parent;
+  node->firstChild = SCENE_NONE;
+  node->lastChild = SCENE_NONE;
+  node->nextSibling = SCENE_NONE;
+  node->world = affine_identity();
+
+  int* last = parent == SCENE_NONE ? &scene->lastRoot : &scene->nodes[parent].lastChild;
+  int* first = parent == SCENE_NONE ? &scene->firstRoot : &scene->nodes[parent].firstChild;
+  if (*last == SCENE_NONE) {
+    *first = id;
+  } else {
+    scene->nodes[*last].nextSibling = id;
+  }
+  *last = id;
+
+  scene_mark(scene, id);
+  scene->unsorted = true;
+  return id;
+}
+
+void scene_set_transform(Scene* scene, int id, Point position, float angle, float scaleX, float scaleY) {
+  if (id < 0 || id >= scene->count) {
+    return;
+  }
+  SceneNode* node = &scene->nodes[id];
+  node->position = position;
+  node->angle = angle;
+  node->scaleX = scaleX;
+  node->scaleY = scaleY;
+  scene_mark(scene, id);
+}
+
+void scene_set_position(Scene* scene, int id, Point position) {
+  if (id >= 0 && id < scene->count) {
+    const SceneNode* node = &scene->nodes[id];
+    scene_set_transform(scene, id, position, node->angle, node->scaleX, node->scaleY);
+  }
+}
+
+void scene_set_angle(Scene* scene, int id, float angle) {
+  if (id >= 0 && id < scene->count) {
+    const SceneNode* node = &scene->nodes[id];
+    scene_set_transform(scene, id, node->position, angle, node->scaleX, node->scaleY);
+  }
+}
+
+void scene_set_scale(Scene* scene, int id, float scaleX, float scaleY) {
+  if (id >= 0 && id < scene->count) {
+    const SceneNode* node = &scene->nodes[id];
+    scene_set_transform(scene, id, node->position, node->angle, scaleX, scaleY);
+  }
+}
+
+// Function to show or hide a node and everything under it
+void scene_set_visible(Scene* scene, int id, bool visible) {
+  if (id >= 0 && id < scene->count && scene->nodes[id].visible != visible) {
+    scene->nodes[id].visible = visible;
+    scene->unsorted = true;
+  }
+}
+
+void scene_set_z(Scene* scene, int id, int z) {
+  if (id >= 0 && id < scene->count && scene->nodes[id].z != z) {
+    scene->nodes[id].z = z;
+    scene->unsorted = true;
+  }
+}
+
+// Function to tell the scene the center, scale or points of the shape of a node were edited
+void scene_shape_changed(Scene* scene, int id) {
+  if (id >= 0 && id < scene->count) {
+    scene_mark(scene, id);
+  }
+}
+
+// Function to get the next node of the subtree of root in tree order, SCENE_NONE after the last
+static int scene_next(const Scene* scene, int id, int root) {
+  const SceneNode* node = &scene->nodes[id];
+  if (node->firstChild != SCENE_NONE) {
+    return node->firstChild;
+  }
+  while (id != root) {
+    if (scene->nodes[id].nextSibling != SCENE_NONE) {
+      return scene->nodes[id].nextSibling;
+    }
+    id = scene->nodes[id].parent;
+  }
+  return SCENE_NONE;
+}
+
+// Function to size the world points of a node, false when out of memory
+static bool scene_points(SceneNode* node, size_t count) {
+  if (count != node->points.count) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    PointQ* points = (PointQ*)mem_realloc(node->points.points, sizeof(PointQ) * (count ? count : 1));
+    if (points == NULL) {
+      debugf("Scene point allocation failed\n");
+      node->points.count = 0;
+      return false;
+    }
+    node->points.points = points;
+    node->points.count = count;
+  }
+  return true;
+}
+
+// Function to recompute the world transform of a node from its parent and the outline of its shape there
+static void scene_transform(Scene* scene, int id) {
+  SceneNode* node = &scene->nodes[id];
+  Affine local = affine_from(node->position, node->angle, node->scaleX, node->scaleY);
+  node->world = node->parent == SCENE_NONE ? local : affine_mul(&scene->nodes[node->parent].world, &local);
+  node->dirty = false;
+  scene->transformed++;
+
+  const Affine* m = &node->world;
+  const Shape* shape = node->shape;
+  if (node->type == SCENE_ELLIPSE) {
+    // Segments for the size on screen, the points go around the ellipse of the shape and through the transform
+    float rx = shape->scaleX * sqrtf(m->a * m->a + m->b * m->b);
+    float ry = shape->scaleY * sqrtf(m->c * m->c + m->d * m->d);
+    int segments;
+    {
+      LOD_SCOPE(&node->lod);
+      segments = lod_ellipse_segments(rx, ry);
+    }
+    segments = segments == LOD_QUAD ? 4 : segments;
+    if (!scene_points(node, segments)) {
+      return;
+    }
+    float theta = 2.0f * M_PI / (float)(segments ? segments : 1);
+    float cosTheta = fm_cosf(theta);
+    float sinTheta = fm_sinf(theta);
+    float x = 1.0f, y = 0.0f;
+    for (int i = 0; i < segments; ++i) {
+      Point p = point_new(shape->center.x + x * shape->scaleX, shape->center.y + y * shape->scaleY);
+      node->points.points[i] = point_quantize(affine_apply(m, p));
+      float nextX = cosTheta * x - sinTheta * y;
+      y = sinTheta * x + cosTheta * y;
+      x = nextX;
+    }
+  } else if (node->type == SCENE_POLYGON) {
+    const PointArray* outline = shape->currPoints;
+    size_t count = outline != NULL ? outline->count : 0;
+    if (!scene_points(node, count)) {
+      return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      node->points.points[i] = point_quantize(affine_apply(m, outline->points[i]));
+    }
+  }
+}
+
+static int scene_key_compare(const void* a, const void* b) {
+  uint64_t ka = *(const uint64_t*)a;
+  uint64_t kb = *(const uint64_t*)b;
+  return ka < kb ? -1 : ka > kb;
+}
+
+// Function to list the visible shape nodes in tree order, then sort them by z keeping that order for ties
+static void scene_sort(Scene* scene) {
+  scene->drawCount = 0;
+  for (int root = scene->firstRoot; root != SCENE_NONE; root = scene->nodes[root].nextSibling) {
+    int id = root;
+    while (id != SCENE_NONE) {
+      const SceneNode* node = &scene->nodes[id];
+      if (!node->visible) {
+        // Skip the subtree, continue after it
+        int next = id;
+        while (next != root && scene->nodes[next].nextSibling == SCENE_NONE) {
+          next = scene->nodes[next].parent;
+        }
+        id = next == root ? SCENE_NONE : scene->nodes[next].nextSibling;
+        continue;
+      }
+      if (node->type != SCENE_GROUP) {
+        scene->drawList[scene->drawCount++] = id;
+      }
+      id = scene_next(scene, id, root);
+    }
+  }
+
+  // Sorted by z then by the place in tree order, which keeps ties as they were
+  int* list = scene->drawList;
+  uint64_t* keys = scene->sortKeys;
+  for (int i = 0; i < scene->drawCount; ++i) {
+    keys[i] = ((uint64_t)((uint32_t)scene->nodes[list[i]].z ^ 0x80000000u) << 32) | (uint32_t)i;
+  }
+  qsort(keys, scene->drawCount, sizeof(uint64_t), scene_key_compare);
+  for (int i = 0; i < scene->drawCount; ++i) {
+    keys[i] = (uint64_t)list[(uint32_t)keys[i]];
+  }
+  for (int i = 0; i < scene->drawCount; ++i) {
+    list[i] = (int)keys[i];
+  }
+  scene->unsorted = false;
+}
+
+// Function to bring the world transforms of everything that changed up to date, and the draw list
+void scene_update(Scene* scene) {
+  scene->transformed = 0;
+  for (int i = 0; i < scene->dirtyCount; ++i) {
+    int id = scene->dirty[i];
+    if (!scene->nodes[id].dirty) {
+      // Done with the subtree of a dirty parent already
+      continue;
+    }
+    bool covered = false;
+    for (int p = scene->nodes[id].parent; p != SCENE_NONE && !covered; p = scene->nodes[p].parent) {
+      covered = scene->nodes[p].dirty;
+    }
+    if (covered) {
+      continue;
+    }
+    for (int n = id; n != SCENE_NONE; n = scene_next(scene, n, id)) {
+      scene_transform(scene, n);
+    }
+  }
+  scene->dirtyCount = 0;
+
+  if (scene->unsorted) {
+    scene_sort(scene);
+  }
+}
+
+// Function to update the scene and draw its visible shapes back to front
+void scene_draw(Scene* scene) {
+  scene_update(scene);
+  for (int i = 0; i < scene->drawCount; ++i) {
+    const SceneNode* node = &scene->nodes[scene->drawList[i]];
+    set_render_color(node->shape->fillColor);
+    if (node->points.count >= 3) {
+      draw_convex_strip_q(&node->points);
+    }
+  }
+}
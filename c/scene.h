@@ -0,0 +1,123 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <libdragon.h>
+#include "point.h"
+#include "shapes.h"
+#include "lod.h"
+
+#define SCENE_NONE (-1)
+
+/*
+  Retained scene graph, a tree of nodes each with a transform relative to
+  its parent, visibility, a draw order and optionally a shape.
+
+  A rig like a creature is one node per part, the body, the eyes under it,
+  the pupils under the eyes, fins and tail, and moving the root node moves
+  everything under it. The shape of a node is in the space of the node,
+  its center and points around (0, 0), so parts that look the same can
+  share one Shape. SCENE_ELLIPSE nodes draw the ellipse of the center and
+  scale of their shape, SCENE_POLYGON nodes the convex outline of its
+  points.
+
+  The setters only store the new local transform and put the node on a
+  dirty list. scene_update recomputes the world transforms of the dirty
+  nodes and everything under them, and nothing else, one fin flapping costs
+  one node. The outline is put through the transform at the same time,
+  ellipses tessellated with the segments of their size on screen (lod.h),
+  and kept packed (PointQ in point.h), so drawing a node that did not
+  change only submits its points again, without converting them.
+
+  The draw list holds the visible shape nodes sorted by z, ties in tree
+  order with parents first, and is only sorted again after nodes were added
+  or their z or visibility changed.
+  The z of a node is its own, not added to the one of its parent.
+*/
+
+typedef enum {
+  SCENE_GROUP,
+  SCENE_ELLIPSE,
+  SCENE_POLYGON,
+} SCENE_NODE_TYPES;
+
+// Maps (x, y) to (a x + c y + tx, b x + d y + ty)
+typedef struct {
+  float a, b, c, d;
+  float tx, ty;
+} Affine;
+
+typedef struct {
+  int type;
+  Shape* shape; // Not owned, may be shared by several nodes
+  Point position; // Local, relative to the parent
+  float angle;
+  float scaleX, scaleY;
+  int z;
+  bool visible;
+  int parent, firstChild, lastChild, nextSibling;
+  bool dirty;
+  Affine world;
+  PointArrayQ points; // Outline in world space, packed
+  LodState lod; // Segments of an ellipse, held while it scales
+} SceneNode;
+
+typedef struct {
+  SceneNode* nodes;
+  int count;
+  int capacity;
+  int firstRoot, lastRoot;
+  int* dirty; // Nodes set since the last update, their subtrees are recomputed
+  int dirtyCount;
+  int dirtyCapacity;
+  int* drawList; // Visible shape nodes by z
+  int drawCount;
+  uint64_t* sortKeys;
+  bool unsorted; // Nodes were added or their z or visibility changed
+  uint32_t transformed; // World transforms recomputed by the last update
+} Scene;
+
+static inline Affine affine_identity() {
+  return (Affine){ 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };
+}
+
+// Function to get the transform that scales, then rotates, then moves
+static inline Affine affine_from(Point position, float angle, float scaleX, float scaleY) {
+  float c = fm_cosf(angle);
+  float s = fm_sinf(angle);
+  return (Affine){ c * scaleX, s * scaleX, -s * scaleY, c * scaleY, position.x, position.y };
+}
+
+// Function to get the transform that applies l then p
+static inline Affine affine_mul(const Affine* p, const Affine* l) {
+  return (Affine){
+    p->a * l->a + p->c * l->b,
+    p->b * l->a + p->d * l->b,
+    p->a * l->c + p->c * l->d,
+    p->b * l->c + p->d * l->d,
+    p->a * l->tx + p->c * l->ty + p->tx,
+    p->b * l->tx + p->d * l->ty + p->ty,
+  };
+}
+
+static inline Point affine_apply(const Affine* m, Point p) {
+  return point_new(m->a * p.x + m->c * p.y + m->tx, m->b * p.x + m->d * p.y + m->ty);
+}
+
+void scene_init(Scene* scene);
+void scene_free(Scene* scene);
+int scene_add(Scene* scene, int parent, int type, Shape* shape);
+void scene_set_transform(Scene* scene, int id, Point position, float angle, float scaleX, float scaleY);
+void scene_set_position(Scene* scene, int id, Point position);
+void scene_set_angle(Scene* scene, int id, float angle);
+void scene_set_scale(Scene* scene, int id, float scaleX, float scaleY);
+void scene_set_visible(Scene* scene, int id, bool visible);
+void scene_set_z(Scene* scene, int id, int z);
+void scene_shape_changed(Scene* scene, int id);
+void scene_update(Scene* scene);
+void scene_draw(Scene* scene);
+
+static inline const SceneNode* scene_node(const Scene* scene, int id) {
+  return &scene->nodes[id];
+}
+
+#endif // SCENE_H
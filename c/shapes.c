@@ -6,6 +6,8 @@
 
 // Initialization functions
 void shape_init(Shape* shape) {
+    MEM_TAG(MEM_TAG_SHAPES);
+
     if (shape == NULL) {
         return;
     }
@@ -16,7 +18,11 @@ void shape_init(Shape* shape) {
     shape->segments = 1;
     shape->lod = 1.0f;
     shape->fillColor = BLACK;
-    shape->currPoints = (PointArray*)malloc(sizeof(PointArray));
+    shape->grid = NULL;
+    shape->gridId = SPATIAL_NONE;
+    shape->bvh = NULL;
+    shape->bvhId = BVH_NONE;
+    shape->currPoints = (PointArray*)mem_malloc(sizeof(PointArray));
     init_point_array(shape->currPoints);
 
 }
@@ -58,18 +64,39 @@ void strip_init(Shape* strip, Point origin, float scaleX, float scaleY, float th
 }
 
 
+// Function to move a shape in its grid and BVH after it changed, cheap while it stays in the same cells
+static void shape_grid_update(Shape* shape) {
+    if (shape->grid != NULL) {
+        spatial_update(shape->grid, shape->gridId, shape_bounds(shape));
+    }
+    if (shape->bvh != NULL) {
+        bvh_update(shape->bvh, shape->bvhId, shape_bounds(shape));
+    }
+}
+
 // Common functions for shapes
 void set_points(Shape* shape, PointArray* points) {
 
-    // Free old points if they exist
-    if (shape->currPoints != NULL) {
-        free(shape->currPoints->points);
-        shape->currPoints->count = 0;
+    MEM_TAG(MEM_TAG_SHAPES);
+
+    // Setting a shape's own points only tells the grid they were edited, the old points used to be freed before the copy
+    if (shape->currPoints == NULL || shape->currPoints == points) {
+        shape_grid_update(shape);
+        return;
+    }
+
+    // Resize the old points to fit
+    Point* new_points = (Point*)mem_realloc(shape->currPoints->points, sizeof(Point) * (points->count ? points->count : 1));
+    if (new_points == NULL) {
+        debugf("Point reallocation failed\n");
+        return;
     }
 
     // Copy new points
+    shape->currPoints->points = new_points;
     memcpy(shape->currPoints->points, points->points, sizeof(Point) * points->count);
     shape->currPoints->count = points->count;
+    shape_grid_update(shape);
 }
 
 PointArray* get_points(Shape* shape) {
@@ -86,6 +113,7 @@ float get_thickness(const Shape* shape) {
 
 void set_scaleX(Shape* shape, float scaleX) {
     shape->scaleX = scaleX;
+    shape_grid_update(shape);
 }
 
 float get_scaleX(const Shape* shape) {
@@ -94,6 +122,7 @@ float get_scaleX(const Shape* shape) {
 
 void set_scaleY(Shape* shape, float scaleY) {
     shape->scaleY = scaleY;
+    shape_grid_update(shape);
 }
 
 float get_scaleY(const Shape* shape) {
@@ -102,6 +131,7 @@ float get_scaleY(const Shape* shape) {
 
 void set_center(Shape* shape, Point center) {
     shape->center = center;
+    shape_grid_update(shape);
 }
 
 Point get_center(const Shape* shape) {
@@ -183,9 +213,51 @@ void resolve(Shape* shape, float stickX, float stickY) {
 }
 
 void destroy(Shape* shape) {
+    shape_grid_remove(shape);
+    shape_bvh_remove(shape);
     if (shape->currPoints != NULL) {
-        free(shape->currPoints);
+        mem_free(shape->currPoints->points);
+        mem_free(shape->currPoints);
+        shape->currPoints = NULL;
     }
 }
 
+// Function to get a box around a shape, its points and the ellipse of its scale around its center, which may be ahead of them
+Bounds shape_bounds(const Shape* shape) {
+    float radius = fmaxf(shape->scaleX, shape->scaleY);
+    Bounds bounds = bounds_around(shape->center, radius, radius);
+    if (shape->currPoints != NULL && shape->currPoints->count > 0) {
+        bounds = bounds_union(bounds, bounds_of_points(shape->currPoints->points, shape->currPoints->count));
+    }
+    return bounds;
+}
+
+// Function to add a shape to a grid, it then follows every change of center, scale and points
+void shape_grid_insert(Shape* shape, SpatialHash* grid) {
+    shape_grid_remove(shape);
+    shape->gridId = spatial_insert(grid, shape_bounds(shape), shape, 0);
+    shape->grid = shape->gridId != SPATIAL_NONE ? grid : NULL;
+}
 
+void shape_grid_remove(Shape* shape) {
+    if (shape->grid != NULL) {
+        spatial_remove(shape->grid, shape->gridId);
+    }
+    shape->grid = NULL;
+    shape->gridId = SPATIAL_NONE;
+}
+
+// Function to add a shape to a BVH, found by its queries after the next bvh_build and refitted as it moves
+void shape_bvh_insert(Shape* shape, Bvh* bvh) {
+    shape_bvh_remove(shape);
+    shape->bvhId = bvh_insert(bvh, shape_bounds(shape), shape);
+    shape->bvh = shape->bvhId != BVH_NONE ? bvh : NULL;
+}
+
+void shape_bvh_remove(Shape* shape) {
+    if (shape->bvh != NULL) {
+        bvh_remove(shape->bvh, shape->bvhId);
+    }
+    shape->bvh = NULL;
+    shape->bvhId = BVH_NONE;
+}
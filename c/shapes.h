@@ -4,6 +4,8 @@
 #include <libdragon.h>
 #include "point.h"
 #include "render.h"
+#include "spatial.h"
+#include "bvh.h"
 #include "utils.h"
 
 typedef struct {
@@ -14,6 +16,10 @@ typedef struct {
     int segments;
     float lod;
     color_t fillColor;
+    SpatialHash* grid; // Optional, kept up to date as the shape moves
+    int gridId;
+    Bvh* bvh; // Optional, its box is kept up to date as the shape moves
+    int bvhId;
 } Shape;
 
 // Initialization functions
@@ -43,4 +49,11 @@ color_t get_fill_color(const Shape* shape);
 void resolve(Shape* shape, float stickX, float stickY);
 void destroy(Shape* shape);
 
+// Spatial queries, see spatial.h
+Bounds shape_bounds(const Shape* shape);
+void shape_grid_insert(Shape* shape, SpatialHash* grid);
+void shape_grid_remove(Shape* shape);
+void shape_bvh_insert(Shape* shape, Bvh* bvh);
+void shape_bvh_remove(Shape* shape);
+
 #endif // SHAPE_H
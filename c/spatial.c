@@ -0,0 +1,307 @@
+#include <libdragon.h>
+#include "spatial.h"
+#include "memtrack.h"
+
+static uint32_t spatial_bucket(const SpatialHash* hash, int cx, int cy) {
+  return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & hash->bucketMask;
+}
+
+// Function to get the cells a box covers, none for an empty one
+static void spatial_cells(const SpatialHash* hash, const Bounds* b, int* cx0, int* cy0, int* cx1, int* cy1) {
+  if (!(b->x0 <= b->x1 && b->y0 <= b->y1)) {
+    *cx0 = *cy0 = 0;
+    *cx1 = *cy1 = -1;
+    return;
+  }
+  *cx0 = (int)floorf(b->x0 * hash->invCell);
+  *cy0 = (int)floorf(b->y0 * hash->invCell);
+  *cx1 = (int)floorf(b->x1 * hash->invCell);
+  *cy1 = (int)floorf(b->y1 * hash->invCell);
+}
+
+void spatial_init(SpatialHash* hash, float cell, uint32_t buckets) {
+  MEM_TAG(MEM_TAG_SHAPES);
+
+  memset(hash, 0, sizeof(SpatialHash));
+  hash->cell = cell > 0.0f ? cell : SPATIAL_CELL;
+  hash->invCell = 1.0f / hash->cell;
+
+  // Round up to a power of two so the hash is a mask
+  uint32_t count = 1;
+  while (count < buckets) {
+    count <<= 1;
+  }
+  hash->bucketMask = count - 1;
+  hash->buckets = (int*)mem_malloc(sizeof(int) * count);
+  if (hash->buckets == NULL) {
+    debugf("Spatial hash bucket allocation failed\n");
+    hash->bucketMask = 0;
+    return;
+  }
+  spatial_clear(hash);
+}
+
+void spatial_free(SpatialHash* hash) {
+  mem_free(hash->buckets);
+  mem_free(hash->items);
+  mem_free(hash->links);
+  memset(hash, 0, sizeof(SpatialHash));
+}
+
+// Function to remove every item and keep the memory
+void spatial_clear(SpatialHash* hash) {
+  if (hash->buckets == NULL) {
+    return;
+  }
+  for (uint32_t i = 0; i <= hash->bucketMask; ++i) {
+    hash->buckets[i] = SPATIAL_NONE;
+  }
+  hash->itemCount = 0;
+  hash->freeItem = SPATIAL_NONE;
+  hash->linkCount = 0;
+  hash->freeLink = SPATIAL_NONE;
+  hash->count = 0;
+}
+
+// Function to get a free link, reusing removed ones first
+static int spatial_new_link(SpatialHash* hash) {
+  if (hash->freeLink != SPATIAL_NONE) {
+    int link = hash->freeLink;
+    hash->freeLink = hash->links[link].next;
+    return link;
+  }
+  if (hash->linkCount == hash->linkCapacity) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    int capacity = hash->linkCapacity ? hash->linkCapacity * 2 : 256;
+    SpatialLink* links = (SpatialLink*)mem_realloc(hash->links, sizeof(SpatialLink) * capacity);
+    if (links == NULL) {
+      debugf("Spatial hash link allocation failed\n");
+      return SPATIAL_NONE;
+    }
+    hash->links = links;
+    hash->linkCapacity = capacity;
+  }
+  return hash->linkCount++;
+}
+
+// Function to double the buckets once there are twice as many links, the links are kept and only rehashed
+static void spatial_grow(SpatialHash* hash) {
+  uint32_t count = (hash->bucketMask + 1) * 2;
+  int* buckets = (int*)mem_realloc(hash->buckets, sizeof(int) * count);
+  if (buckets == NULL) {
+    return;
+  }
+  hash->buckets = buckets;
+  hash->bucketMask = count - 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    buckets[i] = SPATIAL_NONE;
+  }
+  for (int id = 0; id < hash->itemCount; ++id) {
+    for (int link = hash->items[id].first; hash->items[id].live && link != SPATIAL_NONE; link = hash->links[link].itemNext) {
+      SpatialLink* l = &hash->links[link];
+      uint32_t bucket = spatial_bucket(hash, l->cx, l->cy);
+      l->next = buckets[bucket];
+      buckets[bucket] = link;
+    }
+  }
+}
+
+// Function to link an item into every cell of its box
+static void spatial_link(SpatialHash* hash, int id) {
+  SpatialItem* item = &hash->items[id];
+  spatial_cells(hash, &item->bounds, &item->cx0, &item->cy0, &item->cx1, &item->cy1);
+  item->first = SPATIAL_NONE;
+  for (int cy = item->cy0; cy <= item->cy1; ++cy) {
+    for (int cx = item->cx0; cx <= item->cx1; ++cx) {
+      int link = spatial_new_link(hash);
+      if (link == SPATIAL_NONE) {
+        return;
+      }
+      uint32_t bucket = spatial_bucket(hash, cx, cy);
+      SpatialLink* l = &hash->links[link];
+      l->cx = cx;
+      l->cy = cy;
+      l->item = id;
+      l->next = hash->buckets[bucket];
+      l->itemNext = item->first;
+      hash->buckets[bucket] = link;
+      item->first = link;
+    }
+  }
+}
+
+// Function to take an item out of its cells, the links go to the free list
+static void spatial_unlink(SpatialHash* hash, int id) {
+  SpatialItem* item = &hash->items[id];
+  int link = item->first;
+  while (link != SPATIAL_NONE) {
+    SpatialLink* l = &hash->links[link];
+    int* prev = &hash->buckets[spatial_bucket(hash, l->cx, l->cy)];
+    while (*prev != link) {
+      prev = &hash->links[*prev].next;
+    }
+    *prev = l->next;
+
+    int itemNext = l->itemNext;
+    l->next = hash->freeLink;
+    hash->freeLink = link;
+    link = itemNext;
+  }
+  item->first = SPATIAL_NONE;
+}
+
+// Function to add an item, returns its id for updates and removal
+int spatial_insert(SpatialHash* hash, Bounds bounds, void* data, int tag) {
+  if (hash->buckets == NULL) {
+    return SPATIAL_NONE;
+  }
+
+  int id;
+  if (hash->freeItem != SPATIAL_NONE) {
+    id = hash->freeItem;
+    hash->freeItem = hash->items[id].first;
+  } else {
+    if (hash->itemCount == hash->itemCapacity) {
+      MEM_TAG(MEM_TAG_SHAPES);
+      int capacity = hash->itemCapacity ? hash->itemCapacity * 2 : 64;
+      SpatialItem* items = (SpatialItem*)mem_realloc(hash->items, sizeof(SpatialItem) * capacity);
+      if (items == NULL) {
+        debugf("Spatial hash item allocation failed\n");
+        return SPATIAL_NONE;
+      }
+      hash->items = items;
+      hash->itemCapacity = capacity;
+    }
+    id = hash->itemCount++;
+  }
+
+  SpatialItem* item = &hash->items[id];
+  item->bounds = bounds;
+  item->data = data;
+  item->tag = tag;
+  item->mark = hash->mark;
+  item->live = true;
+  spatial_link(hash, id);
+  hash->count++;
+
+  // Live links, the free ones are not in any bucket
+  if (hash->linkCount > (int)(hash->bucketMask + 1) * 2 && hash->freeLink == SPATIAL_NONE) {
+    MEM_TAG(MEM_TAG_SHAPES);
+    spatial_grow(hash);
+  }
+  return id;
+}
+
+// Function to move an item, only relinked when its box covers other cells than before
+void spatial_update(SpatialHash* hash, int id, Bounds bounds) {
+  if (id < 0 || id >= hash->itemCount || !hash->items[id].live) {
+    return;
+  }
+  SpatialItem* item = &hash->items[id];
+  item->bounds = bounds;
+
+  int cx0, cy0, cx1, cy1;
+  spatial_cells(hash, &bounds, &cx0, &cy0, &cx1, &cy1);
+  if (cx0 == item->cx0 && cy0 == item->cy0 && cx1 == item->cx1 && cy1 == item->cy1) {
+    return;
+  }
+  spatial_unlink(hash, id);
+  spatial_link(hash, id);
+  hash->relinks++;
+}
+
+void spatial_remove(SpatialHash* hash, int id) {
+  if (id < 0 || id >= hash->itemCount || !hash->items[id].live) {
+    return;
+  }
+  spatial_unlink(hash, id);
+  SpatialItem* item = &hash->items[id];
+  item->live = false;
+  item->data = NULL;
+  item->cx0 = item->cy0 = 0;
+  item->cx1 = item->cy1 = -1;
+  item->first = hash->freeItem;
+  hash->freeItem = id;
+  hash->count--;
+}
+
+// Function to call visit once for every item linked into the cells of an area
+static void spatial_visit(SpatialHash* hash, const Bounds* area, void (*visit)(SpatialHash* hash, int id, void* arg), void* arg) {
+  int cx0, cy0, cx1, cy1;
+  spatial_cells(hash, area, &cx0, &cy0, &cx1, &cy1);
+  hash->mark++;
+  for (int cy = cy0; cy <= cy1; ++cy) {
+    for (int cx = cx0; cx <= cx1; ++cx) {
+      for (int link = hash->buckets[spatial_bucket(hash, cx, cy)]; link != SPATIAL_NONE; link = hash->links[link].next) {
+        const SpatialLink* l = &hash->links[link];
+        SpatialItem* item = &hash->items[l->item];
+        if (l->cx != cx || l->cy != cy || item->mark == hash->mark) {
+          continue;
+        }
+        item->mark = hash->mark;
+        visit(hash, l->item, arg);
+      }
+    }
+  }
+}
+
+typedef struct {
+  Bounds area;
+  Point center;
+  float radiusSq;
+  int* ids;
+  int max;
+  int found;
+} SpatialQuery;
+
+static void spatial_visit_rect(SpatialHash* hash, int id, void* arg) {
+  SpatialQuery* q = (SpatialQuery*)arg;
+  if (bounds_overlap(&hash->items[id].bounds, &q->area)) {
+    if (q->found < q->max) {
+      q->ids[q->found] = id;
+    }
+    q->found++;
+  }
+}
+
+static void spatial_visit_radius(SpatialHash* hash, int id, void* arg) {
+  SpatialQuery* q = (SpatialQuery*)arg;
+  if (bounds_distance_sq(&hash->items[id].bounds, q->center) <= q->radiusSq) {
+    if (q->found < q->max) {
+      q->ids[q->found] = id;
+    }
+    q->found++;
+  }
+}
+
+static void spatial_visit_nearest(SpatialHash* hash, int id, void* arg) {
+  SpatialQuery* q = (SpatialQuery*)arg;
+  float d = bounds_distance_sq(&hash->items[id].bounds, q->center);
+  if (d <= q->radiusSq) {
+    q->radiusSq = d;
+    q->found = id;
+  }
+}
+
+// Function to find the items whose box overlaps an area, returns how many, only the first max go to ids
+int spatial_query_rect(SpatialHash* hash, Bounds area, int* ids, int max) {
+  SpatialQuery q = { .area = area, .ids = ids, .max = max };
+  spatial_visit(hash, &area, spatial_visit_rect, &q);
+  return q.found;
+}
+
+// Function to find the items whose box is within radius of a point, returns how many, only the first max go to ids
+int spatial_query_radius(SpatialHash* hash, Point center, float radius, int* ids, int max) {
+  SpatialQuery q = { .center = center, .radiusSq = radius * radius, .ids = ids, .max = max };
+  Bounds area = bounds_around(center, radius, radius);
+  spatial_visit(hash, &area, spatial_visit_radius, &q);
+  return q.found;
+}
+
+// Function to pick the item closest to a point within radius, like the control point under a cursor, SPATIAL_NONE for none
+int spatial_nearest(SpatialHash* hash, Point p, float radius) {
+  SpatialQuery q = { .center = p, .radiusSq = radius * radius, .found = SPATIAL_NONE };
+  Bounds area = bounds_around(p, radius, radius);
+  spatial_visit(hash, &area, spatial_visit_nearest, &q);
+  return q.found;
+}
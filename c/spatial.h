@@ -0,0 +1,115 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include <libdragon.h>
+#include "point.h"
+
+#define SPATIAL_CELL 32.0f // Default cell size in pixels, about the size of a shape
+#define SPATIAL_BUCKETS 1024 // Default starting bucket count, a power of two
+#define SPATIAL_NONE (-1)
+
+/*
+  Uniform spatial hash for hit testing, like the shape under a cursor, the
+  control point nearest to it or which shapes touch which.
+
+  Every item is an axis aligned box, a point for vertices, with a data
+  pointer and a tag for the caller, like a Shape and the index of one of its
+  points. An item is linked into every cell of the grid its box covers, and
+  the cells are hashed into buckets so the grid has no bounds, their count
+  doubles as items are added to keep the lists short. spatial_update only
+  relinks an item when it moves into other cells, a shape moving a few
+  pixels a frame mostly just stores its new box.
+
+  Queries visit the cells of the area asked for and return every item once.
+
+  Items much larger than a cell are linked into many cells, pick the cell
+  size close to the size of the typical item.
+*/
+
+typedef struct {
+  float x0, y0; // Top left
+  float x1, y1; // Bottom right
+} Bounds;
+
+typedef struct {
+  Bounds bounds;
+  void* data;
+  int tag;
+  int cx0, cy0, cx1, cy1; // Cells it is linked into
+  int first; // First link, SPATIAL_NONE once removed
+  uint32_t mark; // Query that last returned it
+  bool live;
+} SpatialItem;
+
+// One item in one cell, in the list of its bucket and in the list of its item
+typedef struct {
+  int cx, cy;
+  int item;
+  int next;
+  int itemNext;
+} SpatialLink;
+
+typedef struct {
+  float cell;
+  float invCell;
+  int* buckets;
+  uint32_t bucketMask;
+  SpatialItem* items;
+  int itemCount; // Used slots, live and removed
+  int itemCapacity;
+  int freeItem; // Removed slots to reuse, chained through first
+  SpatialLink* links;
+  int linkCount;
+  int linkCapacity;
+  int freeLink;
+  int count; // Live items
+  uint32_t mark;
+  uint32_t relinks; // Updates that moved an item into other cells, since spatial_init
+} SpatialHash;
+
+// Function to get the box of some points, an empty one for none
+static inline Bounds bounds_of_points(const Point* points, size_t count) {
+  Bounds b = { INFINITY, INFINITY, -INFINITY, -INFINITY };
+  for (size_t i = 0; i < count; ++i) {
+    b.x0 = fminf(b.x0, points[i].x);
+    b.y0 = fminf(b.y0, points[i].y);
+    b.x1 = fmaxf(b.x1, points[i].x);
+    b.y1 = fmaxf(b.y1, points[i].y);
+  }
+  return b;
+}
+
+static inline Bounds bounds_around(Point p, float rx, float ry) {
+  return (Bounds){ p.x - rx, p.y - ry, p.x + rx, p.y + ry };
+}
+
+static inline Bounds bounds_union(Bounds a, Bounds b) {
+  return (Bounds){ fminf(a.x0, b.x0), fminf(a.y0, b.y0), fmaxf(a.x1, b.x1), fmaxf(a.y1, b.y1) };
+}
+
+static inline bool bounds_overlap(const Bounds* a, const Bounds* b) {
+  return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+// Function to get the squared distance from a point to a box, 0 inside it
+static inline float bounds_distance_sq(const Bounds* b, Point p) {
+  float dx = fmaxf(fmaxf(b->x0 - p.x, p.x - b->x1), 0.0f);
+  float dy = fmaxf(fmaxf(b->y0 - p.y, p.y - b->y1), 0.0f);
+  return dx * dx + dy * dy;
+}
+
+void spatial_init(SpatialHash* hash, float cell, uint32_t buckets);
+void spatial_free(SpatialHash* hash);
+void spatial_clear(SpatialHash* hash);
+int spatial_insert(SpatialHash* hash, Bounds bounds, void* data, int tag);
+void spatial_update(SpatialHash* hash, int id, Bounds bounds);
+void spatial_remove(SpatialHash* hash, int id);
+int spatial_query_rect(SpatialHash* hash, Bounds area, int* ids, int max);
+int spatial_query_radius(SpatialHash* hash, Point center, float radius, int* ids, int max);
+int spatial_nearest(SpatialHash* hash, Point p, float radius);
+
+static inline const SpatialItem* spatial_item(const SpatialHash* hash, int id) {
+  return &hash->items[id];
+}
+
+#endif // SPATIAL_H
@@ -23,6 +23,9 @@ static rspq_profile_data_t profile_data;
 // Initialize libdragon
 void setup() {
 
+  // Before anything is allocated
+  mem_init();
+
   debug_init_isviewer();
   debug_init_usblog();
     
@@ -56,26 +59,31 @@ void setup() {
 
   // Initialize acummulators
   accums_init();
+  prof_init();
+  lod_init();
+  budget_init();
+  fillrate_init();
 
-  // Calculated available RAM
-  mem_info = mallinfo(); // Setting this every frame leads to memory leak
-  ldRAM = 916; // Precalculated RAM used by Libdragon
-  totalRAM = (get_memory_size() / 1024) - ldRAM; // Either 3180 or 7276
+  // Available RAM
+  totalRAM = (get_memory_size() / 1024); // Either 4096 or 8192
 
 }
 
 // Main function with rendering loop
 int main() {
   setup();
-  bootTime = get_ticks_ms();
 
   for (;;) {
 
+    prof_begin(ZONE_FRAME);
+
     display_set_fps_limit(0); // Disable limiter
 
-    firstTime = get_ticks_ms();// set loop time
+    prof_begin(ZONE_SYNC);
+    surface_t* fb = display_get();
+    prof_end(ZONE_SYNC);
 
-    rdpq_attach(display_get(), &disp);
+    rdpq_attach(fb, &disp);
     rdpq_clear(GREY);
     rdpq_clear_z(0xFFFC);
 
@@ -84,23 +92,17 @@ int main() {
     rdpq_mode_combiner(RDPQ_COMBINER_FLAT);
     rdpq_mode_blender(0);
 
-    dispTime = get_ticks_ms() - firstTime; // set display time
-    secondTime = get_ticks_ms();
-
     joypad_poll();
     joypad_inputs_t input = joypad_get_inputs(JOYPAD_PORT_1);
     joypad_buttons_t keys = joypad_get_buttons_pressed(JOYPAD_PORT_1);
     joypad_buttons_t keysDown = joypad_get_buttons_held(JOYPAD_PORT_1);
 
-    // RAM used from RDPQ Demo
-    ramUsed = mem_info.uordblks - (size_t) (((display_get_width() * display_get_height()) * 2) - ((unsigned int) HEAP_START_ADDR - 0x80000000) - 0x10000);
-    ramUsed = (ramUsed / 1024) - ldRAM;
+    // RAM allocated by this program, tracked by memtrack.c
+    ramUsed = memTotal.live / 1024;
 
     stickX = (float)input.stick_x;
     stickY = (float)input.stick_y;
 
-    jpTime = get_ticks_ms() - secondTime; // set input time
-
 //=========== ~ UPDATE ~ ==============//
 
 //=========== ~ CONTROLS ~ ==============//
@@ -110,21 +112,24 @@ int main() {
     uint32_t frameLimit = 59;
 
     if(frameCounter > frameLimit){
-      drawTime = ((get_ticks_ms() - secondTime) + dispTime + jpTime); // CPU time after draw and transform
+      // CPU time is the whole frame minus waiting on the display
+      prof_update_stats();
+      mem_update_stats();
+      cpuTime = prof_ticks_to_ms(prof_get_stats(ZONE_FRAME)->avg - prof_get_stats(ZONE_SYNC)->avg);
       frameCounter = 0;
     }
     rdpq_text_printf(NULL, FONT_BUILTIN_DEBUG_MONO, 20, 20,
       "Verts: %u\n"
       "Tris: %u\n"
       "FPS: %.2f\n"
-      "CPU Time: %lldms\n"
+      "CPU Time: %.2fms\n"
       "RAM:\n"
       " Used/Free:\n"
       " %dKB/%dKB\n",
       vertCount,
       triCount,
       display_get_fps(),
-      drawTime,
+      cpuTime,
       ramUsed, totalRAM
     );
     
@@ -133,7 +138,9 @@ int main() {
 
     frameCounter++;
     
+    prof_begin(ZONE_SYNC);
     rdpq_detach_show();
+    prof_end(ZONE_SYNC);
 
 #if defined(RSPQ_PROFILE) && RSPQ_PROFILE
     rspq_profile_next_frame();
@@ -147,6 +154,13 @@ int main() {
     rspq_profile_get_data(&profile_data);
 #endif // RSPQ_PROFILE
 
+    prof_end(ZONE_FRAME);
+    prof_frame_end();
+    mem_frame_end();
+    lod_frame_end();
+    budget_frame_end();
+    fillrate_frame_end();
+
   }
 
   //=========== ~ CLEAN UP ~ =============//
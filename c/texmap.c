@@ -0,0 +1,36 @@
+#include <libdragon.h>
+#include "texmap.h"
+
+TexMap texmap_planar(sprite_t* sprite, Point origin, float scale) {
+  return (TexMap){ .mode = TEXMAP_PLANAR, .sprite = sprite, .origin = origin, .scale = scale };
+}
+
+TexMap texmap_bounds(sprite_t* sprite) {
+  return (TexMap){ .mode = TEXMAP_BOUNDS, .sprite = sprite, .scale = 1.0f };
+}
+
+TexMap texmap_path(sprite_t* sprite, float scale) {
+  return (TexMap){ .mode = TEXMAP_PATH, .sprite = sprite, .scale = scale };
+}
+
+/*
+  Function to write the s, t and inverse w of TRIFMT_TEX for a vertex at x, y.
+  bounds is the min x, min y, max x, max y of the draw call, path the distance
+  along it and 0 or 1 across it, NULL when the shape has none.
+*/
+void texmap_uv(const TexMap* map, const float* bounds, const float* path, float x, float y, float* st) {
+  float w = map->sprite ? map->sprite->width : 1.0f;
+  float h = map->sprite ? map->sprite->height : 1.0f;
+
+  if (map->mode == TEXMAP_BOUNDS && bounds && bounds[2] > bounds[0] && bounds[3] > bounds[1]) {
+    st[0] = (x - bounds[0]) / (bounds[2] - bounds[0]) * w;
+    st[1] = (y - bounds[1]) / (bounds[3] - bounds[1]) * h;
+  } else if (map->mode == TEXMAP_PATH && path) {
+    st[0] = path[0] * map->scale;
+    st[1] = path[1] * h;
+  } else {
+    st[0] = (x - map->origin.x) * map->scale;
+    st[1] = (y - map->origin.y) * map->scale;
+  }
+  st[2] = 1.0f;
+}
@@ -0,0 +1,38 @@
+#ifndef TEXMAP_H
+#define TEXMAP_H
+
+#include <libdragon.h>
+#include "point.h"
+
+/*
+  Texture coordinates for the tessellators in render.c.
+
+  While a map is set with set_render_texture, every vertex the tessellators
+  emit gets an s, t in texels from it and triangles go out as TRIFMT_TEX,
+  or TRIFMT_SHADE_TEX under a gradient. The sprite is uploaded to TILE0
+  once for the whole batch, repeating in both directions.
+
+  - Planar: s, t follow the screen, (x, y) - origin times scale
+  - Bounds: the bounding box of each draw call is stretched over the sprite
+  - Path: s runs along strips and curves by arc length times scale, t goes
+    across them over the sprite height. Shapes without a path are planar
+*/
+typedef enum {
+  TEXMAP_PLANAR,
+  TEXMAP_BOUNDS,
+  TEXMAP_PATH,
+} TEXMAP_MODES;
+
+typedef struct {
+  int mode;
+  sprite_t* sprite;
+  Point origin; // Planar, and path for shapes without one
+  float scale; // Texels per pixel
+} TexMap;
+
+TexMap texmap_planar(sprite_t* sprite, Point origin, float scale);
+TexMap texmap_bounds(sprite_t* sprite);
+TexMap texmap_path(sprite_t* sprite, float scale);
+void texmap_uv(const TexMap* map, const float* bounds, const float* path, float x, float y, float* st);
+
+#endif // TEXMAP_H
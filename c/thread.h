@@ -0,0 +1,44 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <libdragon.h>
+
+/*
+  Threading for the host job system, see host/jobs.h. The console draws from
+  one thread and everything here compiles away there.
+
+  Per frame state the draw calls write, like the counters and the current
+  scope of a cleanup macro, is THREAD_LOCAL so every worker tessellates into
+  its own copy, the job system adds them up once the jobs are done. State
+  shared across threads, like the heap bookkeeping, is changed under a
+  THREAD_LOCK for the rest of the scope.
+*/
+#ifdef N64_HOST
+
+#include <pthread.h>
+
+#define THREAD_LOCAL _Thread_local
+#define THREAD_MUTEX(name) pthread_mutex_t name = PTHREAD_MUTEX_INITIALIZER
+
+static inline pthread_mutex_t* thread_lock_begin(pthread_mutex_t* mutex) {
+  pthread_mutex_lock(mutex);
+  return mutex;
+}
+
+static inline void thread_lock_end(pthread_mutex_t** mutex) {
+  pthread_mutex_unlock(*mutex);
+}
+
+// Holds the mutex for the rest of the enclosing block
+#define THREAD_LOCK(name) \
+  pthread_mutex_t* __attribute__((cleanup(thread_lock_end), unused)) _thread_lock = thread_lock_begin(&name)
+
+#else
+
+#define THREAD_LOCAL
+#define THREAD_MUTEX(name) int name
+#define THREAD_LOCK(name) (void)name
+
+#endif // N64_HOST
+
+#endif // THREAD_H
@@ -119,7 +119,7 @@ float apply_deadzone(float value) {
 
 // Function to add a vertex to a vertex array
 void add_vertex(float** vertices, int* vertex_count, float x, float y) {
-  float* new_vertices = (float*)realloc(*vertices, sizeof(float) * (*vertex_count + 2));
+  float* new_vertices = (float*)mem_realloc(*vertices, sizeof(float) * (*vertex_count + 2));
   if (new_vertices == NULL) {
     debugf("Vertex reallocation failed\n");
     return;
@@ -133,7 +133,7 @@ void add_vertex(float** vertices, int* vertex_count, float x, float y) {
 // Function to add an index to the index array
 void add_index(int** indices, int* index_count, int index) {
   int new_size = *index_count + 1;
-  int* new_indices = (int*)realloc(*indices, sizeof(int) * new_size);
+  int* new_indices = (int*)mem_realloc(*indices, sizeof(int) * new_size);
   if (new_indices == NULL) {
     debugf("Index reallocation failed\n");
     return;
@@ -147,7 +147,7 @@ void add_index(int** indices, int* index_count, int index) {
 // Function to create triangle fan indices
 int* create_triangle_fan_indices(int* indices, int segments, int* index_count) {
   *index_count = (segments + 1) * 3 - 3; // Number of indices needed
-  indices = (int*)malloc_uncached(*index_count * sizeof(int));
+  indices = (int*)mem_malloc_uncached(*index_count * sizeof(int));
 
   int center_idx = 0;
   for (int i = 1; i < segments; ++i) {
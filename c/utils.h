@@ -5,6 +5,8 @@
 #include <malloc.h>
 #include <math.h>
 #include "point.h"
+#include "memtrack.h"
+#include "thread.h"
 
 
 // Define whether to use RDPQ Validate
@@ -18,11 +20,11 @@ extern const float TWO_PI;
 extern const float radiansToDegrees;
 
 // Accumulators for UI
-extern int triCount;
-extern int vertCount;
-extern int currTris;
-extern int fillTris;
-extern int currVerts;
+extern THREAD_LOCAL int triCount;
+extern THREAD_LOCAL int vertCount;
+extern THREAD_LOCAL int currTris;
+extern THREAD_LOCAL int fillTris;
+extern THREAD_LOCAL int currVerts;
 
 // Colors
 extern const color_t RED;
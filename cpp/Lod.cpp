@@ -0,0 +1,102 @@
+#include <libdragon.h>
+#include <algorithm>
+#include <cmath>
+#include "Lod.h"
+#include "Utils.h"
+
+float Lod::quality = 1.0f;
+int Lod::shapes = 0;
+int Lod::tris = 0;
+int Lod::trisSaved = 0;
+
+void Lod::set_quality(float q) {
+  quality = std::min(std::max(q, 0.25f), 4.0f);
+}
+
+// Function to keep a count steady in a state, going up right away and down with some margin
+int Lod::hold(int wanted, LodState* state) {
+  if (!state) {
+    return wanted;
+  }
+  if (state->segments == 0 || wanted > state->segments || float(wanted) < float(state->segments) * (1.0f - HYSTERESIS)) {
+    state->segments = wanted;
+  }
+  return state->segments;
+}
+
+// Function to get the segments of an ellipse, CULL when too small to see and QUAD when a quad will do
+int Lod::ellipse_segments(float rx, float ry, LodState* state) {
+  float radius = std::max(std::fabs(rx), std::fabs(ry));
+  float size = radius * 2.0f;
+  if (size <= CULL_SIZE) {
+    return CULL;
+  }
+  if (size < QUAD_SIZE) {
+    return QUAD;
+  }
+
+  // The larger radius bounds the chord error all around the ellipse
+  float error = ERROR / quality;
+  int segments = MIN_SEGMENTS;
+  if (radius > error) {
+    float step = 2.0f * std::acos(1.0f - error / radius);
+    segments = std::min(std::max(int(std::ceil(TWO_PI / step)), MIN_SEGMENTS), MAX_SEGMENTS);
+  }
+  return hold(segments, state);
+}
+
+// Function to get the segments the fixed area rules picked before the policy, kept to report the savings
+int Lod::fixed_ellipse_segments(float rx, float lod) {
+  float area = rx * 2.0f;
+  if (area <= 0.9f) {
+    return CULL;
+  }
+  if (area < 2.9f) {
+    return QUAD;
+  }
+  int segments = int((area < 3.0f) ? 3.0f : area) / ((area >= 9.9f) ? 2 : 3);
+  segments = std::max(segments, 6);
+  if (area > 9.9f) {
+    segments = (segments > 200 || lod > 2.0f) ? 200 : segments;
+  }
+  return segments;
+}
+
+// Raw segments of a cubic bezier, Wang's formula: the second differences bound how far it bends from a chord
+int Lod::bezier_count(const Point& p0, const Point& p1, const Point& p2, const Point& p3) {
+  Point a = p0 - p1 * 2.0f + p2;
+  Point b = p1 - p2 * 2.0f + p3;
+  float bend = std::max(a.magnitude(), b.magnitude());
+  int segments = int(std::ceil(std::sqrt(0.75f * bend * quality / ERROR)));
+  return std::max(segments, 1);
+}
+
+int Lod::cap(int segments, int maxSegments) {
+  return std::min(segments, maxSegments > 0 ? maxSegments : MAX_SEGMENTS);
+}
+
+// Function to get the segments of a cubic bezier, at most maxSegments unless it is 0
+int Lod::bezier_segments(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int maxSegments, LodState* state) {
+  return cap(hold(bezier_count(p0, p1, p2, p3), state), maxSegments);
+}
+
+// Function to get one count for two beziers drawn point to point, the one bending more decides
+int Lod::bezier_pair_segments(const Point& p0, const Point& p1, const Point& p2, const Point& p3,
+                              const Point& q0, const Point& q1, const Point& q2, const Point& q3,
+                              int maxSegments, LodState* state) {
+  int segments = std::max(bezier_count(p0, p1, p2, p3), bezier_count(q0, q1, q2, q3));
+  return cap(hold(segments, state), maxSegments);
+}
+
+// Function to count a shape drawn through the policy against what the fixed counts would have drawn
+void Lod::count(int fixedTris, int drawnTris) {
+  shapes++;
+  tris += drawnTris;
+  trisSaved += fixedTris - drawnTris;
+}
+
+void Lod::frame_end() {
+  shapes = 0;
+  tris = 0;
+  trisSaved = 0;
+}
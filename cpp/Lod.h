@@ -0,0 +1,54 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <libdragon.h>
+#include "Point.h"
+
+/*
+  Screen size driven level of detail, the same policy as c/lod.h.
+
+  Segments are added until no chord is further than ERROR / quality pixels
+  from the curve: ellipses use their larger radius, beziers the largest
+  second difference of their control points. Passing a LodState keeps the
+  count steady between frames, it goes up right away but only comes down
+  once the wanted count is HYSTERESIS lower.
+*/
+struct LodState {
+    int segments = 0; // Count in use, 0 before the first draw
+};
+
+class Lod {
+public:
+    static constexpr float ERROR = 0.5f;
+    static constexpr float HYSTERESIS = 0.2f;
+    static constexpr float CULL_SIZE = 0.9f;
+    static constexpr float QUAD_SIZE = 2.9f;
+    static constexpr int MIN_SEGMENTS = 5;
+    static constexpr int MAX_SEGMENTS = 200;
+
+    // Ellipse segment counts with a special meaning
+    static constexpr int CULL = 0;
+    static constexpr int QUAD = 2;
+
+    static float quality; // Global quality knob, higher draws more segments
+    static int shapes; // This frame
+    static int tris;
+    static int trisSaved; // Against the fixed counts used before the policy
+
+    static void set_quality(float q);
+    static int ellipse_segments(float rx, float ry, LodState* state = nullptr);
+    static int fixed_ellipse_segments(float rx, float lod);
+    static int bezier_segments(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int maxSegments, LodState* state = nullptr);
+    static int bezier_pair_segments(const Point& p0, const Point& p1, const Point& p2, const Point& p3,
+                                    const Point& q0, const Point& q1, const Point& q2, const Point& q3,
+                                    int maxSegments, LodState* state = nullptr);
+    static void count(int fixedTris, int drawnTris);
+    static void frame_end();
+
+private:
+    static int hold(int wanted, LodState* state);
+    static int bezier_count(const Point& p0, const Point& p1, const Point& p2, const Point& p3);
+    static int cap(int segments, int maxSegments);
+};
+
+#endif // LOD_H
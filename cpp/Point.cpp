@@ -1,6 +1,7 @@
 #include <libdragon.h>
 #include "Point.h"
 #include "Utils.h"
+#include "../c/fixed.h"
 
 // Point, the API's internal Vector2f
 
@@ -26,26 +27,51 @@ Point Point::sub(const Point& v1, const Point& v2) {
 
 // Computes the angle (heading) of the vector from the origin to the current Point, in radians
 float Point::heading() const {
+#if POINT_FIXED
+    return fixed_angle_to_float(fixed_atan2(fixed_from_float(y), fixed_from_float(x)));
+#else
     return fm_atan2f(y, x);
+#endif
 }
 
 // Creates a Point representing a vector with unit length in the direction of the given angle
 Point Point::from_angle(float angle) {
+#if POINT_FIXED
+    int32_t a = fixed_angle_from_float(angle);
+    return Point(fixed_to_float(fixed_cos(a)), fixed_to_float(fixed_sin(a)));
+#else
     return Point(fm_cosf(angle), fm_sinf(angle));
+#endif
 }
 
 // Calculates the magnitude (length) of the vector represented by the current Point
 float Point::magnitude() const {
+#if POINT_FIXED
+    return fixed_to_float(fixed_length(fixed_from_float(x), fixed_from_float(y)));
+#else
     return sqrtf(x * x + y * y);
+#endif
 }
 
 // Normalizes the vector represented by the current Point
 void Point::normalize() {
+#if POINT_FIXED
+    fixed_t fx = fixed_from_float(x);
+    fixed_t fy = fixed_from_float(y);
+    fixed_t length = fixed_length(fx, fy);
+    if (length != 0) {
+        // One division for both, x and y are at most the length so the products fit 64 bits
+        int64_t inverse = ((int64_t)1 << 47) / length;
+        x = fixed_to_float((fixed_t)((fx * inverse) >> 31));
+        y = fixed_to_float((fixed_t)((fy * inverse) >> 31));
+    }
+#else
     float mag = magnitude();
     if (mag != 0) {
         x /= mag;
         y /= mag;
     }
+#endif
 }
 
 
@@ -81,6 +107,15 @@ Point Point::translate(Point p, float dx, float dy) {
 
 // Rotates a Point around a given center by a given angle
 void Point::rotate(Point center, float angle) {
+#if POINT_FIXED
+    int32_t a = fixed_angle_from_float(angle);
+    fixed_t fs = fixed_sin(a);
+    fixed_t fc = fixed_cos(a);
+    fixed_t fx = fixed_from_float(x - center.x);
+    fixed_t fy = fixed_from_float(y - center.y);
+    x = fixed_to_float(fixed_mul(fx, fc) - fixed_mul(fy, fs)) + center.x;
+    y = fixed_to_float(fixed_mul(fx, fs) + fixed_mul(fy, fc)) + center.y;
+#else
     float s = fm_sinf(angle);
     float c = fm_cosf(angle);
         
@@ -95,13 +130,21 @@ void Point::rotate(Point center, float angle) {
     // Translate point back
     x = xrot + center.x;
     y = yrot + center.y;;
+#endif
 }
 
 // Transforms a Point by translating it along a direction given by an angle and distance
 Point Point::transform(const Point& point, float angle, float width) {
     Point transformed;
+#if POINT_FIXED
+    int32_t a = fixed_angle_from_float(angle);
+    fixed_t w = fixed_from_float(width);
+    transformed.x = point.x + fixed_to_float(fixed_mul(fixed_cos(a), w));
+    transformed.y = point.y + fixed_to_float(fixed_mul(fixed_sin(a), w));
+#else
     transformed.x = point.x + fm_cosf(angle) * width;
     transformed.y = point.y + fm_sinf(angle) * width;
+#endif
     return transformed;
 }
 
@@ -23,8 +23,9 @@ public:
     }
 
     Point normalized() const {
-        float length = std::sqrt(x * x + y * y);
-        return {x / length, y / length};
+        Point n = *this;
+        n.normalize();
+        return n;
     }
 
     void add(const Point& v);
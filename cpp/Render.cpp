@@ -52,17 +52,11 @@ std::vector<Point> Render::get_ellipse_points(Point center, float rx, float ry,
 // Texture test
 void Render::draw_triangle(float* v1, float* v2, float* v3) {
 
-  //const rdpq_trifmt_t trifmt = (rdpq_trifmt_t){
-  //  .pos_offset = 0,
-  //  .tex_offset = 3,
-  //  .tex_tile = TILE0,
-  //};
+  // Planar texture coordinates, one texel per pixel from the screen origin like TEXMAP_PLANAR in the C version
+  float A[] = {v1[0],v1[1],v1[0],v1[1],1};
+  float B[] = {v2[0],v2[1],v2[0],v2[1],1};
+  float C[] = {v3[0],v3[1],v3[0],v3[1],1};
 
-  float A[] = {v1[0],v1[1],0,0,1};
-  float B[] = {v2[0],v2[1],0,0,1};
-  float C[] = {v3[0],v3[1],0,0,1};
-
-        
   rdpq_triangle(&TRIFMT_TEX, A, B, C);
 
 }
@@ -115,7 +109,7 @@ void Render::draw_fan(const std::vector<Point>& points, const Point center) {
 }
 
 // Draw a uniformed closed shape of any number of vertices as a triangle fan
-void Render::draw_ellipse(float cx, float cy, float rx, float ry, float angle, float lod) {
+void Render::draw_ellipse(float cx, float cy, float rx, float ry, float angle, float lod, LodState* lodState) {
 
   /*
     Segments directly related to the number of triangles to be drawn.
@@ -145,37 +139,22 @@ void Render::draw_ellipse(float cx, float cy, float rx, float ry, float angle, f
 
   */
 
-  int base_segments = 100; // Base number of segments for the highest LOD
-  int segments = std::max(static_cast<int>(base_segments * lod), 3);
-
-  // Area thresholds
-  float area = rx * 2.0f;
-  float offset = (float)area * 0.3f;
+  // Segments come from the LOD policy, lod > 2 still asks for the most detail
+  int segments = lod > 2.0f ? Lod::MAX_SEGMENTS : Lod::ellipse_segments(rx, ry, lodState);
+  int fixedSegments = Lod::fixed_ellipse_segments(rx, lod);
 
-  //debugf("Area %.0f\n", area);
-
-  if (area <= 0.9f) {
+  if (segments == Lod::CULL) {
     // If only drawing subpixels, exit
-    debugf("Do you really need subpixels?\n");
+    Lod::count(fixedSegments, 0);
     return;
-  } else if (area >= 1.0f && area < 2.9f) {
+  } else if (segments == Lod::QUAD) {
     // If only drawing ~4 pixels or less, just draw a quad to save triangles
+    float offset = std::max(rx, ry) * 2.0f * 0.3f;
+    Lod::count(fixedSegments, 2);
     draw_line(cx - offset, cy - offset, cx + offset, cy + offset, angle, 1.0f);
     return;
-  } else {
-    // Default segments calculation for areas > 2.9f
-    segments = (int)((area < 3.0f) ? 3.0f : area) / ((area >= 9.9f) ? 2 : 3);
-
-    // Enforce a minimum of 6 segments
-    segments = segments < 6 ? 6 : segments;
-
-    // Enforce a maximum of 200 segments for high detail levels
-    if (area > 9.9f) {
-      segments = (segments > 200 || lod > 2.0f) ? 200 : segments;
-    }
-
-    // debugf("Segments %u\n", segments);
   }
+  Lod::count(fixedSegments, segments);
 
   // Calculate angles for position
   float theta = 2.0f * M_PI / float(segments);
@@ -292,7 +271,12 @@ void Render::draw_line(float x1, float y1, float x2, float y2, float angle, floa
 
 
 // Function to draw a Bézier curve as a triangle strip with a given thickness
-void Render::draw_bezier_curve(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments, float angle, float thickness) {
+void Render::draw_bezier_curve(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments, float angle, float thickness, LodState* lodState) {
+  // Segments come from the LOD policy, the argument is the most that will be drawn
+  int fixedSegments = segments;
+  segments = Lod::bezier_segments(p0, p1, p2, p3, segments, lodState);
+  Lod::count(2 * (fixedSegments > 0 ? fixedSegments : segments), 2 * segments);
+
   std::vector<Point> curvePoints;
   std::vector<float> vertices;
   std::vector<int> indices;
@@ -394,7 +378,12 @@ void Render::fill_between_beziers(const std::vector<Point>& curve1, const std::v
 // Function to draw a filled shape between 2 Bézier curves
 void Render::draw_filled_beziers(const Point& p0, const Point& p1, const Point& p2, const Point& p3, 
                                const Point& q0, const Point& q1, const Point& q2, const Point& q3, 
-                               int segments) {
+                               int segments, LodState* lodState) {
+    // Segments come from the LOD policy, the argument is the most that will be drawn
+    int fixedSegments = segments;
+    segments = Lod::bezier_pair_segments(p0, p1, p2, p3, q0, q1, q2, q3, segments, lodState);
+    Lod::count(2 * (fixedSegments > 0 ? fixedSegments : segments), 2 * segments);
+
     std::vector<Point> upper_curve;
     std::vector<Point> lower_curve;
 
@@ -503,7 +492,12 @@ void Render::triangulate_polygon(const std::vector<Point>& polygon, std::vector<
 }
 
 // Function to draw a Bézier curve using line segments, then fill shape with triangles. Note the base will always be a straight line.
-void Render::draw_filled_bezier_shape(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments) {
+void Render::draw_filled_bezier_shape(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments, LodState* lodState) {
+  // Segments come from the LOD policy, the argument is the most that will be drawn
+  int fixedSegments = segments;
+  segments = Lod::bezier_segments(p0, p1, p2, p3, segments, lodState);
+  Lod::count(fixedSegments > 0 ? fixedSegments : segments, segments);
+
   std::vector<Point> curvePoints;
 
   // Compute Bézier curve points
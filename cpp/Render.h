@@ -5,6 +5,7 @@
 #include "Point.h"
 #include "Shape.h"
 #include "Utils.h"
+#include "Lod.h"
 
 class Render{
 public:
@@ -18,16 +19,16 @@ public:
     void draw_triangle(float* v1, float* v2, float* v3);
     void draw_indexed_triangles(float* vertices, int vertex_count, int* indices, int index_count);
     void draw_fan(const std::vector<Point>& points, const Point center);
-    void draw_ellipse(float cx, float cy, float rx, float ry, float angle, float lod);
+    void draw_ellipse(float cx, float cy, float rx, float ry, float angle, float lod, LodState* lodState = nullptr);
     void draw_line(float x1, float y1, float x2, float y2, float angle, float thickness);
-    void draw_bezier_curve(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments, float angle, float thickness);
+    void draw_bezier_curve(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments, float angle, float thickness, LodState* lodState = nullptr);
     void fill_between_beziers(const std::vector<Point>& curve1, const std::vector<Point>& curve2);
     void draw_filled_beziers(const Point& p0, const Point& p1, const Point& p2, const Point& p3, 
                                const Point& q0, const Point& q1, const Point& q2, const Point& q3, 
-                               int segments);
+                               int segments, LodState* lodState = nullptr);
     bool is_ear(const std::vector<Point>& polygon, int u, int v, int w, const std::vector<int>& V);
     void triangulate_polygon(const std::vector<Point>& polygon, std::vector<Point>& triangles);
-    void draw_filled_bezier_shape(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments);
+    void draw_filled_bezier_shape(const Point& p0, const Point& p1, const Point& p2, const Point& p3, int segments, LodState* lodState = nullptr);
     void draw_fan_transform(const std::vector<Point>& points, float angle, int segments, float rx, float ry);
     void fill_edge_ellipse_to_line(const std::vector<Point>& currentPoints, int segments, float scale);
 };
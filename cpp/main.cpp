@@ -38,6 +38,12 @@ int resetCurve = 0;
 std::size_t controlPoint = 0;
 std::vector<Point> bezierPoints;
 std::vector<Point> basePoints;
+
+// Hold the LOD segment counts of shapes that change size between frames
+LodState ellipseLod;
+LodState curveLod;
+LodState fillLod;
+LodState baseLod;
 int bezierMode = 0;
 
 
@@ -160,7 +166,7 @@ void circle_update(){
   currShapeColor = currShape->get_shape_fill_color();
   renderer.set_fill_color(currShapeColor);
   currShape->set_points(renderer.get_ellipse_points(currCenter, currRadiusX, currRadiusY, currSegments));
-  renderer.draw_ellipse(currCenter.x, currCenter.y, currRadiusX, currRadiusY, currAngle, currLOD);
+  renderer.draw_ellipse(currCenter.x, currCenter.y, currRadiusX, currRadiusY, currAngle, currLOD, &ellipseLod);
   currPoints.clear();
   currPoints = currShape->get_points();
 }
@@ -274,14 +280,16 @@ void bezier_update(){
     pointA, pointB, pointC, pointD,
     currSegments,
     currAngle,
-    currThickness
+    currThickness,
+    &curveLod
   );
 
   renderer.set_fill_color(BLUE);
   renderer.draw_filled_beziers(
     bezierPoints[0], bezierPoints[1], bezierPoints[2], bezierPoints[3],
     basePoints[0], basePoints[1], basePoints[2], basePoints[3],
-    currSegments
+    currSegments,
+    &fillLod
   );
 
   renderer.set_fill_color(curve2->get_shape_fill_color());
@@ -289,7 +297,8 @@ void bezier_update(){
     resetA, resetB, resetC, resetD,
     currSegments,
     0.0f,
-    currThickness
+    currThickness,
+    &baseLod
   );
 
 
@@ -802,6 +811,7 @@ int main() {
     }
 
     // Reset acummulators
+    Lod::frame_end();
     triCount = 0;
     vertCount = 0;
     currTris = 0;
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+Compare two runs of the benchmark suite (c/ld_benchmark.c).
+
+Takes the debug logs or CSV files of a baseline and a new run, only the
+`bench,` lines are read. Prints every case whose numbers changed and exits
+with 1 when any case regressed:
+
+  - cpu_avg_us grew by more than --cpu percent (timing is noisy)
+  - triangles, vertices, command bytes, allocations or fill cost grew at all
+
+Usage: bench_compare.py <baseline> <current> [--cpu 10]
+"""
+
+import argparse
+import sys
+
+# Counted metrics, any increase is a regression
+COUNTED = ("tris", "verts", "rspq_bytes", "rdp_bytes", "allocs", "alloc_bytes", "fill_cost")
+
+
+def read_bench(path):
+    header = None
+    rows = {}
+    with open(path) as fp:
+        for line in fp:
+            line = line.strip()
+            if not line.startswith("bench,"):
+                continue
+            fields = line.split(",")[1:]
+            if fields[0] == "case":
+                header = fields
+                continue
+            if header is None or len(fields) != len(header):
+                continue
+            row = dict(zip(header, fields))
+            key = (row["case"], row["param"], row["value"])
+            rows[key] = {k: float(v) for k, v in row.items() if k not in ("case", "param", "value")}
+    if not rows:
+        sys.exit("No bench, lines in %s" % path)
+    return rows
+
+
+def change(old, new):
+    if old == 0:
+        return 0.0 if new == 0 else float("inf")
+    return 100.0 * (new - old) / old
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark runs")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--cpu", type=float, default=10.0, help="allowed cpu_avg_us growth in percent")
+    args = parser.parse_args()
+
+    base = read_bench(args.baseline)
+    curr = read_bench(args.current)
+
+    regressions = 0
+    print("%-28s %-10s %6s  %-12s %10s %10s %8s" % ("case", "param", "value", "metric", "baseline", "current", "change"))
+
+    for key in sorted(base.keys() | curr.keys()):
+        name = "%-28s %-10s %6s" % key
+        if key not in curr:
+            print("%s  missing from current run" % name)
+            regressions += 1
+            continue
+        if key not in base:
+            print("%s  new case" % name)
+            continue
+
+        old = base[key]
+        new = curr[key]
+        for metric in ("cpu_avg_us",) + COUNTED:
+            if metric not in old or metric not in new or old[metric] == new[metric]:
+                continue
+            pct = change(old[metric], new[metric])
+            bad = pct > args.cpu if metric == "cpu_avg_us" else new[metric] > old[metric]
+            if metric == "cpu_avg_us" and not bad and pct > -args.cpu:
+                continue
+            regressions += bad
+            print("%s  %-12s %10.2f %10.2f %7.1f%%%s" % (name, metric, old[metric], new[metric], pct, "  REGRESSION" if bad else ""))
+
+    print("\n%d regression(s)" % regressions)
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,341 @@
+#!/usr/bin/env python3
+"""
+Golden frame test for the examples, run on the host build (c/host).
+
+Every scene in tools/golden/scenes.json is played from its input script
+(tools/golden/<scene>.txt, see input_rec.py) through the host rasterizer.
+The listed frames are compared against the PNGs in tools/golden and the
+capture log is checked against the scene's budgets:
+
+  - a pixel differs when any channel is off by more than --tolerance, a
+    frame fails when more than --max-diff of its pixels differ, a diff
+    image is written next to the output
+  - tris and verts are the per frame maximum over the frames from
+    measure_from on and fail the test when over budget
+  - cpu_ms is the average host CPU time per frame over the same frames,
+    the median of --cpu-runs plays of the scene. Its budget is a reference
+    from an idle host and only warns when the median is more than
+    --cpu-slack times it, since a loaded machine, a DEBUG=1 build or
+    another CPU is slower with no regression. --cpu-strict makes it fail
+
+With --heatmap the overdraw of every scene is reported too, from the writes
+per pixel of the host rasterizer: mean writes per touched pixel, the most
+writes to one pixel and the share of touched pixels written more than
+twice, over the frames from measure_from on. A color mapped heatmap of each
+listed frame is saved as <scene>_heat_<frame>.png in the output, blue is one
+write, then green, yellow, orange, red, magenta and white for 8 or more.
+
+With --fixed the host build with the s16.16 geometry math is run instead
+(make -C c/host POINT_FIXED=1, see c/fixed.h) against the same goldens, so
+what the fixed point math moves shows as differing pixels.
+
+A scene plays tools/golden/<scene>.txt unless it names another "script",
+and its "env" is added to the environment of the host build, so one script
+can be checked under another budget or quality.
+
+The host rasterizer approximates the RDP, goldens are only comparable with
+other host runs. Text is not drawn. Budgets of 0 are not checked.
+
+Usage: golden_test.py [scene ...] [--update] [--heatmap] [--fixed] [--cpu-runs N] [--cpu-slack X] [--cpu-strict] [--out DIR] [--host PATH]
+Exits with 1 when any frame or budget fails.
+"""
+
+import argparse
+import json
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import zlib
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, TOOLS)
+
+import input_rec  # noqa: E402
+import rdpcap_report  # noqa: E402
+
+GOLDEN = os.path.join(TOOLS, "golden")
+HOST = os.path.join(TOOLS, "..", "c", "host", "build", "2d_shapes_host")
+HOST_FIXED = os.path.join(TOOLS, "..", "c", "host", "build_fixed", "2d_shapes_host")
+
+
+# ====~ Images ~==== #
+
+def read_ppm(path):
+    with open(path, "rb") as fp:
+        data = fp.read()
+    # P6, width, height and max value separated by whitespace, then the pixels
+    fields = data.split(maxsplit=4)
+    if fields[0] != b"P6" or fields[3] != b"255":
+        sys.exit("%s is not an 8-bit PPM" % path)
+    return int(fields[1]), int(fields[2]), fields[4]
+
+
+def write_png(path, width, height, rgb):
+    rows = b"".join(b"\0" + rgb[y * width * 3:(y + 1) * width * 3] for y in range(height))
+
+    def chunk(kind, body):
+        return struct.pack(">I", len(body)) + kind + body + struct.pack(">I", zlib.crc32(kind + body))
+
+    with open(path, "wb") as fp:
+        fp.write(b"\x89PNG\r\n\x1a\n")
+        fp.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0)))
+        fp.write(chunk(b"IDAT", zlib.compress(rows, 9)))
+        fp.write(chunk(b"IEND", b""))
+
+
+def read_png(path):
+    with open(path, "rb") as fp:
+        data = fp.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        sys.exit("%s is not a PNG" % path)
+    pos = 8
+    idat = b""
+    width = height = 0
+    while pos < len(data):
+        length, kind = struct.unpack_from(">I4s", data, pos)
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", body)
+            if depth != 8 or color != 2 or interlace:
+                sys.exit("%s: only 8-bit RGB PNGs written by this script are supported" % path)
+        elif kind == b"IDAT":
+            idat += body
+    raw = zlib.decompress(idat)
+
+    # Undo the per row filters
+    stride = width * 3
+    rgb = bytearray()
+    prev = bytearray(stride)
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        row = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = row[i - 3] if i >= 3 else 0
+            b = prev[i]
+            c = prev[i - 3] if i >= 3 else 0
+            if kind == 1:
+                row[i] = (row[i] + a) & 0xFF
+            elif kind == 2:
+                row[i] = (row[i] + b) & 0xFF
+            elif kind == 3:
+                row[i] = (row[i] + (a + b) // 2) & 0xFF
+            elif kind == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+                row[i] = (row[i] + pred) & 0xFF
+        rgb += row
+        prev = row
+    return width, height, bytes(rgb)
+
+
+def compare(expected, actual, tolerance):
+    """Returns the number of differing pixels and a diff image, red where they differ"""
+    diff = bytearray(len(actual))
+    count = 0
+    for i in range(0, len(actual), 3):
+        if max(abs(expected[i + c] - actual[i + c]) for c in range(3)) > tolerance:
+            count += 1
+            diff[i] = 255
+        else:
+            grey = actual[i] // 4
+            diff[i] = diff[i + 1] = diff[i + 2] = grey
+    return count, bytes(diff)
+
+
+# ====~ Scenes ~==== #
+
+def run_scene(host, name, scene, out, heatmap):
+    os.makedirs(out, exist_ok=True)
+    rec = os.path.join(out, name + ".rec")
+    runs = input_rec.parse_script(os.path.join(GOLDEN, scene.get("script", name) + ".txt"))
+    with open(rec, "wb") as fp:
+        fp.write(b"INPR" + struct.pack(">HI", input_rec.VERSION, input_rec.SEED))
+        for run in runs:
+            fp.write(struct.pack(">BHbb", *run))
+
+    # One frame past the last dump, the capture record of a frame is written after it is shown
+    env = dict(os.environ)
+    env.update({
+        "INPUT_REPLAY": os.path.abspath(rec),
+        "HOST_FRAMES": str(max(scene["frames"]) + 2),
+        "HOST_DUMP": os.path.abspath(out),
+        "HOST_DUMP_FRAMES": ",".join(str(f) for f in scene["frames"]),
+    })
+    env.pop("INPUT_RECORD", None)
+    env.pop("HOST_STREAM", None)
+    env.pop("HOST_HEATMAP", None)
+    if heatmap:
+        env["HOST_HEATMAP"] = os.path.abspath(out)
+    env.update({k: str(v) for k, v in scene.get("env", {}).items()})
+    result = subprocess.run([os.path.abspath(host)], cwd=out, env=env,
+                            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    if result.returncode != 0:
+        print("%s: host build exited with %d" % (name, result.returncode))
+        return None
+
+    capture = os.path.join(out, name + ".rdpcap")
+    os.replace(os.path.join(out, "rdpcap.bin"), capture)
+    with open(capture, "rb") as fp:
+        return rdpcap_report.read_rcap(fp.read())
+
+
+def check_frames(name, scene, out, args):
+    failures = 0
+    for frame in scene["frames"]:
+        ppm = os.path.join(out, "frame_%04d.ppm" % frame)
+        golden = os.path.join(GOLDEN, "%s_%04d.png" % (name, frame))
+        if not os.path.exists(ppm):
+            print("  frame %4d  missing from the output" % frame)
+            failures += 1
+            continue
+        width, height, actual = read_ppm(ppm)
+        os.replace(ppm, os.path.join(out, "%s_%04d.ppm" % (name, frame)))
+
+        if args.update:
+            write_png(golden, width, height, actual)
+            print("  frame %4d  updated" % frame)
+            continue
+        if not os.path.exists(golden):
+            print("  frame %4d  no golden, run with --update" % frame)
+            failures += 1
+            continue
+
+        gw, gh, expected = read_png(golden)
+        if (gw, gh) != (width, height):
+            print("  frame %4d  size %dx%d, golden is %dx%d" % (frame, width, height, gw, gh))
+            failures += 1
+            continue
+        count, diff = compare(expected, actual, args.tolerance)
+        share = count / float(width * height)
+        bad = share > args.max_diff
+        print("  frame %4d  %6d pixels differ (%.3f%%)%s" % (frame, count, 100.0 * share, "  FAIL" if bad else ""))
+        if bad:
+            write_png(os.path.join(out, "%s_%04d_diff.png" % (name, frame)), width, height, diff)
+            failures += 1
+    return failures
+
+
+def measured_frames(scene, cap):
+    return [f for f in cap.frames if f["frame"] >= scene.get("measure_from", 0)]
+
+
+def check_budget(name, scene, caps, args):
+    """caps holds the capture of every play of the scene, tris and verts come from the first"""
+    frames = measured_frames(scene, caps[0])
+    if not frames:
+        print("  no frames to measure")
+        return 1
+
+    cap = caps[0]
+    tris = max(sum(f["cmds"][i] for i, c in enumerate(cap.cmds) if c[0] in rdpcap_report.TRI_CMDS) for f in frames)
+    verts = max(sum(f["cmds"][i] * (1 if c[0] == "fan_vtx" else 3)
+                    for i, c in enumerate(cap.cmds) if c[0] in rdpcap_report.TRI_CMDS[:3] + ("fan_vtx",)) for f in frames)
+    runs = sorted(sum(f["cpuTicks"] for f in measured_frames(scene, c)) * 1000.0 / rdpcap_report.TICKS_PER_SECOND /
+                  len(measured_frames(scene, c)) for c in caps)
+    cpu_ms = runs[len(runs) // 2]
+
+    failures = 0
+    budget = scene.get("budget", {})
+    for metric, value in (("tris", tris), ("verts", verts)):
+        limit = budget.get(metric, 0)
+        bad = limit and value > limit
+        failures += 1 if bad else 0
+        print("  %-6s %10.3f / %s%s" % (metric, value, limit if limit else "-", "  OVER BUDGET" if bad else ""))
+
+    # Host CPU time depends on the machine and its load, only far over the reference counts
+    limit = budget.get("cpu_ms", 0)
+    slow = limit and cpu_ms > limit * args.cpu_slack
+    note = ""
+    if slow:
+        failures += 1 if args.cpu_strict else 0
+        note = "  OVER BUDGET" if args.cpu_strict else "  over %gx the reference (warning)" % args.cpu_slack
+    print("  %-6s %10.3f / %s%s%s" % ("cpu_ms", cpu_ms, limit if limit else "-",
+                                      "  median of %d" % len(runs) if len(runs) > 1 else "", note))
+    return failures
+
+
+def check_heat(name, scene, out):
+    path = os.path.join(out, "heat.csv")
+    if not os.path.exists(path):
+        print("  no heat.csv in the output")
+        return 1
+    with open(path) as fp:
+        header = fp.readline().strip().split(",")
+        rows = [dict(zip(header, map(float, line.split(",")))) for line in fp if line.strip()]
+    rows = [r for r in rows if r["frame"] >= scene.get("measure_from", 0)]
+    touched = sum(r["touched"] for r in rows)
+    if not touched:
+        print("  overdraw: nothing drawn")
+        return 0
+    writes = sum(r["writes"] for r in rows)
+    over2 = sum(r["touched"] * r["over2_pct"] / 100.0 for r in rows)
+    print("  overdraw  mean %.2f  max %d  >2 writes %.1f%% of touched pixels" % (
+        writes / touched, max(r["max"] for r in rows), 100.0 * over2 / touched))
+
+    for frame in scene["frames"]:
+        ppm = os.path.join(out, "heat_%04d.ppm" % frame)
+        if os.path.exists(ppm):
+            width, height, rgb = read_ppm(ppm)
+            write_png(os.path.join(out, "%s_heat_%04d.png" % (name, frame)), width, height, rgb)
+            os.remove(ppm)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Golden frame and budget test on the host build")
+    parser.add_argument("scenes", nargs="*", help="scenes to run, all by default")
+    parser.add_argument("--update", action="store_true", help="write the output as the new goldens")
+    parser.add_argument("--heatmap", action="store_true", help="report overdraw and save heatmaps of the listed frames")
+    parser.add_argument("--tolerance", type=int, default=8, help="allowed difference per channel")
+    parser.add_argument("--max-diff", type=float, default=0.001, help="allowed share of differing pixels")
+    parser.add_argument("--out", help="folder for the output, a temporary one by default")
+    parser.add_argument("--fixed", action="store_true", help="run the fixed point build against the float goldens")
+    parser.add_argument("--host", help="host build of the examples")
+    parser.add_argument("--cpu-runs", type=int, default=3, help="plays of every scene cpu_ms is the median of")
+    parser.add_argument("--cpu-slack", type=float, default=3.0, help="times the cpu_ms budget the median may take before it warns")
+    parser.add_argument("--cpu-strict", action="store_true", help="fail instead of warn when cpu_ms is over budget")
+    args = parser.parse_args()
+
+    if args.fixed and args.update:
+        sys.exit("The goldens come from the float build, --update does not go with --fixed")
+    args.host = args.host or (HOST_FIXED if args.fixed else HOST)
+    if not os.path.exists(args.host):
+        sys.exit("%s not found, build it with: make -C c/host%s" % (args.host, " POINT_FIXED=1" if args.fixed else ""))
+
+    with open(os.path.join(GOLDEN, "scenes.json")) as fp:
+        scenes = {k: v for k, v in json.load(fp).items() if not k.startswith("_")}
+    names = args.scenes or list(scenes)
+    out = args.out or tempfile.mkdtemp(prefix="golden_")
+
+    failures = 0
+    for name in names:
+        if name not in scenes:
+            sys.exit("Unknown scene %s, see %s" % (name, os.path.join(GOLDEN, "scenes.json")))
+        print(name)
+        scene_out = os.path.join(out, name)
+        cap = run_scene(args.host, name, scenes[name], scene_out, args.heatmap)
+        if cap is None:
+            failures += 1
+            continue
+        failures += check_frames(name, scenes[name], scene_out, args)
+
+        # More plays only for the CPU time, their frames are not compared
+        caps = [cap]
+        for run in range(1, max(args.cpu_runs, 1)):
+            extra = run_scene(args.host, name, scenes[name], os.path.join(scene_out, "cpu_%d" % run), False)
+            if extra is not None:
+                caps.append(extra)
+        failures += check_budget(name, scenes[name], caps, args)
+        if args.heatmap:
+            failures += check_heat(name, scenes[name], scene_out)
+
+    print("\n%d failure(s), output in %s" % (failures, out))
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+Read and write joypad recordings made by c/input.c.
+
+  input_rec.py dump <file.rec>
+      Print one line per run: frames, held buttons, stick.
+
+  input_rec.py make <script.txt> <file.rec>
+      Build a recording from a text script, one run per line:
+
+          # comment
+          60                 # 60 frames of no input
+          30 stick 80 0      # 30 frames holding the stick right
+          1 L                # press L for one frame
+          20 A Z stick 0 -40 # buttons and stick together
+
+      Scripted recordings give the same input on every run, for benchmarks
+      and the golden frame tests.
+"""
+
+import struct
+import sys
+
+VERSION = 1
+SEED = 1
+
+# INPUT_BUTTONS in c/input.h
+BUTTONS = {
+    "A": 1 << 0,
+    "B": 1 << 1,
+    "Z": 1 << 2,
+    "START": 1 << 3,
+    "D_UP": 1 << 4,
+    "D_DOWN": 1 << 5,
+    "D_LEFT": 1 << 6,
+    "D_RIGHT": 1 << 7,
+    "L": 1 << 8,
+    "R": 1 << 9,
+    "C_UP": 1 << 10,
+    "C_DOWN": 1 << 11,
+    "C_LEFT": 1 << 12,
+    "C_RIGHT": 1 << 13,
+}
+
+
+def read_runs(path):
+    with open(path, "rb") as fp:
+        data = fp.read()
+    if data[:4] != b"INPR":
+        sys.exit("%s is not an input recording" % path)
+    version, seed = struct.unpack_from(">HI", data, 4)
+    runs = []
+    pos = 10
+    while pos + 5 <= len(data):
+        runs.append(struct.unpack_from(">BHbb", data, pos))
+        pos += 5
+    return version, seed, runs
+
+
+def dump(path):
+    version, seed, runs = read_runs(path)
+    print("# version %d, seed %d, %d frames" % (version, seed, sum(r[0] for r in runs)))
+    for frames, held, x, y in runs:
+        names = [name for name, bit in BUTTONS.items() if held & bit]
+        line = [str(frames)] + names
+        if x or y:
+            line += ["stick", str(x), str(y)]
+        print(" ".join(line))
+
+
+def parse_script(path):
+    runs = []
+    with open(path) as fp:
+        for number, line in enumerate(fp, 1):
+            line = line.split("#")[0].split()
+            if not line:
+                continue
+            frames = int(line[0])
+            held, x, y = 0, 0, 0
+            i = 1
+            while i < len(line):
+                word = line[i].upper()
+                if word == "STICK":
+                    x, y = int(line[i + 1]), int(line[i + 2])
+                    i += 3
+                    continue
+                if word not in BUTTONS:
+                    sys.exit("%s:%d: unknown button %s" % (path, number, line[i]))
+                held |= BUTTONS[word]
+                i += 1
+            if not -128 <= x <= 127 or not -128 <= y <= 127:
+                sys.exit("%s:%d: stick out of range" % (path, number))
+            # Runs hold at most 255 frames
+            while frames > 0:
+                n = min(frames, 255)
+                runs.append((n, held, x, y))
+                frames -= n
+    return runs
+
+
+def make(script, out):
+    runs = parse_script(script)
+    with open(out, "wb") as fp:
+        fp.write(b"INPR" + struct.pack(">HI", VERSION, SEED))
+        for run in runs:
+            fp.write(struct.pack(">BHbb", *run))
+    print("%s: %d frames in %d runs" % (out, sum(r[0] for r in runs), len(runs)))
+
+
+def main():
+    if len(sys.argv) == 3 and sys.argv[1] == "dump":
+        dump(sys.argv[2])
+    elif len(sys.argv) == 4 and sys.argv[1] == "make":
+        make(sys.argv[2], sys.argv[3])
+    else:
+        sys.exit(__doc__)
+
+
+if __name__ == "__main__":
+    main()
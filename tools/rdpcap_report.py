@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+"""
+Offline report for RSPQ/RDP captures.
+
+Reads either a capture log written by c/rdpcap.c ("RCAP", console or host
+build with RDPCAP=1) or a command stream recorded by the host stand-in
+("HSTR", c/host/host.c with HOST_STREAM set) and prints:
+
+  - command counts and bytes per frame
+  - RSPQ bandwidth per draw call, largest first
+  - RSP overlay and RDP busy time (RCAP logs built with RSPQ_PROFILE=1)
+
+Usage: rdpcap_report.py <file> [--csv] [--skip N]
+"""
+
+import argparse
+import struct
+import sys
+
+TICKS_PER_SECOND = 93750000 // 2
+
+# Same table as capCmdInfo in c/rdpcap.c, RCAP logs carry their own copy
+DEFAULT_CMDS = [
+    ("tri", 88, 32),
+    ("tri_shade", 88, 96),
+    ("tri_tex", 88, 96),
+    ("tri_shade_tex", 88, 160),
+    ("fan_vtx", 28, 0),
+    ("fan_tri", 4, 32),
+    ("fan_tri_shade", 4, 96),
+    ("fan_tri_tex", 4, 96),
+    ("fan_tri_shade_tex", 4, 160),
+    ("sync_pipe", 8, 8),
+    ("sync_tile", 8, 8),
+    ("sync_load", 8, 8),
+    ("prim_color", 8, 8),
+    ("mode_standard", 16, 16),
+    ("combiner", 16, 16),
+    ("blender", 8, 16),
+    ("mode_fill", 24, 24),
+    ("mode_push", 8, 0),
+    ("mode_pop", 8, 16),
+    ("clear", 48, 48),
+    ("clear_z", 64, 64),
+    ("rect", 8, 8),
+    ("tex_load", 40, 40),
+]
+
+DEFAULT_TAGS = [
+    "state",
+    "draw_circle",
+    "draw_line",
+    "draw_quad",
+    "draw_fan",
+    "draw_strip",
+    "draw_indexed_triangles",
+    "draw_bezier_curve",
+    "draw_filled_beziers",
+    "draw_filled_bezier_shape",
+    "fill_edge_ellipse_to_line",
+    "draw_snake_shape",
+]
+
+TRI_CMDS = ("tri", "tri_shade", "tri_tex", "tri_shade_tex", "fan_tri", "fan_tri_shade", "fan_tri_tex", "fan_tri_shade_tex")
+
+# HOST_OPS in c/host/host.h
+HOST_OP_ATTACH = 1
+HOST_OP_SHOW = 2
+HOST_OP_CLEAR = 3
+HOST_OP_CLEAR_Z = 4
+HOST_OP_MODE_STANDARD = 5
+HOST_OP_COMBINER = 6
+HOST_OP_BLENDER = 7
+HOST_OP_PRIM_COLOR = 8
+HOST_OP_SYNC_PIPE = 9
+HOST_OP_SYNC_TILE = 10
+HOST_OP_SYNC_LOAD = 11
+HOST_OP_TRIANGLE = 12
+HOST_OP_RSPQ = 13
+HOST_OP_SPRITE_UPLOAD = 14
+HOST_OP_TEXT = 15
+HOST_OP_MODE_FILL = 16
+HOST_OP_MODE_PUSH = 17
+HOST_OP_MODE_POP = 18
+HOST_OP_FILL_RECTANGLE = 19
+
+RDPQ_CMD_TRIANGLE = 0x1E
+RDPQ_CMD_TRIANGLE_DATA = 0x1F
+
+HOST_OP_CMD = {
+    HOST_OP_CLEAR: "clear",
+    HOST_OP_CLEAR_Z: "clear_z",
+    HOST_OP_MODE_STANDARD: "mode_standard",
+    HOST_OP_COMBINER: "combiner",
+    HOST_OP_BLENDER: "blender",
+    HOST_OP_PRIM_COLOR: "prim_color",
+    HOST_OP_SYNC_PIPE: "sync_pipe",
+    HOST_OP_SYNC_TILE: "sync_tile",
+    HOST_OP_SYNC_LOAD: "sync_load",
+    HOST_OP_MODE_FILL: "mode_fill",
+    HOST_OP_MODE_PUSH: "mode_push",
+    HOST_OP_MODE_POP: "mode_pop",
+    HOST_OP_FILL_RECTANGLE: "rect",
+    HOST_OP_SPRITE_UPLOAD: "tex_load",
+}
+
+
+class Capture:
+    def __init__(self, cmds, tags):
+        self.cmds = cmds          # [(name, rspqBytes, rdpBytes)]
+        self.tags = tags          # [name]
+        self.slots = []           # RSP overlay names
+        self.frames = []          # dicts, see new_frame
+
+    def new_frame(self, number):
+        return {
+            "frame": number,
+            "cmds": [0] * len(self.cmds),
+            "tagBytes": [0] * len(self.tags),
+            "tagTris": [0] * len(self.tags),
+            "rcpTicks": 0,
+            "rdpBusy": 0,
+            "cpuTicks": 0,
+            "slots": {},
+        }
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def left(self):
+        return len(self.data) - self.pos
+
+    def take(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.left() < size:
+            raise EOFError
+        values = struct.unpack_from(fmt, self.data, self.pos)
+        self.pos += size
+        return values if len(values) > 1 else values[0]
+
+    def string(self):
+        length = self.take(">B")
+        if self.left() < length:
+            raise EOFError
+        s = self.data[self.pos:self.pos + length].decode("ascii", "replace")
+        self.pos += length
+        return s
+
+
+def read_rcap(data):
+    r = Reader(data)
+    r.take(">4s")
+    version = r.take(">H")
+    if version not in (1, 2):
+        sys.exit("Unsupported RCAP version %d" % version)
+    cmd_count = r.take(">B")
+    tag_count = r.take(">B")
+    cmds = []
+    for _ in range(cmd_count):
+        name = r.string()
+        rspq, rdp = r.take(">HH")
+        cmds.append((name, rspq, rdp))
+    tags = [r.string() for _ in range(tag_count)]
+    cap = Capture(cmds, tags)
+
+    # The log may end mid record if the console was switched off
+    try:
+        while r.left() > 0:
+            kind = chr(r.take(">B"))
+            if kind == "S":
+                cap.slots = [r.string() for _ in range(r.take(">B"))]
+            elif kind == "F":
+                f = cap.new_frame(r.take(">I"))
+                f["rcpTicks"], f["rdpBusy"] = r.take(">II")
+                # Version 2 adds the CPU time of the frame
+                if version >= 2:
+                    f["cpuTicks"] = r.take(">I")
+                f["cmds"] = [r.take(">H") for _ in range(cmd_count)]
+                for i in range(tag_count):
+                    f["tagBytes"][i], f["tagTris"][i] = r.take(">IH")
+                for _ in range(r.take(">B")):
+                    idx, ticks = r.take(">BI")
+                    f["slots"][idx] = ticks
+                cap.frames.append(f)
+            else:
+                print("Unknown record '%s' at %d, stopping" % (kind, r.pos - 1), file=sys.stderr)
+                break
+    except EOFError:
+        pass
+    return cap
+
+
+def read_hstr(data):
+    r = Reader(data)
+    r.take(">4s")
+    version, width, height = r.take(">HHH")
+    if version != 1:
+        sys.exit("Unsupported HSTR version %d" % version)
+    cap = Capture(DEFAULT_CMDS, DEFAULT_TAGS)
+    index = {c[0]: i for i, c in enumerate(cap.cmds)}
+    frame = cap.new_frame(0)
+
+    def count(name, tag):
+        i = index[name]
+        frame["cmds"][i] += 1
+        if tag < len(cap.tags):
+            frame["tagBytes"][tag] += cap.cmds[i][1]
+            if name in TRI_CMDS:
+                frame["tagTris"][tag] += 1
+
+    try:
+        while r.left() > 0:
+            op, tag, length = r.take(">BBH")
+            payload = Reader(data[r.pos:r.pos + length])
+            r.pos += length
+            if op == HOST_OP_SHOW:
+                cap.frames.append(frame)
+                frame = cap.new_frame(frame["frame"] + 1)
+            elif op in HOST_OP_CMD:
+                count(HOST_OP_CMD[op], tag)
+            elif op == HOST_OP_TRIANGLE:
+                pos, shade, tex, z = payload.take(">BBBB")
+                if tex != 0xFF:
+                    count("tri_shade_tex" if shade != 0xFF else "tri_tex", tag)
+                elif shade != 0xFF:
+                    count("tri_shade", tag)
+                else:
+                    count("tri", tag)
+            elif op == HOST_OP_RSPQ:
+                _, cmd = payload.take(">II")
+                if cmd == RDPQ_CMD_TRIANGLE_DATA:
+                    count("fan_vtx", tag)
+                elif cmd == RDPQ_CMD_TRIANGLE:
+                    # The shade and texture bits of the triangle command id, see rdpcap_fan_tri_cmd
+                    arg = payload.take(">I") if payload.left() >= 4 else 0
+                    name = "fan_tri" + ("_shade" if arg & 0x400 else "") + ("_tex" if arg & 0x200 else "")
+                    count(name, tag)
+    except EOFError:
+        pass
+    return cap
+
+
+def frame_bytes(cap, f, column):
+    return sum(n * cap.cmds[i][column] for i, n in enumerate(f["cmds"]))
+
+
+def report(cap, csv):
+    frames = cap.frames
+    n = len(frames)
+    if n == 0:
+        sys.exit("No complete frames in capture")
+
+    if csv:
+        names = [c[0] for c in cap.cmds]
+        print("frame,rspq_bytes,rdp_bytes,cpu_ticks,rcp_ticks,rdp_busy," + ",".join(names))
+        for f in frames:
+            print("%d,%d,%d,%d,%d,%d,%s" % (f["frame"], frame_bytes(cap, f, 1), frame_bytes(cap, f, 2), f["cpuTicks"],
+                                            f["rcpTicks"], f["rdpBusy"], ",".join(str(c) for c in f["cmds"])))
+        return
+
+    rspq = [frame_bytes(cap, f, 1) for f in frames]
+    rdp = [frame_bytes(cap, f, 2) for f in frames]
+    print("Frames: %d" % n)
+    print("RSPQ bytes/frame: avg %.0f, min %d, max %d" % (sum(rspq) / n, min(rspq), max(rspq)))
+    print("RDP bytes/frame:  avg %.0f, min %d, max %d" % (sum(rdp) / n, min(rdp), max(rdp)))
+    cpu = [f["cpuTicks"] * 1000.0 / TICKS_PER_SECOND for f in frames]
+    if any(cpu):
+        print("CPU ms/frame:     avg %.2f, min %.2f, max %.2f" % (sum(cpu) / n, min(cpu), max(cpu)))
+
+    print("\nCommands per frame")
+    print("  %-17s %10s %12s %12s" % ("command", "count", "rspq bytes", "rdp bytes"))
+    for i, (name, rspq_size, rdp_size) in enumerate(cap.cmds):
+        total = sum(f["cmds"][i] for f in frames)
+        if total == 0:
+            continue
+        avg = total / n
+        print("  %-17s %10.1f %12.0f %12.0f" % (name, avg, avg * rspq_size, avg * rdp_size))
+
+    print("\nRSPQ bandwidth per draw call")
+    tag_bytes = [sum(f["tagBytes"][i] for f in frames) for i in range(len(cap.tags))]
+    tag_tris = [sum(f["tagTris"][i] for f in frames) for i in range(len(cap.tags))]
+    total_bytes = sum(tag_bytes) or 1
+    order = sorted(range(len(cap.tags)), key=lambda i: tag_bytes[i], reverse=True)
+    print("  %-28s %8s %10s %8s %10s" % ("draw call", "share", "bytes/fr", "tris/fr", "bytes/tri"))
+    for i in order:
+        if tag_bytes[i] == 0:
+            continue
+        per_tri = tag_bytes[i] / tag_tris[i] if tag_tris[i] else 0
+        print("  %-28s %7.1f%% %10.0f %8.1f %10.1f" % (cap.tags[i], 100.0 * tag_bytes[i] / total_bytes,
+                                                    tag_bytes[i] / n, tag_tris[i] / n, per_tri))
+
+    rcp = sum(f["rcpTicks"] for f in frames)
+    if rcp == 0:
+        print("\nNo RCP timing, build with RSPQ_PROFILE=1 on console for RSP/RDP busy time")
+        return
+
+    print("\nRCP time over %.1f ms" % (rcp * 1000.0 / TICKS_PER_SECOND))
+    busy = sum(f["rdpBusy"] for f in frames)
+    print("  %-28s %7.1f%%" % ("RDP busy", 100.0 * busy / rcp))
+    slot_totals = {}
+    for f in frames:
+        for idx, ticks in f["slots"].items():
+            slot_totals[idx] = slot_totals.get(idx, 0) + ticks
+    for idx, ticks in sorted(slot_totals.items(), key=lambda s: s[1], reverse=True):
+        name = cap.slots[idx] if idx < len(cap.slots) and cap.slots[idx] else "slot %d" % idx
+        print("  %-28s %7.1f%%" % ("RSP " + name, 100.0 * ticks / rcp))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report on an RCAP capture log or HSTR host stream")
+    parser.add_argument("file")
+    parser.add_argument("--csv", action="store_true", help="per frame CSV instead of the summary")
+    parser.add_argument("--skip", type=int, default=0, help="frames to skip at the start (loading, warm up)")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as fp:
+        data = fp.read()
+
+    magic = data[:4]
+    if magic == b"RCAP":
+        cap = read_rcap(data)
+    elif magic == b"HSTR":
+        cap = read_hstr(data)
+    else:
+        sys.exit("%s is not an RCAP log or HSTR stream" % args.file)
+
+    cap.frames = cap.frames[args.skip:]
+    report(cap, args.csv)
+
+
+if __name__ == "__main__":
+    main()